@@ -0,0 +1,66 @@
+# Checks the per-client snapshot rate over loopback: one load_gen bot
+# connects directly, another one through crapnet which drops packets after
+# a warmup. The lossy client must step down while the clean one keeps the
+# full rate, as shown by the status command over the econ.
+#
+# usage: python3 scripts/snap_rate_loopback.py [build_dir] [loss_percent]
+
+import re, socket, subprocess, sys, time
+
+build_dir = sys.argv[1] if len(sys.argv) > 1 else "."
+loss = sys.argv[2] if len(sys.argv) > 2 else "15"
+
+port = 8390
+econ_port = 8391
+crapnet_port = 8392
+password = "snaprate"
+warmup = 15
+duration = 45
+
+def econ_status():
+	s = socket.create_connection(("127.0.0.1", econ_port))
+	time.sleep(0.3)
+	s.sendall((password + "\nstatus\n").encode())
+	time.sleep(0.5)
+	s.settimeout(0.5)
+	data = b""
+	try:
+		while True:
+			chunk = s.recv(65536)
+			if not chunk:
+				break
+			data += chunk
+	except socket.timeout:
+		pass
+	s.close()
+	rates = {}
+	for m in re.finditer(r"\[ip=([^\]]+)\].*\[snaprate=(\d+)\]", data.decode(errors="replace")):
+		rates[m.group(1)] = int(m.group(2))
+	return rates
+
+def run(cmd):
+	return subprocess.Popen(cmd, cwd=build_dir, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+server = run(["./Infclass-Server", "sv_port %d; sv_register 0; sv_max_clients_per_ip 64; inf_captcha 0; ec_port %d; ec_password %s" % (port, econ_port, password)])
+time.sleep(3)
+crapnet = run(["./crapnet", "-p", str(crapnet_port), "-a", "127.0.0.1:%d" % port, "-l", loss, "-b", "10", "-w", str(warmup)])
+time.sleep(1)
+bots = [
+	run(["./load_gen", "-a", "127.0.0.1:%d" % crapnet_port, "-n", "1", "-d", str(duration)]),
+	run(["./load_gen", "-a", "127.0.0.1:%d" % port, "-n", "1", "-d", str(duration)]),
+]
+
+try:
+	time.sleep(warmup + 20)
+	rates = econ_status()
+finally:
+	for p in bots + [crapnet, server]:
+		p.kill()
+
+lossy = rates.get("127.0.0.1:%d" % crapnet_port)
+clean = [r for addr, r in rates.items() if addr != "127.0.0.1:%d" % crapnet_port]
+print("lossy client: %s Hz, clean clients: %s Hz" % (lossy, clean))
+if lossy is None or not clean or lossy >= min(clean):
+	print("FAILED")
+	sys.exit(1)
+print("OK")
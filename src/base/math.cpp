@@ -4,6 +4,12 @@ static std::random_device RandomDevice;
 static std::mt19937 RandomEngine(RandomDevice());
 static std::uniform_real_distribution<float> DistributionFloat(0.0f, 1.0f);
 
+void random_seed(unsigned Seed)
+{
+	RandomEngine.seed(Seed);
+	DistributionFloat.reset();
+}
+
 float random_float()
 {
 	return DistributionFloat(RandomEngine);
@@ -33,6 +33,7 @@ constexpr inline T mix(const T a, const T b, TB amount)
 	return a + (b - a) * amount;
 }
 
+void random_seed(unsigned Seed);
 float random_float();
 bool random_prob(float f);
 int random_int(int Min, int Max);
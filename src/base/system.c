@@ -31,6 +31,7 @@
 #include <netinet/in.h>
 #include <pthread.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 
 #include <dirent.h>
@@ -290,6 +291,73 @@ IOHANDLE io_open(const char *filename, int flags)
 	return 0x0;
 }
 
+static void *io_map_file_impl(const char *filename, unsigned *size, int copy_on_write)
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	HANDLE file, mapping;
+	LARGE_INTEGER length;
+	void *data = 0;
+
+	*size = 0;
+	file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+		return 0;
+	if(GetFileSizeEx(file, &length) && length.QuadPart > 0 && length.HighPart == 0)
+	{
+		mapping = CreateFileMappingA(file, NULL, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+		if(mapping)
+		{
+			data = MapViewOfFile(mapping, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+			if(data)
+				*size = length.LowPart;
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+	return data;
+#else
+	struct stat st;
+	void *data = 0;
+	int fd;
+
+	*size = 0;
+	fd = open(filename, O_RDONLY);
+	if(fd < 0)
+		return 0;
+	if(fstat(fd, &st) == 0 && st.st_size > 0 && (unsigned long long)st.st_size <= 0xffffffffu)
+	{
+		data = mmap(0, st.st_size, copy_on_write ? PROT_READ|PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+		if(data == MAP_FAILED)
+			data = 0;
+		else
+			*size = (unsigned)st.st_size;
+	}
+	close(fd);
+	return data;
+#endif
+}
+
+void *io_map_file(const char *filename, unsigned *size)
+{
+	return io_map_file_impl(filename, size, 0);
+}
+
+void *io_map_file_private(const char *filename, unsigned *size)
+{
+	return io_map_file_impl(filename, size, 1);
+}
+
+void io_unmap_file(void *data, unsigned size)
+{
+	if(!data)
+		return;
+#if defined(CONF_FAMILY_WINDOWS)
+	UnmapViewOfFile(data);
+#else
+	munmap(data, size);
+#endif
+}
+
 unsigned io_read(IOHANDLE io, void *buffer, unsigned size)
 {
 	return fread(buffer, 1, size, (FILE *)io);
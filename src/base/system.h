@@ -299,6 +299,53 @@ long int io_length(IOHANDLE io);
 */
 int io_close(IOHANDLE io);
 
+/*
+	Function: io_map_file
+		Maps a whole file read only into memory.
+
+	Parameters:
+		filename - File to map.
+		size - Receives the size of the file.
+
+	Returns:
+		Returns a pointer to the file data, 0 on error or for empty files.
+
+	Remarks:
+		- The data stays valid until <io_unmap_file> is called, the file can
+		  be closed or replaced in the meantime.
+*/
+void *io_map_file(const char *filename, unsigned *size);
+
+/*
+	Function: io_map_file_private
+		Maps a whole file copy on write into memory.
+
+	Parameters:
+		filename - File to map.
+		size - Receives the size of the file.
+
+	Returns:
+		Returns a pointer to the file data, 0 on error or for empty files.
+
+	Remarks:
+		- The data can be written, changed pages are copied and never
+		  written back to the file.
+		- Same lifetime as <io_map_file>. Pages that were not written are
+		  read from the file on access, the file must not be truncated
+		  while it is mapped.
+*/
+void *io_map_file_private(const char *filename, unsigned *size);
+
+/*
+	Function: io_unmap_file
+		Releases memory returned by <io_map_file> or <io_map_file_private>.
+
+	Parameters:
+		data - Pointer returned by the mapping function.
+		size - Size returned by the mapping function.
+*/
+void io_unmap_file(void *data, unsigned size);
+
 /*
 	Function: io_flush
 		Empties all buffers and writes all pending data.
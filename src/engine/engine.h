@@ -32,6 +32,7 @@ public:
 	virtual void Init() = 0;
 	virtual void InitLogfile() = 0;
 	virtual void AddJob(std::shared_ptr<IJob> pJob) = 0;
+	CJobPool *JobPool() { return &m_JobPool; }
 	static void RunJobBlocking(IJob *pJob);
 };
 
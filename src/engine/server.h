@@ -160,6 +160,8 @@ public:
 	virtual const char *ClientName(int ClientID) const = 0;
 	virtual const char *ClientClan(int ClientID) const = 0;
 	virtual int ClientCountry(int ClientID) const = 0;
+	// changes with the names, clans and countries of the clients
+	virtual int ClientInfoRevision() const = 0;
 	virtual bool ClientIngame(int ClientID) const = 0;
 	virtual int GetClientInfo(int ClientID, CClientInfo *pInfo) const = 0;
 	virtual void SetClientDDNetVersion(int ClientID, int DDNetVersion) = 0;
@@ -273,6 +275,10 @@ public:
 	virtual int SnapNewID() = 0;
 	virtual void SnapFreeID(int ID) = 0;
 	virtual void *SnapNewItem(int Type, int ID, int Size) = 0;
+	virtual int SnapSize() = 0;
+	// the tick of the previous snapshot of the client or of the demo (-1),
+	// events since then have to go into the snapshot that is built
+	virtual int LastSnapTick(int ClientID) const = 0;
 
 	virtual void SnapSetStaticsize(int ItemType, int Size) = 0;
 
@@ -409,6 +415,7 @@ public:
 	virtual const char *GameType() const = 0;
 	virtual const char *Version() const = 0;
 	virtual const char *NetVersion() const = 0;
+	virtual const char *NetObjName(int Type) const = 0;
 	
 	virtual class CLayers *Layers() = 0;
 	
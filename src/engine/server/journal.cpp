@@ -0,0 +1,360 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <engine/shared/protocol.h>
+
+#include "journal.h"
+
+static const char s_aJournalMagic[] = "infclass-journal";
+
+enum
+{
+	JOURNAL_VERSION = 1,
+	JOURNAL_BLOCK_SIZE = 64*1024,
+};
+
+CJournalWriter::CJournalWriter()
+{
+	m_File = 0;
+	m_pThread = 0;
+	m_Stop = false;
+	m_Lock = lock_create();
+}
+
+CJournalWriter::~CJournalWriter()
+{
+	Stop();
+	lock_destroy(m_Lock);
+}
+
+bool CJournalWriter::Start(IOHANDLE File, const CJournalHeader *pHeader)
+{
+	if(m_File || !File)
+		return false;
+
+	mem_zero(&m_Stream, sizeof(m_Stream));
+	if(deflateInit(&m_Stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+	{
+		io_close(File);
+		return false;
+	}
+
+	m_File = File;
+	m_Stop = false;
+	m_Block.clear();
+	m_Block.reserve(JOURNAL_BLOCK_SIZE);
+	m_Addrs.clear();
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddString(s_aJournalMagic, 0);
+	Packer.AddInt(JOURNAL_VERSION);
+	Packer.AddString(pHeader->m_aNetVersion, 0);
+	Packer.AddString(pHeader->m_aMap, 0);
+	Packer.AddInt(pHeader->m_MapCrc);
+	Packer.AddInt(pHeader->m_Seed);
+	Packer.AddInt(pHeader->m_StartTick);
+	Add(&Packer);
+
+	sphore_init(&m_Semaphore);
+	m_pThread = thread_init(WriterThread, this, "journal writer");
+	return true;
+}
+
+void CJournalWriter::Stop()
+{
+	if(!m_File)
+		return;
+
+	Flush();
+	lock_wait(m_Lock);
+	m_Stop = true;
+	lock_unlock(m_Lock);
+	sphore_signal(&m_Semaphore);
+	thread_wait(m_pThread);
+	m_pThread = 0;
+	sphore_destroy(&m_Semaphore);
+
+	deflateEnd(&m_Stream);
+	io_close(m_File);
+	m_File = 0;
+}
+
+void CJournalWriter::Flush()
+{
+	if(!m_File || m_Block.empty())
+		return;
+
+	lock_wait(m_Lock);
+	m_Queue.push_back(std::vector<unsigned char>());
+	m_Queue.back().swap(m_Block);
+	lock_unlock(m_Lock);
+	sphore_signal(&m_Semaphore);
+
+	m_Block.reserve(JOURNAL_BLOCK_SIZE);
+}
+
+void CJournalWriter::Add(const CPacker *pPacker)
+{
+	if(!m_File)
+		return;
+	m_Block.insert(m_Block.end(), pPacker->Data(), pPacker->Data() + pPacker->Size());
+}
+
+void CJournalWriter::Compress(const unsigned char *pData, int Size, int Flush)
+{
+	unsigned char aOut[16*1024];
+	m_Stream.next_in = (Bytef *)pData;
+	m_Stream.avail_in = Size;
+	do
+	{
+		m_Stream.next_out = aOut;
+		m_Stream.avail_out = sizeof(aOut);
+		deflate(&m_Stream, Flush);
+		io_write(m_File, aOut, sizeof(aOut) - m_Stream.avail_out);
+	}
+	while(m_Stream.avail_out == 0);
+}
+
+void CJournalWriter::WriterThread(void *pUser)
+{
+	CJournalWriter *pSelf = (CJournalWriter *)pUser;
+	std::vector<std::vector<unsigned char> > Blocks;
+
+	while(1)
+	{
+		sphore_wait(&pSelf->m_Semaphore);
+
+		lock_wait(pSelf->m_Lock);
+		Blocks.swap(pSelf->m_Queue);
+		bool Stop = pSelf->m_Stop;
+		lock_unlock(pSelf->m_Lock);
+
+		for(unsigned i = 0; i < Blocks.size(); i++)
+			pSelf->Compress(&Blocks[i][0], Blocks[i].size(), Z_NO_FLUSH);
+		Blocks.clear();
+
+		if(Stop)
+		{
+			pSelf->Compress(0, 0, Z_FINISH);
+			return;
+		}
+	}
+}
+
+void CJournalWriter::Tick(int Tick)
+{
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(JOURNALREC_TICK);
+	Packer.AddInt(Tick);
+	Add(&Packer);
+}
+
+void CJournalWriter::Snap()
+{
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(JOURNALREC_SNAP);
+	Add(&Packer);
+}
+
+void CJournalWriter::Connect(int ClientID, const NETADDR *pAddr)
+{
+	CPacker Packer;
+	Packer.Reset();
+	unsigned Index = 0;
+	while(Index < m_Addrs.size() && !(m_Addrs[Index].type == pAddr->type && mem_comp(m_Addrs[Index].ip, pAddr->ip, sizeof(pAddr->ip)) == 0))
+		Index++;
+	if(Index == m_Addrs.size())
+		m_Addrs.push_back(*pAddr);
+
+	NETADDR Addr;
+	mem_zero(&Addr, sizeof(Addr));
+	Addr.type = NETTYPE_IPV4;
+	Addr.ip[0] = 10;
+	Addr.ip[1] = ((Index+1)>>16)&0xff;
+	Addr.ip[2] = ((Index+1)>>8)&0xff;
+	Addr.ip[3] = (Index+1)&0xff;
+	Addr.port = pAddr->port;
+
+	Packer.AddInt(JOURNALREC_CONNECT);
+	Packer.AddInt(ClientID);
+	Packer.AddRaw(&Addr, sizeof(Addr));
+	Add(&Packer);
+}
+
+void CJournalWriter::Rejoin(int ClientID)
+{
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(JOURNALREC_REJOIN);
+	Packer.AddInt(ClientID);
+	Add(&Packer);
+}
+
+void CJournalWriter::Drop(int ClientID, int Type, const char *pReason)
+{
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(JOURNALREC_DROP);
+	Packer.AddInt(ClientID);
+	Packer.AddInt(Type);
+	Packer.AddString(pReason, 128);
+	Add(&Packer);
+}
+
+void CJournalWriter::Packet(int ClientID, int Flags, const void *pData, int Size)
+{
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(JOURNALREC_PACKET);
+	Packer.AddInt(ClientID);
+	Packer.AddInt(Flags);
+	Packer.AddInt(Size);
+	Packer.AddRaw(pData, Size);
+	Add(&Packer);
+}
+
+void CJournalWriter::Check(int Tick, unsigned Crc)
+{
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(JOURNALREC_CHECK);
+	Packer.AddInt(Tick);
+	Packer.AddInt(Crc);
+	Add(&Packer);
+}
+
+void CJournalWriter::Latency(int ClientID, int Latency)
+{
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(JOURNALREC_LATENCY);
+	Packer.AddInt(ClientID);
+	Packer.AddInt(Latency);
+	Add(&Packer);
+}
+
+void CJournalWriter::Restore(int ClientID, int State, const char *pName, const char *pClan, int Country)
+{
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(JOURNALREC_RESTORE);
+	Packer.AddInt(ClientID);
+	Packer.AddInt(State);
+	Packer.AddString(pName, 0);
+	Packer.AddString(pClan, 0);
+	Packer.AddInt(Country);
+	Add(&Packer);
+}
+
+bool CJournalReader::Open(IOHANDLE File, CJournalHeader *pHeader)
+{
+	if(!File)
+		return false;
+
+	std::vector<unsigned char> Compressed(io_length(File));
+	if(!Compressed.empty())
+		io_read(File, &Compressed[0], Compressed.size());
+	io_close(File);
+
+	z_stream Stream;
+	mem_zero(&Stream, sizeof(Stream));
+	if(Compressed.empty() || inflateInit(&Stream) != Z_OK)
+		return false;
+
+	// the journal may be cut off if the server did not shut down cleanly,
+	// use whatever could be decompressed
+	m_Data.resize(Compressed.size() * 4);
+	Stream.next_in = &Compressed[0];
+	Stream.avail_in = Compressed.size();
+	int Result = Z_OK;
+	while(Result == Z_OK)
+	{
+		if(Stream.total_out == m_Data.size())
+			m_Data.resize(m_Data.size() * 2);
+		Stream.next_out = &m_Data[Stream.total_out];
+		Stream.avail_out = m_Data.size() - Stream.total_out;
+		Result = inflate(&Stream, Z_NO_FLUSH);
+	}
+	m_Data.resize(Stream.total_out);
+	inflateEnd(&Stream);
+
+	if(m_Data.empty())
+		return false;
+	m_Unpacker.Reset(&m_Data[0], m_Data.size());
+
+	const char *pMagic = m_Unpacker.GetString(CUnpacker::SANITIZE_CC);
+	int Version = m_Unpacker.GetInt();
+	if(m_Unpacker.Error() || str_comp(pMagic, s_aJournalMagic) != 0 || Version != JOURNAL_VERSION)
+		return false;
+
+	str_copy(pHeader->m_aNetVersion, m_Unpacker.GetString(CUnpacker::SANITIZE_CC), sizeof(pHeader->m_aNetVersion));
+	str_copy(pHeader->m_aMap, m_Unpacker.GetString(CUnpacker::SANITIZE_CC), sizeof(pHeader->m_aMap));
+	pHeader->m_MapCrc = m_Unpacker.GetInt();
+	pHeader->m_Seed = m_Unpacker.GetInt();
+	pHeader->m_StartTick = m_Unpacker.GetInt();
+	return !m_Unpacker.Error();
+}
+
+bool CJournalReader::Next(CJournalRecord *pRecord)
+{
+	mem_zero(pRecord, sizeof(*pRecord));
+	pRecord->m_Type = m_Unpacker.GetInt();
+	if(m_Unpacker.Error())
+		return false;
+
+	switch(pRecord->m_Type)
+	{
+	case JOURNALREC_TICK:
+		pRecord->m_Tick = m_Unpacker.GetInt();
+		break;
+	case JOURNALREC_SNAP:
+		break;
+	case JOURNALREC_CONNECT:
+	{
+		pRecord->m_ClientID = m_Unpacker.GetInt();
+		const void *pAddr = m_Unpacker.GetRaw(sizeof(pRecord->m_Addr));
+		if(pAddr)
+			mem_copy(&pRecord->m_Addr, pAddr, sizeof(pRecord->m_Addr));
+		break;
+	}
+	case JOURNALREC_REJOIN:
+		pRecord->m_ClientID = m_Unpacker.GetInt();
+		break;
+	case JOURNALREC_DROP:
+		pRecord->m_ClientID = m_Unpacker.GetInt();
+		pRecord->m_Flags = m_Unpacker.GetInt();
+		pRecord->m_pReason = m_Unpacker.GetString(CUnpacker::SANITIZE_CC);
+		break;
+	case JOURNALREC_PACKET:
+		pRecord->m_ClientID = m_Unpacker.GetInt();
+		pRecord->m_Flags = m_Unpacker.GetInt();
+		pRecord->m_DataSize = m_Unpacker.GetInt();
+		pRecord->m_pData = m_Unpacker.GetRaw(pRecord->m_DataSize);
+		break;
+	case JOURNALREC_CHECK:
+		pRecord->m_Tick = m_Unpacker.GetInt();
+		pRecord->m_Crc = m_Unpacker.GetInt();
+		break;
+	case JOURNALREC_LATENCY:
+		pRecord->m_ClientID = m_Unpacker.GetInt();
+		pRecord->m_Latency = m_Unpacker.GetInt();
+		break;
+	case JOURNALREC_RESTORE:
+		pRecord->m_ClientID = m_Unpacker.GetInt();
+		pRecord->m_Flags = m_Unpacker.GetInt();
+		pRecord->m_pName = m_Unpacker.GetString(CUnpacker::SANITIZE_CC);
+		pRecord->m_pClan = m_Unpacker.GetString(CUnpacker::SANITIZE_CC);
+		pRecord->m_Country = m_Unpacker.GetInt();
+		break;
+	default:
+		return false;
+	}
+
+	if(m_Unpacker.Error())
+		return false;
+	if(pRecord->m_ClientID < 0 || pRecord->m_ClientID >= MAX_CLIENTS)
+		return false;
+	return true;
+}
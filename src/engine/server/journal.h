@@ -0,0 +1,113 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SERVER_JOURNAL_H
+#define ENGINE_SERVER_JOURNAL_H
+
+#include <base/system.h>
+
+#include <engine/shared/packer.h>
+
+#include <vector>
+#include <zlib.h>
+
+/*
+	The journal records everything that enters the game from the network
+	during one map: connections, raw client packets, drops, the tick and
+	snapshot boundaries and the RNG seed. Replaying it through CServer
+	reproduces the match without any client.
+*/
+
+enum
+{
+	JOURNALREC_TICK = 0,
+	JOURNALREC_SNAP,
+	JOURNALREC_CONNECT,
+	JOURNALREC_REJOIN,
+	JOURNALREC_DROP,
+	JOURNALREC_PACKET,
+	JOURNALREC_CHECK,
+	JOURNALREC_LATENCY,
+	JOURNALREC_RESTORE,
+};
+
+struct CJournalHeader
+{
+	char m_aNetVersion[64];
+	char m_aMap[128];
+	unsigned m_MapCrc;
+	unsigned m_Seed;
+	int m_StartTick;
+};
+
+struct CJournalRecord
+{
+	int m_Type;
+	int m_Tick;
+	int m_ClientID;
+	int m_Flags;
+	unsigned m_Crc;
+	int m_Latency;
+	NETADDR m_Addr;
+	const char *m_pReason;
+	const char *m_pName;
+	const char *m_pClan;
+	int m_Country;
+	const void *m_pData;
+	int m_DataSize;
+};
+
+class CJournalWriter
+{
+	IOHANDLE m_File;
+	void *m_pThread;
+	LOCK m_Lock;
+	SEMAPHORE m_Semaphore;
+	bool m_Stop;
+
+	// filled by the game thread, compressed and written by the writer thread
+	std::vector<unsigned char> m_Block;
+	std::vector<std::vector<unsigned char> > m_Queue;
+	z_stream m_Stream;
+	// real client addresses, the journal only stores their index
+	std::vector<NETADDR> m_Addrs;
+
+	void Add(const CPacker *pPacker);
+	void Compress(const unsigned char *pData, int Size, int Flush);
+	static void WriterThread(void *pUser);
+
+public:
+	CJournalWriter();
+	~CJournalWriter();
+
+	bool Start(IOHANDLE File, const CJournalHeader *pHeader);
+	void Stop();
+	bool IsRecording() const { return m_File != 0; }
+
+	// hands the records of the last tick to the writer thread
+	void Flush();
+
+	void Tick(int Tick);
+	void Snap();
+	// the address is replaced by a stand-in that only keeps which
+	// connections came from the same IP
+	void Connect(int ClientID, const NETADDR *pAddr);
+	void Rejoin(int ClientID);
+	void Drop(int ClientID, int Type, const char *pReason);
+	void Packet(int ClientID, int Flags, const void *pData, int Size);
+	void Check(int Tick, unsigned Crc);
+	void Latency(int ClientID, int Latency);
+	// clients that stay connected across a map change
+	void Restore(int ClientID, int State, const char *pName, const char *pClan, int Country);
+};
+
+class CJournalReader
+{
+	std::vector<unsigned char> m_Data;
+	CUnpacker m_Unpacker;
+
+public:
+	bool Open(IOHANDLE File, CJournalHeader *pHeader);
+	bool Next(CJournalRecord *pRecord);
+};
+
+#endif
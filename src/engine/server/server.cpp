@@ -22,6 +22,7 @@
 #include <engine/shared/netban.h>
 #include <engine/shared/network.h>
 #include <engine/shared/packer.h>
+#include <engine/shared/profiler.h>
 #include <engine/shared/protocol.h>
 #include <engine/shared/protocol_ex.h>
 #include <engine/shared/snapshot.h>
@@ -204,7 +205,7 @@ void CServerBan::InitServerBan(IConsole *pConsole, IStorage *pStorage, CServer*
 }
 
 template<class T>
-int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason)
+int CServerBan::BanExt(const T *pData, int Seconds, const char *pReason)
 {
 	// validate address
 	if(Server()->m_RconClientID >= 0 && Server()->m_RconClientID < MAX_CLIENTS &&
@@ -243,14 +244,14 @@ int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seco
 		}
 	}
 
-	int Result = Ban(pBanPool, pData, Seconds, pReason);
+	int Result = Ban(pData, Seconds, pReason);
 	if(Result != 0)
 		return Result;
 
 	// drop banned clients
 
 	// don't drop it like that. just kick the desired guy
-	typename T::CDataType Data = *pData;
+	T Data = *pData;
 	for(int i = 0; i < MAX_CLIENTS; ++i)
 	{
 		if(Server()->m_aClients[i].m_State == CServer::CClient::STATE_EMPTY)
@@ -261,9 +262,8 @@ int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seco
 
 		if(NetMatch(&Data, Server()->m_NetServer.ClientAddr(i)))
 		{
-			CNetHash NetHash(&Data);
 			char aBuf[256];
-			MakeBanInfo(pBanPool->Find(&Data, &NetHash), aBuf, sizeof(aBuf), MSGTYPE_PLAYER);
+			MakeBanInfo(Find(&Data), aBuf, sizeof(aBuf), MSGTYPE_PLAYER);
 			Server()->m_NetServer.Drop(i, CLIENTDROPTYPE_BAN, aBuf);
 		}
 	}
@@ -273,13 +273,13 @@ int CServerBan::BanExt(T *pBanPool, const typename T::CDataType *pData, int Seco
 
 int CServerBan::BanAddr(const NETADDR *pAddr, int Seconds, const char *pReason)
 {
-	return BanExt(&m_BanAddrPool, pAddr, Seconds, pReason);
+	return BanExt(pAddr, Seconds, pReason);
 }
 
 int CServerBan::BanRange(const CNetRange *pRange, int Seconds, const char *pReason)
 {
 	if(pRange->IsValid())
-		return BanExt(&m_BanRangePool, pRange, Seconds, pReason);
+		return BanExt(pRange, Seconds, pReason);
 
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (invalid range)");
 	return -1;
@@ -327,6 +327,15 @@ void CServer::CClient::Reset(bool ResetScore)
 	m_LastInputTick = -1;
 	m_Quitting = false;
 	m_SnapRate = CClient::SNAPRATE_INIT;
+	m_SnapLevel = CClient::SNAPLEVEL_25HZ;
+	m_LastSnapTick = -1;
+	m_SnapWindowTick = -1;
+	m_SnapCleanWindows = 0;
+	m_SnapsSent = 0;
+	m_SnapsAcked = 0;
+	m_SnapPackets = 0;
+	m_MinAckRtt = -1;
+	m_WindowAckRtt = -1;
 	m_NextMapChunk = 0;
 	m_DDNetVersion = VERSION_NONE;
 	m_InfClassVersion = 0;
@@ -372,6 +381,13 @@ CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 
 	m_CurrentGameTick = 0;
 	m_RunServer = 1;
+	m_Replaying = false;
+	m_CheckTick = -1;
+	m_CheckCrc = 0;
+	m_LastDemoSnapTick = -1;
+	m_ClientInfoRevision = 0;
+	m_NetStatsTick = 0;
+	mem_zero(m_aNetStatsTypes, sizeof(m_aNetStatsTypes));
 
 	str_copy(m_aShutdownReason, "Server shutdown", sizeof(m_aShutdownReason));
 
@@ -386,6 +402,7 @@ CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 	m_ServerInfoFirstRequest = 0;
 	m_ServerInfoNumRequests = 0;
 	m_ServerInfoHighLoad = false;
+	mem_zero(m_aInfoRequestBuckets, sizeof(m_aInfoRequestBuckets));
 
 #ifdef CONF_SQL
 /* DDNET MODIFICATION START *******************************************/
@@ -484,6 +501,7 @@ void CServer::SetClientName(int ClientID, const char *pName)
 				break;
 		}
 	}
+	ExpireServerInfo();
 }
 
 void CServer::SetClientClan(int ClientID, const char *pClan)
@@ -492,6 +510,7 @@ void CServer::SetClientClan(int ClientID, const char *pClan)
 		return;
 
 	str_copy(m_aClients[ClientID].m_aClan, pClan, MAX_CLAN_LENGTH);
+	ExpireServerInfo();
 }
 
 void CServer::SetClientCountry(int ClientID, int Country)
@@ -500,6 +519,7 @@ void CServer::SetClientCountry(int ClientID, int Country)
 		return;
 
 	m_aClients[ClientID].m_Country = Country;
+	ExpireServerInfo();
 }
 
 void CServer::Kick(int ClientID, const char *pReason)
@@ -858,6 +878,10 @@ int CServer::SendMsg(CMsgPacker *pMsg, int Flags, int ClientID)
 	if(!pMsg)
 		return -1;
 
+	// nobody is listening during a replay
+	if(m_Replaying)
+		return 0;
+
 	// drop packet to dummy client
 	if(ClientID >= 0 && ClientID < MAX_CLIENTS && GameServer()->IsClientBot(ClientID))
 		return 0;
@@ -916,12 +940,88 @@ int CServer::SendMsg(CMsgPacker *pMsg, int Flags, int ClientID)
 	return 0;
 }
 
+// ticks between two snapshots at the snapshot levels, 50, 25, 16 and 10 Hz
+static const int s_aSnapIntervals[CServer::CClient::NUM_SNAPLEVELS] = {1, 2, 3, 5};
+
+int CServer::SnapInterval(int ClientID) const
+{
+	return s_aSnapIntervals[m_aClients[ClientID].m_SnapLevel];
+}
+
+/*
+	Every second the snapshot rate of a client steps down if its link
+	looks congested: it loses snapshots or vital chunks, or the round
+	trip of the snapshot acks grows as packets queue up. After three
+	clean seconds it steps up again, up to sv_snap_rate_max. Snapshots
+	of more than one packet are lost when any of their packets is, so
+	those never go at 50 Hz.
+*/
+void CServer::UpdateSnapRate(int ClientID)
+{
+	CClient *pClient = &m_aClients[ClientID];
+
+	int TopLevel = CClient::SNAPLEVEL_10HZ;
+	while(TopLevel > 0 && (g_Config.m_SvHighBandwidth || SERVER_TICK_SPEED/s_aSnapIntervals[TopLevel-1] <= g_Config.m_SvSnapRateMax))
+		TopLevel--;
+	if(pClient->m_SnapLevel < TopLevel)
+		pClient->m_SnapLevel = TopLevel;
+
+	if(pClient->m_SnapWindowTick >= 0 && Tick()-pClient->m_SnapWindowTick < SERVER_TICK_SPEED)
+		return;
+
+	const NETSTATS *pStats = m_NetServer.ClientStats(ClientID);
+	int ResentChunks = m_NetServer.ClientResentChunks(ClientID);
+	if(pClient->m_SnapWindowTick >= 0)
+	{
+		int SentPackets = pStats->sent_packets - pClient->m_WindowSentPackets;
+		int Resent = ResentChunks - pClient->m_WindowResentChunks;
+
+		bool Lossy = pClient->m_SnapsSent >= 5 && pClient->m_SnapsAcked*5 < pClient->m_SnapsSent*4;
+		bool Resending = Resent > 0 && Resent*20 > SentPackets;
+		bool Queueing = pClient->m_WindowAckRtt >= 0 && pClient->m_WindowAckRtt > pClient->m_MinAckRtt + 100;
+		bool Large = pClient->m_SnapPackets > pClient->m_SnapsSent;
+
+		if(Lossy || Resending || Queueing || (Large && pClient->m_SnapLevel == CClient::SNAPLEVEL_50HZ))
+		{
+			if(pClient->m_SnapLevel < CClient::SNAPLEVEL_10HZ)
+				pClient->m_SnapLevel++;
+			pClient->m_SnapCleanWindows = 0;
+		}
+		else if(++pClient->m_SnapCleanWindows >= 3 && pClient->m_SnapLevel > TopLevel &&
+			!(Large && pClient->m_SnapLevel == CClient::SNAPLEVEL_25HZ))
+		{
+			pClient->m_SnapLevel--;
+			pClient->m_SnapCleanWindows = 0;
+		}
+
+		// let the base round trip follow a route that got slower
+		if(pClient->m_WindowAckRtt >= 0)
+			pClient->m_MinAckRtt = minimum(pClient->m_MinAckRtt + 10, pClient->m_WindowAckRtt);
+	}
+
+	pClient->m_SnapWindowTick = Tick();
+	pClient->m_SnapsSent = 0;
+	pClient->m_SnapsAcked = 0;
+	pClient->m_SnapPackets = 0;
+	pClient->m_WindowAckRtt = -1;
+	pClient->m_WindowSentPackets = pStats->sent_packets;
+	pClient->m_WindowResentChunks = ResentChunks;
+}
+
 void CServer::DoSnapshot()
 {
+	CProfileScope ProfileScope(CProfiler::PHASE_SNAPSHOT);
+	CProfileTimer SnapCreateTimer(CProfiler::PHASE_SNAP_CREATE);
+	CProfileTimer SnapDeltaTimer(CProfiler::PHASE_SNAP_DELTA);
+	CProfileTimer SnapCompressTimer(CProfiler::PHASE_SNAP_COMPRESS);
+
 	GameServer()->OnPreSnap();
 
+	// the demo keeps the global rate
+	bool DemoSnap = g_Config.m_SvHighBandwidth || (Tick()%2) == 0;
+
 	// create snapshot for demo recording
-	if(m_DemoRecorder.IsRecording())
+	if(DemoSnap && m_DemoRecorder.IsRecording())
 	{
 		char aData[CSnapshot::MAX_SIZE];
 		int SnapshotSize;
@@ -935,6 +1035,24 @@ void CServer::DoSnapshot()
 		m_DemoRecorder.RecordSnapshot(Tick(), aData, SnapshotSize);
 	}
 
+	// checksum the world once per second so replays can detect divergence
+	if((m_Journal.IsRecording() || m_Replaying) && Tick()%SERVER_TICK_SPEED == 0)
+	{
+		char aData[CSnapshot::MAX_SIZE];
+		CSnapshot *pData = (CSnapshot*)aData;
+
+		m_SnapshotBuilder.Init();
+		GameServer()->OnSnap(-1);
+		m_SnapshotBuilder.Finish(pData);
+
+		m_CheckTick = Tick();
+		m_CheckCrc = pData->Crc();
+		m_Journal.Check(m_CheckTick, m_CheckCrc);
+	}
+
+	if(DemoSnap)
+		m_LastDemoSnapTick = Tick();
+
 	// create snapshots for all clients
 	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
@@ -942,6 +1060,8 @@ void CServer::DoSnapshot()
 		if(m_aClients[i].m_State != CClient::STATE_INGAME)
 			continue;
 
+		UpdateSnapRate(i);
+
 		// this client is trying to recover, don't spam snapshots
 		if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_RECOVER && (Tick()%50) != 0)
 			continue;
@@ -950,6 +1070,10 @@ void CServer::DoSnapshot()
 		if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_INIT && (Tick()%10) != 0)
 			continue;
 
+		// the ticks in between go into the next delta
+		if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_FULL && Tick()-m_aClients[i].m_LastSnapTick < SnapInterval(i))
+			continue;
+
 		{
 			char aData[CSnapshot::MAX_SIZE];
 			CSnapshot *pData = (CSnapshot*)aData;	// Fix compiler warning for strict-aliasing
@@ -963,6 +1087,7 @@ void CServer::DoSnapshot()
 			int DeltaTick = -1;
 			int DeltaSize;
 
+			SnapCreateTimer.Start();
 			m_SnapshotBuilder.Init();
 
 			GameServer()->OnSnap(i);
@@ -970,6 +1095,7 @@ void CServer::DoSnapshot()
 			// finish snapshot
 			SnapshotSize = m_SnapshotBuilder.Finish(pData);
 			Crc = pData->Crc();
+			SnapCreateTimer.Stop();
 
 			// remove old snapshos
 			// keep 3 seconds worth of snapshots
@@ -994,7 +1120,9 @@ void CServer::DoSnapshot()
 			}
 
 			// create delta
-			DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData);
+			SnapDeltaTimer.Start();
+			DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData, g_Config.m_SvNetStats ? m_aNetStatsTypes : 0);
+			SnapDeltaTimer.Stop();
 
 			if(DeltaSize)
 			{
@@ -1003,8 +1131,12 @@ void CServer::DoSnapshot()
 				const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
 				int NumPackets;
 
+				SnapCompressTimer.Start();
 				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
+				SnapCompressTimer.Stop();
 				NumPackets = (SnapshotSize+MaxSize-1)/MaxSize;
+				m_aClients[i].m_SnapPackets += NumPackets;
+				CountSnapshot(i, pData->NumItems(), SnapshotSize, DeltaTick < 0);
 
 				for(int n = 0, Left = SnapshotSize; Left > 0; n++)
 				{
@@ -1041,13 +1173,108 @@ void CServer::DoSnapshot()
 				Msg.AddInt(m_CurrentGameTick);
 				Msg.AddInt(m_CurrentGameTick-DeltaTick);
 				SendMsg(&Msg, MSGFLAG_FLUSH, i);
+				m_aClients[i].m_SnapPackets++;
+				CountSnapshot(i, pData->NumItems(), 0, DeltaTick < 0);
 			}
+
+			m_aClients[i].m_LastSnapTick = Tick();
+			m_aClients[i].m_SnapsSent++;
 		}
 	}
 
+	if(g_Config.m_SvNetStatsInterval && Tick()%(g_Config.m_SvNetStatsInterval*SERVER_TICK_SPEED) == 0)
+		PrintNetStats();
+
 	GameServer()->OnPostSnap();
 }
 
+void CServer::ResetNetStats(int ClientID)
+{
+	CClient *pClient = &m_aClients[ClientID];
+	pClient->m_StatsTick = Tick();
+	pClient->m_StatsSentBytes = m_NetServer.ClientStats(ClientID)->sent_bytes;
+	pClient->m_StatsResentChunks = m_NetServer.ClientResentChunks(ClientID);
+	pClient->m_StatsSnaps = 0;
+	pClient->m_StatsFullSnaps = 0;
+	pClient->m_StatsSnapBytes = 0;
+	pClient->m_StatsSnapItems = 0;
+	mem_zero(pClient->m_aStatsSnapSizes, sizeof(pClient->m_aStatsSnapSizes));
+}
+
+void CServer::CountSnapshot(int ClientID, int NumItems, int Size, bool Full)
+{
+	CClient *pClient = &m_aClients[ClientID];
+	pClient->m_StatsSnaps++;
+	pClient->m_StatsFullSnaps += Full;
+	pClient->m_StatsSnapBytes += Size;
+	pClient->m_StatsSnapItems += NumItems;
+
+	int Bucket = 0;
+	if(Size > 0)
+	{
+		for(Bucket = 1; Bucket < CClient::NUM_SNAPSIZE_BUCKETS-1; Bucket++)
+		{
+			if(Size <= 32<<Bucket)
+				break;
+		}
+	}
+	pClient->m_aStatsSnapSizes[Bucket]++;
+}
+
+/*
+	Prints one line per client and one per snapshot item type, as
+	key=value pairs for scripts that read the log. The client lines
+	count the compressed snapshots, their items and sizes and the bytes
+	and resent chunks of the whole connection. The type lines count
+	the items and the packed bytes the client deltas carried, they are
+	only counted with sv_netstats.
+*/
+void CServer::PrintNetStats()
+{
+	char aBuf[512];
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CClient *pClient = &m_aClients[i];
+		if(pClient->m_State != CClient::STATE_INGAME)
+			continue;
+
+		float Seconds = maximum(Tick() - pClient->m_StatsTick, 1) / (float)SERVER_TICK_SPEED;
+		int Snaps = maximum(pClient->m_StatsSnaps, 1);
+		const int *pSizes = pClient->m_aStatsSnapSizes;
+		str_format(aBuf, sizeof(aBuf), "cid=%d secs=%.1f snaps=%d snaprate=%.1f full=%.1f%% items=%.1f snapbytes=%.1f snapbps=%.0f bps=%.0f resent=%d sizes=%d/%d/%d/%d/%d/%d/%d/%d",
+			i, Seconds, pClient->m_StatsSnaps, pClient->m_StatsSnaps/Seconds,
+			pClient->m_StatsFullSnaps*100.0f/Snaps, pClient->m_StatsSnapItems/(float)Snaps,
+			pClient->m_StatsSnapBytes/(float)Snaps, pClient->m_StatsSnapBytes/Seconds,
+			(m_NetServer.ClientStats(i)->sent_bytes - pClient->m_StatsSentBytes)/Seconds,
+			m_NetServer.ClientResentChunks(i) - pClient->m_StatsResentChunks,
+			pSizes[0], pSizes[1], pSizes[2], pSizes[3], pSizes[4], pSizes[5], pSizes[6], pSizes[7]);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "netstats", aBuf);
+	}
+
+	float Seconds = maximum(Tick() - m_NetStatsTick, 1) / (float)SERVER_TICK_SPEED;
+	for(int i = 0; i < CSnapshotDelta::NUM_TYPE_STATS; i++)
+	{
+		const CSnapshotDelta::CTypeStats *pStats = &m_aNetStatsTypes[i];
+		int64 NumItems = pStats->m_NumFull + pStats->m_NumDelta;
+		if(!NumItems && !pStats->m_NumDeleted)
+			continue;
+
+		int Type = CSnapshotDelta::TypeStatsType(i);
+		const char *pName = "other";
+		if(Type >= 0 && Type < CSnapshot::OFFSET_UUID_TYPE)
+			pName = GameServer()->NetObjName(Type);
+		else if(Type >= 0)
+		{
+			int TypeID = m_SnapshotBuilder.GetExtendedItemType(CSnapshot::MAX_TYPE - Type);
+			pName = TypeID ? g_UuidManager.GetName(TypeID) : "extended";
+		}
+		str_format(aBuf, sizeof(aBuf), "type=%s secs=%.1f items=%lld full=%.1f%% deleted=%lld bytes=%lld bps=%.0f",
+			pName, Seconds, (long long)NumItems, NumItems ? pStats->m_NumFull*100.0f/NumItems : 0.0f,
+			(long long)pStats->m_NumDeleted, (long long)pStats->m_Bytes, pStats->m_Bytes/Seconds);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "netstats", aBuf);
+	}
+}
+
 int CServer::ClientRejoinCallback(int ClientID, void *pUser)
 {
 	CServer *pThis = (CServer *)pUser;
@@ -1057,6 +1284,7 @@ int CServer::ClientRejoinCallback(int ClientID, void *pUser)
 	pThis->m_aClients[ClientID].m_Quitting = false;
 
 	pThis->m_aClients[ClientID].Reset();
+	pThis->m_Journal.Rejoin(ClientID);
 	
 	//Getback session about the client
 	IServer::CClientSession* pSession = pThis->m_NetSession.GetData(pThis->m_NetServer.ClientAddr(ClientID));
@@ -1085,6 +1313,9 @@ int CServer::NewClientCallback(int ClientID, void *pUser)
 {
 	CServer *pThis = (CServer *)pUser;
 
+	pThis->m_Journal.Connect(ClientID, pThis->m_NetServer.ClientAddr(ClientID));
+	pThis->ExpireServerInfo();
+
 	// Remove non human player on same slot
 	if(pThis->GameServer()->IsClientBot(ClientID))
 	{
@@ -1135,6 +1366,8 @@ int CServer::DelClientCallback(int ClientID, int Type, const char *pReason, void
 		return 0;
 	
 	pThis->m_aClients[ClientID].m_Quitting = true;
+	pThis->m_Journal.Drop(ClientID, Type, pReason ? pReason : "");
+	pThis->ExpireServerInfo();
 
 	char aAddrStr[NETADDR_MAXSTRSIZE];
 
@@ -1343,10 +1576,7 @@ bool CServer::GenerateClientMap(const char *pMapFilePath, const char *pMapName)
 	//We need to convert the map to something that the client can use
 	//First, try to find if the client map is already generated
 
-	CDataFileReader dfServerMap;
-	dfServerMap.Open(Storage(), pMapFilePath, IStorage::TYPE_ALL);
-	unsigned ServerMapCrc = dfServerMap.Crc();
-	dfServerMap.Close();
+	unsigned ServerMapCrc = m_pMap->Crc();
 
 	EventsDirector::SetPreloadedMapName(pMapName);
 
@@ -1541,6 +1771,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				str_format(aBuf, sizeof(aBuf), "player has entered the game. ClientID=%d addr=%s", ClientID, aAddrStr);
 				Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 				m_aClients[ClientID].m_State = CClient::STATE_INGAME;
+				ResetNetStats(ClientID);
 				
 				if(m_aClients[ClientID].m_WaitingTime <= 0)
 				{
@@ -1552,6 +1783,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 		{
 			CClient::CInput *pInput;
 			int64 TagTime;
+			int LastAckedSnapshot = m_aClients[ClientID].m_LastAckedSnapshot;
 
 			m_aClients[ClientID].m_LastAckedSnapshot = Unpacker.GetInt();
 			int IntendedTick = Unpacker.GetInt();
@@ -1565,7 +1797,21 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				m_aClients[ClientID].m_SnapRate = CClient::SNAPRATE_FULL;
 
 			if(m_aClients[ClientID].m_Snapshots.Get(m_aClients[ClientID].m_LastAckedSnapshot, &TagTime, 0, 0) >= 0)
+			{
 				m_aClients[ClientID].m_Latency = (int)(((time_get()-TagTime)*1000)/time_freq());
+				m_Journal.Latency(ClientID, m_aClients[ClientID].m_Latency);
+
+				// the first ack of a snapshot measures the round trip
+				if(m_aClients[ClientID].m_LastAckedSnapshot > LastAckedSnapshot)
+				{
+					CClient *pClient = &m_aClients[ClientID];
+					pClient->m_SnapsAcked++;
+					if(pClient->m_WindowAckRtt < 0 || pClient->m_Latency < pClient->m_WindowAckRtt)
+						pClient->m_WindowAckRtt = pClient->m_Latency;
+					if(pClient->m_MinAckRtt < 0 || pClient->m_Latency < pClient->m_MinAckRtt)
+						pClient->m_MinAckRtt = pClient->m_Latency;
+				}
+			}
 
 			// add message to report the input timing
 			// skip packets that are old
@@ -1763,8 +2009,51 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 	}
 }
 
+bool CServer::AllowInfoRequest(const NETADDR *pAddr)
+{
+	if(!g_Config.m_SvServerInfoIpRate)
+		return true;
+
+	NETADDR Addr = *pAddr;
+	Addr.port = 0;
+
+	unsigned Hash = 2166136261u;
+	for(int i = 0; i < (int)sizeof(Addr.ip); i++)
+		Hash = (Hash ^ Addr.ip[i]) * 16777619u;
+
+	// a colliding address takes over the bucket, the global limit still applies
+	CInfoRequestBucket *pBucket = &m_aInfoRequestBuckets[Hash%NUM_INFO_REQUEST_BUCKETS];
+	int64 Now = time_get();
+	if(net_addr_comp(&pBucket->m_Addr, &Addr) != 0)
+	{
+		pBucket->m_Addr = Addr;
+		pBucket->m_Tokens = g_Config.m_SvServerInfoIpBurst;
+	}
+	else
+	{
+		float Refill = (Now - pBucket->m_LastTime) * g_Config.m_SvServerInfoIpRate / (float)time_freq();
+		pBucket->m_Tokens = minimum(pBucket->m_Tokens + Refill, (float)g_Config.m_SvServerInfoIpBurst);
+	}
+	pBucket->m_LastTime = Now;
+
+	if(pBucket->m_Tokens < 1.0f)
+		return false;
+	pBucket->m_Tokens -= 1.0f;
+	return true;
+}
+
 void CServer::SendServerInfoConnless(const NETADDR *pAddr, int Token, int Type)
 {
+	if(!AllowInfoRequest(pAddr))
+	{
+		char aBuf[256];
+		char aAddrStr[NETADDR_MAXSTRSIZE];
+		net_addr_str(pAddr, aAddrStr, sizeof(aAddrStr), false);
+		str_format(aBuf, sizeof(aBuf), "Too many info requests from %s", aAddrStr);
+		Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "inforequests", aBuf);
+		return;
+	}
+
 	const int MaxRequests = g_Config.m_SvServerInfoPerSecond;
 	int64 Now = Tick();
 	if(abs(Now - m_ServerInfoFirstRequest) <= TickSpeed())
@@ -1793,8 +2082,15 @@ void CServer::SendServerInfoConnless(const NETADDR *pAddr, int Token, int Type)
 	SendServerInfo(pAddr, Token, Type, SendClients);
 }
 
-void CServer::SendServerInfo(const NETADDR *pAddr, int Token, int Type, bool SendClients)
+// longest token as text, "-2147483648" and the terminator
+static const int SERVERINFO_MAX_TOKEN_LENGTH = 12;
+
+void CServer::CacheServerInfo(CServerInfoCache *pCache, int Type, bool SendClients, const NETADDR *pAddr)
 {
+	pCache->m_vPackets.clear();
+	pCache->m_Valid = true;
+	pCache->m_BuildTime = time_get();
+
 	// One chance to improve the protocol!
 	CPacker p;
 	char aBuf[256];
@@ -1817,7 +2113,6 @@ void CServer::SendServerInfo(const NETADDR *pAddr, int Token, int Type, bool Sen
 
 	p.Reset();
 
-#define ADD_RAW(p, x) (p).AddRaw(x, sizeof(x))
 #define ADD_INT(p, x) \
 	do \
 	{ \
@@ -1825,17 +2120,17 @@ void CServer::SendServerInfo(const NETADDR *pAddr, int Token, int Type, bool Sen
 		(p).AddString(aBuf, 0); \
 	} while(0)
 
+	// the magic and the token are added in front of every packet by SendServerInfo
+	const unsigned char *pMagic = SERVERBROWSE_INFO;
 	switch(Type)
 	{
-	case SERVERINFO_EXTENDED: ADD_RAW(p, SERVERBROWSE_INFO_EXTENDED); break;
-	case SERVERINFO_64_LEGACY: ADD_RAW(p, SERVERBROWSE_INFO_64_LEGACY); break;
-	case SERVERINFO_VANILLA: ADD_RAW(p, SERVERBROWSE_INFO); break;
-	case SERVERINFO_INGAME: ADD_RAW(p, SERVERBROWSE_INFO); break;
+	case SERVERINFO_EXTENDED: pMagic = SERVERBROWSE_INFO_EXTENDED; break;
+	case SERVERINFO_64_LEGACY: pMagic = SERVERBROWSE_INFO_64_LEGACY; break;
+	case SERVERINFO_VANILLA: pMagic = SERVERBROWSE_INFO; break;
+	case SERVERINFO_INGAME: pMagic = SERVERBROWSE_INFO; break;
 	default: dbg_assert(false, "unknown serverinfo type");
 	}
 
-	ADD_INT(p, Token);
-
 	p.AddString(GameServer()->Version(), 32);
 	
 	//Add captcha if needed
@@ -1964,19 +2259,16 @@ void CServer::SendServerInfo(const NETADDR *pAddr, int Token, int Type, bool Sen
 	int PrefixSize = p.Size();
 
 	CPacker pp;
-	CNetChunk Packet;
 	int PacketsSent = 0;
 	int PlayersSent = 0;
-	Packet.m_ClientID = -1;
-	Packet.m_Address = *pAddr;
-	Packet.m_Flags = NETSENDFLAG_CONNLESS;
 
 	#define SEND(size) \
 		do \
 		{ \
-			Packet.m_pData = pp.Data(); \
-			Packet.m_DataSize = size; \
-			m_NetServer.Send(&Packet); \
+			CServerInfoCache::CPacket Packet; \
+			Packet.m_pMagic = pMagic; \
+			Packet.m_vBody.assign(pp.Data(), pp.Data() + (size)); \
+			pCache->m_vPackets.push_back(Packet); \
 			PacketsSent++; \
 		} while(0)
 
@@ -1998,11 +2290,9 @@ void CServer::SendServerInfo(const NETADDR *pAddr, int Token, int Type, bool Sen
 		return;
 	}
 
+	// following extended packets only repeat the magic and the token
 	if(Type == SERVERINFO_EXTENDED)
-	{
-		pPrefix = SERVERBROWSE_INFO_EXTENDED_MORE;
-		PrefixSize = sizeof(SERVERBROWSE_INFO_EXTENDED_MORE);
-	}
+		PrefixSize = 0;
 
 	int Remaining;
 	switch(Type)
@@ -2060,13 +2350,13 @@ void CServer::SendServerInfo(const NETADDR *pAddr, int Token, int Type, bool Sen
 
 			if(Type == SERVERINFO_EXTENDED)
 			{
-				if(pp.Size() >= NET_MAX_PAYLOAD)
+				if((int)sizeof(SERVERBROWSE_INFO_EXTENDED_MORE) + SERVERINFO_MAX_TOKEN_LENGTH + pp.Size() >= NET_MAX_PAYLOAD)
 				{
 					// Retry current player.
 					i--;
 					SEND(PreviousSize);
+					pMagic = SERVERBROWSE_INFO_EXTENDED_MORE;
 					RESET();
-					ADD_INT(pp, Token);
 					ADD_INT(pp, PacketsSent);
 					pp.AddString("", 0); // extra info, reserved
 					continue;
@@ -2079,12 +2369,62 @@ void CServer::SendServerInfo(const NETADDR *pAddr, int Token, int Type, bool Sen
 	SEND(pp.Size());
 	#undef SEND
 	#undef RESET
-	#undef ADD_RAW
 	#undef ADD_INT
 }
 
+void CServer::SendServerInfo(const NETADDR *pAddr, int Token, int Type, bool SendClients)
+{
+	CServerInfoCache CaptchaCache;
+	CServerInfoCache *pCache = &m_aServerInfoCache[Type][SendClients];
+	if(g_Config.m_InfCaptcha)
+	{
+		// the server name carries the captcha of this address
+		pCache = &CaptchaCache;
+		CacheServerInfo(pCache, Type, SendClients, pAddr);
+	}
+	else if(!pCache->m_Valid || time_get() - pCache->m_BuildTime > time_freq())
+	{
+		// scores change all the time, refresh them at least once per second
+		CacheServerInfo(pCache, Type, SendClients, pAddr);
+	}
+
+	char aToken[16];
+	str_format(aToken, sizeof(aToken), "%d", Token);
+
+	CNetChunk Packet;
+	Packet.m_ClientID = -1;
+	Packet.m_Address = *pAddr;
+	Packet.m_Flags = NETSENDFLAG_CONNLESS;
+
+	for(unsigned i = 0; i < pCache->m_vPackets.size(); i++)
+	{
+		const CServerInfoCache::CPacket *pPacket = &pCache->m_vPackets[i];
+		CPacker p;
+		p.Reset();
+		p.AddRaw(pPacket->m_pMagic, sizeof(SERVERBROWSE_INFO));
+		p.AddString(aToken, 0);
+		p.AddRaw(&pPacket->m_vBody[0], pPacket->m_vBody.size());
+
+		Packet.m_pData = p.Data();
+		Packet.m_DataSize = p.Size();
+		m_NetServer.Send(&Packet);
+	}
+}
+
+void CServer::ExpireServerInfo()
+{
+	m_ClientInfoRevision++;
+	for(int i = 0; i < SERVERINFO_INGAME+1; i++)
+	{
+		m_aServerInfoCache[i][0].m_Valid = false;
+		m_aServerInfoCache[i][1].m_Valid = false;
+	}
+}
+
 void CServer::UpdateServerInfo()
 {
+	ExpireServerInfo();
+
 	for(int i = 0; i < MAX_CLIENTS; ++i)
 	{
 		if(m_aClients[i].m_State != CClient::STATE_EMPTY)
@@ -2094,8 +2434,64 @@ void CServer::UpdateServerInfo()
 	}
 }
 
+// The journal lands on disk in readable form, so rcon traffic never goes
+// into it and the account chat commands keep only their name. Returns false
+// to leave the packet out; a non-empty pRedacted replaces its data.
+static bool RedactJournalPacket(const CNetChunk *pPacket, CPacker *pRedacted)
+{
+	static const char *s_apSecretCommands[] = {"login", "register", "setemail"};
+
+	pRedacted->Reset();
+	CUnpacker Unpacker;
+	Unpacker.Reset(pPacket->m_pData, pPacket->m_DataSize);
+	int MsgID = Unpacker.GetInt();
+	if(Unpacker.Error())
+		return true;
+	bool Sys = MsgID&1;
+	MsgID >>= 1;
+	if(Sys)
+		return MsgID != NETMSG_RCON_AUTH && MsgID != NETMSG_RCON_CMD;
+	if(MsgID != NETMSGTYPE_CL_SAY)
+		return true;
+
+	int Team = Unpacker.GetInt();
+	const char *pMessage = Unpacker.GetString(0);
+	if(Unpacker.Error() || pMessage[0] != '/')
+		return true;
+
+	const char *pCommand = str_skip_whitespaces_const(pMessage+1);
+	const char *pArgs = 0;
+	for(unsigned i = 0; i < sizeof(s_apSecretCommands)/sizeof(s_apSecretCommands[0]) && !pArgs; i++)
+	{
+		int Length = str_length(s_apSecretCommands[i]);
+		if(str_comp_nocase_num(pCommand, s_apSecretCommands[i], Length) == 0 &&
+			(pCommand[Length] == 0 || (unsigned char)pCommand[Length] <= ' '))
+			pArgs = pCommand+Length;
+	}
+	if(!pArgs)
+		return true;
+
+	// blank out the arguments but keep their length, the chat spam
+	// protection weighs messages by it and replay has to match
+	char aBuf[1024];
+	int BufLen = minimum((int)(pArgs-pMessage), (int)sizeof(aBuf)-1);
+	mem_copy(aBuf, pMessage, BufLen);
+	while(*pArgs && BufLen < (int)sizeof(aBuf)-1)
+	{
+		int Code = str_utf8_decode(&pArgs);
+		aBuf[BufLen++] = Code >= 0 && Code <= ' ' ? (char)Code : '*';
+	}
+	aBuf[BufLen] = 0;
+
+	pRedacted->AddInt(NETMSGTYPE_CL_SAY<<1);
+	pRedacted->AddInt(Team);
+	pRedacted->AddString(aBuf, 0);
+	return true;
+}
+
 void CServer::PumpNetwork()
 {
+	CProfileScope ProfileScope(CProfiler::PHASE_NETWORK);
 	CNetChunk Packet;
 
 	m_NetServer.Update();
@@ -2135,7 +2531,20 @@ void CServer::PumpNetwork()
 			}
 		}
 		else
+		{
+			if(m_Journal.IsRecording())
+			{
+				CPacker Redacted;
+				if(RedactJournalPacket(&Packet, &Redacted))
+				{
+					if(Redacted.Size())
+						m_Journal.Packet(Packet.m_ClientID, Packet.m_Flags, Redacted.Data(), Redacted.Size());
+					else
+						m_Journal.Packet(Packet.m_ClientID, Packet.m_Flags, Packet.m_pData, Packet.m_DataSize);
+				}
+			}
 			ProcessClientPacket(&Packet);
+		}
 	}
 
 	m_ServerBan.Update();
@@ -2254,6 +2663,91 @@ void CServer::InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterS
 
 static bool IsSeparator(char c) { return c == ';' || c == ' ' || c == ',' || c == '\t'; }
 
+void CServer::ProcessGameTick()
+{
+	g_Profiler.SetTick(m_CurrentGameTick);
+
+	//Check for name collision. We add this because the login is in a different thread and can't check it himself.
+	for(int i=MAX_CLIENTS-1; i>=0; i--)
+	{
+		if(m_aClients[i].m_State >= CClient::STATE_READY && m_aClients[i].m_Session.m_MuteTick > 0)
+			m_aClients[i].m_Session.m_MuteTick--;
+		
+		if(m_aClients[i].m_State >= CClient::STATE_READY && m_aClients[i].m_UserID < 0)
+		{
+			if(TrySetClientName(i, m_aClients[i].m_aName))
+			{
+				// auto rename
+				for(int j = 1;; j++)
+				{
+					char aNameTry[MAX_NAME_LENGTH];
+					str_format(aNameTry, sizeof(aNameTry), "(%d)%s", j, m_aClients[i].m_aName);
+					if(TrySetClientName(i, aNameTry) == 0)
+						break;
+				}
+			}
+		}
+	}
+	
+	for(int i=0; i<MAX_CLIENTS; i++)
+	{
+		if(m_aClients[i].m_WaitingTime > 0)
+		{
+			m_aClients[i].m_WaitingTime--;
+			if(m_aClients[i].m_WaitingTime <= 0)
+			{
+				if(m_aClients[i].m_State == CClient::STATE_READY)
+				{
+					GameServer()->OnClientConnected(i);	
+					SendConnectionReady(i);
+				}
+				else if(m_aClients[i].m_State == CClient::STATE_INGAME)
+				{
+					GameServer()->OnClientEnter(i);
+				}
+			}
+		}
+	}
+	
+	// apply new input
+	{
+		CProfileScope ProfileScope(CProfiler::PHASE_INPUT);
+		for(int c = 0; c < MAX_CLIENTS; c++)
+		{
+			if(m_aClients[c].m_State != CClient::STATE_INGAME)
+				continue;
+			for(int i = 0; i < 200; i++)
+			{
+				if(m_aClients[c].m_aInputs[i].m_GameTick == Tick())
+				{
+					GameServer()->OnClientPredictedInput(c, m_aClients[c].m_aInputs[i].m_aData);
+					break;
+				}
+			}
+		}
+	}
+
+	{
+		CProfileScope ProfileScope(CProfiler::PHASE_GAMETICK);
+		GameServer()->OnTick();
+	}
+	
+#ifdef CONF_SQL
+	if(m_lGameServerCmds.size())
+	{
+		CProfileScope ProfileScope(CProfiler::PHASE_SQL);
+		lock_wait(m_GameServerCmdLock);
+		for(int i=0; i<m_lGameServerCmds.size(); i++)
+		{
+			m_lGameServerCmds[i]->Execute(GameServer());
+			delete m_lGameServerCmds[i];
+		}
+		m_lGameServerCmds.clear();
+		lock_release(m_GameServerCmdLock);
+	} 
+#endif
+}
+
 int CServer::Run()
 {
 	if(g_Config.m_Debug)
@@ -2263,6 +2757,9 @@ int CServer::Run()
 
 	m_PrintCBIndex = Console()->RegisterPrintCallback(g_Config.m_ConsoleOutputLevel, SendRconLineAuthed, this);
 
+	if(g_Config.m_SvReplay[0])
+		return RunReplay();
+
 	//Choose a random map from the rotation
 	if(!str_length(g_Config.m_SvMap) && str_length(g_Config.m_SvMaprotation))
 	{
@@ -2365,6 +2862,7 @@ int CServer::Run()
 	str_format(aBuf, sizeof(aBuf), "server name is '%s'", g_Config.m_SvName);
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 
+	StartJournal();
 	GameServer()->OnInit();
 	str_format(aBuf, sizeof(aBuf), "version %s", GameServer()->NetVersion());
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
@@ -2390,6 +2888,7 @@ int CServer::Run()
 
 		while(m_RunServer)
 		{
+			g_Profiler.SetEnabled(g_Config.m_DbgProfile);
 			if(NonActive)
 				PumpNetwork();
 			set_new_tick();
@@ -2432,8 +2931,11 @@ int CServer::Run()
 
 					m_GameStartTime = time_get();
 					m_CurrentGameTick = 0;
+					m_NetStatsTick = 0;
+					mem_zero(m_aNetStatsTypes, sizeof(m_aNetStatsTypes));
 					m_ServerInfoFirstRequest = 0;
 					Kernel()->ReregisterInterface(GameServer());
+					StartJournal();
 					GameServer()->OnInit();
 					UpdateServerInfo();
 				}
@@ -2449,86 +2951,16 @@ int CServer::Run()
 			{
 				m_CurrentGameTick++;
 				NewTicks++;
-
-				//Check for name collision. We add this because the login is in a different thread and can't check it himself.
-				for(int i=MAX_CLIENTS-1; i>=0; i--)
-				{
-					if(m_aClients[i].m_State >= CClient::STATE_READY && m_aClients[i].m_Session.m_MuteTick > 0)
-						m_aClients[i].m_Session.m_MuteTick--;
-					
-					if(m_aClients[i].m_State >= CClient::STATE_READY && m_aClients[i].m_UserID < 0)
-					{
-						if(TrySetClientName(i, m_aClients[i].m_aName))
-						{
-							// auto rename
-							for(int j = 1;; j++)
-							{
-								char aNameTry[MAX_NAME_LENGTH];
-								str_format(aNameTry, sizeof(aNameTry), "(%d)%s", j, m_aClients[i].m_aName);
-								if(TrySetClientName(i, aNameTry) == 0)
-									break;
-							}
-						}
-					}
-				}
-				
-				for(int i=0; i<MAX_CLIENTS; i++)
-				{
-					if(m_aClients[i].m_WaitingTime > 0)
-					{
-						m_aClients[i].m_WaitingTime--;
-						if(m_aClients[i].m_WaitingTime <= 0)
-						{
-							if(m_aClients[i].m_State == CClient::STATE_READY)
-							{
-								GameServer()->OnClientConnected(i);	
-								SendConnectionReady(i);
-							}
-							else if(m_aClients[i].m_State == CClient::STATE_INGAME)
-							{
-								GameServer()->OnClientEnter(i);
-							}
-						}
-					}
-				}
-				
-				// apply new input
-				for(int c = 0; c < MAX_CLIENTS; c++)
-				{
-					if(m_aClients[c].m_State != CClient::STATE_INGAME)
-						continue;
-					for(int i = 0; i < 200; i++)
-					{
-						if(m_aClients[c].m_aInputs[i].m_GameTick == Tick())
-						{
-							GameServer()->OnClientPredictedInput(c, m_aClients[c].m_aInputs[i].m_aData);
-							break;
-						}
-					}
-				}
-
-				GameServer()->OnTick();
-				
-#ifdef CONF_SQL
-				if(m_lGameServerCmds.size())
-				{
-					lock_wait(m_GameServerCmdLock);
-					for(int i=0; i<m_lGameServerCmds.size(); i++)
-					{
-						m_lGameServerCmds[i]->Execute(GameServer());
-						delete m_lGameServerCmds[i];
-					}
-					m_lGameServerCmds.clear();
-					lock_release(m_GameServerCmdLock);
-				} 
-#endif
+				m_Journal.Tick(m_CurrentGameTick);
+				ProcessGameTick();
 			}
 
 			// snap game
 			if(NewTicks)
 			{
-				if(g_Config.m_SvHighBandwidth || (m_CurrentGameTick%2) == 0)
-					DoSnapshot();
+				// the clients are snapped at their own rates
+				m_Journal.Snap();
+				DoSnapshot();
 
 				UpdateClientRconCommands();
 			}
@@ -2545,6 +2977,8 @@ int CServer::Run()
 				if(m_aClients[c].m_State != CClient::STATE_EMPTY)
 					NonActive = false;
 
+			m_Journal.Flush();
+
 			// wait for incoming data
 			if (NonActive)
 			{
@@ -2563,6 +2997,13 @@ int CServer::Run()
 			}
 		}
 	}
+
+	Shutdown();
+	return 0;
+}
+
+void CServer::Shutdown()
+{
 	// disconnect all clients on shutdown
 	for(int i = 0; i < MAX_CLIENTS; ++i)
 	{
@@ -2574,6 +3015,8 @@ int CServer::Run()
 
 	GameServer()->OnShutdown();
 	m_pMap->Unload();
+	g_Profiler.StopRecording();
+	m_Journal.Stop();
 
 	free(m_pCurrentMapData);
 		
@@ -2589,8 +3032,158 @@ int CServer::Run()
 	}
 #endif
 /* DDNET MODIFICATION END *********************************************/
-		
-	return 0;
+}
+
+void CServer::StartJournal()
+{
+	m_Journal.Stop();
+	if(!g_Config.m_SvJournal)
+		return;
+
+	// the journal only replays if the game draws the same random numbers
+	unsigned Seed;
+	secure_random_fill(&Seed, sizeof(Seed));
+	random_seed(Seed);
+
+	char aFilename[128];
+	char aDate[20];
+	str_timestamp(aDate, sizeof(aDate));
+	str_format(aFilename, sizeof(aFilename), "journals/%s_%s.journal", GetMapName(), aDate);
+	Storage()->CreateFolder("journals", IStorage::TYPE_SAVE);
+	IOHANDLE File = Storage()->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+
+	CJournalHeader Header;
+	str_copy(Header.m_aNetVersion, GameServer()->NetVersion(), sizeof(Header.m_aNetVersion));
+	str_copy(Header.m_aMap, m_aCurrentMap, sizeof(Header.m_aMap));
+	Header.m_MapCrc = m_CurrentMapCrc;
+	Header.m_Seed = Seed;
+	Header.m_StartTick = m_CurrentGameTick;
+
+	char aBuf[256];
+	if(m_Journal.Start(File, &Header))
+	{
+		str_format(aBuf, sizeof(aBuf), "recording journal to '%s'", aFilename);
+
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			if(m_aClients[i].m_State == CClient::STATE_EMPTY)
+				continue;
+			m_Journal.Connect(i, m_NetServer.ClientAddr(i));
+			m_Journal.Restore(i, m_aClients[i].m_State, m_aClients[i].m_aName, m_aClients[i].m_aClan, m_aClients[i].m_Country);
+		}
+	}
+	else
+		str_format(aBuf, sizeof(aBuf), "failed to open journal '%s'", aFilename);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+}
+
+int CServer::RunReplay()
+{
+	CJournalReader Reader;
+	CJournalHeader Header;
+	if(!Reader.Open(Storage()->OpenFile(g_Config.m_SvReplay, IOFLAG_READ, IStorage::TYPE_ALL), &Header))
+	{
+		dbg_msg("replay", "failed to open journal '%s'", g_Config.m_SvReplay);
+		return -1;
+	}
+
+	str_copy(g_Config.m_SvMap, Header.m_aMap, sizeof(g_Config.m_SvMap));
+	if(!LoadMap(g_Config.m_SvMap))
+	{
+		dbg_msg("replay", "failed to load map. mapname='%s'", g_Config.m_SvMap);
+		return -1;
+	}
+	if(m_CurrentMapCrc != Header.m_MapCrc)
+		dbg_msg("replay", "map crc differs from the recording, expect divergence");
+	if(str_comp(Header.m_aNetVersion, GameServer()->NetVersion()) != 0)
+		dbg_msg("replay", "recorded with net version '%s'", Header.m_aNetVersion);
+
+	m_Replaying = true;
+	m_NetServer.OpenOffline(g_Config.m_SvMaxClients);
+	m_NetServer.SetCallbacks(NewClientCallback, ClientRejoinCallback, DelClientCallback, this);
+
+	random_seed(Header.m_Seed);
+	GameServer()->OnInit();
+	m_pConsole->StoreCommands(false);
+
+	m_GameStartTime = time_get();
+	m_CurrentGameTick = Header.m_StartTick;
+
+	int NumTicks = 0;
+	int NumChecks = 0;
+	int NumMismatches = 0;
+	int FirstMismatch = -1;
+	int64 StartTime = time_get_impl();
+
+	CJournalRecord Record;
+	while(m_RunServer && Reader.Next(&Record))
+	{
+		switch(Record.m_Type)
+		{
+		case JOURNALREC_TICK:
+			set_new_tick();
+			m_CurrentGameTick = Record.m_Tick;
+			ProcessGameTick();
+			NumTicks++;
+			break;
+		case JOURNALREC_SNAP:
+			DoSnapshot();
+			UpdateClientRconCommands();
+			break;
+		case JOURNALREC_CONNECT:
+			m_NetServer.ConnectOffline(Record.m_ClientID, Record.m_Addr);
+			break;
+		case JOURNALREC_REJOIN:
+			ClientRejoinCallback(Record.m_ClientID, this);
+			break;
+		case JOURNALREC_DROP:
+			// drops caused by the game itself already happened during the replay
+			if(m_aClients[Record.m_ClientID].m_State != CClient::STATE_EMPTY)
+				m_NetServer.Drop(Record.m_ClientID, Record.m_Flags, Record.m_pReason);
+			break;
+		case JOURNALREC_PACKET:
+		{
+			CNetChunk Packet;
+			mem_zero(&Packet, sizeof(Packet));
+			Packet.m_ClientID = Record.m_ClientID;
+			Packet.m_Flags = Record.m_Flags;
+			Packet.m_DataSize = Record.m_DataSize;
+			Packet.m_pData = Record.m_pData;
+			if(m_aClients[Record.m_ClientID].m_State != CClient::STATE_EMPTY)
+				ProcessClientPacket(&Packet);
+			break;
+		}
+		case JOURNALREC_CHECK:
+			NumChecks++;
+			if(Record.m_Tick != m_CheckTick || Record.m_Crc != m_CheckCrc)
+			{
+				if(FirstMismatch < 0)
+					FirstMismatch = Record.m_Tick;
+				NumMismatches++;
+			}
+			break;
+		case JOURNALREC_LATENCY:
+			m_aClients[Record.m_ClientID].m_Latency = Record.m_Latency;
+			break;
+		case JOURNALREC_RESTORE:
+			m_aClients[Record.m_ClientID].m_State = Record.m_Flags;
+			str_copy(m_aClients[Record.m_ClientID].m_aName, Record.m_pName, sizeof(m_aClients[Record.m_ClientID].m_aName));
+			str_copy(m_aClients[Record.m_ClientID].m_aClan, Record.m_pClan, sizeof(m_aClients[Record.m_ClientID].m_aClan));
+			m_aClients[Record.m_ClientID].m_Country = Record.m_Country;
+			break;
+		}
+	}
+
+	double Seconds = (time_get_impl() - StartTime) / (double)time_freq();
+	dbg_msg("replay", "replayed %d ticks (%.1f s of game time) in %.2f s, %.0f ticks/s",
+		NumTicks, NumTicks / (double)SERVER_TICK_SPEED, Seconds, Seconds > 0 ? NumTicks / Seconds : 0.0);
+	if(NumMismatches)
+		dbg_msg("replay", "%d of %d checks diverged, first at tick %d", NumMismatches, NumChecks, FirstMismatch);
+	else
+		dbg_msg("replay", "all %d checks matched", NumChecks);
+
+	Shutdown();
+	return NumMismatches ? 1 : 0;
 }
 
 bool CServer::ConUnmute(IConsole::IResult *pResult, void *pUser)
@@ -2754,7 +3347,7 @@ bool CServer::ConStatus(IConsole::IResult *pResult, void *pUser)
 				int AuthLevel = pThis->m_aClients[i].m_Authed == CServer::AUTHED_ADMIN ? 2 :
 										pThis->m_aClients[i].m_Authed == CServer::AUTHED_MOD ? 1 : 0;
 				
-				str_format(aBuf, sizeof(aBuf), "(#%02i) %s: [antispoof=%d] [login=%d] [level=%d] [ip=%s] [version=%d] [inf=%d]",
+				str_format(aBuf, sizeof(aBuf), "(#%02i) %s: [antispoof=%d] [login=%d] [level=%d] [ip=%s] [version=%d] [inf=%d] [snaprate=%d]",
 					i,
 					aBufName,
 					pThis->m_NetServer.HasSecurityToken(i),
@@ -2762,7 +3355,8 @@ bool CServer::ConStatus(IConsole::IResult *pResult, void *pUser)
 					AuthLevel,
 					aAddrStr,
 					pThis->m_aClients[i].m_DDNetVersion,
-					pThis->m_aClients[i].m_InfClassVersion
+					pThis->m_aClients[i].m_InfClassVersion,
+					SERVER_TICK_SPEED/pThis->SnapInterval(i)
 				);
 			}
 			else
@@ -2837,6 +3431,100 @@ bool CServer::ConStopRecord(IConsole::IResult *pResult, void *pUser)
 	return true;
 }
 
+bool CServer::ConNetStats(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pServer = (CServer *)pUser;
+	pServer->PrintNetStats();
+	if(!g_Config.m_SvNetStats)
+		pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "netstats", "the item types are only counted with sv_netstats 1");
+
+	return true;
+}
+
+bool CServer::ConNetStatsReset(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pServer = (CServer *)pUser;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(pServer->m_aClients[i].m_State == CClient::STATE_INGAME)
+			pServer->ResetNetStats(i);
+	}
+	mem_zero(pServer->m_aNetStatsTypes, sizeof(pServer->m_aNetStatsTypes));
+	pServer->m_NetStatsTick = pServer->Tick();
+
+	return true;
+}
+
+bool CServer::ConProfDump(IConsole::IResult *pResult, void *pUser)
+{
+	CServer* pServer = (CServer *)pUser;
+	const char *pFilter = pResult->NumArguments() ? pResult->GetString(0) : "";
+	const int64 Freq = time_freq();
+	char aBuf[256];
+
+	for(int i = 0; i < g_Profiler.NumPhases(); i++)
+	{
+		CProfiler::CStats Stats;
+		if(!g_Profiler.GetStats(i, &Stats) || !str_find(g_Profiler.PhaseName(i), pFilter))
+			continue;
+
+		str_format(aBuf, sizeof(aBuf), "%-28s samples=%3d avg=%5dus p50=%5dus p99=%5dus max=%5dus",
+			g_Profiler.PhaseName(i), Stats.m_NumSamples,
+			(int)(Stats.m_Avg*1000000/Freq), (int)(Stats.m_P50*1000000/Freq),
+			(int)(Stats.m_P99*1000000/Freq), (int)(Stats.m_Max*1000000/Freq));
+		pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profiler", aBuf);
+	}
+
+	return true;
+}
+
+bool CServer::ConProfReset(IConsole::IResult *pResult, void *pUser)
+{
+	g_Profiler.Reset();
+
+	return true;
+}
+
+bool CServer::ConProfRecord(IConsole::IResult *pResult, void *pUser)
+{
+	CServer* pServer = (CServer *)pUser;
+	char aFilename[128];
+
+	if(pResult->NumArguments())
+		str_format(aFilename, sizeof(aFilename), "profiles/%s.prof", pResult->GetString(0));
+	else
+	{
+		char aDate[20];
+		str_timestamp(aDate, sizeof(aDate));
+		str_format(aFilename, sizeof(aFilename), "profiles/profile_%s.prof", aDate);
+	}
+
+	pServer->Storage()->CreateFolder("profiles", IStorage::TYPE_SAVE);
+	IOHANDLE File = pServer->Storage()->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "unable to open '%s' for writing", aFilename);
+		pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profiler", aBuf);
+		return true;
+	}
+
+	g_Profiler.StartRecording(File);
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "recording samples to '%s'", aFilename);
+	pServer->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "profiler", aBuf);
+
+	return true;
+}
+
+bool CServer::ConProfStopRecord(IConsole::IResult *pResult, void *pUser)
+{
+	g_Profiler.StopRecording();
+
+	return true;
+}
+
 bool CServer::ConMapReload(IConsole::IResult *pResult, void *pUser)
 {
 	((CServer *)pUser)->m_MapReload = 1;
@@ -3098,6 +3786,13 @@ void CServer::RegisterCommands()
 
 	Console()->Register("reload", "", CFGFLAG_SERVER, ConMapReload, this, "Reload the map");
 
+	Console()->Register("netstats", "", CFGFLAG_SERVER, ConNetStats, this, "Print the snapshot and bandwidth counters per client and per item type");
+	Console()->Register("netstats_reset", "", CFGFLAG_SERVER, ConNetStatsReset, this, "Restart the netstats counters");
+	Console()->Register("prof_dump", "?s<phase>", CFGFLAG_SERVER, ConProfDump, this, "Print the timings of the last ticks per phase");
+	Console()->Register("prof_reset", "", CFGFLAG_SERVER, ConProfReset, this, "Clear the profiler samples");
+	Console()->Register("prof_record", "?s", CFGFLAG_SERVER, ConProfRecord, this, "Stream the profiler samples to a file");
+	Console()->Register("prof_stoprecord", "", CFGFLAG_SERVER, ConProfStopRecord, this, "Stop streaming the profiler samples");
+
 	Console()->Chain("sv_name", ConchainSpecialInfoupdate, this);
 	Console()->Chain("password", ConchainSpecialInfoupdate, this);
 
@@ -3152,6 +3847,16 @@ void *CServer::SnapNewItem(int Type, int ID, int Size)
 	return ID < 0 ? 0 : m_SnapshotBuilder.NewItem(Type, ID, Size);
 }
 
+int CServer::SnapSize()
+{
+	return m_SnapshotBuilder.Size();
+}
+
+int CServer::LastSnapTick(int ClientID) const
+{
+	return ClientID < 0 ? m_LastDemoSnapTick : m_aClients[ClientID].m_LastSnapTick;
+}
+
 void CServer::SnapSetStaticsize(int ItemType, int Size)
 {
 	m_SnapshotDelta.SetStaticsize(ItemType, Size);
@@ -8,6 +8,7 @@
 
 #include <engine/masterserver.h>
 #include <engine/server.h>
+#include <engine/server/journal.h>
 #include <engine/server/netsession.h>
 #include <engine/server/register.h>
 #include <engine/server/roundstatistics.h>
@@ -18,6 +19,9 @@
 #include <engine/shared/snapshot.h>
 #include <game/server/classes.h>
 #include <game/voting.h>
+#include <mastersrv/mastersrv.h>
+
+#include <vector>
 
 /* DDNET MODIFICATION START *******************************************/
 #include "sql_connector.h"
@@ -63,7 +67,7 @@ class CServerBan : public CNetBan
 {
 	class CServer *m_pServer;
 
-	template<class T> int BanExt(T *pBanPool, const typename T::CDataType *pData, int Seconds, const char *pReason);
+	template<class T> int BanExt(const T *pData, int Seconds, const char *pReason);
 
 public:
 	class CServer *Server() const { return m_pServer; }
@@ -119,7 +123,14 @@ public:
 
 			SNAPRATE_INIT=0,
 			SNAPRATE_FULL,
-			SNAPRATE_RECOVER
+			SNAPRATE_RECOVER,
+
+			// the full snapshot rate adapts to the link, see UpdateSnapRate
+			SNAPLEVEL_50HZ=0,
+			SNAPLEVEL_25HZ,
+			SNAPLEVEL_16HZ,
+			SNAPLEVEL_10HZ,
+			NUM_SNAPLEVELS
 		};
 
 		class CInput
@@ -136,6 +147,35 @@ public:
 		int m_SnapRate;
 		bool m_Quitting;
 
+		int m_SnapLevel;
+		int m_LastSnapTick;
+
+		// measurements of the current rate window
+		int m_SnapWindowTick;
+		int m_SnapCleanWindows;
+		int m_SnapsSent;
+		int m_SnapsAcked;
+		int m_SnapPackets;
+		int m_MinAckRtt;
+		int m_WindowAckRtt;
+		int m_WindowSentPackets;
+		int m_WindowResentChunks;
+
+		// snapshot accounting for netstats, since the client entered the
+		// game or netstats_reset
+		enum
+		{
+			NUM_SNAPSIZE_BUCKETS = 8, // empty, then up to 64, 128, ..., 2048 bytes and more
+		};
+		int m_StatsTick;
+		int m_StatsSentBytes; // connection counters at the start
+		int m_StatsResentChunks;
+		int m_StatsSnaps;
+		int m_StatsFullSnaps; // snapshots not sent as a delta, as nothing was acked
+		int64 m_StatsSnapBytes;
+		int64 m_StatsSnapItems;
+		int m_aStatsSnapSizes[NUM_SNAPSIZE_BUCKETS];
+
 		int m_LastAckedSnapshot;
 		int m_LastInputTick;
 		CSnapshotStorage m_Snapshots;
@@ -194,6 +234,8 @@ public:
 
 	CSnapshotDelta m_SnapshotDelta;
 	CSnapshotBuilder m_SnapshotBuilder;
+	int m_NetStatsTick; // start of the item type stats
+	CSnapshotDelta::CTypeStats m_aNetStatsTypes[CSnapshotDelta::NUM_TYPE_STATS]; // counted with sv_netstats
 	CSnapIDPool m_IDPool;
 	CNetServer m_NetServer;
 	CEcon m_Econ;
@@ -224,9 +266,46 @@ public:
 	int64 m_ServerInfoFirstRequest;
 	int m_ServerInfoNumRequests;
 
+	// prebuilt info responses, the requester's token is inserted when sending
+	struct CServerInfoCache
+	{
+		struct CPacket
+		{
+			const unsigned char *m_pMagic;
+			std::vector<unsigned char> m_vBody;
+		};
+
+		std::vector<CPacket> m_vPackets;
+		bool m_Valid;
+		int64 m_BuildTime;
+
+		CServerInfoCache() : m_Valid(false), m_BuildTime(0) {}
+	};
+	CServerInfoCache m_aServerInfoCache[SERVERINFO_INGAME+1][2];
+	int m_ClientInfoRevision; // expires with the server info
+
+	// token buckets for connless info requests, indexed by a hash of the address
+	struct CInfoRequestBucket
+	{
+		NETADDR m_Addr;
+		int64 m_LastTime;
+		float m_Tokens;
+	};
+	enum
+	{
+		NUM_INFO_REQUEST_BUCKETS = 1024,
+	};
+	CInfoRequestBucket m_aInfoRequestBuckets[NUM_INFO_REQUEST_BUCKETS];
+
 	CDemoRecorder m_DemoRecorder;
 	CRegister m_Register;
 
+	CJournalWriter m_Journal;
+	bool m_Replaying;
+	int m_CheckTick;
+	unsigned m_CheckCrc;
+	int m_LastDemoSnapTick;
+
 	int m_RconRestrict;
 
 	CServer();
@@ -258,6 +337,7 @@ public:
 	const char *ClientName(int ClientID) const;
 	const char *ClientClan(int ClientID) const;
 	int ClientCountry(int ClientID) const;
+	int ClientInfoRevision() const { return m_ClientInfoRevision; }
 	bool ClientIngame(int ClientID) const;
 	int Port() const;
 	int MaxClients() const;
@@ -266,7 +346,13 @@ public:
 
 	virtual int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID);
 
+	int SnapInterval(int ClientID) const;
+	void UpdateSnapRate(int ClientID);
 	void DoSnapshot();
+	void ResetNetStats(int ClientID);
+	void CountSnapshot(int ClientID, int NumItems, int Size, bool Full);
+	void PrintNetStats();
+	void ProcessGameTick();
 
 	static int ClientRejoinCallback(int ClientID, void *pUser);
 	static int NewClientCallback(int ClientID, void *pUser);
@@ -285,8 +371,11 @@ public:
 
 	void ProcessClientPacket(CNetChunk *pPacket);
 
+	void CacheServerInfo(CServerInfoCache *pCache, int Type, bool SendClients, const NETADDR *pAddr);
 	void SendServerInfo(const NETADDR *pAddr, int Token, int Type, bool SendClients);
+	bool AllowInfoRequest(const NETADDR *pAddr);
 	void SendServerInfoConnless(const NETADDR *pAddr, int Token, int Type);
+	void ExpireServerInfo();
 	void UpdateServerInfo();
 
 	void PumpNetwork();
@@ -297,7 +386,10 @@ public:
 	int LoadMap(const char *pMapName);
 
 	void InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterServer, IConsole *pConsole);
+	void StartJournal();
+	int RunReplay();
 	int Run();
+	void Shutdown();
 
 	static bool ConKick(IConsole::IResult *pResult, void *pUser);
 	static bool ConStatus(IConsole::IResult *pResult, void *pUser);
@@ -306,6 +398,12 @@ public:
 	static bool ConShutdown(IConsole::IResult *pResult, void *pUser);
 	static bool ConRecord(IConsole::IResult *pResult, void *pUser);
 	static bool ConStopRecord(IConsole::IResult *pResult, void *pUser);
+	static bool ConNetStats(IConsole::IResult *pResult, void *pUser);
+	static bool ConNetStatsReset(IConsole::IResult *pResult, void *pUser);
+	static bool ConProfDump(IConsole::IResult *pResult, void *pUser);
+	static bool ConProfReset(IConsole::IResult *pResult, void *pUser);
+	static bool ConProfRecord(IConsole::IResult *pResult, void *pUser);
+	static bool ConProfStopRecord(IConsole::IResult *pResult, void *pUser);
 	static bool ConMapReload(IConsole::IResult *pResult, void *pUser);
 	static bool ConLogout(IConsole::IResult *pResult, void *pUser);
 	static bool ConchainSpecialInfoupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
@@ -336,6 +434,8 @@ public:
 	virtual int SnapNewID();
 	virtual void SnapFreeID(int ID);
 	virtual void *SnapNewItem(int Type, int ID, int Size);
+	virtual int SnapSize();
+	virtual int LastSnapTick(int ClientID) const;
 	void SnapSetStaticsize(int ItemType, int Size);
 	
 /* INFECTION MODIFICATION START ***************************************/
@@ -20,6 +20,11 @@ MACRO_CONFIG_STR(SvMap, sv_map, 128, "", CFGFLAG_SERVER, "Map to use on the serv
 MACRO_CONFIG_INT(SvMaxClients, sv_max_clients, 64, 1, MAX_CLIENTS, CFGFLAG_SERVER, "Maximum number of clients that are allowed on a server")
 MACRO_CONFIG_INT(SvMaxClientsPerIP, sv_max_clients_per_ip, 4, 1, MAX_CLIENTS, CFGFLAG_SERVER, "Maximum number of clients with the same IP that can connect to the server")
 MACRO_CONFIG_INT(SvHighBandwidth, sv_high_bandwidth, 0, 0, 1, CFGFLAG_SERVER, "Use high bandwidth mode. Doubles the bandwidth required for the server. LAN use only")
+MACRO_CONFIG_INT(SvSnapBudget, sv_snap_budget, 0, 0, 65536, CFGFLAG_SERVER, "Snapshot bytes per client before decorative and then gameplay items are thinned and left out (0 = no budget)")
+MACRO_CONFIG_INT(SvSpecViewScale, sv_spec_view_scale, 100, 100, 400, CFGFLAG_SERVER, "View range of free view spectators in percent of the player view, for zoomed out spectators")
+MACRO_CONFIG_INT(SvSnapRateMax, sv_snap_rate_max, 25, 10, 50, CFGFLAG_SERVER, "Highest snapshot rate in Hz for clients on good links, lossy links step down to 16 and 10 Hz")
+MACRO_CONFIG_INT(SvNetStats, sv_netstats, 0, 0, 1, CFGFLAG_SERVER, "Count the snapshot items and bytes per item type for netstats")
+MACRO_CONFIG_INT(SvNetStatsInterval, sv_netstats_interval, 0, 0, 3600, CFGFLAG_SERVER, "Seconds between the netstats lines in the log (0 = off)")
 MACRO_CONFIG_INT(SvRegister, sv_register, 1, 0, 1, CFGFLAG_SERVER, "Register server with master server for public listing")
 MACRO_CONFIG_STR(SvRconPassword, sv_rcon_password, 32, "", CFGFLAG_SERVER, "Remote console password (full access)")
 MACRO_CONFIG_STR(SvRconModPassword, sv_rcon_mod_password, 32, "", CFGFLAG_SERVER, "Remote console password for moderators (limited access)")
@@ -29,6 +34,8 @@ MACRO_CONFIG_INT(SvRconTokenCheck, sv_rcon_token_check, 1, 0, 1, CFGFLAG_SERVER,
 MACRO_CONFIG_INT(SvAutoDemoRecord, sv_auto_demo_record, 0, 0, 1, CFGFLAG_SERVER, "Automatically record demos")
 MACRO_CONFIG_INT(SvAutoDemoMax, sv_auto_demo_max, 10, 0, 1000, CFGFLAG_SERVER, "Maximum number of automatically recorded demos (0 = no limit)")
 MACRO_CONFIG_INT(SvServerInfoPerSecond, sv_server_info_per_second, 10, 1, 1000, CFGFLAG_SERVER, "Maximum number of complete server info responses that are sent out per second")
+MACRO_CONFIG_INT(SvServerInfoIpRate, sv_server_info_ip_rate, 5, 0, 1000, CFGFLAG_SERVER, "Info requests per second that are answered for one address (0 for no limit)")
+MACRO_CONFIG_INT(SvServerInfoIpBurst, sv_server_info_ip_burst, 10, 1, 1000, CFGFLAG_SERVER, "Info requests one address may send at once before sv_server_info_ip_rate applies")
 MACRO_CONFIG_INT(SvHideInfo, sv_hide_info, 0, 0, 1, CFGFLAG_SERVER, "Hide the server info")
 MACRO_CONFIG_INT(SvInfoMaxClients, sv_info_max_clients, -1, -1, 128, CFGFLAG_SERVER, "Limit the server info max clients number (-1 means 'unlimited')")
 
@@ -44,6 +51,9 @@ MACRO_CONFIG_INT(DbgStress, dbg_stress, 0, 0, 0, CFGFLAG_SERVER, "Stress systems
 MACRO_CONFIG_INT(DbgStressNetwork, dbg_stress_network, 0, 0, 0, CFGFLAG_SERVER, "Stress network")
 MACRO_CONFIG_INT(DbgPref, dbg_pref, 0, 0, 1, CFGFLAG_SERVER, "Performance outputs")
 MACRO_CONFIG_INT(DbgHitch, dbg_hitch, 0, 0, 0, CFGFLAG_SERVER, "Hitch warnings")
+MACRO_CONFIG_INT(DbgProfile, dbg_profile, 1, 0, 1, CFGFLAG_SERVER, "Measure the time spent in each tick phase (see prof_dump)")
+MACRO_CONFIG_INT(SvJournal, sv_journal, 0, 0, 1, CFGFLAG_SERVER, "Record all client input of every map to journals/ for offline replay (rcon, passwords and client IPs are left out, chat is kept)")
+MACRO_CONFIG_STR(SvReplay, sv_replay, 128, "", CFGFLAG_SERVER, "Replay the given journal without opening a socket, then quit")
 
 MACRO_CONFIG_STR(SvBroadcast, sv_broadcast, 64, "DDRace.info Trunk 0.5", CFGFLAG_SERVER, "The broadcasting message")
 MACRO_CONFIG_INT(SvShutdownWhenEmpty, sv_shutdown_when_empty, 0, 0, 1, CFGFLAG_SERVER, "Shutdown server as soon as noone is on it anymore")
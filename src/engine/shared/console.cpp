@@ -1,5 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <algorithm>
 #include <new>
 
 #include <base/math.h>
@@ -288,8 +289,154 @@ bool CConsole::LineIsValid(const char *pStr)
 	return true;
 }
 
+void CConsole::ExecuteCommand(CCommand *pCommand, CResult *pResult)
+{
+	if(m_StoreCommands && pCommand->m_Flags&CFGFLAG_STORE)
+	{
+		m_ExecutionQueue.AddEntry();
+		m_ExecutionQueue.m_pLast->m_pfnCommandCallback = pCommand->m_pfnCallback;
+		m_ExecutionQueue.m_pLast->m_pCommandUserData = pCommand->m_pUserData;
+		m_ExecutionQueue.m_pLast->m_Result = *pResult;
+		return;
+	}
+
+	int64 Start = time_get_impl();
+	bool ValideArguments = pCommand->m_pfnCallback(pResult, pCommand->m_pUserData);
+	int64 Duration = time_get_impl() - Start;
+	pCommand->m_NumCalls++;
+	pCommand->m_TotalTime += Duration;
+	pCommand->m_MaxTime = maximum(pCommand->m_MaxTime, Duration);
+
+	if(!ValideArguments)
+	{
+		char aBuf[256];
+		
+		str_format(aBuf, sizeof(aBuf), "Usage: %s %s", pCommand->m_pName, pCommand->m_pUsage);
+		
+		Print(OUTPUT_LEVEL_STANDARD, "Console", "Invalid arguments.");
+		Print(OUTPUT_LEVEL_STANDARD, "Console", aBuf);
+	}
+}
+
+CConsole::CCachedLine *CConsole::FindCachedLine(const char *pStr, unsigned Hash)
+{
+	for(int i = 0; i < LINE_CACHE_SIZE; i++)
+	{
+		CCachedLine *pLine = &m_aLineCache[i];
+		if(pLine->m_Hash == Hash && pLine->m_Version == m_CommandsVersion && pLine->m_FlagMask == m_FlagMask &&
+			!pLine->m_vCommands.empty() && str_comp(pLine->m_aLine, pStr) == 0)
+		{
+			pLine->m_LastUse = ++m_LineCacheTick;
+			return pLine;
+		}
+	}
+	return 0;
+}
+
+void CConsole::CacheLine(const char *pStr, unsigned Hash, std::vector<CCachedCommand> &vCommands)
+{
+	CCachedLine *pOldest = 0;
+	for(int i = 0; i < LINE_CACHE_SIZE; i++)
+	{
+		if(!m_aLineCache[i].m_Pinned && (!pOldest || m_aLineCache[i].m_LastUse < pOldest->m_LastUse))
+			pOldest = &m_aLineCache[i];
+	}
+	if(!pOldest)
+		return;
+
+	str_copy(pOldest->m_aLine, pStr, sizeof(pOldest->m_aLine));
+	pOldest->m_Hash = Hash;
+	pOldest->m_FlagMask = m_FlagMask;
+	pOldest->m_Version = m_CommandsVersion;
+	pOldest->m_LastUse = ++m_LineCacheTick;
+	pOldest->m_vCommands.swap(vCommands);
+}
+
+void CConsole::ExecuteCachedLine(CCachedLine *pLine, int ClientID, bool TeamChat)
+{
+	// commands run from here may execute and cache other lines
+	pLine->m_Pinned++;
+	int Version = m_CommandsVersion;
+
+	for(unsigned i = 0; i < pLine->m_vCommands.size(); i++)
+	{
+		const CCachedCommand *pCached = &pLine->m_vCommands[i];
+		CCommand *pCommand = pCached->m_pCommand;
+
+		if(pCommand->GetAccessLevel() >= m_AccessLevel)
+		{
+			CResult Result;
+			Result.SetClientID(ClientID);
+			Result.SetTeamChat(TeamChat);
+			mem_copy(Result.m_aStringStorage, pCached->m_aStorage, pCached->m_StorageSize);
+			Result.m_pCommand = Result.m_aStringStorage + pCached->m_Command;
+			Result.m_pArgsStart = Result.m_aStringStorage + pCached->m_ArgsStart;
+			for(int a = 0; a < pCached->m_NumArgs; a++)
+				Result.AddArgument(Result.m_aStringStorage + pCached->m_aArgs[a]);
+
+			ExecuteCommand(pCommand, &Result);
+		}
+		else
+		{
+			char aBuf[256];
+			str_format(aBuf, sizeof(aBuf), "Access for command %s denied.", pCommand->m_pName);
+			Print(OUTPUT_LEVEL_STANDARD, "Console", aBuf);
+		}
+
+		// the commands changed, parse the rest of the line again
+		if(m_CommandsVersion != Version)
+		{
+			if(pCached->m_NextPart >= 0)
+				ExecuteLineStroked(1, pLine->m_aLine + pCached->m_NextPart, ClientID, TeamChat);
+			break;
+		}
+	}
+
+	pLine->m_Pinned--;
+}
+
+static unsigned HashLine(const char *pStr, int *pLength)
+{
+	unsigned Hash = 2166136261u;
+	const char *p = pStr;
+	for(; *p; p++)
+		Hash = (Hash ^ (unsigned char)*p) * 16777619u;
+	*pLength = p - pStr;
+	return Hash;
+}
+
 void CConsole::ExecuteLineStroked(int Stroke, const char *pStr, int ClientID, bool TeamChat)
 {
+	if(!pStr)
+		return;
+
+	// lines without stroke commands are cached once they ran successfully,
+	// they only do something when pressed
+	int Length;
+	unsigned LineHash = HashLine(pStr, &Length);
+	bool Cacheable = false;
+	if(Length < MAX_CACHED_LINE_LENGTH)
+	{
+		CCachedLine *pLine = FindCachedLine(pStr, LineHash);
+		if(pLine)
+		{
+			if(Stroke)
+			{
+				m_LineCacheHits++;
+				ExecuteCachedLine(pLine, ClientID, TeamChat);
+			}
+			return;
+		}
+		if(Stroke)
+		{
+			m_LineCacheMisses++;
+			Cacheable = true;
+		}
+	}
+	const char *pLineStart = pStr;
+	int Version = m_CommandsVersion;
+	std::vector<CCachedCommand> vParsed;
+
 	while(pStr && *pStr)
 	{
 		CResult Result;
@@ -340,6 +487,7 @@ void CConsole::ExecuteLineStroked(int Stroke, const char *pStr, int ClientID, bo
 					// insert the stroke direction token
 					Result.AddArgument(m_paStrokeStr[Stroke]);
 					IsStrokeCommand = 1;
+					Cacheable = false;
 				}
 
 				if(Stroke || IsStrokeCommand)
@@ -352,45 +500,56 @@ void CConsole::ExecuteLineStroked(int Stroke, const char *pStr, int ClientID, bo
 						
 						Print(OUTPUT_LEVEL_STANDARD, "Console", "Invalid arguments.");
 						Print(OUTPUT_LEVEL_STANDARD, "Console", aBuf);
-					}
-					else if(m_StoreCommands && pCommand->m_Flags&CFGFLAG_STORE)
-					{
-						m_ExecutionQueue.AddEntry();
-						m_ExecutionQueue.m_pLast->m_pfnCommandCallback = pCommand->m_pfnCallback;
-						m_ExecutionQueue.m_pLast->m_pCommandUserData = pCommand->m_pUserData;
-						m_ExecutionQueue.m_pLast->m_Result = Result;
+						Cacheable = false;
 					}
 					else
 					{
-						bool ValideArguments = pCommand->m_pfnCallback(&Result, pCommand->m_pUserData);
-						if(!ValideArguments)
+						if(Cacheable)
 						{
-							char aBuf[256];
-							
-							str_format(aBuf, sizeof(aBuf), "Usage: %s %s", pCommand->m_pName, pCommand->m_pUsage);
-							
-							Print(OUTPUT_LEVEL_STANDARD, "Console", "Invalid arguments.");
-							Print(OUTPUT_LEVEL_STANDARD, "Console", aBuf);
+							// keep the parsed form before the command can change it
+							vParsed.resize(vParsed.size()+1);
+							CCachedCommand *pCached = &vParsed.back();
+							pCached->m_pCommand = pCommand;
+							pCached->m_StorageSize = minimum((int)(pEnd-pStr) + 1, (int)sizeof(pCached->m_aStorage));
+							mem_copy(pCached->m_aStorage, Result.m_aStringStorage, pCached->m_StorageSize);
+							pCached->m_Command = Result.m_pCommand - Result.m_aStringStorage;
+							pCached->m_ArgsStart = Result.m_pArgsStart - Result.m_aStringStorage;
+							pCached->m_NumArgs = Result.NumArguments();
+							for(int a = 0; a < pCached->m_NumArgs; a++)
+								pCached->m_aArgs[a] = Result.m_apArgs[a] - Result.m_aStringStorage;
+							pCached->m_NextPart = pNextPart ? pNextPart - pLineStart : -1;
 						}
+						ExecuteCommand(pCommand, &Result);
 					}
 				}
 			}
-			else if(Stroke)
+			else
 			{
-				char aBuf[256];
-				str_format(aBuf, sizeof(aBuf), "Access for command %s denied.", Result.m_pCommand);
-				Print(OUTPUT_LEVEL_STANDARD, "Console", aBuf);
+				Cacheable = false;
+				if(Stroke)
+				{
+					char aBuf[256];
+					str_format(aBuf, sizeof(aBuf), "Access for command %s denied.", Result.m_pCommand);
+					Print(OUTPUT_LEVEL_STANDARD, "Console", aBuf);
+				}
 			}
 		}
-		else if(Stroke)
+		else
 		{
-			char aBuf[256];
-			str_format(aBuf, sizeof(aBuf), "No such command: %s.", Result.m_pCommand);
-			Print(OUTPUT_LEVEL_STANDARD, "Console", aBuf);
+			Cacheable = false;
+			if(Stroke)
+			{
+				char aBuf[256];
+				str_format(aBuf, sizeof(aBuf), "No such command: %s.", Result.m_pCommand);
+				Print(OUTPUT_LEVEL_STANDARD, "Console", aBuf);
+			}
 		}
 
 		pStr = pNextPart;
 	}
+
+	if(Cacheable && !vParsed.empty() && Version == m_CommandsVersion)
+		CacheLine(pLineStart, LineHash, vParsed);
 }
 
 void CConsole::PossibleCommands(const char *pStr, int FlagMask, bool Temp, FPossibleCallback pfnCallback, void *pUser)
@@ -405,15 +564,63 @@ void CConsole::PossibleCommands(const char *pStr, int FlagMask, bool Temp, FPoss
 	}
 }
 
-CConsole::CCommand *CConsole::FindCommand(const char *pName, int FlagMask)
+unsigned CConsole::HashCommandName(const char *pName)
 {
+	unsigned Hash = 2166136261u;
+	for(; *pName; pName++)
+	{
+		unsigned char c = *pName;
+		if(c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		Hash = (Hash ^ c) * 16777619u;
+	}
+	return Hash;
+}
+
+void CConsole::HashCommand(CCommand *pCommand)
+{
+	if((m_NumHashedCommands+1)*2 > (int)m_vCommandHash.size())
+	{
+		// the rebuild picks up the new command from the list
+		RebuildCommandHash(maximum(256, (int)m_vCommandHash.size()*2));
+		return;
+	}
+
+	pCommand->m_Hash = HashCommandName(pCommand->m_pName);
+	unsigned Mask = m_vCommandHash.size()-1;
+	unsigned Slot = pCommand->m_Hash&Mask;
+	while(m_vCommandHash[Slot])
+		Slot = (Slot+1)&Mask;
+	m_vCommandHash[Slot] = pCommand;
+	m_NumHashedCommands++;
+}
+
+void CConsole::RebuildCommandHash(int Size)
+{
+	m_vCommandHash.assign(Size, 0);
+	m_NumHashedCommands = 0;
 	for(CCommand *pCommand = m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+		HashCommand(pCommand);
+}
+
+void CConsole::OnCommandsChanged()
+{
+	// cached lines point at the commands
+	m_CommandsVersion++;
+}
+
+CConsole::CCommand *CConsole::FindCommand(const char *pName, int FlagMask)
+{
+	if(m_vCommandHash.empty())
+		return 0x0;
+
+	unsigned Hash = HashCommandName(pName);
+	unsigned Mask = m_vCommandHash.size()-1;
+	for(unsigned Slot = Hash&Mask; m_vCommandHash[Slot]; Slot = (Slot+1)&Mask)
 	{
-		if(pCommand->m_Flags&FlagMask)
-		{
-			if(str_comp_nocase(pCommand->m_pName, pName) == 0)
-				return pCommand;
-		}
+		CCommand *pCommand = m_vCommandHash[Slot];
+		if(pCommand->m_Hash == Hash && pCommand->m_Flags&FlagMask && str_comp_nocase(pCommand->m_pName, pName) == 0)
+			return pCommand;
 	}
 
 	return 0x0;
@@ -554,6 +761,35 @@ bool CConsole::ConModCommandStatus(IResult *pResult, void *pUser)
 	return true;
 }
 
+bool CConsole::ConCommandStats(IResult *pResult, void *pUser)
+{
+	CConsole *pConsole = static_cast<CConsole *>(pUser);
+	int Count = pResult->NumArguments() ? maximum(1, pResult->GetInteger(0)) : 20;
+
+	std::vector<CCommand *> vCommands;
+	for(CCommand *pCommand = pConsole->m_pFirstCommand; pCommand; pCommand = pCommand->m_pNext)
+	{
+		if(pCommand->m_NumCalls)
+			vCommands.push_back(pCommand);
+	}
+	std::sort(vCommands.begin(), vCommands.end(), [](const CCommand *pA, const CCommand *pB) { return pA->m_TotalTime > pB->m_TotalTime; });
+
+	char aBuf[256];
+	double Scale = 1000000.0 / time_freq();
+	for(int i = 0; i < (int)vCommands.size() && i < Count; i++)
+	{
+		const CCommand *pCommand = vCommands[i];
+		str_format(aBuf, sizeof(aBuf), "%s: calls=%d total=%.0fus avg=%.1fus max=%.0fus", pCommand->m_pName, pCommand->m_NumCalls,
+			pCommand->m_TotalTime * Scale, pCommand->m_TotalTime * Scale / pCommand->m_NumCalls, pCommand->m_MaxTime * Scale);
+		pConsole->Print(OUTPUT_LEVEL_STANDARD, "Console", aBuf);
+	}
+
+	str_format(aBuf, sizeof(aBuf), "%d commands in %d hash slots, line cache hits=%d misses=%d",
+		pConsole->m_NumHashedCommands, (int)pConsole->m_vCommandHash.size(), pConsole->m_LineCacheHits, pConsole->m_LineCacheMisses);
+	pConsole->Print(OUTPUT_LEVEL_STANDARD, "Console", aBuf);
+	return true;
+}
+
 struct CIntVariableData
 {
 	IConsole *m_pConsole;
@@ -861,6 +1097,20 @@ CConsole::CConsole(int FlagMask)
 	m_pFirstExec = 0;
 	mem_zero(m_aPrintCB, sizeof(m_aPrintCB));
 	m_NumPrintCB = 0;
+	m_NumHashedCommands = 0;
+	m_CommandsVersion = 0;
+	for(int i = 0; i < LINE_CACHE_SIZE; i++)
+	{
+		m_aLineCache[i].m_aLine[0] = 0;
+		m_aLineCache[i].m_Hash = 0;
+		m_aLineCache[i].m_FlagMask = 0;
+		m_aLineCache[i].m_Version = -1;
+		m_aLineCache[i].m_LastUse = 0;
+		m_aLineCache[i].m_Pinned = 0;
+	}
+	m_LineCacheTick = 0;
+	m_LineCacheHits = 0;
+	m_LineCacheMisses = 0;
 
 	m_pStorage = 0;
 
@@ -876,6 +1126,7 @@ CConsole::CConsole(int FlagMask)
 	Register("adjust", "si", CFGFLAG_SERVER, ConAdjustVariable, this, "Adjust the variable value (add the given delta)");
 	Register("get", "s", CFGFLAG_SERVER, ConModCommandGet, this, "Get the value of a config variable");
 	Register("dump_variables", "", CFGFLAG_SERVER|CFGFLAG_CLIENT, ConModCommandDumpVariables, this, "Dump all config variables");
+	Register("command_stats", "?i<count>", CFGFLAG_SERVER, ConCommandStats, this, "List the commands that took the most time");
 
 	// TODO: this should disappear
 	#define MACRO_CONFIG_INT(Name,ScriptName,Def,Min,Max,Flags,Desc) \
@@ -937,10 +1188,7 @@ void CConsole::AddCommandSorted(CCommand *pCommand)
 {
 	if(!m_pFirstCommand || str_comp(pCommand->m_pName, m_pFirstCommand->m_pName) <= 0)
 	{
-		if(m_pFirstCommand && m_pFirstCommand->m_pNext)
-			pCommand->m_pNext = m_pFirstCommand;
-		else
-			pCommand->m_pNext = 0;
+		pCommand->m_pNext = m_pFirstCommand;
 		m_pFirstCommand = pCommand;
 	}
 	else
@@ -1066,7 +1314,11 @@ void CConsole::Register(const char *pName, const char *pParams,
 		pCommand->SetAccessLevel(ACCESS_LEVEL_USER);
 		
 	if(DoAdd)
+	{
 		AddCommandSorted(pCommand);
+		HashCommand(pCommand);
+	}
+	OnCommandsChanged();
 }
 
 void CConsole::RegisterTemp(const char *pName, const char *pParams,	int Flags, const char *pHelp)
@@ -1079,6 +1331,9 @@ void CConsole::RegisterTemp(const char *pName, const char *pParams,	int Flags, c
 		GenerateUsage(pParams, pCommand->m_pUsage);
 		str_copy(const_cast<char *>(pCommand->m_pHelp), pHelp, TEMPCMD_HELP_LENGTH);
 		str_copy(const_cast<char *>(pCommand->m_pParams), pParams, TEMPCMD_PARAMS_LENGTH);
+		pCommand->m_NumCalls = 0;
+		pCommand->m_TotalTime = 0;
+		pCommand->m_MaxTime = 0;
 
 		m_pRecycleList = m_pRecycleList->m_pNext;
 	}
@@ -1107,6 +1362,8 @@ void CConsole::RegisterTemp(const char *pName, const char *pParams,	int Flags, c
 	pCommand->m_Temp = true;
 
 	AddCommandSorted(pCommand);
+	HashCommand(pCommand);
+	OnCommandsChanged();
 }
 
 void CConsole::DeregisterTemp(const char *pName)
@@ -1138,6 +1395,8 @@ void CConsole::DeregisterTemp(const char *pName)
 	{
 		pRemoved->m_pNext = m_pRecycleList;
 		m_pRecycleList = pRemoved;
+		RebuildCommandHash(m_vCommandHash.size());
+		OnCommandsChanged();
 	}
 }
 
@@ -1159,6 +1418,8 @@ void CConsole::DeregisterTempAll()
 
 	m_TempCommands.Reset();
 	m_pRecycleList = 0;
+	RebuildCommandHash(m_vCommandHash.size());
+	OnCommandsChanged();
 }
 
 bool CConsole::Con_Chain(IResult *pResult, void *pUserData)
@@ -6,6 +6,8 @@
 #include <engine/console.h>
 #include "memheap.h"
 
+#include <vector>
+
 class CConsole : public IConsole
 {
 	class CCommand : public CCommandInfo
@@ -16,6 +18,14 @@ class CConsole : public IConsole
 		bool m_Temp;
 		FCommandCallback m_pfnCallback;
 		void *m_pUserData;
+		unsigned m_Hash;
+
+		// execution stats, times in time_get_impl() units
+		int m_NumCalls;
+		int64 m_TotalTime;
+		int64 m_MaxTime;
+
+		CCommand() : m_NumCalls(0), m_TotalTime(0), m_MaxTime(0) {}
 
 		virtual const CCommandInfo *NextCommandInfo(int AccessLevel, int FlagMask) const;
 
@@ -61,6 +71,7 @@ class CConsole : public IConsole
 	static bool ConModCommandDumpVariables(IResult *pResult, void *pUserData);
 	static bool ConModCommandAccess(IResult *pResult, void *pUser);
 	static bool ConModCommandStatus(IConsole::IResult *pResult, void *pUser);
+	static bool ConCommandStats(IConsole::IResult *pResult, void *pUser);
 
 	void ExecuteFileRecurse(const char *pFilename);
 	void ExecuteLineStroked(int Stroke, const char *pStr, int ClientID, bool TeamChat);
@@ -88,12 +99,12 @@ class CConsole : public IConsole
 		const char *m_pCommand;
 		const char *m_apArgs[MAX_PARTS];
 
+		// only the first m_NumArgs arguments are ever read
 		CResult() : IResult()
 		{
-			mem_zero(m_aStringStorage, sizeof(m_aStringStorage));
+			m_aStringStorage[0] = 0;
 			m_pArgsStart = 0;
 			m_pCommand = 0;
-			mem_zero(m_apArgs, sizeof(m_apArgs));
 		}
 
 		CResult &operator =(const CResult &Other)
@@ -169,6 +180,57 @@ class CConsole : public IConsole
 
 	void AddCommandSorted(CCommand *pCommand);
 	CCommand *FindCommand(const char *pName, int FlagMask);
+	void ExecuteCommand(CCommand *pCommand, CResult *pResult);
+
+	// open addressing hash over the command names, case insensitive
+	std::vector<CCommand *> m_vCommandHash;
+	int m_NumHashedCommands;
+	// bumped whenever commands are added, changed or removed
+	int m_CommandsVersion;
+
+	static unsigned HashCommandName(const char *pName);
+	void HashCommand(CCommand *pCommand);
+	void RebuildCommandHash(int Size);
+	void OnCommandsChanged();
+
+	// recently executed lines with their parsed commands
+	enum
+	{
+		LINE_CACHE_SIZE = 64,
+		MAX_CACHED_LINE_LENGTH = 256,
+	};
+
+	struct CCachedCommand
+	{
+		CCommand *m_pCommand;
+		char m_aStorage[MAX_CACHED_LINE_LENGTH];
+		int m_StorageSize;
+		int m_Command;
+		int m_ArgsStart;
+		int m_NumArgs;
+		unsigned char m_aArgs[MAX_CACHED_LINE_LENGTH/2];
+		int m_NextPart; // offset of the rest of the line, -1 at the end
+	};
+
+	struct CCachedLine
+	{
+		char m_aLine[MAX_CACHED_LINE_LENGTH];
+		unsigned m_Hash;
+		int m_FlagMask;
+		int m_Version;
+		int m_LastUse;
+		int m_Pinned; // executing right now, must not be replaced
+		std::vector<CCachedCommand> m_vCommands;
+	};
+
+	CCachedLine m_aLineCache[LINE_CACHE_SIZE];
+	int m_LineCacheTick;
+	int m_LineCacheHits;
+	int m_LineCacheMisses;
+
+	CCachedLine *FindCachedLine(const char *pStr, unsigned Hash);
+	void CacheLine(const char *pStr, unsigned Hash, std::vector<CCachedCommand> &vCommands);
+	void ExecuteCachedLine(CCachedLine *pLine, int ClientID, bool TeamChat);
 
 public:
 	CConsole(int FlagMask);
@@ -101,68 +101,69 @@ struct CDatafileInfo
 	char *m_pDataStart;
 };
 
+// a data block that was loaded once
+struct CDatafileBlock
+{
+	char *m_pData;
+	bool m_Owned; // decompressed, otherwise it points into the mapping
+	bool m_Released; // unloaded by the user but kept for reuse
+	int m_ReleaseTick;
+};
+
 struct CDatafile
 {
-	IOHANDLE m_File;
+	void *m_pMapping;
+	unsigned m_MappingSize;
+	bool m_HashesValid;
 	SHA256_DIGEST m_Sha256;
 	unsigned m_Crc;
 	CDatafileInfo m_Info;
 	CDatafileHeader m_Header;
 	int m_DataStartOffset;
-	char **m_ppDataPtrs;
-	char *m_pData;
+	CDatafileBlock *m_pBlocks;
+	int m_ReleasedSize;
+	int m_ReleaseTick;
 };
 
 bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int StorageType)
 {
 	dbg_msg("datafile", "loading. filename='%s'", pFilename);
 
-	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType);
+	char aPath[IO_MAX_PATH_LENGTH];
+	str_copy(aPath, pFilename, sizeof(aPath));
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, aPath, sizeof(aPath));
 	if(!File)
 	{
 		dbg_msg("datafile", "could not open '%s'", pFilename);
 		return false;
 	}
+	io_close(File);
 
-	// take the CRC of the file and store it
-	unsigned Crc = 0;
-	SHA256_DIGEST Sha256;
+	// the game patches some items in place, keep those changes private
+	unsigned MappingSize;
+	void *pMapping = io_map_file_private(aPath, &MappingSize);
+	if(!pMapping)
 	{
-		enum
-		{
-			BUFFER_SIZE = 64 * 1024
-		};
-
-		SHA256_CTX Sha256Ctxt;
-		sha256_init(&Sha256Ctxt);
-		unsigned char aBuffer[BUFFER_SIZE];
-
-		while(1)
-		{
-			unsigned Bytes = io_read(File, aBuffer, BUFFER_SIZE);
-			if(Bytes <= 0)
-				break;
-			Crc = crc32(Crc, aBuffer, Bytes); // ignore_convention
-			sha256_update(&Sha256Ctxt, aBuffer, Bytes);
-		}
-		Sha256 = sha256_finish(&Sha256Ctxt);
-
-		io_seek(File, 0, IOSEEK_START);
+		dbg_msg("datafile", "could not map '%s'", pFilename);
+		return false;
 	}
 
 	// TODO: change this header
 	CDatafileHeader Header;
-	if(sizeof(Header) != io_read(File, &Header, sizeof(Header)))
+	if(MappingSize < sizeof(Header))
 	{
 		dbg_msg("datafile", "couldn't load header");
-		return 0;
+		io_unmap_file(pMapping, MappingSize);
+		return false;
 	}
+	mem_copy(&Header, pMapping, sizeof(Header));
 	if(Header.m_aID[0] != 'A' || Header.m_aID[1] != 'T' || Header.m_aID[2] != 'A' || Header.m_aID[3] != 'D')
 	{
 		if(Header.m_aID[0] != 'D' || Header.m_aID[1] != 'A' || Header.m_aID[2] != 'T' || Header.m_aID[3] != 'A')
 		{
 			dbg_msg("datafile", "wrong signature. %x %x %x %x", Header.m_aID[0], Header.m_aID[1], Header.m_aID[2], Header.m_aID[3]);
-			return 0;
+			io_unmap_file(pMapping, MappingSize);
+			return false;
 		}
 	}
 
@@ -172,60 +173,57 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	if(Header.m_Version != 3 && Header.m_Version != 4)
 	{
 		dbg_msg("datafile", "wrong version. version=%x", Header.m_Version);
-		return 0;
+		io_unmap_file(pMapping, MappingSize);
+		return false;
 	}
 
-	// read in the rest except the data
-	unsigned Size = 0;
-	Size += Header.m_NumItemTypes * sizeof(CDatafileItemType);
-	Size += (Header.m_NumItems + Header.m_NumRawData) * sizeof(int);
+	// the types, offsets, sizes and item data are used in place
+	int64 Size = 0;
+	Size += (int64)Header.m_NumItemTypes * sizeof(CDatafileItemType);
+	Size += ((int64)Header.m_NumItems + Header.m_NumRawData) * sizeof(int);
 	if(Header.m_Version == 4)
-		Size += Header.m_NumRawData * sizeof(int); // v4 has uncompressed data sizes as well
+		Size += (int64)Header.m_NumRawData * sizeof(int); // v4 has uncompressed data sizes as well
 	Size += Header.m_ItemSize;
+	if(Header.m_NumItemTypes < 0 || Header.m_NumItems < 0 || Header.m_NumRawData < 0 || Header.m_ItemSize < 0 ||
+		(int64)sizeof(Header) + Size > MappingSize)
+	{
+		dbg_msg("datafile", "couldn't load the whole thing, wanted=%lld got=%u", (long long)(sizeof(Header) + Size), MappingSize);
+		io_unmap_file(pMapping, MappingSize);
+		return false;
+	}
 
-	unsigned AllocSize = Size;
-	AllocSize += sizeof(CDatafile); // add space for info structure
-	AllocSize += Header.m_NumRawData * sizeof(void *); // add space for data pointers
-
-	CDatafile *pTmpDataFile = (CDatafile *)malloc(AllocSize);
+	CDatafile *pTmpDataFile = (CDatafile *)malloc(sizeof(CDatafile) + Header.m_NumRawData * sizeof(CDatafileBlock));
+	pTmpDataFile->m_pMapping = pMapping;
+	pTmpDataFile->m_MappingSize = MappingSize;
+	pTmpDataFile->m_HashesValid = false;
+	pTmpDataFile->m_Crc = 0;
 	pTmpDataFile->m_Header = Header;
 	pTmpDataFile->m_DataStartOffset = sizeof(CDatafileHeader) + Size;
-	pTmpDataFile->m_ppDataPtrs = (char **)(pTmpDataFile + 1);
-	pTmpDataFile->m_pData = (char *)(pTmpDataFile + 1) + Header.m_NumRawData * sizeof(char *);
-	pTmpDataFile->m_File = File;
-	pTmpDataFile->m_Sha256 = Sha256;
-	pTmpDataFile->m_Crc = Crc;
+	pTmpDataFile->m_pBlocks = (CDatafileBlock *)(pTmpDataFile + 1);
+	pTmpDataFile->m_ReleasedSize = 0;
+	pTmpDataFile->m_ReleaseTick = 0;
 
 	// clear the data pointers
-	mem_zero(pTmpDataFile->m_ppDataPtrs, Header.m_NumRawData * sizeof(void *));
-
-	// read types, offsets, sizes and item data
-	unsigned ReadSize = io_read(File, pTmpDataFile->m_pData, Size);
-	if(ReadSize != Size)
-	{
-		io_close(pTmpDataFile->m_File);
-		free(pTmpDataFile);
-		pTmpDataFile = 0;
-		dbg_msg("datafile", "couldn't load the whole thing, wanted=%d got=%d", Size, ReadSize);
-		return false;
-	}
+	mem_zero(pTmpDataFile->m_pBlocks, Header.m_NumRawData * sizeof(CDatafileBlock));
 
 	Close();
 	m_pDataFile = pTmpDataFile;
 
+	char *pData = (char *)pMapping + sizeof(CDatafileHeader);
 #if defined(CONF_ARCH_ENDIAN_BIG)
-	swap_endian(m_pDataFile->m_pData, sizeof(int), minimum(static_cast<unsigned>(Header.m_Swaplen), Size) / sizeof(int));
+	// the hashes are of the file as it is, before swapping
+	CalculateHashes();
+	swap_endian(pData, sizeof(int), minimum(static_cast<int64>(Header.m_Swaplen), Size) / sizeof(int));
 #endif
 
 	//if(DEBUG)
 	{
-		dbg_msg("datafile", "allocsize=%d", AllocSize);
-		dbg_msg("datafile", "readsize=%d", ReadSize);
+		dbg_msg("datafile", "mapsize=%u", MappingSize);
 		dbg_msg("datafile", "swaplen=%d", Header.m_Swaplen);
 		dbg_msg("datafile", "item_size=%d", m_pDataFile->m_Header.m_ItemSize);
 	}
 
-	m_pDataFile->m_Info.m_pItemTypes = (CDatafileItemType *)m_pDataFile->m_pData;
+	m_pDataFile->m_Info.m_pItemTypes = (CDatafileItemType *)pData;
 	m_pDataFile->m_Info.m_pItemOffsets = (int *)&m_pDataFile->m_Info.m_pItemTypes[m_pDataFile->m_Header.m_NumItemTypes];
 	m_pDataFile->m_Info.m_pDataOffsets = &m_pDataFile->m_Info.m_pItemOffsets[m_pDataFile->m_Header.m_NumItems];
 	m_pDataFile->m_Info.m_pDataSizes = &m_pDataFile->m_Info.m_pDataOffsets[m_pDataFile->m_Header.m_NumRawData];
@@ -323,55 +321,80 @@ void *CDataFileReader::GetDataImpl(int Index, int Swap)
 	if(Index < 0 || Index >= m_pDataFile->m_Header.m_NumRawData)
 		return 0;
 
-	// load it if needed
-	if(!m_pDataFile->m_ppDataPtrs[Index])
+	CDatafileBlock *pBlock = &m_pDataFile->m_pBlocks[Index];
+	if(pBlock->m_pData)
 	{
-		// fetch the data size
-		int DataSize = GetFileDataSize(Index);
-#if defined(CONF_ARCH_ENDIAN_BIG)
-		int SwapSize = DataSize;
-#endif
-
-		if(m_pDataFile->m_Header.m_Version == 4)
+		if(pBlock->m_Released)
 		{
-			// v4 has compressed data
-			void *pTemp = malloc(DataSize);
-			unsigned long UncompressedSize = m_pDataFile->m_Info.m_pDataSizes[Index];
-			unsigned long s;
-
-			dbg_msg("datafile", "loading data index=%d size=%d uncompressed=%lu", Index, DataSize, UncompressedSize);
-			m_pDataFile->m_ppDataPtrs[Index] = (char *)malloc(UncompressedSize);
-
-			// read the compressed data
-			io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START);
-			io_read(m_pDataFile->m_File, pTemp, DataSize);
+			pBlock->m_Released = false;
+			m_pDataFile->m_ReleasedSize -= GetDataSize(Index);
+		}
+		return pBlock->m_pData;
+	}
 
-			// decompress the data, TODO: check for errors
-			s = UncompressedSize;
-			uncompress((Bytef *)m_pDataFile->m_ppDataPtrs[Index], &s, (Bytef *)pTemp, DataSize); // ignore_convention
+	// fetch the data size
+	int DataSize = GetFileDataSize(Index);
+	int64 Offset = (int64)m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index];
+	if(DataSize < 0 || Offset < 0 || Offset + DataSize > m_pDataFile->m_MappingSize)
+	{
+		dbg_msg("datafile", "data out of bounds. index=%d size=%d", Index, DataSize);
+		return 0;
+	}
+	char *pSource = (char *)m_pDataFile->m_pMapping + Offset;
 #if defined(CONF_ARCH_ENDIAN_BIG)
-			SwapSize = s;
+	int SwapSize = DataSize;
 #endif
 
-			// clean up the temporary buffers
-			free(pTemp);
-		}
-		else
+	if(m_pDataFile->m_Header.m_Version == 4)
+	{
+		// v4 has compressed data
+		unsigned long UncompressedSize = m_pDataFile->m_Info.m_pDataSizes[Index];
+		unsigned long s = UncompressedSize;
+
+		dbg_msg("datafile", "loading data index=%d size=%d uncompressed=%lu", Index, DataSize, UncompressedSize);
+		char *pData = (char *)malloc(UncompressedSize);
+		if(!pData || uncompress((Bytef *)pData, &s, (Bytef *)pSource, DataSize) != Z_OK) // ignore_convention
 		{
-			// load the data
-			dbg_msg("datafile", "loading data index=%d size=%d", Index, DataSize);
-			m_pDataFile->m_ppDataPtrs[Index] = (char *)malloc(DataSize);
-			io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset + m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START);
-			io_read(m_pDataFile->m_File, m_pDataFile->m_ppDataPtrs[Index], DataSize);
+			dbg_msg("datafile", "couldn't decompress data index=%d", Index);
+			free(pData);
+			return 0;
 		}
-
+		pBlock->m_pData = pData;
+		pBlock->m_Owned = true;
+#if defined(CONF_ARCH_ENDIAN_BIG)
+		SwapSize = s;
+#endif
+	}
+	else
+	{
 #if defined(CONF_ARCH_ENDIAN_BIG)
-		if(Swap && SwapSize)
-			swap_endian(m_pDataFile->m_ppDataPtrs[Index], sizeof(int), SwapSize / sizeof(int));
+		// swapped in a copy, the mapping stays as in the file
+		pBlock->m_pData = (char *)malloc(DataSize);
+		mem_copy(pBlock->m_pData, pSource, DataSize);
+		pBlock->m_Owned = true;
+#else
+		// used in place, writes go to private copies of the pages
+		pBlock->m_pData = pSource;
+		pBlock->m_Owned = false;
 #endif
 	}
 
-	return m_pDataFile->m_ppDataPtrs[Index];
+#if defined(CONF_ARCH_ENDIAN_BIG)
+	if(Swap && SwapSize)
+		swap_endian(pBlock->m_pData, sizeof(int), SwapSize / sizeof(int));
+#endif
+
+	return pBlock->m_pData;
+}
+
+void CDataFileReader::FreeData(int Index)
+{
+	CDatafileBlock *pBlock = &m_pDataFile->m_pBlocks[Index];
+	if(pBlock->m_Released)
+		m_pDataFile->m_ReleasedSize -= GetDataSize(Index);
+	if(pBlock->m_Owned)
+		free(pBlock->m_pData);
+	mem_zero(pBlock, sizeof(*pBlock));
 }
 
 void *CDataFileReader::GetData(int Index)
@@ -386,12 +409,34 @@ void *CDataFileReader::GetDataSwapped(int Index)
 
 void CDataFileReader::UnloadData(int Index)
 {
-	if(Index < 0 || Index >= m_pDataFile->m_Header.m_NumRawData)
+	if(!m_pDataFile || Index < 0 || Index >= m_pDataFile->m_Header.m_NumRawData)
+		return;
+
+	CDatafileBlock *pBlock = &m_pDataFile->m_pBlocks[Index];
+	if(!pBlock->m_pData || pBlock->m_Released)
 		return;
 
-	//
-	free(m_pDataFile->m_ppDataPtrs[Index]);
-	m_pDataFile->m_ppDataPtrs[Index] = 0x0;
+#if defined(CONF_ARCH_ENDIAN_BIG)
+	// whether the data is swapped depends on the next caller
+	FreeData(Index);
+#else
+	// keep the data around in case it is requested again, up to the
+	// cache size, dropping the data that was released first
+	pBlock->m_Released = true;
+	pBlock->m_ReleaseTick = ++m_pDataFile->m_ReleaseTick;
+	m_pDataFile->m_ReleasedSize += GetDataSize(Index);
+	while(m_pDataFile->m_ReleasedSize > DATA_CACHE_SIZE)
+	{
+		int Oldest = -1;
+		for(int i = 0; i < m_pDataFile->m_Header.m_NumRawData; i++)
+		{
+			const CDatafileBlock *pOther = &m_pDataFile->m_pBlocks[i];
+			if(pOther->m_Released && (Oldest < 0 || pOther->m_ReleaseTick < m_pDataFile->m_pBlocks[Oldest].m_ReleaseTick))
+				Oldest = i;
+		}
+		FreeData(Oldest);
+	}
+#endif
 }
 
 int CDataFileReader::GetItemSize(int Index) const
@@ -531,16 +576,26 @@ bool CDataFileReader::Close()
 		return true;
 
 	// free the data that is loaded
-	int i;
-	for(i = 0; i < m_pDataFile->m_Header.m_NumRawData; i++)
-		free(m_pDataFile->m_ppDataPtrs[i]);
+	for(int i = 0; i < m_pDataFile->m_Header.m_NumRawData; i++)
+		FreeData(i);
 
-	io_close(m_pDataFile->m_File);
+	io_unmap_file(m_pDataFile->m_pMapping, m_pDataFile->m_MappingSize);
 	free(m_pDataFile);
 	m_pDataFile = 0;
 	return true;
 }
 
+void CDataFileReader::CalculateHashes() const
+{
+	// only on request, most users never need them
+	SHA256_CTX Sha256Ctxt;
+	sha256_init(&Sha256Ctxt);
+	sha256_update(&Sha256Ctxt, m_pDataFile->m_pMapping, m_pDataFile->m_MappingSize);
+	m_pDataFile->m_Sha256 = sha256_finish(&Sha256Ctxt);
+	m_pDataFile->m_Crc = crc32(0, (const Bytef *)m_pDataFile->m_pMapping, m_pDataFile->m_MappingSize); // ignore_convention
+	m_pDataFile->m_HashesValid = true;
+}
+
 SHA256_DIGEST CDataFileReader::Sha256() const
 {
 	if(!m_pDataFile)
@@ -552,6 +607,8 @@ SHA256_DIGEST CDataFileReader::Sha256() const
 		}
 		return Result;
 	}
+	if(!m_pDataFile->m_HashesValid)
+		CalculateHashes();
 	return m_pDataFile->m_Sha256;
 }
 
@@ -559,6 +616,8 @@ unsigned CDataFileReader::Crc() const
 {
 	if(!m_pDataFile)
 		return 0xFFFFFFFF;
+	if(!m_pDataFile->m_HashesValid)
+		CalculateHashes();
 	return m_pDataFile->m_Crc;
 }
 
@@ -569,13 +628,6 @@ int CDataFileReader::MapSize() const
 	return m_pDataFile->m_Header.m_Size + 16;
 }
 
-IOHANDLE CDataFileReader::File()
-{
-	if(!m_pDataFile)
-		return 0;
-	return m_pDataFile->m_File;
-}
-
 CDataFileWriter::CDataFileWriter()
 {
 	m_File = 0;
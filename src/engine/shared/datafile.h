@@ -15,11 +15,28 @@ enum
 	ITEMTYPE_EX = 0xffff,
 };
 
-// raw datafile access
+/*
+	Class: CDataFileReader
+		Raw datafile access. The file is mapped into memory and the headers
+		and items are used in place, data is decompressed on first access.
+		Data that is unloaded is kept for reuse until more than
+		DATA_CACHE_SIZE bytes are unloaded. The hashes are calculated on
+		request.
+
+		The file must not be truncated or rewritten in place while it is
+		open, replacing it is fine.
+*/
 class CDataFileReader
 {
+	enum
+	{
+		DATA_CACHE_SIZE = 16 * 1024 * 1024,
+	};
+
 	struct CDatafile *m_pDataFile;
 	void *GetDataImpl(int Index, int Swap);
+	void FreeData(int Index);
+	void CalculateHashes() const;
 	int GetFileDataSize(int Index);
 
 	int GetExternalItemType(int InternalType);
@@ -51,7 +68,6 @@ public:
 	SHA256_DIGEST Sha256() const;
 	unsigned Crc() const;
 	int MapSize() const;
-	IOHANDLE File();
 };
 
 // write access
@@ -19,10 +19,57 @@ static const int gs_LengthOffset = 152;
 static const int gs_NumMarkersOffset = 176;
 
 
+/*
+	Tickmarker
+		7	= Always set
+		6	= Keyframe flag
+		0-5	= Delta tick
+
+	Normal
+		7 = Not set
+		5-6	= Type
+		0-4	= Size
+*/
+
+enum
+{
+	CHUNKTYPEFLAG_TICKMARKER = 0x80,
+	CHUNKTICKFLAG_KEYFRAME = 0x40, // only when tickmarker is set
+
+	CHUNKMASK_TICK = 0x3f,
+	CHUNKMASK_TYPE = 0x60,
+	CHUNKMASK_SIZE = 0x1f,
+
+	CHUNKTYPE_SNAPSHOT = 1,
+	CHUNKTYPE_MESSAGE = 2,
+	CHUNKTYPE_DELTA = 3,
+
+	CHUNKFLAG_BIGSIZE = 0x10
+};
+
+enum
+{
+	RINGENTRY_SNAPSHOT = 0,
+	RINGENTRY_MESSAGE,
+	RINGENTRY_STOP,
+};
+
+struct CRingEntryHeader
+{
+	int m_Type;
+	int m_Tick;
+	int m_Size;
+};
+
 CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta)
 {
 	m_File = 0;
 	m_LastTickMarker = -1;
+	m_pRing = 0;
+	m_RingRead = 0;
+	m_RingWrite = 0;
+	m_pWriterThread = 0;
+	m_pWriterDelta = 0;
 	m_pSnapshotDelta = pSnapshotDelta;
 }
 
@@ -108,48 +155,98 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 
 	m_LastKeyFrame = -1;
 	m_LastTickMarker = -1;
+	m_WrittenTickMarker = -1;
 	m_FirstTick = -1;
 	m_NumTimelineMarkers = 0;
+	m_NumDroppedSnapshots = 0;
+	m_NumDroppedMessages = 0;
+	m_WriteBufferSize = 0;
 
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "Recording to '%s'", pFilename);
 	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf);
 	m_File = DemoFile;
 
+	m_pRing = (unsigned char *)malloc(RING_SIZE);
+	m_RingRead = 0;
+	m_RingWrite = 0;
+	sphore_init(&m_DataSemaphore);
+	m_pWriterDelta = new CSnapshotDelta(*m_pSnapshotDelta);
+	m_pWriterThread = thread_init(WriterThread, this, "demo writer");
+
 	return 0;
 }
 
-/*
-	Tickmarker
-		7	= Always set
-		6	= Keyframe flag
-		0-5	= Delta tick
+bool CDemoRecorder::Push(int Type, int Tick, const void *pData, int Size)
+{
+	CRingEntryHeader Header;
+	Header.m_Type = Type;
+	Header.m_Tick = Tick;
+	Header.m_Size = Size;
+
+	const unsigned Write = m_RingWrite.load(std::memory_order_relaxed);
+	const unsigned Read = m_RingRead.load(std::memory_order_acquire);
+	if(RING_SIZE - (Write - Read) < sizeof(Header) + Size)
+		return false;
 
-	Normal
-		7 = Not set
-		5-6	= Type
-		0-4	= Size
-*/
+	const unsigned char *apParts[2] = {(const unsigned char *)&Header, (const unsigned char *)pData};
+	const int aPartSizes[2] = {(int)sizeof(Header), Size};
+	unsigned Pos = Write;
+	for(int p = 0; p < 2; p++)
+	{
+		const int Offset = Pos & (RING_SIZE - 1);
+		const int First = minimum(aPartSizes[p], RING_SIZE - Offset);
+		mem_copy(&m_pRing[Offset], apParts[p], First);
+		mem_copy(m_pRing, apParts[p] + First, aPartSizes[p] - First);
+		Pos += aPartSizes[p];
+	}
 
-enum
+	m_RingWrite.store(Pos, std::memory_order_release);
+	sphore_signal(&m_DataSemaphore);
+	return true;
+}
+
+void CDemoRecorder::ReadRing(unsigned Pos, void *pData, int Size)
 {
-	CHUNKTYPEFLAG_TICKMARKER = 0x80,
-	CHUNKTICKFLAG_KEYFRAME = 0x40, // only when tickmarker is set
+	const int Offset = Pos & (RING_SIZE - 1);
+	const int First = minimum(Size, RING_SIZE - Offset);
+	mem_copy(pData, &m_pRing[Offset], First);
+	mem_copy((unsigned char *)pData + First, m_pRing, Size - First);
+}
 
-	CHUNKMASK_TICK = 0x3f,
-	CHUNKMASK_TYPE = 0x60,
-	CHUNKMASK_SIZE = 0x1f,
+void CDemoRecorder::WriterThread(void *pUser)
+{
+	CDemoRecorder *pSelf = (CDemoRecorder *)pUser;
 
-	CHUNKTYPE_SNAPSHOT = 1,
-	CHUNKTYPE_MESSAGE = 2,
-	CHUNKTYPE_DELTA = 3,
+	while(1)
+	{
+		sphore_wait(&pSelf->m_DataSemaphore);
 
-	CHUNKFLAG_BIGSIZE = 0x10
-};
+		unsigned Read = pSelf->m_RingRead.load(std::memory_order_relaxed);
+		while(Read != pSelf->m_RingWrite.load(std::memory_order_acquire))
+		{
+			CRingEntryHeader Header;
+			pSelf->ReadRing(Read, &Header, sizeof(Header));
+			pSelf->ReadRing(Read + sizeof(Header), pSelf->m_aEntryData, Header.m_Size);
+			Read += sizeof(Header) + Header.m_Size;
+			pSelf->m_RingRead.store(Read, std::memory_order_release);
+
+			if(Header.m_Type == RINGENTRY_SNAPSHOT)
+				pSelf->ProcessSnapshot(Header.m_Tick, pSelf->m_aEntryData, Header.m_Size);
+			else if(Header.m_Type == RINGENTRY_MESSAGE)
+				pSelf->Write(CHUNKTYPE_MESSAGE, pSelf->m_aEntryData, Header.m_Size);
+			else
+			{
+				pSelf->FlushWriteBuffer();
+				return;
+			}
+		}
+	}
+}
 
 void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 {
-	if(m_LastTickMarker == -1 || Tick-m_LastTickMarker > 63 || Keyframe)
+	if(m_WrittenTickMarker == -1 || Tick-m_WrittenTickMarker > 63 || Keyframe)
 	{
 		unsigned char aChunk[5];
 		aChunk[0] = CHUNKTYPEFLAG_TICKMARKER;
@@ -161,18 +258,16 @@ void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 		if(Keyframe)
 			aChunk[0] |= CHUNKTICKFLAG_KEYFRAME;
 
-		io_write(m_File, aChunk, sizeof(aChunk));
+		WriteRaw(aChunk, sizeof(aChunk));
 	}
 	else
 	{
 		unsigned char aChunk[1];
-		aChunk[0] = CHUNKTYPEFLAG_TICKMARKER | (Tick-m_LastTickMarker);
-		io_write(m_File, aChunk, sizeof(aChunk));
+		aChunk[0] = CHUNKTYPEFLAG_TICKMARKER | (Tick-m_WrittenTickMarker);
+		WriteRaw(aChunk, sizeof(aChunk));
 	}
 
-	m_LastTickMarker = Tick;
-	if(m_FirstTick < 0)
-		m_FirstTick = Tick;
+	m_WrittenTickMarker = Tick;
 }
 
 void CDemoRecorder::Write(int Type, const void *pData, int Size)
@@ -181,9 +276,6 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 	char aBuffer2[64*1024];
 	unsigned char aChunk[3];
 
-	if(!m_File)
-		return;
-
 	/* pad the data with 0 so we get an alignment of 4,
 	else the compression won't work and miss some bytes */
 	mem_copy(aBuffer2, pData, Size);
@@ -192,13 +284,13 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 	Size = CVariableInt::Compress(aBuffer2, Size, aBuffer, sizeof(aBuffer)); // buffer2 -> buffer
 	if(Size < 0)
 	{
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_recorder", "error during intpack compression");
+		dbg_msg("demo_recorder", "error during intpack compression");
 		return;
 	}
 	Size = CNetBase::Compress(aBuffer, Size, aBuffer2, sizeof(aBuffer2)); // buffer -> buffer2
 	if(Size < 0)
 	{
-		m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_recorder", "error during network compression");
+		dbg_msg("demo_recorder", "error during network compression");
 		return;
 	}
 
@@ -206,7 +298,7 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 	if(Size < 30)
 	{
 		aChunk[0] |= Size;
-		io_write(m_File, aChunk, 1);
+		WriteRaw(aChunk, 1);
 	}
 	else
 	{
@@ -214,21 +306,57 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 		{
 			aChunk[0] |= 30;
 			aChunk[1] = Size&0xff;
-			io_write(m_File, aChunk, 2);
+			WriteRaw(aChunk, 2);
 		}
 		else
 		{
 			aChunk[0] |= 31;
 			aChunk[1] = Size&0xff;
 			aChunk[2] = Size>>8;
-			io_write(m_File, aChunk, 3);
+			WriteRaw(aChunk, 3);
 		}
 	}
 
-	io_write(m_File, aBuffer2, Size);
+	WriteRaw(aBuffer2, Size);
+}
+
+void CDemoRecorder::WriteRaw(const void *pData, int Size)
+{
+	if(m_WriteBufferSize + Size > WRITE_BUFFER_SIZE)
+		FlushWriteBuffer();
+	if(Size > WRITE_BUFFER_SIZE)
+	{
+		io_write(m_File, pData, Size);
+		return;
+	}
+	mem_copy(&m_aWriteBuffer[m_WriteBufferSize], pData, Size);
+	m_WriteBufferSize += Size;
+}
+
+void CDemoRecorder::FlushWriteBuffer()
+{
+	if(m_WriteBufferSize)
+		io_write(m_File, m_aWriteBuffer, m_WriteBufferSize);
+	m_WriteBufferSize = 0;
 }
 
 void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
+{
+	if(!m_File)
+		return;
+
+	// the tick still counts for the length and the markers if the writer
+	// can't keep up, the next snapshot is a delta against the last
+	// written one
+	if(!Push(RINGENTRY_SNAPSHOT, Tick, pData, Size))
+		m_NumDroppedSnapshots++;
+
+	m_LastTickMarker = Tick;
+	if(m_FirstTick < 0)
+		m_FirstTick = Tick;
+}
+
+void CDemoRecorder::ProcessSnapshot(int Tick, const void *pData, int Size)
 {
 	if(m_LastKeyFrame == -1 || (Tick-m_LastKeyFrame) > SERVER_TICK_SPEED*5)
 	{
@@ -250,7 +378,7 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 		// write tickmarker
 		WriteTickMarker(Tick, 0);
 
-		DeltaSize = m_pSnapshotDelta->CreateDelta((CSnapshot*)m_aLastSnapshotData, (CSnapshot*)pData, &aDeltaData);
+		DeltaSize = m_pWriterDelta->CreateDelta((CSnapshot*)m_aLastSnapshotData, (CSnapshot*)pData, &aDeltaData);
 		if(DeltaSize)
 		{
 			// record delta
@@ -262,7 +390,11 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 
 void CDemoRecorder::RecordMessage(const void *pData, int Size)
 {
-	Write(CHUNKTYPE_MESSAGE, pData, Size);
+	if(!m_File)
+		return;
+
+	if(!Push(RINGENTRY_MESSAGE, 0, pData, Size))
+		m_NumDroppedMessages++;
 }
 
 int CDemoRecorder::Stop()
@@ -270,6 +402,24 @@ int CDemoRecorder::Stop()
 	if(!m_File)
 		return -1;
 
+	// let the writer drain the ring
+	while(!Push(RINGENTRY_STOP, 0, 0, 0))
+		thread_sleep(1000);
+	thread_wait(m_pWriterThread);
+	m_pWriterThread = 0;
+	delete m_pWriterDelta;
+	m_pWriterDelta = 0;
+	sphore_destroy(&m_DataSemaphore);
+	free(m_pRing);
+	m_pRing = 0;
+
+	if(m_NumDroppedSnapshots || m_NumDroppedMessages)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "The writer could not keep up, dropped %d snapshots and %d messages", m_NumDroppedSnapshots, m_NumDroppedMessages);
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf);
+	}
+
 	// add the demo length to the header
 	io_seek(m_File, gs_LengthOffset, IOSEEK_START);
 	int DemoLength = Length();
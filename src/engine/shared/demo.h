@@ -10,20 +10,55 @@
 
 #include "snapshot.h"
 
+#include <atomic>
+
 class CDemoRecorder : public IDemoRecorder
 {
+	enum
+	{
+		RING_SIZE = 4*1024*1024, // must be a power of two
+		WRITE_BUFFER_SIZE = 128*1024,
+	};
+
 	class IConsole *m_pConsole;
 	IOHANDLE m_File;
 	int m_LastTickMarker;
-	int m_LastKeyFrame;
 	int m_FirstTick;
-	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
-	class CSnapshotDelta *m_pSnapshotDelta;
 	int m_NumTimelineMarkers;
 	int m_aTimelineMarkers[MAX_TIMELINE_MARKERS];
+	int m_NumDroppedSnapshots;
+	int m_NumDroppedMessages;
+
+	// the game thread only copies the raw payloads into the ring, the
+	// writer thread does the delta, the compression and the file writes
+	unsigned char *m_pRing;
+	std::atomic<unsigned> m_RingRead;
+	std::atomic<unsigned> m_RingWrite;
+	SEMAPHORE m_DataSemaphore;
+	void *m_pWriterThread;
+
+	// only used by the writer thread
+	int m_WrittenTickMarker;
+	int m_LastKeyFrame;
+	unsigned char m_aLastSnapshotData[CSnapshot::MAX_SIZE];
+	unsigned char m_aEntryData[CSnapshot::MAX_SIZE];
+	unsigned char m_aWriteBuffer[WRITE_BUFFER_SIZE];
+	int m_WriteBufferSize;
+	// a copy of the item sizes of the game's delta made at the start,
+	// so the game thread can keep using its own
+	class CSnapshotDelta *m_pWriterDelta;
+
+	class CSnapshotDelta *m_pSnapshotDelta;
+
+	bool Push(int Type, int Tick, const void *pData, int Size);
+	void ReadRing(unsigned Pos, void *pData, int Size);
+	static void WriterThread(void *pUser);
+	void ProcessSnapshot(int Tick, const void *pData, int Size);
 
 	void WriteTickMarker(int Tick, int Keyframe);
 	void Write(int Type, const void *pData, int Size);
+	void WriteRaw(const void *pData, int Size);
+	void FlushWriteBuffer();
 public:
 	CDemoRecorder(class CSnapshotDelta *pSnapshotDelta);
 
@@ -3,6 +3,32 @@
 #include <base/system.h>
 #include "huffman.h"
 
+#include <cstring>
+
+static inline uint64 ReadLittleEndian64(const unsigned char *pData)
+{
+#if defined(CONF_ARCH_ENDIAN_BIG)
+	uint64 Value = 0;
+	for(int i = 7; i >= 0; i--)
+		Value = (Value << 8) | pData[i];
+	return Value;
+#else
+	uint64 Value;
+	memcpy(&Value, pData, sizeof(Value));
+	return Value;
+#endif
+}
+
+static inline void WriteLittleEndian64(unsigned char *pData, uint64 Value)
+{
+#if defined(CONF_ARCH_ENDIAN_BIG)
+	for(int i = 0; i < 8; i++, Value >>= 8)
+		pData[i] = Value & 0xff;
+#else
+	memcpy(pData, &Value, sizeof(Value));
+#endif
+}
+
 struct CHuffmanConstructNode
 {
 	unsigned short m_NodeId;
@@ -129,6 +155,54 @@ void CHuffman::Init(const unsigned *pFrequencies)
 			m_apDecodeLut[i] = pNode;
 	}
 
+	BuildFastTables();
+}
+
+void CHuffman::BuildFastTables()
+{
+	// codes that don't fit into the 64 bit buffers keep the slow paths
+	m_FastTables = false;
+	m_Fast = false;
+	for(int i = 0; i < HUFFMAN_MAX_SYMBOLS; i++)
+	{
+		if(m_aNodes[i].m_NumBits > HUFFMAN_FAST_MAXBITS)
+			return;
+		m_aFastEncode[i] = (m_aNodes[i].m_Bits << 5) | m_aNodes[i].m_NumBits;
+	}
+
+	// resolve as many whole symbols as the bits of each entry hold
+	for(int i = 0; i < HUFFMAN_FAST_LUTSIZE; i++)
+	{
+		CFastEntry *pEntry = &m_aFastDecode[i];
+		unsigned Bits = i;
+		CNode *pNode = m_pStartNode;
+		int NumSymbols = 0;
+		int NumBits = 0;
+		for(int k = 0; k < HUFFMAN_FAST_LUTBITS; k++)
+		{
+			pNode = &m_aNodes[pNode->m_aLeafs[Bits&1]];
+			Bits >>= 1;
+			if(!pNode->m_NumBits)
+				continue;
+
+			NumBits = k+1;
+			if(pNode == &m_aNodes[HUFFMAN_EOF_SYMBOL])
+			{
+				NumSymbols |= HUFFMAN_FAST_EOF;
+				break;
+			}
+			pEntry->m_aSymbols[NumSymbols++] = pNode->m_Symbol;
+			pNode = m_pStartNode;
+			if(NumSymbols == HUFFMAN_FAST_MAXSYMBOLS)
+				break;
+		}
+		pEntry->m_NumSymbols = NumSymbols;
+		pEntry->m_NumBits = NumBits;
+		pEntry->m_Node = pNode - m_aNodes;
+	}
+
+	m_FastTables = true;
+	m_Fast = true;
 }
 
 //***************************************************************
@@ -160,8 +234,44 @@ int CHuffman::Compress(const void *pInput, int InputSize, void *pOutput, int Out
 	unsigned Bits = 0;
 	unsigned Bitcount = 0;
 
+	// fast path, packs symbols into 64 bits and writes them at once as
+	// long as there is room for it
+	if(m_Fast)
+	{
+		uint64 FastBits = 0;
+		unsigned FastBitcount = 0;
+		while(pSrc != pSrcEnd && pDstEnd - pDst >= 8)
+		{
+			unsigned Code = m_aFastEncode[*pSrc++];
+			FastBits |= (uint64)(Code >> 5) << FastBitcount;
+			FastBitcount += Code & 31;
+			if(FastBitcount >= 32)
+			{
+				WriteLittleEndian64(pDst, FastBits);
+				unsigned Bytes = FastBitcount >> 3;
+				pDst += Bytes;
+				FastBits >>= Bytes * 8;
+				FastBitcount -= Bytes * 8;
+				if(pDst == pDstEnd)
+					return -1;
+			}
+		}
+
+		// continue with the whole bytes written out, like below
+		while(FastBitcount >= 8)
+		{
+			*pDst++ = (unsigned char)(FastBits&0xff);
+			if(pDst == pDstEnd)
+				return -1;
+			FastBits >>= 8;
+			FastBitcount -= 8;
+		}
+		Bits = (unsigned)FastBits;
+		Bitcount = FastBitcount;
+	}
+
 	// make sure that we have data that we want to compress
-	if(InputSize)
+	if(pSrc != pSrcEnd)
 	{
 		// {A} load the first symbol
 		int Symbol = *pSrc++;
@@ -213,6 +323,57 @@ int CHuffman::Decompress(const void *pInput, int InputSize, void *pOutput, int O
 	CNode *pEof = &m_aNodes[HUFFMAN_EOF_SYMBOL];
 	CNode *pNode = 0;
 
+	// fast path, resolves several symbols per lookup while the input and
+	// the output are far from their ends
+	if(m_Fast)
+	{
+		uint64 FastBits = 0;
+		unsigned FastBitcount = 0;
+		while(pSrcEnd - pSrc >= 8 && pDstEnd - pDst >= HUFFMAN_FAST_MAXSYMBOLS)
+		{
+			// refill to at least 56 bits, the bits above are the next
+			// input bits and get read again with the next refill
+			FastBits |= ReadLittleEndian64(pSrc) << FastBitcount;
+			pSrc += (63 - FastBitcount) >> 3;
+			FastBitcount |= 56;
+
+			const CFastEntry *pEntry = &m_aFastDecode[FastBits&HUFFMAN_FAST_LUTMASK];
+			if(pEntry->m_NumSymbols)
+			{
+				memcpy(pDst, pEntry->m_aSymbols, HUFFMAN_FAST_MAXSYMBOLS);
+				pDst += pEntry->m_NumSymbols & ~HUFFMAN_FAST_EOF;
+				if(pEntry->m_NumSymbols & HUFFMAN_FAST_EOF)
+					return (int)(pDst - (const unsigned char *)pOutput);
+				FastBits >>= pEntry->m_NumBits;
+				FastBitcount -= pEntry->m_NumBits;
+			}
+			else
+			{
+				// a longer code, walk the rest of the tree
+				FastBits >>= HUFFMAN_FAST_LUTBITS;
+				FastBitcount -= HUFFMAN_FAST_LUTBITS;
+				pNode = &m_aNodes[pEntry->m_Node];
+				do
+				{
+					pNode = &m_aNodes[pNode->m_aLeafs[FastBits&1]];
+					FastBits >>= 1;
+					FastBitcount--;
+				}
+				while(!pNode->m_NumBits);
+
+				if(pNode == pEof)
+					return (int)(pDst - (const unsigned char *)pOutput);
+				*pDst++ = pNode->m_Symbol;
+			}
+		}
+
+		// give back the whole bytes that are left, the rest is decoded below
+		pSrc -= FastBitcount >> 3;
+		FastBitcount &= 7;
+		Bits = (unsigned)FastBits & ((1u << FastBitcount) - 1);
+		Bitcount = FastBitcount;
+	}
+
 	while(1)
 	{
 		// {A} try to load a node now, this will reduce dependency at location {D}
@@ -16,7 +16,16 @@ class CHuffman
 
 		HUFFMAN_LUTBITS = 10,
 		HUFFMAN_LUTSIZE = (1<<HUFFMAN_LUTBITS),
-		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE-1)
+		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE-1),
+
+		// the fast paths resolve up to 4 symbols per lookup of 12 bits
+		// and move 64 bits at once, they need codes of at most 24 bits
+		HUFFMAN_FAST_LUTBITS = 12,
+		HUFFMAN_FAST_LUTSIZE = (1<<HUFFMAN_FAST_LUTBITS),
+		HUFFMAN_FAST_LUTMASK = (HUFFMAN_FAST_LUTSIZE-1),
+		HUFFMAN_FAST_MAXSYMBOLS = 4,
+		HUFFMAN_FAST_MAXBITS = 24,
+		HUFFMAN_FAST_EOF = 0x80,
 	};
 
 	struct CNode
@@ -32,13 +41,28 @@ class CHuffman
 		unsigned char m_Symbol;
 	};
 
+	// the symbols that the bits of a fast lookup start with
+	struct CFastEntry
+	{
+		unsigned char m_aSymbols[HUFFMAN_FAST_MAXSYMBOLS];
+		unsigned char m_NumSymbols; // HUFFMAN_FAST_EOF is set if the eof symbol follows them
+		unsigned char m_NumBits;
+		unsigned short m_Node; // where to continue in the tree if no symbol fits
+	};
+
 	CNode m_aNodes[HUFFMAN_MAX_NODES];
 	CNode *m_apDecodeLut[HUFFMAN_LUTSIZE];
 	CNode *m_pStartNode;
 	int m_NumNodes;
 
+	bool m_FastTables;
+	bool m_Fast;
+	unsigned m_aFastEncode[HUFFMAN_MAX_SYMBOLS]; // bits << 5 | number of bits
+	CFastEntry m_aFastDecode[HUFFMAN_FAST_LUTSIZE];
+
 	void Setbits_r(CNode *pNode, int Bits, unsigned Depth);
 	void ConstructTree(const unsigned *pFrequencies);
+	void BuildFastTables();
 
 public:
 	/*
@@ -87,5 +111,11 @@ public:
 	*/
 	int Decompress(const void *pInput, int InputSize, void *pOutput, int OutputSize);
 
+	/*
+		Function: SetFastPaths
+			Turns the table driven fast paths on or off, for comparisons.
+			Init turns them on if the code allows it.
+	*/
+	void SetFastPaths(bool Enable) { m_Fast = Enable && m_FastTables; }
 };
 #endif // __HUFFMAN_HEADER__
@@ -2,12 +2,24 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include "jobs.h"
 
+// marks the continuation list of a job that is done
+static char s_JobDoneMarker;
+static IJob *const s_pJobDone = reinterpret_cast<IJob *>(&s_JobDoneMarker);
+
+static thread_local void *s_pCurrentWorker = 0;
+
 IJob::IJob() :
+	m_pGroup(0),
+	m_pContinuations(0),
+	m_pNext(0),
 	m_Status(STATE_PENDING)
 {
 }
 
 IJob::IJob(const IJob &Other) :
+	m_pGroup(0),
+	m_pContinuations(0),
+	m_pNext(0),
 	m_Status(STATE_PENDING)
 {
 }
@@ -25,11 +37,72 @@ int IJob::Status()
 	return m_Status.load();
 }
 
+CJobPool::CDeque::CDeque() :
+	m_Top(0),
+	m_Bottom(0)
+{
+	for(int i = 0; i < DEQUE_SIZE; i++)
+		m_apJobs[i].store(0, std::memory_order_relaxed);
+}
+
+bool CJobPool::CDeque::Push(IJob *pJob)
+{
+	int64 Bottom = m_Bottom.load(std::memory_order_relaxed);
+	int64 Top = m_Top.load(std::memory_order_acquire);
+	if(Bottom - Top >= DEQUE_SIZE)
+		return false;
+	m_apJobs[Bottom%DEQUE_SIZE].store(pJob, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_Bottom.store(Bottom+1, std::memory_order_relaxed);
+	return true;
+}
+
+IJob *CJobPool::CDeque::Pop()
+{
+	int64 Bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+	m_Bottom.store(Bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64 Top = m_Top.load(std::memory_order_relaxed);
+
+	if(Top > Bottom)
+	{
+		// empty
+		m_Bottom.store(Bottom+1, std::memory_order_relaxed);
+		return 0;
+	}
+
+	IJob *pJob = m_apJobs[Bottom%DEQUE_SIZE].load(std::memory_order_relaxed);
+	if(Top == Bottom)
+	{
+		// last job, race against the thieves
+		if(!m_Top.compare_exchange_strong(Top, Top+1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			pJob = 0;
+		m_Bottom.store(Bottom+1, std::memory_order_relaxed);
+	}
+	return pJob;
+}
+
+IJob *CJobPool::CDeque::Steal()
+{
+	int64 Top = m_Top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64 Bottom = m_Bottom.load(std::memory_order_acquire);
+	if(Top >= Bottom)
+		return 0;
+
+	IJob *pJob = m_apJobs[Top%DEQUE_SIZE].load(std::memory_order_relaxed);
+	if(!m_Top.compare_exchange_strong(Top, Top+1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return 0;
+	return pJob;
+}
+
 CJobPool::CJobPool()
 {
 	// empty the pool
 	m_NumThreads = 0;
 	m_Shutdown = false;
+	m_NumSleeping = 0;
+	m_NumInjected = 0;
 	m_Lock = lock_create();
 	sphore_init(&m_Semaphore);
 	m_pFirstJob = 0;
@@ -43,38 +116,105 @@ CJobPool::~CJobPool()
 		sphore_signal(&m_Semaphore);
 	for(int i = 0; i < m_NumThreads; i++)
 	{
-		if(m_apThreads[i])
-			thread_wait(m_apThreads[i]);
+		if(m_apWorkers[i]->m_pThread)
+			thread_wait(m_apWorkers[i]->m_pThread);
+	}
+
+	// release the jobs that never ran
+	IJob *pJob;
+	for(int i = 0; i < m_NumThreads; i++)
+	{
+		while((pJob = m_apWorkers[i]->m_Deque.Pop()))
+			pJob->m_pSelf = 0;
+		delete m_apWorkers[i];
+	}
+	while(m_pFirstJob)
+	{
+		pJob = m_pFirstJob;
+		m_pFirstJob = pJob->m_pNext;
+		pJob->m_pSelf = 0;
 	}
 	lock_destroy(m_Lock);
 	sphore_destroy(&m_Semaphore);
 }
 
+CJobPool::CWorker *CJobPool::CurrentWorker() const
+{
+	CWorker *pWorker = (CWorker *)s_pCurrentWorker;
+	return pWorker && pWorker->m_pPool == this ? pWorker : 0;
+}
+
+IJob *CJobPool::FindJob(CWorker *pWorker)
+{
+	IJob *pJob = 0;
+	if(pWorker)
+	{
+		pJob = pWorker->m_Deque.Pop();
+		if(pJob)
+			return pJob;
+	}
+
+	if(m_NumInjected.load() > 0)
+	{
+		lock_wait(m_Lock);
+		if(m_pFirstJob)
+		{
+			pJob = m_pFirstJob;
+			m_pFirstJob = pJob->m_pNext;
+			if(!m_pFirstJob)
+				m_pLastJob = 0;
+			m_NumInjected--;
+		}
+		lock_unlock(m_Lock);
+		if(pJob)
+			return pJob;
+	}
+
+	// steal from a random worker
+	if(m_NumThreads)
+	{
+		unsigned Random = pWorker ? pWorker->m_Random : (unsigned)time_get_impl();
+		Random = Random*1103515245 + 12345;
+		if(pWorker)
+			pWorker->m_Random = Random;
+		int Start = (Random>>16) % m_NumThreads;
+		for(int i = 0; i < m_NumThreads && !pJob; i++)
+		{
+			CWorker *pVictim = m_apWorkers[(Start+i) % m_NumThreads];
+			if(pVictim != pWorker)
+				pJob = pVictim->m_Deque.Steal();
+		}
+	}
+	return pJob;
+}
+
 void CJobPool::WorkerThread(void *pUser)
 {
-	CJobPool *pPool = (CJobPool *)pUser;
+	CWorker *pWorker = (CWorker *)pUser;
+	CJobPool *pPool = pWorker->m_pPool;
+	s_pCurrentWorker = pWorker;
 
 	while(!pPool->m_Shutdown)
 	{
-		std::shared_ptr<IJob> pJob = 0;
-
-		// fetch job from queue
-		sphore_wait(&pPool->m_Semaphore);
-		lock_wait(pPool->m_Lock);
-		if(pPool->m_pFirstJob)
+		IJob *pJob = pPool->FindJob(pWorker);
+		if(pJob)
 		{
-			pJob = pPool->m_pFirstJob;
-			pPool->m_pFirstJob = pPool->m_pFirstJob->m_pNext;
-			if(!pPool->m_pFirstJob)
-				pPool->m_pLastJob = 0;
+			pPool->Execute(pJob);
+			continue;
 		}
-		lock_unlock(pPool->m_Lock);
 
-		// do the job if we have one
+		// announce the sleep before looking again, so a job added in
+		// between wakes us up
+		pPool->m_NumSleeping++;
+		pJob = pPool->FindJob(pWorker);
 		if(pJob)
 		{
-			RunBlocking(pJob.get());
+			pPool->m_NumSleeping--;
+			pPool->Execute(pJob);
+			continue;
 		}
+		sphore_wait(&pPool->m_Semaphore);
+		pPool->m_NumSleeping--;
 	}
 }
 
@@ -82,23 +222,120 @@ void CJobPool::Init(int NumThreads)
 {
 	// start threads
 	m_NumThreads = NumThreads > MAX_THREADS ? MAX_THREADS : NumThreads;
-	for(int i = 0; i < NumThreads; i++)
-		m_apThreads[i] = thread_init(WorkerThread, this, "CJobPool worker");
+	for(int i = 0; i < m_NumThreads; i++)
+	{
+		CWorker *pWorker = new CWorker;
+		pWorker->m_pPool = this;
+		pWorker->m_Index = i;
+		pWorker->m_pThread = 0;
+		pWorker->m_Random = i+1;
+		m_apWorkers[i] = pWorker;
+	}
+	// all deques exist before the first worker starts stealing
+	for(int i = 0; i < m_NumThreads; i++)
+		m_apWorkers[i]->m_pThread = thread_init(WorkerThread, m_apWorkers[i], "CJobPool worker");
+}
+
+void CJobPool::Schedule(IJob *pJob)
+{
+	CWorker *pWorker = CurrentWorker();
+	if(!pWorker || !pWorker->m_Deque.Push(pJob))
+	{
+		lock_wait(m_Lock);
+		pJob->m_pNext = 0;
+		if(m_pLastJob)
+			m_pLastJob->m_pNext = pJob;
+		m_pLastJob = pJob;
+		if(!m_pFirstJob)
+			m_pFirstJob = pJob;
+		m_NumInjected++;
+		lock_unlock(m_Lock);
+	}
+
+	// pairs with the check of the queues after announcing a sleep
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(m_NumSleeping.load() > 0)
+		sphore_signal(&m_Semaphore);
+}
+
+void CJobPool::Prepare(IJob *pJob, CJobGroup *pGroup)
+{
+	pJob->m_Status = IJob::STATE_PENDING;
+	pJob->m_pGroup = pGroup;
+	if(pGroup)
+		pGroup->m_NumPending++;
+
+	// a job that ran before starts with a fresh continuation list,
+	// continuations added before it was added again are kept
+	IJob *pDone = s_pJobDone;
+	pJob->m_pContinuations.compare_exchange_strong(pDone, 0);
 }
 
 void CJobPool::Add(std::shared_ptr<IJob> pJob)
 {
-	lock_wait(m_Lock);
+	IJob *pRaw = pJob.get();
+	Prepare(pRaw, 0);
+	pRaw->m_pSelf = std::move(pJob);
+	Schedule(pRaw);
+}
+
+void CJobPool::Add(IJob *pJob, CJobGroup *pGroup)
+{
+	Prepare(pJob, pGroup);
+	Schedule(pJob);
+}
+
+void CJobPool::AddContinuation(IJob *pJob, IJob *pAfter, CJobGroup *pGroup)
+{
+	Prepare(pJob, pGroup);
+
+	IJob *pHead = pAfter->m_pContinuations.load();
+	while(1)
+	{
+		if(pHead == s_pJobDone)
+		{
+			Schedule(pJob);
+			return;
+		}
+		pJob->m_pNext = pHead;
+		if(pAfter->m_pContinuations.compare_exchange_weak(pHead, pJob))
+			return;
+	}
+}
 
-	// add job to queue
-	if(m_pLastJob)
-		m_pLastJob->m_pNext = pJob;
-	m_pLastJob = std::move(pJob);
-	if(!m_pFirstJob)
-		m_pFirstJob = m_pLastJob;
+void CJobPool::Execute(IJob *pJob)
+{
+	pJob->m_Status = IJob::STATE_RUNNING;
+	pJob->Run();
 
-	lock_unlock(m_Lock);
-	sphore_signal(&m_Semaphore);
+	// the job may be destroyed as soon as it is marked as done
+	CJobGroup *pGroup = pJob->m_pGroup;
+	std::shared_ptr<IJob> pSelf = std::move(pJob->m_pSelf);
+	IJob *pContinuation = pJob->m_pContinuations.exchange(s_pJobDone);
+	pJob->m_Status = IJob::STATE_DONE;
+
+	while(pContinuation)
+	{
+		IJob *pNext = pContinuation->m_pNext;
+		Schedule(pContinuation);
+		pContinuation = pNext;
+	}
+
+	if(pGroup)
+		pGroup->m_NumPending--;
+}
+
+void CJobPool::Wait(CJobGroup *pGroup)
+{
+	CWorker *pWorker = CurrentWorker();
+	while(!pGroup->Done())
+	{
+		IJob *pJob = FindJob(pWorker);
+		if(pJob)
+			Execute(pJob);
+		else
+			thread_yield();
+	}
 }
 
 void CJobPool::RunBlocking(IJob *pJob)
@@ -11,12 +11,30 @@
 class IJob;
 class CJobPool;
 
+// counts the jobs added with it that did not finish yet
+class CJobGroup
+{
+	friend class CJobPool;
+
+	std::atomic<int> m_NumPending;
+
+public:
+	CJobGroup() : m_NumPending(0) {}
+	bool Done() const { return m_NumPending.load(std::memory_order_acquire) == 0; }
+};
+
 class IJob
 {
 	friend class CJobPool;
 
 private:
-	std::shared_ptr<IJob> m_pNext;
+	// keeps jobs that were added as shared pointers alive until they ran
+	std::shared_ptr<IJob> m_pSelf;
+	CJobGroup *m_pGroup;
+
+	// jobs to add once this one is done, linked through m_pNext
+	std::atomic<IJob *> m_pContinuations;
+	IJob *m_pNext;
 
 	std::atomic<int> m_Status;
 	virtual void Run() = 0;
@@ -36,29 +54,82 @@ public:
 	};
 };
 
+/*
+	Class: CJobPool
+		Work stealing thread pool. Every worker owns a Chase-Lev deque, jobs
+		added from a worker go to its own deque and idle workers steal from
+		the others. Jobs added from other threads go through a locked
+		injection queue.
+
+		Jobs are intrusive, adding an IJob pointer does not allocate. The
+		caller keeps such a job alive until it is done, e.g. by waiting for
+		its group.
+*/
 class CJobPool
 {
 	enum
 	{
-		MAX_THREADS = 32
+		MAX_THREADS = 32,
+		DEQUE_SIZE = 4096,
+	};
+
+	class CDeque
+	{
+		std::atomic<int64> m_Top;
+		std::atomic<int64> m_Bottom;
+		std::atomic<IJob *> m_apJobs[DEQUE_SIZE];
+
+	public:
+		CDeque();
+		// owner only
+		bool Push(IJob *pJob);
+		IJob *Pop();
+		// any thread
+		IJob *Steal();
+	};
+
+	struct CWorker
+	{
+		CJobPool *m_pPool;
+		int m_Index;
+		void *m_pThread;
+		unsigned m_Random;
+		CDeque m_Deque;
 	};
+
 	int m_NumThreads;
-	void *m_apThreads[MAX_THREADS];
+	CWorker *m_apWorkers[MAX_THREADS];
 	std::atomic<bool> m_Shutdown;
 
-	LOCK m_Lock;
 	SEMAPHORE m_Semaphore;
-	std::shared_ptr<IJob> m_pFirstJob GUARDED_BY(m_Lock);
-	std::shared_ptr<IJob> m_pLastJob GUARDED_BY(m_Lock);
+	std::atomic<int> m_NumSleeping;
+
+	LOCK m_Lock;
+	IJob *m_pFirstJob GUARDED_BY(m_Lock);
+	IJob *m_pLastJob GUARDED_BY(m_Lock);
+	std::atomic<int> m_NumInjected;
 
 	static void WorkerThread(void *pUser);
+	CWorker *CurrentWorker() const;
+	void Schedule(IJob *pJob);
+	IJob *FindJob(CWorker *pWorker);
+	void Execute(IJob *pJob);
+	void Prepare(IJob *pJob, CJobGroup *pGroup);
 
 public:
 	CJobPool();
 	~CJobPool();
 
 	void Init(int NumThreads);
+	int NumThreads() const { return m_NumThreads; }
+
 	void Add(std::shared_ptr<IJob> pJob);
+	void Add(IJob *pJob, CJobGroup *pGroup = 0);
+	// adds pJob once pAfter is done, right away if it already is
+	void AddContinuation(IJob *pJob, IJob *pAfter, CJobGroup *pGroup = 0);
+	// runs jobs on the calling thread until all jobs of the group are done
+	void Wait(CJobGroup *pGroup);
+
 	static void RunBlocking(IJob *pJob);
 };
 #endif
@@ -6,11 +6,371 @@
 
 #include "netban.h"
 
-template<class POOL>
-int CNetBan::Ban(POOL *pBanPool, const typename POOL::CDataType *pData, int Seconds, const char *pReason)
+#include <algorithm>
+
+static inline int AddrBit(const unsigned char *pAddr, int Index)
+{
+	return (pAddr[Index/8] >> (7-Index%8)) & 1;
+}
+
+// number of equal leading bits, at most Max
+static int CommonPrefix(const unsigned char *pAddr1, const unsigned char *pAddr2, int Max)
+{
+	int Bits = 0;
+	while(Bits+8 <= Max && pAddr1[Bits/8] == pAddr2[Bits/8])
+		Bits += 8;
+	while(Bits < Max && AddrBit(pAddr1, Bits) == AddrBit(pAddr2, Bits))
+		Bits++;
+	return Bits;
+}
+
+// largest aligned block that starts at pStart and does not go past pEnd, returns its host bits
+static int LargestBlock(const unsigned char *pStart, const unsigned char *pEnd, int Bits, unsigned char *pLast)
+{
+	int Bytes = Bits/8;
+	int HostBits = 0;
+	while(HostBits < Bits && !AddrBit(pStart, Bits-1-HostBits))
+		HostBits++;
+
+	while(1)
+	{
+		mem_copy(pLast, pStart, Bytes);
+		for(int i = 0; i < HostBits; i++)
+			pLast[Bytes-1-i/8] |= 1<<(i%8);
+		if(mem_comp(pLast, pEnd, Bytes) <= 0)
+			return HostBits;
+		HostBits--;
+	}
+}
+
+int CNetBan::NewTrieNode(const unsigned char *pPrefix, int Length)
+{
+	CTrieNode Node;
+	mem_zero(Node.m_aPrefix, sizeof(Node.m_aPrefix));
+	mem_copy(Node.m_aPrefix, pPrefix, (Length+7)/8);
+	if(Length%8)
+		Node.m_aPrefix[Length/8] &= 0xff << (8-Length%8);
+	Node.m_Length = Length;
+	Node.m_aChild[0] = Node.m_aChild[1] = -1;
+	Node.m_FirstEntry = -1;
+	m_vTrieNodes.push_back(Node);
+	return m_vTrieNodes.size()-1;
+}
+
+void CNetBan::TrieInsert(int Family, const unsigned char *pPrefix, int Length, int Ban)
+{
+	// the link to the current node is either a root or a child of Parent
+	int Parent = -1;
+	int Side = 0;
+	int Node = m_aTrieRoot[Family];
+	int Target;
+
+	while(1)
+	{
+		if(Node == -1)
+		{
+			Target = Node = NewTrieNode(pPrefix, Length);
+			break;
+		}
+
+		int NodeLength = m_vTrieNodes[Node].m_Length;
+		int Common = CommonPrefix(m_vTrieNodes[Node].m_aPrefix, pPrefix, minimum(NodeLength, Length));
+		if(Common == NodeLength)
+		{
+			if(Common == Length)
+			{
+				// same prefix, attach to the existing node
+				CTrieEntry Entry = {Ban, m_vTrieNodes[Node].m_FirstEntry};
+				m_vTrieEntries.push_back(Entry);
+				m_vTrieNodes[Node].m_FirstEntry = m_vTrieEntries.size()-1;
+				return;
+			}
+			Parent = Node;
+			Side = AddrBit(pPrefix, Common);
+			Node = m_vTrieNodes[Node].m_aChild[Side];
+			continue;
+		}
+
+		// split the node at the first differing bit
+		int Split = NewTrieNode(pPrefix, Common);
+		m_vTrieNodes[Split].m_aChild[AddrBit(m_vTrieNodes[Node].m_aPrefix, Common)] = Node;
+		if(Common == Length)
+			Target = Split;
+		else
+		{
+			Target = NewTrieNode(pPrefix, Length);
+			m_vTrieNodes[Split].m_aChild[AddrBit(pPrefix, Common)] = Target;
+		}
+		Node = Split;
+		break;
+	}
+
+	if(Parent == -1)
+		m_aTrieRoot[Family] = Node;
+	else
+		m_vTrieNodes[Parent].m_aChild[Side] = Node;
+
+	CTrieEntry Entry = {Ban, m_vTrieNodes[Target].m_FirstEntry};
+	m_vTrieEntries.push_back(Entry);
+	m_vTrieNodes[Target].m_FirstEntry = m_vTrieEntries.size()-1;
+}
+
+int CNetBan::TrieFind(int Family, const unsigned char *pPrefix, int Length) const
+{
+	int Node = m_aTrieRoot[Family];
+	while(Node != -1)
+	{
+		const CTrieNode *pNode = &m_vTrieNodes[Node];
+		if(pNode->m_Length > Length || CommonPrefix(pNode->m_aPrefix, pPrefix, pNode->m_Length) < pNode->m_Length)
+			return -1;
+		if(pNode->m_Length == Length)
+			return Node;
+		Node = pNode->m_aChild[AddrBit(pPrefix, pNode->m_Length)];
+	}
+	return -1;
+}
+
+void CNetBan::TrieInsertBan(int Ban)
+{
+	const CNetRange *pRange = &m_vBans[Ban].m_Range;
+	int Family = AddrFamily(&pRange->m_LB);
+	int Bits = AddrBits(&pRange->m_LB);
+	int Bytes = Bits/8;
+
+	// cover the range with the smallest set of prefixes
+	unsigned char aStart[16], aLast[16];
+	mem_copy(aStart, pRange->m_LB.ip, Bytes);
+	while(1)
+	{
+		int HostBits = LargestBlock(aStart, pRange->m_UB.ip, Bits, aLast);
+		TrieInsert(Family, aStart, Bits-HostBits, Ban);
+		if(mem_comp(aLast, pRange->m_UB.ip, Bytes) == 0)
+			break;
+
+		mem_copy(aStart, aLast, Bytes);
+		for(int i = Bytes-1; i >= 0 && ++aStart[i] == 0; i--);
+	}
+}
+
+void CNetBan::RebuildTrie()
+{
+	m_vTrieNodes.clear();
+	m_vTrieEntries.clear();
+	m_aTrieRoot[0] = m_aTrieRoot[1] = -1;
+	for(unsigned i = 0; i < m_vBans.size(); i++)
+		if(m_vBans[i].m_Used)
+			TrieInsertBan(i);
+}
+
+void CNetBan::HeapSwap(int a, int b)
+{
+	int Temp = m_vExpiryHeap[a];
+	m_vExpiryHeap[a] = m_vExpiryHeap[b];
+	m_vExpiryHeap[b] = Temp;
+	m_vBans[m_vExpiryHeap[a]].m_HeapIndex = a;
+	m_vBans[m_vExpiryHeap[b]].m_HeapIndex = b;
+}
+
+void CNetBan::HeapUp(int Index)
+{
+	while(Index > 0 && HeapLess(Index, (Index-1)/2))
+	{
+		HeapSwap(Index, (Index-1)/2);
+		Index = (Index-1)/2;
+	}
+}
+
+void CNetBan::HeapDown(int Index)
+{
+	int Size = m_vExpiryHeap.size();
+	while(1)
+	{
+		int Smallest = Index;
+		if(Index*2+1 < Size && HeapLess(Index*2+1, Smallest))
+			Smallest = Index*2+1;
+		if(Index*2+2 < Size && HeapLess(Index*2+2, Smallest))
+			Smallest = Index*2+2;
+		if(Smallest == Index)
+			return;
+		HeapSwap(Index, Smallest);
+		Index = Smallest;
+	}
+}
+
+void CNetBan::HeapInsert(int Ban)
+{
+	m_vExpiryHeap.push_back(Ban);
+	m_vBans[Ban].m_HeapIndex = m_vExpiryHeap.size()-1;
+	HeapUp(m_vBans[Ban].m_HeapIndex);
+}
+
+void CNetBan::HeapRemove(int Ban)
+{
+	int Index = m_vBans[Ban].m_HeapIndex;
+	if(Index == -1)
+		return;
+
+	int Last = m_vExpiryHeap.size()-1;
+	if(Index != Last)
+	{
+		HeapSwap(Index, Last);
+		m_vExpiryHeap.pop_back();
+		HeapDown(Index);
+		HeapUp(Index);
+	}
+	else
+		m_vExpiryHeap.pop_back();
+	m_vBans[Ban].m_HeapIndex = -1;
+}
+
+int CNetBan::AddBan(const CNetRange *pRange, bool IsRange, const CBanInfo *pInfo)
+{
+	int Ban;
+	if(m_vFreeBans.empty())
+	{
+		Ban = m_vBans.size();
+		m_vBans.push_back(CBan());
+	}
+	else
+	{
+		Ban = m_vFreeBans.back();
+		m_vFreeBans.pop_back();
+	}
+
+	CBan *pBan = &m_vBans[Ban];
+	pBan->m_Range = *pRange;
+	pBan->m_IsRange = IsRange;
+	pBan->m_Used = true;
+	pBan->m_HeapIndex = -1;
+	pBan->m_Info = *pInfo;
+	if(IsRange)
+		m_NumRangeBans++;
+	else
+		m_NumAddrBans++;
+
+	if(pInfo->m_Expires != CBanInfo::EXPIRES_NEVER)
+		HeapInsert(Ban);
+	TrieInsertBan(Ban);
+	return Ban;
+}
+
+void CNetBan::UpdateBan(int Ban, const CBanInfo *pInfo)
+{
+	HeapRemove(Ban);
+	m_vBans[Ban].m_Info = *pInfo;
+	if(pInfo->m_Expires != CBanInfo::EXPIRES_NEVER)
+		HeapInsert(Ban);
+}
+
+// the trie has to be rebuilt afterwards
+void CNetBan::RemoveBan(int Ban)
+{
+	HeapRemove(Ban);
+	if(m_vBans[Ban].m_IsRange)
+		m_NumRangeBans--;
+	else
+		m_NumAddrBans--;
+	m_vBans[Ban].m_Used = false;
+	m_vFreeBans.push_back(Ban);
+}
+
+int CNetBan::FindExact(const CNetRange *pRange, bool IsRange) const
+{
+	// the first prefix of the range carries the ban
+	unsigned char aLast[16];
+	int Bits = AddrBits(&pRange->m_LB);
+	int HostBits = LargestBlock(pRange->m_LB.ip, pRange->m_UB.ip, Bits, aLast);
+	int Node = TrieFind(AddrFamily(&pRange->m_LB), pRange->m_LB.ip, Bits-HostBits);
+	if(Node == -1)
+		return -1;
+
+	for(int e = m_vTrieNodes[Node].m_FirstEntry; e != -1; e = m_vTrieEntries[e].m_Next)
+	{
+		const CBan *pBan = &m_vBans[m_vTrieEntries[e].m_Ban];
+		if(pBan->m_IsRange == IsRange && NetComp(&pBan->m_Range, pRange) == 0)
+			return m_vTrieEntries[e].m_Ban;
+	}
+	return -1;
+}
+
+void CNetBan::GetSortedBans(std::vector<int> *pvBans) const
+{
+	// addresses before ranges, then by expiry with permanent bans last
+	pvBans->clear();
+	for(unsigned i = 0; i < m_vBans.size(); i++)
+		if(m_vBans[i].m_Used)
+			pvBans->push_back(i);
+
+	const std::vector<CBan> &vBans = m_vBans;
+	std::sort(pvBans->begin(), pvBans->end(), [&vBans](int a, int b) {
+		const CBan *pA = &vBans[a];
+		const CBan *pB = &vBans[b];
+		if(pA->m_IsRange != pB->m_IsRange)
+			return pB->m_IsRange;
+		unsigned ExpiresA = pA->m_Info.m_Expires;
+		unsigned ExpiresB = pB->m_Info.m_Expires;
+		if(ExpiresA != ExpiresB)
+			return ExpiresA < ExpiresB;
+		return a < b;
+	});
+}
+
+void CNetBan::MakeBanInfo(int Ban, char *pBuf, unsigned BuffSize, int Type) const
+{
+	if(Ban == -1 || pBuf == 0)
+	{
+		if(BuffSize > 0)
+			pBuf[0] = 0;
+		return;
+	}
+
+	const CBan *pBan = &m_vBans[Ban];
+
+	// build type based part
+	char aBuf[256];
+	if(Type == MSGTYPE_PLAYER)
+		str_copy(aBuf, "You have been banned", sizeof(aBuf));
+	else
+	{
+		char aTemp[256];
+		if(pBan->m_IsRange)
+			NetToString(&pBan->m_Range, aTemp, sizeof(aTemp));
+		else
+			NetToString(&pBan->m_Range.m_LB, aTemp, sizeof(aTemp));
+
+		switch(Type)
+		{
+		case MSGTYPE_LIST:
+			str_format(aBuf, sizeof(aBuf), "%s banned", aTemp); break;
+		case MSGTYPE_BANADD:
+			str_format(aBuf, sizeof(aBuf), "banned %s", aTemp); break;
+		case MSGTYPE_BANREM:
+			str_format(aBuf, sizeof(aBuf), "unbanned %s", aTemp); break;
+		default:
+			aBuf[0] = 0;
+		}
+	}
+
+	// add info part
+	if(pBan->m_Info.m_Expires != CBanInfo::EXPIRES_NEVER)
+	{
+		int Mins = ((pBan->m_Info.m_Expires-time_timestamp()) + 59) / 60;
+		if(Mins <= 1)
+			str_format(pBuf, BuffSize, "%s for 1 minute (%s)", aBuf, pBan->m_Info.m_aReason);
+		else
+			str_format(pBuf, BuffSize, "%s for %d minutes (%s)", aBuf, Mins, pBan->m_Info.m_aReason);
+	}
+	else
+		str_format(pBuf, BuffSize, "%s for life (%s)", aBuf, pBan->m_Info.m_aReason);
+}
+
+int CNetBan::BanImpl(const CNetRange *pRange, bool IsRange, int Seconds, const char *pReason)
 {
 	// do not ban localhost
-	if(NetMatch(pData, &m_LocalhostIPV4) || NetMatch(pData, &m_LocalhostIPV6))
+	bool Localhost = IsRange ?
+		NetMatch(pRange, &m_LocalhostIPV4) || NetMatch(pRange, &m_LocalhostIPV6) :
+		NetMatch(&pRange->m_LB, &m_LocalhostIPV4) || NetMatch(&pRange->m_LB, &m_LocalhostIPV6);
+	if(Localhost)
 	{
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (localhost)");
 		return -1;
@@ -24,42 +384,34 @@ int CNetBan::Ban(POOL *pBanPool, const typename POOL::CDataType *pData, int Seco
 	str_copy(Info.m_aReason, pReason, sizeof(Info.m_aReason));
 
 	// check if it already exists
-	CNetHash NetHash(pData);
-	CNode<typename POOL::CDataType, CBanInfo> *pBan = pBanPool->Find(pData, &NetHash);
-	if(pBan)
+	int Ban = FindExact(pRange, IsRange);
+	if(Ban != -1)
 	{
 		// adjust the ban
-		pBanPool->Update(pBan, &Info);
+		UpdateBan(Ban, &Info);
 		char aBuf[128];
-		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_LIST);
+		MakeBanInfo(Ban, aBuf, sizeof(aBuf), MSGTYPE_LIST);
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
 		return 1;
 	}
 
 	// add ban and print result
-	pBan = pBanPool->Add(pData, &Info, &NetHash);
-	if(pBan)
-	{
-		char aBuf[128];
-		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_BANADD);
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
-		return 0;
-	}
-	else
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (full banlist)");
-	return -1;
+	Ban = AddBan(pRange, IsRange, &Info);
+	char aBuf[128];
+	MakeBanInfo(Ban, aBuf, sizeof(aBuf), MSGTYPE_BANADD);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+	return 0;
 }
 
-template<class POOL>
-int CNetBan::Unban(POOL *pBanPool, const typename POOL::CDataType *pData)
+int CNetBan::UnbanImpl(const CNetRange *pRange, bool IsRange)
 {
-	CNetHash NetHash(pData);
-	CNode<typename POOL::CDataType, CBanInfo> *pBan = pBanPool->Find(pData, &NetHash);
-	if(pBan)
+	int Ban = FindExact(pRange, IsRange);
+	if(Ban != -1)
 	{
 		char aBuf[256];
-		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_BANREM);
-		pBanPool->Remove(pBan);
+		MakeBanInfo(Ban, aBuf, sizeof(aBuf), MSGTYPE_BANREM);
+		RemoveBan(Ban);
+		RebuildTrie();
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
 		return 0;
 	}
@@ -72,8 +424,8 @@ void CNetBan::Init(IConsole *pConsole, IStorage *pStorage)
 {
 	m_pConsole = pConsole;
 	m_pStorage = pStorage;
-	m_BanAddrPool.Reset();
-	m_BanRangePool.Reset();
+	UnbanAll();
+	mem_zero(m_aLastReply, sizeof(m_aLastReply));
 
 	net_host_lookup("localhost", &m_LocalhostIPV4, NETTYPE_IPV4);
 	net_host_lookup("localhost", &m_LocalhostIPV6, NETTYPE_IPV6);
@@ -93,29 +445,33 @@ void CNetBan::Update()
 
 	// remove expired bans
 	char aBuf[256], aNetStr[256];
-	while(m_BanAddrPool.First() && m_BanAddrPool.First()->m_Info.m_Expires != CBanInfo::EXPIRES_NEVER && m_BanAddrPool.First()->m_Info.m_Expires < Now)
-	{
-		str_format(aBuf, sizeof(aBuf), "ban %s expired", NetToString(&m_BanAddrPool.First()->m_Data, aNetStr, sizeof(aNetStr)));
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
-		m_BanAddrPool.Remove(m_BanAddrPool.First());
-	}
-	while(m_BanRangePool.First() && m_BanRangePool.First()->m_Info.m_Expires != CBanInfo::EXPIRES_NEVER && m_BanRangePool.First()->m_Info.m_Expires < Now)
+	bool Removed = false;
+	while(!m_vExpiryHeap.empty() && m_vBans[m_vExpiryHeap[0]].m_Info.m_Expires < Now)
 	{
-		str_format(aBuf, sizeof(aBuf), "ban %s expired", NetToString(&m_BanRangePool.First()->m_Data, aNetStr, sizeof(aNetStr)));
+		const CBan *pBan = &m_vBans[m_vExpiryHeap[0]];
+		if(pBan->m_IsRange)
+			NetToString(&pBan->m_Range, aNetStr, sizeof(aNetStr));
+		else
+			NetToString(&pBan->m_Range.m_LB, aNetStr, sizeof(aNetStr));
+		str_format(aBuf, sizeof(aBuf), "ban %s expired", aNetStr);
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
-		m_BanRangePool.Remove(m_BanRangePool.First());
+		RemoveBan(m_vExpiryHeap[0]);
+		Removed = true;
 	}
+
+	if(Removed)
+		RebuildTrie();
 }
 
 int CNetBan::BanAddr(const NETADDR *pAddr, int Seconds, const char *pReason)
 {
-	return Ban(&m_BanAddrPool, pAddr, Seconds, pReason);
+	return Ban(pAddr, Seconds, pReason);
 }
 
 int CNetBan::BanRange(const CNetRange *pRange, int Seconds, const char *pReason)
 {
 	if(pRange->IsValid())
-		return Ban(&m_BanRangePool, pRange, Seconds, pReason);
+		return Ban(pRange, Seconds, pReason);
 
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (invalid range)");
 	return -1;
@@ -123,13 +479,14 @@ int CNetBan::BanRange(const CNetRange *pRange, int Seconds, const char *pReason)
 
 int CNetBan::UnbanByAddr(const NETADDR *pAddr)
 {
-	return Unban(&m_BanAddrPool, pAddr);
+	CNetRange Range = {*pAddr, *pAddr};
+	return UnbanImpl(&Range, false);
 }
 
 int CNetBan::UnbanByRange(const CNetRange *pRange)
 {
 	if(pRange->IsValid())
-		return Unban(&m_BanRangePool, pRange);
+		return UnbanImpl(pRange, true);
 	
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "ban failed (invalid range)");
 	return -1;
@@ -137,62 +494,71 @@ int CNetBan::UnbanByRange(const CNetRange *pRange)
 
 int CNetBan::UnbanByIndex(int Index)
 {
-	int Result;
-	char aBuf[256];
-	CBanAddr *pBan = m_BanAddrPool.Get(Index);
-	if(pBan)
+	std::vector<int> vBans;
+	GetSortedBans(&vBans);
+	if(Index < 0 || Index >= (int)vBans.size())
 	{
-		NetToString(&pBan->m_Data, aBuf, sizeof(aBuf));
-		Result = m_BanAddrPool.Remove(pBan);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "unban failed (invalid index)");
+		return -1;
 	}
+
+	char aBuf[256];
+	const CBan *pBan = &m_vBans[vBans[Index]];
+	if(pBan->m_IsRange)
+		NetToString(&pBan->m_Range, aBuf, sizeof(aBuf));
 	else
-	{
-		CBanRange *pBan = m_BanRangePool.Get(Index-m_BanAddrPool.Num());
-		if(pBan)
-		{
-			NetToString(&pBan->m_Data, aBuf, sizeof(aBuf));
-			Result = m_BanRangePool.Remove(pBan);
-		}
-		else
-		{
-			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", "unban failed (invalid index)");
-			return -1;
-		}
-	}
+		NetToString(&pBan->m_Range.m_LB, aBuf, sizeof(aBuf));
+	RemoveBan(vBans[Index]);
+	RebuildTrie();
 
 	char aMsg[256];
 	str_format(aMsg, sizeof(aMsg), "unbanned index %i (%s)", Index, aBuf);
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aMsg);
-	return Result;
+	return 0;
 }
 
-bool CNetBan::IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize) const
+void CNetBan::UnbanAll()
 {
-	CNetHash aHash[17];
-	int Length = CNetHash::MakeHashArray(pAddr, aHash);
+	m_vBans.clear();
+	m_vFreeBans.clear();
+	m_vExpiryHeap.clear();
+	m_NumAddrBans = 0;
+	m_NumRangeBans = 0;
+	RebuildTrie();
+}
 
-	// check ban adresses
-	CBanAddr *pBan = m_BanAddrPool.Find(pAddr, &aHash[Length]);
-	if(pBan)
+int CNetBan::FindBan(const NETADDR *pAddr) const
+{
+	// walk down the address bits, the most specific ban wins
+	int Bits = AddrBits(pAddr);
+	int Ban = -1;
+	int Node = m_aTrieRoot[AddrFamily(pAddr)];
+	while(Node != -1)
 	{
-		MakeBanInfo(pBan, pBuf, BufferSize, MSGTYPE_PLAYER);
-		return true;
+		const CTrieNode *pNode = &m_vTrieNodes[Node];
+		if(CommonPrefix(pNode->m_aPrefix, pAddr->ip, pNode->m_Length) < pNode->m_Length)
+			break;
+		if(pNode->m_FirstEntry != -1)
+			Ban = m_vTrieEntries[pNode->m_FirstEntry].m_Ban;
+		if(pNode->m_Length == Bits)
+			break;
+		Node = pNode->m_aChild[AddrBit(pAddr->ip, pNode->m_Length)];
 	}
+	return Ban;
+}
 
-	// check ban ranges
-	for(int i = Length-1; i >= 0; --i)
-	{
-		for(CBanRange *pBan = m_BanRangePool.First(&aHash[i]); pBan; pBan = pBan->m_pHashNext)
-		{
-			if(NetMatch(&pBan->m_Data, pAddr, i, Length))
-			{
-				MakeBanInfo(pBan, pBuf, BufferSize, MSGTYPE_PLAYER);
-				return true;
-			}
-		}
-	}
-	
-	return false;
+bool CNetBan::NeedsBanReply(const NETADDR *pAddr)
+{
+	unsigned Hash = 2166136261u;
+	for(int i = 0; i < (int)sizeof(pAddr->ip); i++)
+		Hash = (Hash ^ pAddr->ip[i]) * 16777619u;
+
+	int64 *pLastReply = &m_aLastReply[Hash%NUM_REPLY_SLOTS];
+	int64 Now = time_get();
+	if(*pLastReply && Now-*pLastReply < time_freq())
+		return false;
+	*pLastReply = Now;
+	return true;
 }
 
 bool CNetBan::ConBan(IConsole::IResult *pResult, void *pUser)
@@ -281,15 +647,11 @@ bool CNetBan::ConBans(IConsole::IResult *pResult, void *pUser)
 
 	int Count = 0;
 	char aBuf[256], aMsg[256];
-	for(CBanAddr *pBan = pThis->m_BanAddrPool.First(); pBan; pBan = pBan->m_pNext)
+	std::vector<int> vBans;
+	pThis->GetSortedBans(&vBans);
+	for(unsigned i = 0; i < vBans.size(); i++)
 	{
-		pThis->MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_LIST);
-		str_format(aMsg, sizeof(aMsg), "#%i %s", Count++, aBuf);
-		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aMsg);
-	}
-	for(CBanRange *pBan = pThis->m_BanRangePool.First(); pBan; pBan = pBan->m_pNext)
-	{
-		pThis->MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_LIST);
+		pThis->MakeBanInfo(vBans[i], aBuf, sizeof(aBuf), MSGTYPE_LIST);
 		str_format(aMsg, sizeof(aMsg), "#%i %s", Count++, aBuf);
 		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aMsg);
 	}
@@ -314,20 +676,20 @@ bool CNetBan::ConBansSave(IConsole::IResult *pResult, void *pUser)
 
 	int Now = time_timestamp();
 	char aAddrStr1[NETADDR_MAXSTRSIZE], aAddrStr2[NETADDR_MAXSTRSIZE];
-	for(CBanAddr *pBan = pThis->m_BanAddrPool.First(); pBan; pBan = pBan->m_pNext)
-	{
-		int Min = pBan->m_Info.m_Expires>-1 ? (pBan->m_Info.m_Expires-Now+59)/60 : -1;
-		net_addr_str(&pBan->m_Data, aAddrStr1, sizeof(aAddrStr1), false);
-		str_format(aBuf, sizeof(aBuf), "ban %s %i %s", aAddrStr1, Min, pBan->m_Info.m_aReason);
-		io_write(File, aBuf, str_length(aBuf));
-		io_write_newline(File);
-	}
-	for(CBanRange *pBan = pThis->m_BanRangePool.First(); pBan; pBan = pBan->m_pNext)
+	std::vector<int> vBans;
+	pThis->GetSortedBans(&vBans);
+	for(unsigned i = 0; i < vBans.size(); i++)
 	{
+		const CBan *pBan = &pThis->m_vBans[vBans[i]];
 		int Min = pBan->m_Info.m_Expires>-1 ? (pBan->m_Info.m_Expires-Now+59)/60 : -1;
-		net_addr_str(&pBan->m_Data.m_LB, aAddrStr1, sizeof(aAddrStr1), false);
-		net_addr_str(&pBan->m_Data.m_UB, aAddrStr2, sizeof(aAddrStr2), false);
-		str_format(aBuf, sizeof(aBuf), "ban_range %s %s %i %s", aAddrStr1, aAddrStr2, Min, pBan->m_Info.m_aReason);
+		net_addr_str(&pBan->m_Range.m_LB, aAddrStr1, sizeof(aAddrStr1), false);
+		if(pBan->m_IsRange)
+		{
+			net_addr_str(&pBan->m_Range.m_UB, aAddrStr2, sizeof(aAddrStr2), false);
+			str_format(aBuf, sizeof(aBuf), "ban_range %s %s %i %s", aAddrStr1, aAddrStr2, Min, pBan->m_Info.m_aReason);
+		}
+		else
+			str_format(aBuf, sizeof(aBuf), "ban %s %i %s", aAddrStr1, Min, pBan->m_Info.m_aReason);
 		io_write(File, aBuf, str_length(aBuf));
 		io_write_newline(File);
 	}
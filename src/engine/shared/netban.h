@@ -4,6 +4,8 @@
 #include <base/system.h>
 #include "netdatabase.h"
 
+#include <vector>
+
 class CNetBan : public CNetDatabase
 {
 protected:
@@ -18,19 +20,78 @@ protected:
 		char m_aReason[REASON_LENGTH];
 	};
 
-	typedef CPool<NETADDR, CBanInfo, 1> CBanAddrPool;
-	typedef CPool<CNetRange, CBanInfo, 16> CBanRangePool;
-	typedef CNode<NETADDR, CBanInfo> CBanAddr;
-	typedef CNode<CNetRange, CBanInfo> CBanRange;
-	
-	template<class DATATYPE> void MakeBanInfo(const CNode<DATATYPE, CBanInfo> *pBan, char *pBuf, unsigned BuffSize, int Type) const;
-	template<class POOL> int Ban(POOL *pBanPool, const typename POOL::CDataType *pData, int Seconds, const char *pReason);
-	template<class POOL> int Unban(POOL *pBanPool, const typename POOL::CDataType *pData);
+	// an address ban is stored as a range with equal bounds
+	struct CBan
+	{
+		CNetRange m_Range;
+		bool m_IsRange;
+		bool m_Used;
+		int m_HeapIndex;	// position in the expiry heap, -1 for permanent bans
+		CBanInfo m_Info;
+	};
+
+	// path compressed binary trie over the address bits, ranges are split into prefixes
+	struct CTrieNode
+	{
+		unsigned char m_aPrefix[16];
+		int m_Length;
+		int m_aChild[2];
+		int m_FirstEntry;
+	};
+
+	struct CTrieEntry
+	{
+		int m_Ban;
+		int m_Next;
+	};
+
+	enum
+	{
+		NUM_REPLY_SLOTS=1024,
+	};
+
+	std::vector<CBan> m_vBans;
+	std::vector<int> m_vFreeBans;
+	std::vector<int> m_vExpiryHeap;
+	std::vector<CTrieNode> m_vTrieNodes;
+	std::vector<CTrieEntry> m_vTrieEntries;
+	int m_aTrieRoot[2];
+	int m_NumAddrBans;
+	int m_NumRangeBans;
+	int64 m_aLastReply[NUM_REPLY_SLOTS];
+
+	static int AddrFamily(const NETADDR *pAddr) { return pAddr->type == NETTYPE_IPV4 ? 0 : 1; }
+	static int AddrBits(const NETADDR *pAddr) { return pAddr->type == NETTYPE_IPV4 ? 32 : 128; }
+
+	int NewTrieNode(const unsigned char *pPrefix, int Length);
+	void TrieInsert(int Family, const unsigned char *pPrefix, int Length, int Ban);
+	int TrieFind(int Family, const unsigned char *pPrefix, int Length) const;
+	void TrieInsertBan(int Ban);
+	void RebuildTrie();
+
+	bool HeapLess(int a, int b) const { return m_vBans[m_vExpiryHeap[a]].m_Info.m_Expires < m_vBans[m_vExpiryHeap[b]].m_Info.m_Expires; }
+	void HeapSwap(int a, int b);
+	void HeapUp(int Index);
+	void HeapDown(int Index);
+	void HeapInsert(int Ban);
+	void HeapRemove(int Ban);
+
+	int AddBan(const CNetRange *pRange, bool IsRange, const CBanInfo *pInfo);
+	void UpdateBan(int Ban, const CBanInfo *pInfo);
+	void RemoveBan(int Ban);
+	int FindExact(const CNetRange *pRange, bool IsRange) const;
+	int Find(const NETADDR *pAddr) const { CNetRange Range = {*pAddr, *pAddr}; return FindExact(&Range, false); }
+	int Find(const CNetRange *pRange) const { return FindExact(pRange, true); }
+	void GetSortedBans(std::vector<int> *pvBans) const;
+
+	void MakeBanInfo(int Ban, char *pBuf, unsigned BuffSize, int Type) const;
+	int BanImpl(const CNetRange *pRange, bool IsRange, int Seconds, const char *pReason);
+	int UnbanImpl(const CNetRange *pRange, bool IsRange);
+	int Ban(const NETADDR *pAddr, int Seconds, const char *pReason) { CNetRange Range = {*pAddr, *pAddr}; return BanImpl(&Range, false, Seconds, pReason); }
+	int Ban(const CNetRange *pRange, int Seconds, const char *pReason) { return BanImpl(pRange, true, Seconds, pReason); }
 
 	class IConsole *m_pConsole;
 	class IStorage *m_pStorage;
-	CBanAddrPool m_BanAddrPool;
-	CBanRangePool m_BanRangePool;
 	NETADDR m_LocalhostIPV4, m_LocalhostIPV6;
 
 public:
@@ -45,6 +106,11 @@ public:
 	class IConsole *Console() const { return m_pConsole; }
 	class IStorage *Storage() const { return m_pStorage; }
 
+	CNetBan() : m_NumAddrBans(0), m_NumRangeBans(0), m_pConsole(0), m_pStorage(0)
+	{
+		m_aTrieRoot[0] = m_aTrieRoot[1] = -1;
+		mem_zero(m_aLastReply, sizeof(m_aLastReply));
+	}
 	virtual ~CNetBan() {}
 	void Init(class IConsole *pConsole, class IStorage *pStorage);
 	void Update();
@@ -54,8 +120,15 @@ public:
 	int UnbanByAddr(const NETADDR *pAddr);
 	int UnbanByRange(const CNetRange *pRange);
 	int UnbanByIndex(int Index);
-	void UnbanAll() { m_BanAddrPool.Reset(); m_BanRangePool.Reset(); }
-	bool IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize) const;
+	void UnbanAll();
+	int NumBans() const { return m_NumAddrBans + m_NumRangeBans; }
+
+	// returns a ban handle or -1, does not format anything
+	int FindBan(const NETADDR *pAddr) const;
+	bool IsBanned(const NETADDR *pAddr) const { return FindBan(pAddr) != -1; }
+	// limits the ban messages sent back to one address to one per second
+	bool NeedsBanReply(const NETADDR *pAddr);
+	void GetBanMessage(int Ban, char *pBuf, unsigned BufferSize) const { MakeBanInfo(Ban, pBuf, BufferSize, MSGTYPE_PLAYER); }
 
 	static bool ConBan(class IConsole::IResult *pResult, void *pUser);
 	static bool ConBanRange(class IConsole::IResult *pResult, void *pUser);
@@ -66,47 +139,4 @@ public:
 	static bool ConBansSave(class IConsole::IResult *pResult, void *pUser);
 };
 
-template<class DATATYPE>
-void CNetBan::MakeBanInfo(const CNode<DATATYPE, CBanInfo> *pBan, char *pBuf, unsigned BuffSize, int Type) const
-{
-	if(pBan == 0 || pBuf == 0)
-	{
-		if(BuffSize > 0)
-			pBuf[0] = 0;
-		return;
-	}
-
-	// build type based part
-	char aBuf[256];
-	if(Type == MSGTYPE_PLAYER)
-		str_copy(aBuf, "You have been banned", sizeof(aBuf));
-	else
-	{
-		char aTemp[256];
-		switch(Type)
-		{
-		case MSGTYPE_LIST:
-			str_format(aBuf, sizeof(aBuf), "%s banned", NetToString(&pBan->m_Data, aTemp, sizeof(aTemp))); break;
-		case MSGTYPE_BANADD:
-			str_format(aBuf, sizeof(aBuf), "banned %s", NetToString(&pBan->m_Data, aTemp, sizeof(aTemp))); break;
-		case MSGTYPE_BANREM:
-			str_format(aBuf, sizeof(aBuf), "unbanned %s", NetToString(&pBan->m_Data, aTemp, sizeof(aTemp))); break;
-		default:
-			aBuf[0] = 0;
-		}
-	}
-
-	// add info part
-	if(pBan->m_Info.m_Expires != CBanInfo::EXPIRES_NEVER)
-	{
-		int Mins = ((pBan->m_Info.m_Expires-time_timestamp()) + 59) / 60;
-		if(Mins <= 1)
-			str_format(pBuf, BuffSize, "%s for 1 minute (%s)", aBuf, pBan->m_Info.m_aReason);
-		else
-			str_format(pBuf, BuffSize, "%s for %d minutes (%s)", aBuf, Mins, pBan->m_Info.m_aReason);
-	}
-	else
-		str_format(pBuf, BuffSize, "%s for life (%s)", aBuf, pBan->m_Info.m_aReason);
-}
-
 #endif
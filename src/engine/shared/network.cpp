@@ -375,5 +375,10 @@ static const unsigned gs_aFreqTable[256+1] = {
 
 void CNetBase::Init()
 {
-	ms_Huffman.Init(gs_aFreqTable);
+	InitHuffman(&ms_Huffman);
+}
+
+void CNetBase::InitHuffman(CHuffman *pHuffman)
+{
+	pHuffman->Init(gs_aFreqTable);
 }
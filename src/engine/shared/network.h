@@ -198,6 +198,7 @@ private:
 	NETADDR m_PeerAddr;
 	NETSOCKET m_Socket;
 	NETSTATS m_Stats;
+	int m_ResentChunks;
 
 public:
 	bool m_TimeoutProtected;
@@ -242,6 +243,10 @@ public:
 	int SecurityToken() const { return m_SecurityToken; }
 	
 	int AckSequence() const { return m_Ack; }
+
+	// traffic of the connection, the counters only grow
+	const NETSTATS *Stats() const { return &m_Stats; }
+	int ResentChunks() const { return m_ResentChunks; }
 	
 	// anti spoof
 	void DirectInit(NETADDR &Addr, SECURITY_TOKEN SecurityToken);
@@ -346,6 +351,10 @@ public:
 	bool Open(NETADDR BindAddr, class CNetBan *pNetBan, int MaxClients, int MaxClientsPerIP, int Flags);
 	int Close();
 
+	// drive the server without a socket, used to replay journals
+	void OpenOffline(int MaxClients);
+	void ConnectOffline(int ClientID, const NETADDR &Addr);
+
 	//
 	int Recv(CNetChunk *pChunk);
 	int Send(CNetChunk *pChunk);
@@ -369,6 +378,8 @@ public:
 	// status requests
 	const NETADDR *ClientAddr(int ClientID) const { return m_aSlots[ClientID].m_Connection.PeerAddress(); }
 	bool HasSecurityToken(int ClientID) const { return m_aSlots[ClientID].m_Connection.SecurityToken() != NET_SECURITY_TOKEN_UNSUPPORTED; }
+	const NETSTATS *ClientStats(int ClientID) const { return m_aSlots[ClientID].m_Connection.Stats(); }
+	int ClientResentChunks(int ClientID) const { return m_aSlots[ClientID].m_Connection.ResentChunks(); }
 	NETADDR Address() const { return m_Address; }
 	NETSOCKET Socket() const { return m_Socket; }
 	class CNetBan *NetBan() const { return m_pNetBan; }
@@ -469,6 +480,8 @@ public:
 	static void OpenLog(IOHANDLE DataLogSent, IOHANDLE DataLogRecv);
 	static void CloseLog();
 	static void Init();
+	// inits pHuffman with the code of the network protocol
+	static void InitHuffman(CHuffman *pHuffman);
 	static int Compress(const void *pData, int DataSize, void *pOutput, int OutputSize);
 	static int Decompress(const void *pData, int DataSize, void *pOutput, int OutputSize);
 
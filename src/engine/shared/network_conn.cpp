@@ -12,6 +12,7 @@ SECURITY_TOKEN ToSecurityToken(const unsigned char* pData)
 void CNetConnection::ResetStats()
 {
 	mem_zero(&m_Stats, sizeof(m_Stats));
+	m_ResentChunks = 0;
 }
 
 void CNetConnection::Reset(bool Rejoin)
@@ -92,6 +93,8 @@ int CNetConnection::Flush()
 	// send of the packets
 	m_Construct.m_Ack = m_Ack;
 	CNetBase::SendPacket(m_Socket, &m_PeerAddr, &m_Construct, m_SecurityToken);
+	m_Stats.sent_packets++;
+	m_Stats.sent_bytes += m_Construct.m_DataSize; // before compression
 
 	// update send times
 	m_LastSendTime = time_get();
@@ -185,6 +188,7 @@ void CNetConnection::ResendChunk(CNetChunkResend *pResend)
 {
 	QueueChunkEx(pResend->m_Flags|NET_CHUNKFLAG_RESEND, pResend->m_DataSize, pResend->m_pData, pResend->m_Sequence);
 	pResend->m_LastSendTime = time_get();
+	m_ResentChunks++;
 }
 
 void CNetConnection::Resend()
@@ -262,6 +266,8 @@ int CNetConnection::Feed(CNetPacketConstruct *pPacket, NETADDR *pAddr)
  			return 0;
  	}
  	m_PeerAck = pPacket->m_Ack;
+	m_Stats.recv_packets++;
+	m_Stats.recv_bytes += pPacket->m_DataSize;
 
 	int64 Now = time_get();
 
@@ -105,11 +105,16 @@ int CNetConsole::Update()
 	if(net_tcp_accept(m_Socket, &Socket, &Addr) > 0)
 	{
 		// check if we just should drop the packet
-		char aBuf[128];
-		if(NetBan() && NetBan()->IsBanned(&Addr, aBuf, sizeof(aBuf)))
+		int Ban = NetBan() ? NetBan()->FindBan(&Addr) : -1;
+		if(Ban != -1)
 		{
 			// banned, reply with a message and drop
-			net_tcp_send(Socket, aBuf, str_length(aBuf));
+			if(NetBan()->NeedsBanReply(&Addr))
+			{
+				char aBuf[128];
+				NetBan()->GetBanMessage(Ban, aBuf, sizeof(aBuf));
+				net_tcp_send(Socket, aBuf, str_length(aBuf));
+			}
 			net_tcp_close(Socket);
 		}
 		else
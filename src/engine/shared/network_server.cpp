@@ -41,6 +41,32 @@ bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int Ma
 	return true;
 }
 
+void CNetServer::OpenOffline(int MaxClients)
+{
+	mem_zero(this, sizeof(*this));
+
+	m_Socket.type = NETTYPE_INVALID;
+	m_Socket.ipv4sock = -1;
+	m_Socket.ipv6sock = -1;
+	m_Socket.web_ipv4sock = -1;
+	m_MaxClients = MaxClients;
+	if(m_MaxClients > NET_MAX_CLIENTS)
+		m_MaxClients = NET_MAX_CLIENTS;
+	if(m_MaxClients < 1)
+		m_MaxClients = 1;
+
+	for(int i = 0; i < NET_MAX_CLIENTS; i++)
+		m_aSlots[i].m_Connection.Init(m_Socket, true);
+}
+
+void CNetServer::ConnectOffline(int ClientID, const NETADDR &Addr)
+{
+	NETADDR PeerAddr = Addr;
+	m_aSlots[ClientID].m_Connection.DirectInit(PeerAddr, NET_SECURITY_TOKEN_UNSUPPORTED);
+	if(m_pfnNewClient)
+		m_pfnNewClient(ClientID, m_UserPtr);
+}
+
 int CNetServer::SetCallbacks(NETFUNC_NEWCLIENT pfnNewClient, NETFUNC_DELCLIENT pfnDelClient, void *pUser)
 {
 	m_pfnNewClient = pfnNewClient;
@@ -426,7 +452,7 @@ int CNetServer::Recv(CNetChunk *pChunk)
 			if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONNLESS)
 			{
 				//refuse server info for banned clients (vanilla behavior)
-				if(NetBan() && NetBan()->IsBanned(&Addr, aBuf, sizeof(aBuf)))
+				if(NetBan() && NetBan()->IsBanned(&Addr))
 					continue;
 
 				pChunk->m_Flags = NETSENDFLAG_CONNLESS;
@@ -470,10 +496,15 @@ int CNetServer::Recv(CNetChunk *pChunk)
 					// not found, client that wants to connect
 
 					//refuse connect for banned clients
-					if(NetBan() && NetBan()->IsBanned(&Addr, aBuf, sizeof(aBuf)))
+					int Ban = NetBan() ? NetBan()->FindBan(&Addr) : -1;
+					if(Ban != -1)
 					{
-						// banned, reply with a message
-						CNetBase::SendControlMsg(m_Socket, &Addr, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf)+1, NET_SECURITY_TOKEN_UNSUPPORTED);
+						// banned, reply with a message, but not to every packet
+						if(NetBan()->NeedsBanReply(&Addr))
+						{
+							NetBan()->GetBanMessage(Ban, aBuf, sizeof(aBuf));
+							CNetBase::SendControlMsg(m_Socket, &Addr, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf)+1, NET_SECURITY_TOKEN_UNSUPPORTED);
+						}
 						continue;
  					}
 
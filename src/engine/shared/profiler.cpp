@@ -0,0 +1,185 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+
+#include "profiler.h"
+
+#include <algorithm>
+
+/*
+	Sample file format, all integers little endian:
+		header:  "TWPROF" u8 version u8 reserved i64 time_freq
+		phase:   'P' u8 phase u8 name_length name
+		sample:  'S' u8 phase u32 tick u32 duration (time_freq units)
+	Phase records always come before the first sample of the phase.
+*/
+
+enum
+{
+	PROFILE_FILE_VERSION = 1,
+};
+
+static const char *s_apEnginePhaseNames[CProfiler::NUM_ENGINE_PHASES] = {
+	"network",
+	"input",
+	"game_tick",
+	"sql_commands",
+	"snapshot",
+	"snapshot_onsnap",
+	"snapshot_delta",
+	"snapshot_compress",
+};
+
+CProfiler g_Profiler;
+
+static void WriteInt(unsigned char *pBuf, int64 Value, int Size)
+{
+	for(int i = 0; i < Size; i++)
+		pBuf[i] = (Value >> (i * 8)) & 0xff;
+}
+
+CProfiler::CProfiler()
+{
+	m_NumPhases = 0;
+	m_Enabled = true;
+	m_Tick = 0;
+	m_File = 0;
+	m_BufferSize = 0;
+	for(int i = 0; i < NUM_ENGINE_PHASES; i++)
+		AddPhase(s_apEnginePhaseNames[i]);
+}
+
+CProfiler::~CProfiler()
+{
+	StopRecording();
+}
+
+int CProfiler::AddPhase(const char *pName)
+{
+	// the game registers its phases again on every map change
+	for(int i = 0; i < m_NumPhases; i++)
+		if(str_comp(m_aPhases[i].m_aName, pName) == 0)
+			return i;
+
+	if(m_NumPhases == MAX_PHASES)
+		return -1;
+
+	CPhase *pPhase = &m_aPhases[m_NumPhases];
+	str_copy(pPhase->m_aName, pName, sizeof(pPhase->m_aName));
+	pPhase->m_NumSamples = 0;
+	pPhase->m_NextSample = 0;
+	if(m_File)
+		WritePhase(m_NumPhases);
+	return m_NumPhases++;
+}
+
+void CProfiler::AddSample(int Phase, int64 Duration)
+{
+	if(Phase < 0 || Phase >= m_NumPhases)
+		return;
+
+	CPhase *pPhase = &m_aPhases[Phase];
+	pPhase->m_aSamples[pPhase->m_NextSample] = Duration;
+	pPhase->m_NextSample = (pPhase->m_NextSample + 1) % NUM_SAMPLES;
+	if(pPhase->m_NumSamples < NUM_SAMPLES)
+		pPhase->m_NumSamples++;
+
+	if(m_File)
+	{
+		unsigned char aRecord[10];
+		aRecord[0] = 'S';
+		aRecord[1] = Phase;
+		WriteInt(&aRecord[2], m_Tick, 4);
+		WriteInt(&aRecord[6], minimum(Duration, (int64)0xffffffff), 4);
+		Write(aRecord, sizeof(aRecord));
+	}
+}
+
+bool CProfiler::GetStats(int Phase, CStats *pStats) const
+{
+	if(Phase < 0 || Phase >= m_NumPhases || !m_aPhases[Phase].m_NumSamples)
+		return false;
+
+	const CPhase *pPhase = &m_aPhases[Phase];
+	int64 aSorted[NUM_SAMPLES];
+	int64 Sum = 0;
+	for(int i = 0; i < pPhase->m_NumSamples; i++)
+	{
+		aSorted[i] = pPhase->m_aSamples[i];
+		Sum += aSorted[i];
+	}
+	std::sort(aSorted, aSorted + pPhase->m_NumSamples);
+
+	pStats->m_NumSamples = pPhase->m_NumSamples;
+	pStats->m_Avg = Sum / pPhase->m_NumSamples;
+	pStats->m_P50 = aSorted[pPhase->m_NumSamples / 2];
+	pStats->m_P99 = aSorted[pPhase->m_NumSamples * 99 / 100];
+	pStats->m_Max = aSorted[pPhase->m_NumSamples - 1];
+	return true;
+}
+
+void CProfiler::Reset()
+{
+	for(int i = 0; i < m_NumPhases; i++)
+	{
+		m_aPhases[i].m_NumSamples = 0;
+		m_aPhases[i].m_NextSample = 0;
+	}
+}
+
+void CProfiler::StartRecording(IOHANDLE File)
+{
+	StopRecording();
+	if(!File)
+		return;
+
+	m_File = File;
+	m_BufferSize = 0;
+
+	unsigned char aHeader[16];
+	mem_copy(aHeader, "TWPROF", 6);
+	aHeader[6] = PROFILE_FILE_VERSION;
+	aHeader[7] = 0;
+	WriteInt(&aHeader[8], time_freq(), 8);
+	Write(aHeader, sizeof(aHeader));
+
+	for(int i = 0; i < m_NumPhases; i++)
+		WritePhase(i);
+}
+
+void CProfiler::StopRecording()
+{
+	if(!m_File)
+		return;
+
+	Flush();
+	io_close(m_File);
+	m_File = 0;
+}
+
+void CProfiler::WritePhase(int Phase)
+{
+	const char *pName = m_aPhases[Phase].m_aName;
+	unsigned char aRecord[3 + MAX_NAME_LENGTH];
+	int Length = str_length(pName);
+	aRecord[0] = 'P';
+	aRecord[1] = Phase;
+	aRecord[2] = Length;
+	mem_copy(&aRecord[3], pName, Length);
+	Write(aRecord, 3 + Length);
+}
+
+void CProfiler::Write(const void *pData, int Size)
+{
+	if(m_BufferSize + Size > (int)sizeof(m_aBuffer))
+		Flush();
+	mem_copy(&m_aBuffer[m_BufferSize], pData, Size);
+	m_BufferSize += Size;
+}
+
+void CProfiler::Flush()
+{
+	if(m_BufferSize)
+		io_write(m_File, m_aBuffer, m_BufferSize);
+	m_BufferSize = 0;
+}
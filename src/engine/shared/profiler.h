@@ -0,0 +1,132 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_PROFILER_H
+#define ENGINE_SHARED_PROFILER_H
+
+#include <base/system.h>
+
+/*
+	Class: Profiler
+		Keeps the last samples of every tick phase in a ring buffer and
+		optionally streams all samples to a file. Samples are in time_get_impl()
+		units. Only used from the server thread.
+*/
+class CProfiler
+{
+public:
+	enum
+	{
+		PHASE_NETWORK = 0,
+		PHASE_INPUT,
+		PHASE_GAMETICK,
+		PHASE_SQL,
+		PHASE_SNAPSHOT,
+		PHASE_SNAP_CREATE,
+		PHASE_SNAP_DELTA,
+		PHASE_SNAP_COMPRESS,
+		NUM_ENGINE_PHASES,
+
+		MAX_PHASES = 64,
+		MAX_NAME_LENGTH = 32,
+		NUM_SAMPLES = 512,
+	};
+
+	struct CStats
+	{
+		int m_NumSamples;
+		int64 m_Avg;
+		int64 m_P50;
+		int64 m_P99;
+		int64 m_Max;
+	};
+
+private:
+	struct CPhase
+	{
+		char m_aName[MAX_NAME_LENGTH];
+		int64 m_aSamples[NUM_SAMPLES];
+		int m_NumSamples;
+		int m_NextSample;
+	};
+
+	CPhase m_aPhases[MAX_PHASES];
+	int m_NumPhases;
+	bool m_Enabled;
+	int m_Tick;
+
+	IOHANDLE m_File;
+	unsigned char m_aBuffer[4096];
+	int m_BufferSize;
+
+	void Write(const void *pData, int Size);
+	void WritePhase(int Phase);
+	void Flush();
+
+public:
+	CProfiler();
+	~CProfiler();
+
+	int AddPhase(const char *pName);
+	int NumPhases() const { return m_NumPhases; }
+	const char *PhaseName(int Phase) const { return m_aPhases[Phase].m_aName; }
+
+	bool Enabled() const { return m_Enabled; }
+	void SetEnabled(bool Enabled) { m_Enabled = Enabled; }
+	void SetTick(int Tick) { m_Tick = Tick; }
+
+	void AddSample(int Phase, int64 Duration);
+	bool GetStats(int Phase, CStats *pStats) const;
+	void Reset();
+
+	// takes ownership of the file
+	void StartRecording(IOHANDLE File);
+	void StopRecording();
+	bool IsRecording() const { return m_File != 0; }
+};
+
+extern CProfiler g_Profiler;
+
+// measures its own lifetime
+class CProfileScope
+{
+	int m_Phase;
+	int64 m_Start;
+
+public:
+	CProfileScope(int Phase) : m_Phase(Phase), m_Start(g_Profiler.Enabled() ? time_get_impl() : 0) {}
+	~CProfileScope()
+	{
+		if(m_Start)
+			g_Profiler.AddSample(m_Phase, time_get_impl() - m_Start);
+	}
+};
+
+// sums several intervals into one sample
+class CProfileTimer
+{
+	int m_Phase;
+	bool m_Enabled;
+	int64 m_Start;
+	int64 m_Total;
+
+public:
+	CProfileTimer(int Phase) : m_Phase(Phase), m_Enabled(g_Profiler.Enabled()), m_Start(0), m_Total(0) {}
+	~CProfileTimer()
+	{
+		if(m_Enabled)
+			g_Profiler.AddSample(m_Phase, m_Total);
+	}
+
+	void Start()
+	{
+		if(m_Enabled)
+			m_Start = time_get_impl();
+	}
+	void Stop()
+	{
+		if(m_Enabled)
+			m_Total += time_get_impl() - m_Start;
+	}
+};
+
+#endif
@@ -166,6 +166,35 @@ void CSnapshotDelta::UndiffItem(int *pPast, int *pDiff, int *pOut, int Size)
 	}
 }
 
+int CSnapshotDelta::TypeStatsIndex(int Type)
+{
+	if(Type < MAX_NETOBJSIZES)
+		return Type;
+	if(Type > CSnapshot::MAX_TYPE - (NUM_TYPE_STATS - MAX_NETOBJSIZES - 1))
+		return MAX_NETOBJSIZES + CSnapshot::MAX_TYPE - Type;
+	return NUM_TYPE_STATS - 1;
+}
+
+int CSnapshotDelta::TypeStatsType(int Index)
+{
+	if(Index < MAX_NETOBJSIZES)
+		return Index;
+	if(Index < NUM_TYPE_STATS - 1)
+		return CSnapshot::MAX_TYPE - (Index - MAX_NETOBJSIZES);
+	return -1;
+}
+
+CSnapshotDelta::CTypeStats *CSnapshotDelta::CountItem(CTypeStats *pTypeStats, int Type, const int *pData, int Num)
+{
+	int Index = TypeStatsIndex(Type);
+	unsigned char aBuf[16];
+	int Bytes = 0;
+	for(int i = 0; i < Num; i++)
+		Bytes += (int)(CVariableInt::Pack(aBuf, pData[i]) - aBuf);
+	pTypeStats[Index].m_Bytes += Bytes;
+	return &pTypeStats[Index];
+}
+
 CSnapshotDelta::CSnapshotDelta()
 {
 	mem_zero(m_aItemSizes, sizeof(m_aItemSizes));
@@ -197,7 +226,7 @@ CSnapshotDelta::CData *CSnapshotDelta::EmptyDelta()
 }
 
 // TODO: OPT: this should be made much faster
-int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData)
+int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData, CTypeStats *pTypeStats)
 {
 	CData *pDelta = (CData *)pDstData;
 	int *pData = (int *)pDelta->m_aData;
@@ -224,6 +253,8 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 			// deleted
 			pDelta->m_NumDeletedItems++;
 			*pData = pFromItem->Key();
+			if(pTypeStats)
+				CountItem(pTypeStats, pFromItem->Type(), pData, 1)->m_NumDeleted++;
 			pData++;
 		}
 	}
@@ -260,16 +291,20 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 
 			if(DiffItem(pPastItem->Data(), pCurItem->Data(), pItemDataDst, ItemSize / 4))
 			{
+				int *pItemStart = pData;
 				*pData++ = pCurItem->Type();
 				*pData++ = pCurItem->ID();
 				if(IncludeSize)
 					*pData++ = ItemSize / 4;
 				pData += ItemSize / 4;
 				pDelta->m_NumUpdateItems++;
+				if(pTypeStats)
+					CountItem(pTypeStats, pCurItem->Type(), pItemStart, pData - pItemStart)->m_NumDelta++;
 			}
 		}
 		else
 		{
+			int *pItemStart = pData;
 			*pData++ = pCurItem->Type();
 			*pData++ = pCurItem->ID();
 			if(IncludeSize)
@@ -280,6 +315,8 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 			pData += ItemSize / 4;
 			pDelta->m_NumUpdateItems++;
 			Count++;
+			if(pTypeStats)
+				CountItem(pTypeStats, pCurItem->Type(), pItemStart, pData - pItemStart)->m_NumFull++;
 		}
 	}
 
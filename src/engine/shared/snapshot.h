@@ -66,11 +66,26 @@ public:
 		int m_aData[1];
 	};
 
-private:
 	enum
 	{
-		MAX_NETOBJSIZES = 64
+		MAX_NETOBJSIZES = 64,
+		// the vanilla item types, the extended ones from MAX_TYPE down and
+		// one for the rest
+		NUM_TYPE_STATS = MAX_NETOBJSIZES * 2
 	};
+
+	// what CreateDelta wrote for an item type when the caller asks for
+	// it, the byte count is the packed size of its ints
+	class CTypeStats
+	{
+	public:
+		int64 m_Bytes;
+		int64 m_NumFull;
+		int64 m_NumDelta;
+		int64 m_NumDeleted;
+	};
+
+private:
 	short m_aItemSizes[MAX_NETOBJSIZES];
 	int m_aSnapshotDataRate[0xffff];
 	int m_aSnapshotDataUpdates[0xffff];
@@ -78,8 +93,13 @@ private:
 	CData m_Empty;
 
 	void UndiffItem(int *pPast, int *pDiff, int *pOut, int Size);
+	// adds the packed size of the ints of an item to the stats of its type
+	static CTypeStats *CountItem(CTypeStats *pTypeStats, int Type, const int *pData, int Num);
 
 public:
+	static int TypeStatsIndex(int Type);
+	// the item type of a stats index, -1 for the rest
+	static int TypeStatsType(int Index);
 	static int DiffItem(int *pPast, int *pCurrent, int *pOut, int Size);
 	CSnapshotDelta();
 	CSnapshotDelta(const CSnapshotDelta &Old);
@@ -87,7 +107,8 @@ public:
 	int GetDataUpdates(int Index) { return m_aSnapshotDataUpdates[Index]; }
 	void SetStaticsize(int ItemType, int Size);
 	CData *EmptyDelta();
-	int CreateDelta(class CSnapshot *pFrom, class CSnapshot *pTo, void *pData);
+	// pTypeStats, if given, has NUM_TYPE_STATS entries
+	int CreateDelta(class CSnapshot *pFrom, class CSnapshot *pTo, void *pData, CTypeStats *pTypeStats = 0);
 	int UnpackDelta(class CSnapshot *pFrom, class CSnapshot *pTo, void *pData, int DataSize);
 };
 
@@ -150,9 +171,13 @@ public:
 	void Init(bool Sixup = false);
 
 	void *NewItem(int Type, int ID, int Size);
+	// the type ID of an extended item type index, 0 if it is not used
+	int GetExtendedItemType(int Index) const { return Index < m_NumExtendedItemTypes ? m_aExtendedItemTypes[Index] : 0; }
 
 	CSnapshotItem *GetItem(int Index);
 	int *GetItemData(int Key);
+	// size of the finished snapshot so far
+	int Size() const { return sizeof(CSnapshot) + sizeof(int) * m_NumItems + m_DataSize; }
 
 	int Finish(void *pSnapdata);
 };
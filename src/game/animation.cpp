@@ -27,12 +27,19 @@ void GetAnimationTransform(float GlobalTime, int Env, CLayers* pLayers, vec2& Po
 
 	CMapItemEnvelope *pItem = (CMapItemEnvelope *)pLayers->Map()->GetItem(Start+Env, 0, 0);
 
-	pPoints += pItem->m_StartPoint;
+	EvaluateAnimationEnvelope(GlobalTime, pPoints + pItem->m_StartPoint, pItem->m_NumPoints, Position, Angle);
+}
+
+void EvaluateAnimationEnvelope(float GlobalTime, const CEnvPoint *pPoints, int NumPoints, vec2& Position, float& Angle)
+{
+	Position.x = 0.0f;
+	Position.y = 0.0f;
+	Angle = 0.0f;
 
-	if(pItem->m_NumPoints == 0)
+	if(NumPoints == 0)
 		return;
 	
-	if(pItem->m_NumPoints == 1)
+	if(NumPoints == 1)
 	{
 		Position.x = fx2f(pPoints[0].m_aValues[0]);
 		Position.y = fx2f(pPoints[0].m_aValues[1]);
@@ -40,8 +47,8 @@ void GetAnimationTransform(float GlobalTime, int Env, CLayers* pLayers, vec2& Po
 		return;
 	}
 
-	float Time = fmod(GlobalTime, pPoints[pItem->m_NumPoints-1].m_Time/1000.0f)*1000.0f;
-	for(int i = 0; i < pItem->m_NumPoints-1; i++)
+	float Time = fmod(GlobalTime, pPoints[NumPoints-1].m_Time/1000.0f)*1000.0f;
+	for(int i = 0; i < NumPoints-1; i++)
 	{
 		if(Time >= pPoints[i].m_Time && Time <= pPoints[i+1].m_Time)
 		{
@@ -88,8 +95,8 @@ void GetAnimationTransform(float GlobalTime, int Env, CLayers* pLayers, vec2& Po
 		}
 	}
 
-	Position.x = fx2f(pPoints[pItem->m_NumPoints-1].m_aValues[0]);
-	Position.y = fx2f(pPoints[pItem->m_NumPoints-1].m_aValues[1]);
-	Angle = fx2f(pPoints[pItem->m_NumPoints-1].m_aValues[2]);
+	Position.x = fx2f(pPoints[NumPoints-1].m_aValues[0]);
+	Position.y = fx2f(pPoints[NumPoints-1].m_aValues[1]);
+	Angle = fx2f(pPoints[NumPoints-1].m_aValues[2]);
 	return;
 }
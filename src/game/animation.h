@@ -6,5 +6,6 @@
 #include <base/vmath.h>
 
 void GetAnimationTransform(float GlobalTime, int Env, class CLayers* pLayers, vec2& Position, float& Angle);
+void EvaluateAnimationEnvelope(float GlobalTime, const struct CEnvPoint *pPoints, int NumPoints, vec2& Position, float& Angle);
 
 #endif
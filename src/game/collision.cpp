@@ -26,6 +26,12 @@ CCollision::CCollision()
 	m_pTele = 0;
 
 	m_Time = 0.0;
+
+	m_ConnectedVisitStamp = 0;
+	m_EnvelopeStamp = 0;
+
+	m_ClearanceZoneHandle = -1;
+	m_ClearanceStaticZones = false;
 }
 
 CCollision::~CCollision()
@@ -63,7 +69,135 @@ void CCollision::Init(class CLayers *pLayers)
 		}
 	}
 
+	InitConnectivity();
+	InitEnvelopes();
 	InitTeleports();
+
+	m_Clearance.clear();
+	m_ClearanceZoneHandle = -1;
+	m_ClearanceStaticZones = false;
+}
+
+void CCollision::InitEnvelopes()
+{
+	m_EnvelopeRanges.clear();
+	m_EnvelopeTransforms.clear();
+	m_EnvelopeStamp = 0;
+
+	const CEnvPoint *pPoints = 0;
+	{
+		int Start, Num;
+		m_pLayers->Map()->GetType(MAPITEMTYPE_ENVPOINTS, &Start, &Num);
+		if(Num)
+			pPoints = (const CEnvPoint *)m_pLayers->Map()->GetItem(Start, 0, 0);
+	}
+
+	int Start, Num;
+	m_pLayers->Map()->GetType(MAPITEMTYPE_ENVELOPE, &Start, &Num);
+	for(int i = 0; i < Num; i++)
+	{
+		const CMapItemEnvelope *pItem = (const CMapItemEnvelope *)m_pLayers->Map()->GetItem(Start+i, 0, 0);
+		CEnvelopeRange Range;
+		Range.m_pPoints = pPoints + pItem->m_StartPoint;
+		Range.m_NumPoints = pItem->m_NumPoints;
+		m_EnvelopeRanges.push_back(Range);
+	}
+
+	CEnvelopeTransform Transform;
+	Transform.m_Position = vec2(0.0f, 0.0f);
+	Transform.m_Angle = 0.0f;
+	Transform.m_Stamp = -1;
+	m_EnvelopeTransforms.assign(Num, Transform);
+}
+
+void CCollision::SetTime(double Time)
+{
+	m_Time = Time;
+	//Invalidates the transforms evaluated for the previous time
+	m_EnvelopeStamp++;
+	if(m_EnvelopeStamp == 0x7fffffff)
+	{
+		m_EnvelopeStamp = 0;
+		for(unsigned i = 0; i < m_EnvelopeTransforms.size(); i++)
+			m_EnvelopeTransforms[i].m_Stamp = -1;
+	}
+}
+
+void CCollision::GetEnvelopeTransform(double Time, int Env, vec2 &Position, float &Angle)
+{
+	if(Env < 0 || Env >= (int)m_EnvelopeRanges.size())
+	{
+		Position = vec2(0.0f, 0.0f);
+		Angle = 0.0f;
+		return;
+	}
+
+	const CEnvelopeRange &Range = m_EnvelopeRanges[Env];
+	if(Time != m_Time)
+	{
+		EvaluateAnimationEnvelope(Time, Range.m_pPoints, Range.m_NumPoints, Position, Angle);
+		return;
+	}
+
+	CEnvelopeTransform &Transform = m_EnvelopeTransforms[Env];
+	if(Transform.m_Stamp != m_EnvelopeStamp)
+	{
+		EvaluateAnimationEnvelope(m_Time, Range.m_pPoints, Range.m_NumPoints, Transform.m_Position, Transform.m_Angle);
+		Transform.m_Stamp = m_EnvelopeStamp;
+	}
+	Position = Transform.m_Position;
+	Angle = Transform.m_Angle;
+}
+
+void CCollision::InitConnectivity()
+{
+	m_TileComponents.assign(m_Width*m_Height, -1);
+	m_ComponentBounds.clear();
+
+	std::vector<int> Queue;
+	Queue.reserve(m_Width*m_Height);
+
+	for(int Start = 0; Start < m_Width*m_Height; Start++)
+	{
+		if((m_pTiles[Start]&COLFLAG_SOLID) || m_TileComponents[Start] >= 0)
+			continue;
+
+		const int Component = m_ComponentBounds.size();
+		CComponentBounds Bounds;
+		Bounds.m_MinX = Bounds.m_MaxX = Start % m_Width;
+		Bounds.m_MinY = Bounds.m_MaxY = Start / m_Width;
+
+		Queue.clear();
+		Queue.push_back(Start);
+		m_TileComponents[Start] = Component;
+		for(unsigned q = 0; q < Queue.size(); q++)
+		{
+			const int Index = Queue[q];
+			const int x = Index % m_Width;
+			const int y = Index / m_Width;
+			Bounds.m_MinX = minimum(Bounds.m_MinX, x);
+			Bounds.m_MinY = minimum(Bounds.m_MinY, y);
+			Bounds.m_MaxX = maximum(Bounds.m_MaxX, x);
+			Bounds.m_MaxY = maximum(Bounds.m_MaxY, y);
+
+			const int aNeighbors[4] = {
+				x > 0 ? Index-1 : -1,
+				x < m_Width-1 ? Index+1 : -1,
+				y > 0 ? Index-m_Width : -1,
+				y < m_Height-1 ? Index+m_Width : -1,
+			};
+			for(int n = 0; n < 4; n++)
+			{
+				const int Neighbor = aNeighbors[n];
+				if(Neighbor < 0 || (m_pTiles[Neighbor]&COLFLAG_SOLID) || m_TileComponents[Neighbor] >= 0)
+					continue;
+				m_TileComponents[Neighbor] = Component;
+				Queue.push_back(Neighbor);
+			}
+		}
+
+		m_ComponentBounds.push_back(Bounds);
+	}
 }
 
 void CCollision::InitTeleports()
@@ -407,7 +541,7 @@ int CCollision::GetZoneValueAt(int ZoneHandle, float x, float y)
 				float Angle = 0.0f;
 				if(pQuads[q].m_PosEnv >= 0)
 				{
-					GetAnimationTransform(m_Time, pQuads[q].m_PosEnv, m_pLayers, Position, Angle);
+					GetEnvelopeTransform(m_Time, pQuads[q].m_PosEnv, Position, Angle);
 				}
 				
 				vec2 p0 = Position + vec2(fx2f(pQuads[q].m_aPoints[0].x), fx2f(pQuads[q].m_aPoints[0].y));
@@ -445,66 +579,212 @@ bool CCollision::AreConnected(vec2 Pos1, vec2 Pos2, float Radius)
 	int CenterY = TileRadius;
 	int Width = 2*TileRadius+1;
 	int Height = 2*TileRadius+1;
-	char* pMap = new char[Width*Height];
+	
+	int Pos2X = clamp(CenterX + (int)round((Pos2.x - Pos1.x)/32.0f), 0, Width-1);
+	int Pos2Y = clamp(CenterY + (int)round((Pos2.y - Pos1.y)/32.0f), 0, Height-1);
+	
+	//The starting tile is always reachable, even inside of a wall
+	if(Pos2X == CenterX && Pos2Y == CenterY)
+		return true;
+	
+	//Tiles probed by the cells of the search window. Neighbour cells always
+	//map to the same or to neighbour tiles, so a path in the window is a path
+	//in the map too.
+	m_ConnectedTileX.resize(Width);
+	m_ConnectedTileY.resize(Height);
+	for(int i=0; i<Width; i++)
+		m_ConnectedTileX[i] = clamp((int)round(Pos1.x + 32.0f*(i-CenterX))/32, 0, m_Width-1);
 	for(int j=0; j<Height; j++)
+		m_ConnectedTileY[j] = clamp((int)round(Pos1.y + 32.0f*(j-CenterY))/32, 0, m_Height-1);
+	
+	const int TargetComponent = m_TileComponents[m_ConnectedTileY[Pos2Y]*m_Width+m_ConnectedTileX[Pos2X]];
+	if(TargetComponent < 0)
+		return false;
+	
+	//Without any path in the whole map there is nothing to search
+	const int CenterComponent = m_TileComponents[m_ConnectedTileY[CenterY]*m_Width+m_ConnectedTileX[CenterX]];
+	bool SameComponent = CenterComponent == TargetComponent;
+	if(CenterComponent < 0)
 	{
-		for(int i=0; i<Width; i++)
-		{
-			if(CheckPoint(Pos1.x + 32.0f*(i-CenterX), Pos1.y + 32.0f*(j-CenterY)))
-				pMap[j*Width+i] = 0x0; //This tile can be checked
-			else
-				pMap[j*Width+i] = 0x1;
-		}
+		if(CenterX > 0 && m_TileComponents[m_ConnectedTileY[CenterY]*m_Width+m_ConnectedTileX[CenterX-1]] == TargetComponent)
+			SameComponent = true;
+		if(CenterX < Width-1 && m_TileComponents[m_ConnectedTileY[CenterY]*m_Width+m_ConnectedTileX[CenterX+1]] == TargetComponent)
+			SameComponent = true;
+		if(CenterY > 0 && m_TileComponents[m_ConnectedTileY[CenterY-1]*m_Width+m_ConnectedTileX[CenterX]] == TargetComponent)
+			SameComponent = true;
+		if(CenterY < Height-1 && m_TileComponents[m_ConnectedTileY[CenterY+1]*m_Width+m_ConnectedTileX[CenterX]] == TargetComponent)
+			SameComponent = true;
 	}
+	if(!SameComponent)
+		return false;
 	
-	pMap[CenterY*Width+CenterX] = 0x2; //This tile is checked
+	//The whole component fits in the search window
+	const CComponentBounds &Bounds = m_ComponentBounds[TargetComponent];
+	if(Bounds.m_MinX >= m_ConnectedTileX[0] && Bounds.m_MaxX <= m_ConnectedTileX[Width-1] &&
+		Bounds.m_MinY >= m_ConnectedTileY[0] && Bounds.m_MaxY <= m_ConnectedTileY[Height-1])
+		return true;
 	
-	int Pos2X = clamp(CenterX + (int)round((Pos2.x - Pos1.x)/32.0f), 0, Width-1);
-	int Pos2Y = clamp(CenterY + (int)round((Pos2.y - Pos1.y)/32.0f), 0, Height-1);
+	//Otherwise the path must stay in the search window
+	if((int)m_ConnectedVisits.size() < Width*Height)
+	{
+		m_ConnectedVisits.assign(Width*Height, 0);
+		m_ConnectedQueue.resize(Width*Height);
+		m_ConnectedVisitStamp = 0;
+	}
+	m_ConnectedVisitStamp++;
+	if(m_ConnectedVisitStamp <= 0)
+	{
+		m_ConnectedVisits.assign(m_ConnectedVisits.size(), 0);
+		m_ConnectedVisitStamp = 1;
+	}
+	
+	const int Stamp = m_ConnectedVisitStamp;
+	const int Target = Pos2Y*Width+Pos2X;
+	int QueueSize = 0;
+	m_ConnectedQueue[QueueSize++] = CenterY*Width+CenterX;
+	m_ConnectedVisits[CenterY*Width+CenterX] = Stamp;
+	for(int q=0; q<QueueSize; q++)
+	{
+		const int Cell = m_ConnectedQueue[q];
+		const int i = Cell % Width;
+		const int j = Cell / Width;
+		const int aNeighbors[4] = {
+			i>0 ? Cell-1 : -1,
+			i<Width-1 ? Cell+1 : -1,
+			j>0 ? Cell-Width : -1,
+			j<Height-1 ? Cell+Width : -1,
+		};
+		for(int n=0; n<4; n++)
+		{
+			const int Neighbor = aNeighbors[n];
+			if(Neighbor < 0 || m_ConnectedVisits[Neighbor] == Stamp)
+				continue;
+			const int TileIndex = m_ConnectedTileY[Neighbor/Width]*m_Width+m_ConnectedTileX[Neighbor%Width];
+			if(m_TileComponents[TileIndex] != TargetComponent)
+				continue;
+			if(Neighbor == Target)
+				return true;
+			m_ConnectedVisits[Neighbor] = Stamp;
+			m_ConnectedQueue[QueueSize++] = Neighbor;
+		}
+	}
 	
-	bool Changes = true;
-	while(Changes)
+	return false;
+}
+
+int CCollision::ClearanceZoneBit(int ZoneValue)
+{
+	//Tiles with an index above 128 are no zone
+	if(ZoneValue <= 0 || ZoneValue > 128)
+		return 0;
+	return 1 << (minimum(ZoneValue, 8)-1);
+}
+
+void CCollision::InitClearance(int ZoneHandle)
+{
+	m_ClearanceZoneHandle = ZoneHandle;
+	m_ClearanceStaticZones = true;
+
+	CClearanceTile Empty;
+	Empty.m_Flags = 0;
+	Empty.m_Zones = 0;
+	m_Clearance.assign(m_Width*m_Height, Empty);
+
+	for(int y = 0; y < m_Height; y++)
 	{
-		Changes = false;
-		for(int j=0; j<Height; j++)
+		for(int x = 0; x < m_Width; x++)
 		{
-			for(int i=0; i<Width; i++)
+			for(int dy = -1; dy <= 1; dy++)
 			{
-				if(pMap[j*Width+i]&0x1 && !(pMap[j*Width+i]&0x2))
+				for(int dx = -1; dx <= 1; dx++)
 				{
-					if(i>0 && (pMap[j*Width+(i-1)]&0x2))
-					{
-						pMap[j*Width+i] = 0x2;
-						Changes = true;
-					}
-					if(j>0 && (pMap[(j-1)*Width+i]&0x2))
-					{
-						pMap[j*Width+i] = 0x2;
-						Changes = true;
-					}
-					if(i<Width-1 && (pMap[j*Width+(i+1)]&0x2))
-					{
-						pMap[j*Width+i] = 0x2;
-						Changes = true;
-					}
-					if(j<Height-1 && (pMap[(j+1)*Width+i]&0x2))
-					{
-						pMap[j*Width+i] = 0x2;
-						Changes = true;
-					}
+					if(m_pTiles[clamp(y+dy, 0, m_Height-1)*m_Width+clamp(x+dx, 0, m_Width-1)]&COLFLAG_SOLID)
+						m_Clearance[y*m_Width+x].m_Flags |= CLEARANCE_NEAR_SOLID;
 				}
 			}
 		}
-		
-		if(pMap[Pos2Y*Width+Pos2X]&0x2)
+	}
+
+	if(!m_pLayers->ZoneGroup() || ZoneHandle < 0 || ZoneHandle >= m_Zones.size())
+		return;
+
+	for(int i = 0; i < m_Zones[ZoneHandle].size(); i++)
+	{
+		CMapItemLayer *pLayer = m_pLayers->GetLayer(m_pLayers->ZoneGroup()->m_StartLayer+m_Zones[ZoneHandle][i]);
+		if(pLayer->m_Type == LAYERTYPE_QUADS)
 		{
-			delete[] pMap;
-			return true;
+			m_ClearanceStaticZones = false;
+			continue;
 		}
-	}	
-	
-	delete[] pMap;
-	return false;
+		if(pLayer->m_Type != LAYERTYPE_TILES)
+			continue;
+
+		//Zone layers may be smaller or larger than the physics layer, the
+		//lookups clamp to their own size
+		CMapItemLayerTilemap *pTLayer = (CMapItemLayerTilemap *)pLayer;
+		CTile *pTiles = (CTile *) m_pLayers->Map()->GetData(pTLayer->m_Data);
+		for(int y = 0; y < m_Height; y++)
+		{
+			for(int x = 0; x < m_Width; x++)
+			{
+				for(int dy = -1; dy <= 1; dy++)
+				{
+					for(int dx = -1; dx <= 1; dx++)
+					{
+						int Nx = clamp(x+dx, 0, pTLayer->m_Width-1);
+						int Ny = clamp(y+dy, 0, pTLayer->m_Height-1);
+						m_Clearance[y*m_Width+x].m_Zones |= ClearanceZoneBit(pTiles[Ny*pTLayer->m_Width+Nx].m_Index);
+					}
+				}
+			}
+		}
+	}
+}
+
+bool CCollision::IsClear(vec2 Pos, int ZoneValue)
+{
+	bool CheckSolid = true;
+	bool CheckZone = ZoneValue != 0;
+
+	//The probes are at most 30 pixels and a rounding away from the center,
+	//so they stay in the neighbour tiles of the center tile
+	if(!m_Clearance.empty() && Pos.x >= 0.0f && Pos.y >= 0.0f && Pos.x < m_Width*32.0f && Pos.y < m_Height*32.0f)
+	{
+		int Nx = clamp(round_to_int(Pos.x)/32, 0, m_Width-1);
+		int Ny = clamp(round_to_int(Pos.y)/32, 0, m_Height-1);
+		const CClearanceTile &Tile = m_Clearance[Ny*m_Width+Nx];
+		CheckSolid = Tile.m_Flags&CLEARANCE_NEAR_SOLID;
+		if(CheckZone && m_ClearanceStaticZones)
+			CheckZone = Tile.m_Zones&ClearanceZoneBit(ZoneValue);
+	}
+
+	if(!CheckSolid && !CheckZone)
+		return true;
+	return ProbeClearance(Pos, ZoneValue, CheckSolid, CheckZone);
+}
+
+bool CCollision::ProbeClearance(vec2 Pos, int ZoneValue, bool CheckSolid, bool CheckZone)
+{
+	CheckZone = CheckZone && ZoneValue != 0;
+
+	//Check the center
+	if(CheckSolid && CheckPoint(Pos))
+		return false;
+	if(CheckZone && GetZoneValueAt(m_ClearanceZoneHandle, Pos) == ZoneValue)
+		return false;
+
+	//Check the border of the tee. Kind of extrem, but more precise
+	for(int i=0; i<16; i++)
+	{
+		float Angle = i * (2.0f * pi / 16.0f);
+		vec2 CheckPos = Pos + vec2(cos(Angle), sin(Angle)) * 30.0f;
+		if(CheckSolid && CheckPoint(CheckPos))
+			return false;
+		if(CheckZone && GetZoneValueAt(m_ClearanceZoneHandle, CheckPos) == ZoneValue)
+			return false;
+	}
+
+	return true;
 }
 
 int CCollision::GetPureMapIndex(float x, float y)
@@ -40,6 +40,8 @@ public:
 	~CCollision();
 	void Init(class CLayers *pLayers);
 	void InitTeleports();
+	//Builds the clearance field used by IsClear() for the zones of ZoneHandle
+	void InitClearance(int ZoneHandle);
 
 	bool CheckPoint(float x, float y) const { return IsTileSolid(round(x), round(y)); }
 	bool CheckPoint(vec2 Pos) const { return CheckPoint(Pos.x, Pos.y); }
@@ -51,7 +53,10 @@ public:
 	void MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity) const;
 	bool TestBox(vec2 Pos, vec2 Size) const;
 
-	void SetTime(double Time) { m_Time = Time; }
+	void SetTime(double Time);
+	double GetTime() const { return m_Time; }
+	//Envelope transforms are evaluated at most once for each time set by SetTime()
+	void GetEnvelopeTransform(double Time, int Env, vec2 &Position, float &Angle);
 	
 	//This function return an Handle to access all zone layers with the name "pName"
 	int GetZoneHandle(const char* pName);
@@ -62,6 +67,13 @@ public:
 	bool CheckPhysicsFlag(vec2 Pos, int Flag);
 	
 	bool AreConnected(vec2 Pos1, vec2 Pos2, float Radius);
+
+	//Returns false if a tee sized circle at Pos touches a solid tile or the
+	//zone ZoneValue of the clearance zones. The field answers most positions
+	//without probing the map.
+	bool IsClear(vec2 Pos, int ZoneValue);
+	//The same test with the probes only
+	bool ProbeClearance(vec2 Pos, int ZoneValue, bool CheckSolid, bool CheckZone);
 /* INFECTION MODIFICATION END *****************************************/
 
 	int GetPureMapIndex(float x, float y);
@@ -73,8 +85,68 @@ public:
 	const std::map<int, std::vector<vec2>> &GetTeleOuts() const { return m_TeleOuts; }
 
 private:
+	void InitConnectivity();
+	void InitEnvelopes();
+
 	class CTeleTile *m_pTele;
 	std::map<int, std::vector<vec2>> m_TeleOuts;
+
+	struct CComponentBounds
+	{
+		int m_MinX;
+		int m_MinY;
+		int m_MaxX;
+		int m_MaxY;
+	};
+
+	struct CEnvelopeRange
+	{
+		const struct CEnvPoint *m_pPoints;
+		int m_NumPoints;
+	};
+
+	struct CEnvelopeTransform
+	{
+		vec2 m_Position;
+		float m_Angle;
+		int m_Stamp;
+	};
+
+	std::vector<CEnvelopeRange> m_EnvelopeRanges;
+	std::vector<CEnvelopeTransform> m_EnvelopeTransforms;
+	int m_EnvelopeStamp;
+
+	// 4-connected components of the non-solid tiles, -1 for solid tiles
+	std::vector<int> m_TileComponents;
+	std::vector<CComponentBounds> m_ComponentBounds;
+
+	// scratch buffers of AreConnected(), reused between the calls
+	std::vector<int> m_ConnectedTileX;
+	std::vector<int> m_ConnectedTileY;
+	std::vector<int> m_ConnectedVisits;
+	std::vector<int> m_ConnectedQueue;
+	int m_ConnectedVisitStamp;
+
+	enum
+	{
+		CLEARANCE_NEAR_SOLID=1,
+	};
+
+	//The probes of a position stay in the neighbour tiles of its tile, so
+	//each tile keeps what its neighbourhood contains. Zone values above 7
+	//share the last bit of the mask.
+	struct CClearanceTile
+	{
+		unsigned char m_Flags;
+		unsigned char m_Zones;
+	};
+
+	static int ClearanceZoneBit(int ZoneValue);
+
+	std::vector<CClearanceTile> m_Clearance;
+	int m_ClearanceZoneHandle;
+	//False if the zones have quads, their values are probed then
+	bool m_ClearanceStaticZones;
 };
 
 #endif
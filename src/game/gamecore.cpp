@@ -58,6 +58,87 @@ float VelocityRamp(float Value, float Start, float Range, float Curvature)
 	return 1.0f / powf(Curvature, (Value - Start) / Range);
 }
 
+CWorldCore::CWorldCore()
+{
+	mem_zero(m_apCharacters, sizeof(m_apCharacters));
+	mem_zero(m_aBuckets, sizeof(m_aBuckets));
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		m_aCharacterBuckets[i] = -1;
+	m_CharactersMask = 0;
+	m_UseBroadphase = true;
+}
+
+int CWorldCore::CellCoord(float Value)
+{
+	if(Value != Value)
+		return 0;
+	return (int)floorf(clamp(Value, -1e7f, 1e7f)) >> BROADPHASE_CELL_SHIFT;
+}
+
+int CWorldCore::BucketOf(int CellX, int CellY)
+{
+	return ((unsigned)CellX * 73856093u ^ (unsigned)CellY * 19349663u) % BROADPHASE_NUM_BUCKETS;
+}
+
+void CWorldCore::SetCharacter(int ClientID, CCharacterCore *pCharCore)
+{
+	m_apCharacters[ClientID] = pCharCore;
+	if(pCharCore)
+		pCharCore->m_Id = ClientID;
+	UpdateCharacter(ClientID);
+}
+
+void CWorldCore::UpdateCharacter(int ClientID)
+{
+	const uint64 Bit = (uint64)1 << ClientID;
+	if(m_aCharacterBuckets[ClientID] >= 0)
+		m_aBuckets[m_aCharacterBuckets[ClientID]] &= ~Bit;
+
+	const CCharacterCore *pCharCore = m_apCharacters[ClientID];
+	if(!pCharCore)
+	{
+		m_aCharacterBuckets[ClientID] = -1;
+		m_CharactersMask &= ~Bit;
+		return;
+	}
+
+	const int Bucket = BucketOf(CellCoord(pCharCore->m_Pos.x), CellCoord(pCharCore->m_Pos.y));
+	m_aBuckets[Bucket] |= Bit;
+	m_aCharacterBuckets[ClientID] = Bucket;
+	m_CharactersMask |= Bit;
+}
+
+uint64 CWorldCore::QueryCharacters(vec2 From, vec2 To, float Radius) const
+{
+#ifdef CONF_DEBUG
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		const CCharacterCore *pCharCore = m_apCharacters[i];
+		const int Bucket = pCharCore ? BucketOf(CellCoord(pCharCore->m_Pos.x), CellCoord(pCharCore->m_Pos.y)) : -1;
+		dbg_assert(m_aCharacterBuckets[i] == Bucket, "character broadphase is out of sync, use SetCharacter()/SetPosition()");
+	}
+#endif
+
+	if(!m_UseBroadphase || !m_CharactersMask)
+		return m_CharactersMask;
+
+	// one extra pixel keeps the box conservative against rounding
+	const float Margin = Radius + 1.0f;
+	const int MinX = CellCoord(minimum(From.x, To.x) - Margin);
+	const int MinY = CellCoord(minimum(From.y, To.y) - Margin);
+	const int MaxX = CellCoord(maximum(From.x, To.x) + Margin);
+	const int MaxY = CellCoord(maximum(From.y, To.y) + Margin);
+
+	if((int64)(MaxX - MinX + 1) * (MaxY - MinY + 1) > BROADPHASE_MAX_QUERY_CELLS)
+		return m_CharactersMask;
+
+	uint64 Mask = 0;
+	for(int y = MinY; y <= MaxY; y++)
+		for(int x = MinX; x <= MaxX; x++)
+			Mask |= m_aBuckets[BucketOf(x, y)];
+	return Mask;
+}
+
 const float CCharacterCore::PhysicalSize = 28.0f;
 const float CCharacterCore::PassengerYOffset = -50;
 
@@ -65,6 +146,7 @@ void CCharacterCore::Init(CWorldCore *pWorld, CCollision *pCollision)
 {
 	m_pWorld = pWorld;
 	m_pCollision = pCollision;
+	m_Id = -1;
 	Reset();
 }
 
@@ -113,6 +195,7 @@ void CCharacterCore::Tick(bool UseInput, CParams* pParams)
 			m_ProbablyStucked = false;
 			m_Pos.y -= 1;
 		}
+		SetPosition(m_Pos);
 	}
 	// InfClassR taxi mode end
 
@@ -232,8 +315,12 @@ void CCharacterCore::Tick(bool UseInput, CParams* pParams)
 		if(m_pWorld)
 		{
 			float Distance = 0.0f;
-			for(int i = 0; i < MAX_CLIENTS; i++)
+			uint64 Candidates = m_pWorld->QueryCharacters(m_HookPos, NewPos, PhysicalSize + 2.0f);
+			for(int i = 0; Candidates; i++, Candidates >>= 1)
 			{
+				if(!(Candidates & 1))
+					continue;
+
 				CCharacterCore *pCharCore = m_pWorld->m_apCharacters[i];
 				if (IsRecursePassenger(pCharCore))
 					continue;
@@ -338,8 +425,16 @@ void CCharacterCore::Tick(bool UseInput, CParams* pParams)
 
 	if(m_pWorld)
 	{
-		for(int i = 0; i < MAX_CLIENTS; i++)
+		// only the hooked player can be influenced from further away
+		uint64 Candidates = m_pWorld->QueryCharacters(m_Pos, m_Pos, PhysicalSize * 1.25f);
+		if(m_HookedPlayer >= 0 && m_HookedPlayer < MAX_CLIENTS)
+			Candidates |= (uint64)1 << m_HookedPlayer;
+
+		for(int i = 0; Candidates; i++, Candidates >>= 1)
 		{
+			if(!(Candidates & 1))
+				continue;
+
 			CCharacterCore *pCharCore = m_pWorld->m_apCharacters[i];
 			if(!pCharCore)
 				continue;
@@ -433,14 +528,19 @@ void CCharacterCore::Move(CParams* pParams)
 		float Distance = distance(m_Pos, NewPos);
 		if(Distance > 0)
 		{
+			const uint64 Candidates = m_pWorld->QueryCharacters(m_Pos, NewPos, 28.0f);
 			int End = Distance + 1;
 			vec2 LastPos = m_Pos;
 			for(int i = 0; i < End; i++)
 			{
 				float a = i / Distance;
 				vec2 Pos = mix(m_Pos, NewPos, a);
-				for(int p = 0; p < MAX_CLIENTS; p++)
+				uint64 Mask = Candidates;
+				for(int p = 0; Mask; p++, Mask >>= 1)
 				{
+					if(!(Mask & 1))
+						continue;
+
 					CCharacterCore *pCharCore = m_pWorld->m_apCharacters[p];
 					if(!pCharCore || pCharCore == this)
 						continue;
@@ -452,9 +552,9 @@ void CCharacterCore::Move(CParams* pParams)
 					if(D < 28.0f && D >= 0.0f)
 					{
 						if(a > 0.0f)
-							m_Pos = LastPos;
+							SetPosition(LastPos);
 						else if(distance(NewPos, pCharCore->m_Pos) > D)
-							m_Pos = NewPos;
+							SetPosition(NewPos);
 						return;
 					}
 				}
@@ -463,7 +563,7 @@ void CCharacterCore::Move(CParams* pParams)
 		}
 	}
 
-	m_Pos = NewPos;
+	SetPosition(NewPos);
 }
 
 void CCharacterCore::Write(CNetObj_CharacterCore *pObjCore)
@@ -487,8 +587,7 @@ void CCharacterCore::Write(CNetObj_CharacterCore *pObjCore)
 
 void CCharacterCore::Read(const CNetObj_CharacterCore *pObjCore)
 {
-	m_Pos.x = pObjCore->m_X;
-	m_Pos.y = pObjCore->m_Y;
+	SetPosition(vec2(pObjCore->m_X, pObjCore->m_Y));
 	m_Vel.x = pObjCore->m_VelX/256.0f;
 	m_Vel.y = pObjCore->m_VelY/256.0f;
 	m_HookState = pObjCore->m_HookState;
@@ -510,6 +609,13 @@ void CCharacterCore::Quantize()
 	Read(&Core);
 }
 
+void CCharacterCore::SetPosition(vec2 Pos)
+{
+	m_Pos = Pos;
+	if(m_pWorld && m_Id >= 0)
+		m_pWorld->UpdateCharacter(m_Id);
+}
+
 bool CCharacterCore::IsRecursePassenger(CCharacterCore *pMaybePassenger) const
 {
 	if(m_Passenger)
@@ -571,8 +677,7 @@ void CCharacterCore::UpdateTaxiPassengers()
 			if(abs(pPassenger->m_Vel.y) <= 1.0f)
 				pPassenger->m_Vel.y = 0.0f;
 
-			pPassenger->m_Pos.x = m_Pos.x;
-			pPassenger->m_Pos.y = m_Pos.y + PassengerYOffset * PassengerNumber;
+			pPassenger->SetPosition(vec2(m_Pos.x, m_Pos.y + PassengerYOffset * PassengerNumber));
 
 			pPassenger = pPassenger->m_Passenger;
 		}
@@ -52,6 +52,27 @@ public:
 		return true;
 	}
 
+	enum
+	{
+#define MACRO_TUNING_PARAM(Name, ScriptName, Value, Description) TUNE_##Name,
+#include "tuning.h"
+#undef MACRO_TUNING_PARAM
+		NUM_TUNES,
+	};
+	static_assert(NUM_TUNES <= 64, "the params must fit a diff mask");
+
+	// bit i is set if the param i differs
+	uint64 Diff(const CTuningParams &TuningParams) const
+	{
+		uint64 Mask = 0;
+#define MACRO_TUNING_PARAM(Name, ScriptName, Value, Description) \
+	if(m_##Name.Get() != TuningParams.m_##Name.Get()) \
+		Mask |= 1ull << TUNE_##Name;
+#include "tuning.h"
+#undef MACRO_TUNING_PARAM
+		return Mask;
+	}
+
 	static const char *ms_apNames[];
 
 #define MACRO_TUNING_PARAM(Name, ScriptName, Value, Description) CTuneParam m_##Name;
@@ -194,13 +215,40 @@ enum
 class CWorldCore
 {
 public:
-	CWorldCore()
+	// Characters are bucketed by coarse cells into a hashed grid of client
+	// masks, so player-player hook and collision tests only visit the
+	// characters that can actually be reached. A hash collision only adds
+	// extra candidates, the exact tests stay the same.
+	enum
 	{
-		mem_zero(m_apCharacters, sizeof(m_apCharacters));
-	}
+		BROADPHASE_CELL_SHIFT = 6,
+		BROADPHASE_NUM_BUCKETS = 256,
+		BROADPHASE_MAX_QUERY_CELLS = 16,
+	};
+
+	CWorldCore();
 
 	CTuningParams m_Tuning;
 	class CCharacterCore *m_apCharacters[MAX_CLIENTS];
+
+	void SetCharacter(int ClientID, class CCharacterCore *pCharCore);
+	void UpdateCharacter(int ClientID);
+
+	// Returns the mask of the characters which may be closer than Radius to
+	// the segment From-To. Bits are ordered by client id.
+	uint64 QueryCharacters(vec2 From, vec2 To, float Radius) const;
+
+	// Without the broadphase every query returns all characters, which is
+	// the old full scan. core_equiv compares the two.
+	bool m_UseBroadphase;
+
+private:
+	static int CellCoord(float Value);
+	static int BucketOf(int CellX, int CellY);
+
+	uint64 m_aBuckets[BROADPHASE_NUM_BUCKETS];
+	int m_aCharacterBuckets[MAX_CLIENTS];
+	uint64 m_CharactersMask;
 };
 
 class CCharacterCore
@@ -221,8 +269,12 @@ public:
 	};
 
 private:
+	friend class CWorldCore;
+
 	CWorldCore *m_pWorld;
 	CCollision *m_pCollision;
+	int m_Id;
+
 public:
 	static const float PhysicalSize;
 	vec2 m_Pos;
@@ -258,6 +310,7 @@ public:
 	void Read(const CNetObj_CharacterCore *pObjCore);
 	void Write(CNetObj_CharacterCore *pObjCore);
 	void Quantize();
+	void SetPosition(vec2 Pos);
 	bool IsRecursePassenger(CCharacterCore *pMaybePassenger) const;
 	void SetPassenger(CCharacterCore *pPassenger);
 	void EnableJump();
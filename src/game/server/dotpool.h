@@ -0,0 +1,263 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_SERVER_DOTPOOL_H
+#define GAME_SERVER_DOTPOOL_H
+
+#include <base/math.h>
+#include <base/system.h>
+#include <base/vmath.h>
+
+#include <engine/server.h>
+#include <engine/shared/protocol.h>
+
+#include <vector>
+
+/*
+	Class: CDotPool
+		Short lived effect dots, like the laser dots of growing
+		explosions. The dots live in a slot map, a handle holds the slot
+		and its generation so it does not find the next dot of the slot.
+		A timing wheel expires the dots, which costs nothing for the dots
+		that live on. Each slot keeps its snap ID, the IDs are reserved in
+		batches as the pool grows and an expired slot cools down before it
+		is reused so clients do not mix up two dots. Slots that stay free
+		for a while give their IDs back, so a burst of dots does not keep
+		them until the map ends. The dots are bucketed by the grid cell of
+		their position, a query visits the buckets of the cells in range.
+*/
+template<class T>
+class CDotPool
+{
+	enum
+	{
+		CELL_SHIFT = 10, // cells of 1024 units
+		NUM_BUCKETS = 256,
+		WHEEL_SIZE = 256, // ticks
+		COOLDOWN = SERVER_TICK_SPEED, // ticks before the snap ID of a slot is used again
+		GROW_SIZE = 64, // slots and snap IDs that are reserved at once
+		IDLE_TIME = SERVER_TICK_SPEED*10, // ticks before a free slot gives its snap ID back
+	};
+
+	struct CSlot
+	{
+		T m_Dot;
+		int m_Expire; // tick of the end of the dot or of the cooldown, or when it was freed
+		int m_Generation;
+		int m_SnapID; // -1 if it was given back
+		bool m_Alive;
+		int m_Bucket;
+		int m_PrevInBucket;
+		int m_NextInBucket;
+		int m_NextInWheel;
+	};
+
+	IServer *m_pServer;
+	std::vector<CSlot> m_vSlots;
+	std::vector<int> m_vFree; // a stack, the slots at the bottom are free for the longest
+	int m_NumIdleFree; // slots at the bottom of the stack that gave their snap ID back
+	int m_aBuckets[NUM_BUCKETS];
+	int m_aWheel[WHEEL_SIZE];
+	int m_CurrentTick;
+	int m_NumAlive;
+
+	static int Cell(float Value) { return (int)floor(Value) >> CELL_SHIFT; }
+	static int Bucket(int CellX, int CellY) { return (((unsigned)CellX*73856093u)^((unsigned)CellY*19349663u))&(NUM_BUCKETS-1); }
+
+	void Grow()
+	{
+		int First = m_vSlots.size();
+		m_vSlots.resize(First+GROW_SIZE);
+		for(int i = First+GROW_SIZE-1; i >= First; i--)
+		{
+			m_vSlots[i].m_Generation = 0;
+			m_vSlots[i].m_SnapID = m_pServer->SnapNewID();
+			m_vSlots[i].m_Alive = false;
+			m_vSlots[i].m_Expire = m_CurrentTick;
+			m_vFree.push_back(i);
+		}
+	}
+
+	void AddToWheel(int Slot)
+	{
+		int *pHead = &m_aWheel[m_vSlots[Slot].m_Expire&(WHEEL_SIZE-1)];
+		m_vSlots[Slot].m_NextInWheel = *pHead;
+		*pHead = Slot;
+	}
+
+	void RemoveFromBucket(int Slot)
+	{
+		CSlot *pSlot = &m_vSlots[Slot];
+		if(pSlot->m_PrevInBucket >= 0)
+			m_vSlots[pSlot->m_PrevInBucket].m_NextInBucket = pSlot->m_NextInBucket;
+		else
+			m_aBuckets[pSlot->m_Bucket] = pSlot->m_NextInBucket;
+		if(pSlot->m_NextInBucket >= 0)
+			m_vSlots[pSlot->m_NextInBucket].m_PrevInBucket = pSlot->m_PrevInBucket;
+	}
+
+public:
+	/*
+		Class: CQuery
+			Walks the dots in the cells that touch a box, the caller
+			checks the exact range.
+	*/
+	class CQuery
+	{
+		const CDotPool *m_pPool;
+		int m_MinX;
+		int m_MaxX;
+		int m_MaxY;
+		int m_X;
+		int m_Y;
+		int m_Slot;
+		bool m_aVisited[NUM_BUCKETS]; // cells can share a bucket
+
+	public:
+		CQuery(const CDotPool *pPool, vec2 Pos, vec2 Range)
+		{
+			m_pPool = pPool;
+			m_MinX = Cell(Pos.x-Range.x);
+			m_MaxX = Cell(Pos.x+Range.x);
+			m_MaxY = Cell(Pos.y+Range.y);
+			m_X = m_MinX;
+			m_Y = Cell(Pos.y-Range.y);
+			m_Slot = -1;
+			mem_zero(m_aVisited, sizeof(m_aVisited));
+		}
+
+		// returns the next slot, -1 at the end
+		int Next()
+		{
+			if(m_Slot >= 0)
+				m_Slot = m_pPool->m_vSlots[m_Slot].m_NextInBucket;
+			while(m_Slot < 0 && m_Y <= m_MaxY)
+			{
+				int Bucket = CDotPool::Bucket(m_X, m_Y);
+				if(++m_X > m_MaxX)
+				{
+					m_X = m_MinX;
+					m_Y++;
+				}
+				if(!m_aVisited[Bucket])
+				{
+					m_aVisited[Bucket] = true;
+					m_Slot = m_pPool->m_aBuckets[Bucket];
+				}
+			}
+			return m_Slot;
+		}
+	};
+
+	CDotPool()
+	{
+		m_pServer = 0;
+		m_CurrentTick = -1;
+		m_NumAlive = 0;
+		m_NumIdleFree = 0;
+		for(int i = 0; i < NUM_BUCKETS; i++)
+			m_aBuckets[i] = -1;
+		for(int i = 0; i < WHEEL_SIZE; i++)
+			m_aWheel[i] = -1;
+	}
+
+	~CDotPool()
+	{
+		for(unsigned i = 0; i < m_vSlots.size(); i++)
+		{
+			if(m_vSlots[i].m_SnapID >= 0)
+				m_pServer->SnapFreeID(m_vSlots[i].m_SnapID);
+		}
+	}
+
+	void SetServer(IServer *pServer) { m_pServer = pServer; }
+
+	// the dot expires in the tick Expire before it is snapped, Pos places it in the grid
+	int Create(const T &Dot, vec2 Pos, int Expire)
+	{
+		if(m_vFree.empty())
+			Grow();
+		int Slot = m_vFree.back();
+		m_vFree.pop_back();
+		m_NumIdleFree = minimum(m_NumIdleFree, (int)m_vFree.size());
+
+		CSlot *pSlot = &m_vSlots[Slot];
+		if(pSlot->m_SnapID < 0)
+			pSlot->m_SnapID = m_pServer->SnapNewID();
+		pSlot->m_Dot = Dot;
+		pSlot->m_Expire = maximum(Expire, m_CurrentTick+1);
+		pSlot->m_Alive = true;
+		pSlot->m_Bucket = Bucket(Cell(Pos.x), Cell(Pos.y));
+		pSlot->m_PrevInBucket = -1;
+		pSlot->m_NextInBucket = m_aBuckets[pSlot->m_Bucket];
+		if(pSlot->m_NextInBucket >= 0)
+			m_vSlots[pSlot->m_NextInBucket].m_PrevInBucket = Slot;
+		m_aBuckets[pSlot->m_Bucket] = Slot;
+		AddToWheel(Slot);
+		m_NumAlive++;
+		return Slot|((pSlot->m_Generation&0x7fff)<<16);
+	}
+
+	// returns 0 if the dot of the handle expired
+	T *Get(int Handle)
+	{
+		int Slot = Handle&0xffff;
+		if(Handle < 0 || Slot >= (int)m_vSlots.size() || !m_vSlots[Slot].m_Alive ||
+			(m_vSlots[Slot].m_Generation&0x7fff) != Handle>>16)
+			return 0;
+		return &m_vSlots[Slot].m_Dot;
+	}
+
+	// expires the dots and ends the cooldowns of the tick
+	void Tick(int Tick)
+	{
+		m_CurrentTick = Tick;
+		int *pLink = &m_aWheel[Tick&(WHEEL_SIZE-1)];
+		while(*pLink >= 0)
+		{
+			int Slot = *pLink;
+			CSlot *pSlot = &m_vSlots[Slot];
+
+			// expires in a later turn of the wheel
+			if(pSlot->m_Expire > Tick)
+			{
+				pLink = &pSlot->m_NextInWheel;
+				continue;
+			}
+
+			*pLink = pSlot->m_NextInWheel;
+			if(pSlot->m_Alive)
+			{
+				RemoveFromBucket(Slot);
+				pSlot->m_Alive = false;
+				pSlot->m_Generation++;
+				pSlot->m_Expire = Tick+COOLDOWN;
+				AddToWheel(Slot);
+				m_NumAlive--;
+			}
+			else
+			{
+				pSlot->m_Expire = Tick;
+				m_vFree.push_back(Slot);
+			}
+		}
+
+		// give the snap IDs of the slots that stayed free back
+		if(Tick%SERVER_TICK_SPEED == 0)
+		{
+			while(m_NumIdleFree < (int)m_vFree.size() && m_vSlots[m_vFree[m_NumIdleFree]].m_Expire <= Tick-IDLE_TIME)
+			{
+				CSlot *pSlot = &m_vSlots[m_vFree[m_NumIdleFree++]];
+				m_pServer->SnapFreeID(pSlot->m_SnapID);
+				pSlot->m_SnapID = -1;
+			}
+		}
+	}
+
+	int NumAlive() const { return m_NumAlive; }
+	int NumSlots() const { return m_vSlots.size(); }
+	bool IsAlive(int Slot) const { return m_vSlots[Slot].m_Alive; }
+	const T *GetSlot(int Slot) const { return &m_vSlots[Slot].m_Dot; }
+	int SnapID(int Slot) const { return m_vSlots[Slot].m_SnapID; }
+};
+
+#endif
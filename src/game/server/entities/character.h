@@ -51,6 +51,7 @@ public:
 	virtual void TickDefered();
 	virtual void TickPaused();
 	virtual void Snap(int SnappingClient);
+	virtual int SnapPriority() const { return CGameWorld::SNAP_PRIORITY_CRITICAL; }
 
 	bool IsGrounded();
 
@@ -19,6 +19,7 @@ public:
 
 	void Tick() override;
 	void TickPaused() override;
+	int GetInterestPositions(vec2 *pPositions) override;
 	void Snap(int SnappingClient) override;
 
 private:
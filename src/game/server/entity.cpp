@@ -23,6 +23,7 @@ CEntity::CEntity(CGameWorld *pGameWorld, int ObjType, const vec2 &Pos, int Proxi
 	m_ProximityRadius = ProximityRadius;
 
 	m_MarkedForDestroy = false;
+	m_InterestIndex = -1;
 	m_Pos = Pos;
 }
 
@@ -32,27 +33,30 @@ CEntity::~CEntity()
 	Server()->SnapFreeID(m_ID);
 }
 
-int CEntity::NetworkClipped(int SnappingClient) const
-{
-	return NetworkClipped(SnappingClient, m_Pos);
-}
-
-int CEntity::NetworkClipped(int SnappingClient, vec2 CheckPos) const
+int CEntity::NetworkClipped(int SnappingClient)
 {
 	if(SnappingClient == -1)
 		return 0;
 
-	const CPlayer *pClient = m_pGameWorld->GameServer()->m_apPlayers[SnappingClient];
-	float dx = pClient->m_ViewPos.x-CheckPos.x;
-	float dy = pClient->m_ViewPos.y-CheckPos.y;
-
-	if(absolute(dx) > 1000.0f || absolute(dy) > 800.0f)
-		return 1;
+	int Interest = m_pGameWorld->SnapInterest(this, SnappingClient);
+	if(Interest >= 0)
+		return !Interest;
 
-	if(distance(pClient->m_ViewPos, CheckPos) > 1100.0f)
-		return 1;
+	vec2 aPositions[MAX_INTEREST_POSITIONS];
+	int NumPositions = GetInterestPositions(aPositions);
+	if(NumPositions == 0)
+		return 0;
+	for(int i = 0; i < NumPositions; i++)
+	{
+		if(m_pGameWorld->InView(SnappingClient, aPositions[i]))
+			return 0;
+	}
+	return 1;
+}
 
-	return 0;
+int CEntity::NetworkClipped(int SnappingClient, vec2 CheckPos) const
+{
+	return !m_pGameWorld->InView(SnappingClient, CheckPos);
 }
 
 bool CEntity::GameLayerClipped(vec2 CheckPos)
@@ -85,7 +89,7 @@ void CAnimatedEntity::Tick()
 	float Angle = 0.0f;
 	if(m_PosEnv >= 0)
 	{
-		GetAnimationTransform(GameServer()->m_pController->GetTime(), m_PosEnv, GameServer()->Layers(), Position, Angle);
+		GameServer()->Collision()->GetEnvelopeTransform(GameServer()->m_pController->GetTime(), m_PosEnv, Position, Angle);
 	}
 	
 	float x = (m_RelPosition.x * cosf(Angle) - m_RelPosition.y * sinf(Angle));
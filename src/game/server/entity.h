@@ -26,9 +26,15 @@ protected:
 	bool m_MarkedForDestroy;
 	int m_ID;
 	int m_ObjType;
+	int m_InterestIndex;
 public:
+	enum
+	{
+		MAX_INTEREST_POSITIONS = 2,
+	};
 
 	int GetID() const { return m_ID; }
+	int GetInterestIndex() const { return m_InterestIndex; }
 
 	/* Constructor */
 	CEntity(CGameWorld *pGameWorld, int Objtype, const vec2 &Pos = vec2(0,0), int ProximityRadius = 0);
@@ -99,10 +105,45 @@ public:
 	*/
 	virtual void Snap(int SnappingClient) {}
 
+	/*
+		Function: SnapPriority
+			Returns the class of the entity in the snapshot budget, one
+			of CGameWorld::SNAP_PRIORITY_*. Higher classes are snapped
+			first, decorative entities are thinned and left out first.
+	*/
+	virtual int SnapPriority() const { return CGameWorld::SNAP_PRIORITY_GAMEPLAY; }
+
+	/*
+		Function: SnapLod
+			Called instead of Snap when the snapshot budget runs low.
+			Entities with many items can snap fewer of them.
+
+		Arguments:
+			SnappingClient - ID of the client which snapshot is
+				being generated.
+			Lod - Level of detail, every level halves the detail.
+	*/
+	virtual void SnapLod(int SnappingClient, int Lod) { Snap(SnappingClient); }
+
+	/*
+		Function: GetInterestPositions
+			Fills the positions a client must see one of to get the
+			entity in its snapshot, m_Pos by default. Entities that are
+			snapped for every client return 0.
+
+		Arguments:
+			pPositions - Array of MAX_INTEREST_POSITIONS positions.
+
+		Returns:
+			Number of positions.
+	*/
+	virtual int GetInterestPositions(vec2 *pPositions) { pPositions[0] = m_Pos; return 1; }
+
 	/*
 		Function: NetworkClipped(int SnappingClient)
 			Performs a series of test to see if a client can see the
-			entity.
+			entity. Looks the entity up in the interest set of the
+			snapshot, tests the interest positions without one.
 
 		Arguments:
 			SnappingClient - ID of the client which snapshot is
@@ -113,7 +154,7 @@ public:
 		Returns:
 			Non-zero if the entity doesn't have to be in the snapshot.
 	*/
-	int NetworkClipped(int SnappingClient) const;
+	int NetworkClipped(int SnappingClient);
 	int NetworkClipped(int SnappingClient, vec2 CheckPos) const;
 
 	bool GameLayerClipped(vec2 CheckPos);
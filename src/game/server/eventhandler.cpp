@@ -11,50 +11,191 @@
 CEventHandler::CEventHandler()
 {
 	m_pGameServer = 0;
+	m_vEvents.resize(256);
+	m_FirstSerial = 0;
+	m_NextSerial = 0;
+	m_PeakEvents = 0;
+	m_NumOverflows = 0;
+	m_NumCulled = 0;
+	m_NumDropped = 0;
 	Clear();
 }
 
+CEventHandler::~CEventHandler()
+{
+	Clear();
+	for(unsigned i = 0; i < m_vpFreeBlocks.size(); i++)
+		delete m_vpFreeBlocks[i];
+}
+
 void CEventHandler::SetGameServer(CGameContext *pGameServer)
 {
 	m_pGameServer = pGameServer;
 }
 
-void *CEventHandler::Create(int Type, int Size, int64 Mask)
+char *CEventHandler::Allocate(int Size, int Tick)
 {
-	if(m_NumEvents == MAX_EVENTS)
+	Size = (Size+7)&~7;
+	if(Size > BLOCK_SIZE)
 		return 0;
-	if(m_CurrentOffset+Size >= MAX_DATASIZE)
+
+	if(m_vpBlocks.empty() || m_vpBlocks.back()->m_Used+Size > BLOCK_SIZE)
+	{
+		CBlock *pBlock;
+		if(m_vpFreeBlocks.empty())
+			pBlock = new CBlock;
+		else
+		{
+			pBlock = m_vpFreeBlocks.back();
+			m_vpFreeBlocks.pop_back();
+		}
+		pBlock->m_Used = 0;
+		m_vpBlocks.push_back(pBlock);
+	}
+
+	CBlock *pBlock = m_vpBlocks.back();
+	char *pData = pBlock->m_aData+pBlock->m_Used;
+	pBlock->m_Used += Size;
+	pBlock->m_LastTick = Tick;
+	return pData;
+}
+
+void CEventHandler::Grow()
+{
+	std::vector<CEvent> vEvents(m_vEvents.size()*2);
+	for(int64 Serial = m_FirstSerial; Serial < m_NextSerial; Serial++)
+		vEvents[Serial&(vEvents.size()-1)] = *GetEvent(Serial);
+	m_vEvents.swap(vEvents);
+}
+
+void *CEventHandler::Create(int Type, int Size, vec2 Pos, int64 Mask)
+{
+	// events after the snapshots of a tick go with the next tick
+	int Tick = GameServer()->Server()->Tick();
+	if(Tick <= m_SnappedTick)
+		Tick = m_SnappedTick+1;
+
+	if(NumEvents() == MAX_EVENTS)
+	{
+		m_NumOverflows++;
+		return 0;
+	}
+	char *pData = Allocate(Size, Tick);
+	if(!pData)
+	{
+		m_NumOverflows++;
 		return 0;
+	}
+	if(NumEvents() == (int)m_vEvents.size())
+		Grow();
+
+	int64 Serial = m_NextSerial++;
+	int Bucket = CEventHandler::Bucket(Cell(Pos.x), Cell(Pos.y));
+	CEvent *pEvent = GetEvent(Serial);
+	pEvent->m_Type = Type;
+	pEvent->m_Size = Size;
+	pEvent->m_Tick = Tick;
+	pEvent->m_Pos = Pos;
+	pEvent->m_ClientMask = Mask;
+	pEvent->m_NextInBucket = m_aBuckets[Bucket];
+	pEvent->m_pData = pData;
+	m_aBuckets[Bucket] = Serial;
 
-	void *p = &m_aData[m_CurrentOffset];
-	m_aOffsets[m_NumEvents] = m_CurrentOffset;
-	m_aTypes[m_NumEvents] = Type;
-	m_aSizes[m_NumEvents] = Size;
-	m_aClientMasks[m_NumEvents] = Mask;
-	m_CurrentOffset += Size;
-	m_NumEvents++;
-	return p;
+	m_PeakEvents = maximum(m_PeakEvents, NumEvents());
+	return pData;
 }
 
 void CEventHandler::Clear()
 {
-	m_NumEvents = 0;
-	m_CurrentOffset = 0;
+	m_FirstSerial = m_NextSerial;
+	for(int i = 0; i < NUM_BUCKETS; i++)
+		m_aBuckets[i] = -1;
+	m_vpFreeBlocks.insert(m_vpFreeBlocks.end(), m_vpBlocks.begin(), m_vpBlocks.end());
+	m_vpBlocks.clear();
+	m_SnappedTick = -1;
+}
+
+void CEventHandler::Expire()
+{
+	m_SnappedTick = GameServer()->Server()->Tick();
+	int ExpireTick = m_SnappedTick-MAX_AGE;
+
+	// the events and the blocks are in the order of their ticks
+	while(m_FirstSerial < m_NextSerial && GetEvent(m_FirstSerial)->m_Tick <= ExpireTick)
+		m_FirstSerial++;
+
+	unsigned NumExpired = 0;
+	while(NumExpired < m_vpBlocks.size() && m_vpBlocks[NumExpired]->m_LastTick <= ExpireTick)
+		m_vpFreeBlocks.push_back(m_vpBlocks[NumExpired++]);
+	m_vpBlocks.erase(m_vpBlocks.begin(), m_vpBlocks.begin()+NumExpired);
+}
+
+int64 CEventHandler::FirstSerialAfter(int Tick)
+{
+	int64 Low = m_FirstSerial;
+	int64 High = m_NextSerial;
+	while(Low < High)
+	{
+		int64 Mid = Low+(High-Low)/2;
+		if(GetEvent(Mid)->m_Tick <= Tick)
+			Low = Mid+1;
+		else
+			High = Mid;
+	}
+	return Low;
+}
+
+void CEventHandler::SnapEvent(int64 Serial)
+{
+	CEvent *pEvent = GetEvent(Serial);
+	void *pData = GameServer()->Server()->SnapNewItem(pEvent->m_Type, Serial&(MAX_EVENTS-1), pEvent->m_Size);
+	if(pData)
+		mem_copy(pData, pEvent->m_pData, pEvent->m_Size);
+	else
+		m_NumDropped++;
 }
 
 void CEventHandler::Snap(int SnappingClient)
 {
-	for(int i = 0; i < m_NumEvents; i++)
+	int64 First = FirstSerialAfter(GameServer()->Server()->LastSnapTick(SnappingClient));
+
+	// the demo gets all events
+	if(SnappingClient == -1)
 	{
-		if(SnappingClient == -1 || CmaskIsSet(m_aClientMasks[i], SnappingClient))
+		for(int64 Serial = First; Serial < m_NextSerial; Serial++)
+			SnapEvent(Serial);
+		return;
+	}
+
+	vec2 ViewPos = GameServer()->m_World.SnapViewPos();
+	float ViewRange = VIEW_RANGE*GameServer()->m_World.SnapViewScale();
+	int MinX = Cell(ViewPos.x-ViewRange);
+	int MaxX = Cell(ViewPos.x+ViewRange);
+	int MinY = Cell(ViewPos.y-ViewRange);
+	int MaxY = Cell(ViewPos.y+ViewRange);
+
+	// cells can share a bucket, visit each bucket once
+	bool aVisited[NUM_BUCKETS] = {false};
+	int NumInRange = 0;
+	for(int y = MinY; y <= MaxY; y++)
+	{
+		for(int x = MinX; x <= MaxX; x++)
 		{
-			CNetEvent_Common *ev = (CNetEvent_Common *)&m_aData[m_aOffsets[i]];
-			if(SnappingClient == -1 || distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, vec2(ev->m_X, ev->m_Y)) < 1500.0f)
+			int Bucket = CEventHandler::Bucket(x, y);
+			if(aVisited[Bucket])
+				continue;
+			aVisited[Bucket] = true;
+
+			for(int64 Serial = m_aBuckets[Bucket]; Serial >= First; Serial = GetEvent(Serial)->m_NextInBucket)
 			{
-				void *d = GameServer()->Server()->SnapNewItem(m_aTypes[i], i, m_aSizes[i]);
-				if(d)
-					mem_copy(d, &m_aData[m_aOffsets[i]], m_aSizes[i]);
+				CEvent *pEvent = GetEvent(Serial);
+				if(distance(ViewPos, pEvent->m_Pos) >= ViewRange)
+					continue;
+				NumInRange++;
+				if(CmaskIsSet(pEvent->m_ClientMask, SnappingClient))
+					SnapEvent(Serial);
 			}
 		}
 	}
+	m_NumCulled += (m_NextSerial-First)-NumInRange;
 }
@@ -4,30 +4,95 @@
 #define GAME_SERVER_EVENTHANDLER_H
 
 #include <base/system.h>
+#include <base/vmath.h>
 
+#include <vector>
+
+/*
+	Class: CEventHandler
+		The events of the last ticks. Clients get snapshots at their own
+		rates, so each snapshot carries the events since the previous
+		snapshot of its client. Events are kept until the slowest rate
+		must have sent them.
+
+		The event data comes from an arena of blocks which are reused once
+		their events expired. Events are numbered by a serial and bucketed
+		by a coarse grid cell when they are created, newest first, so the
+		snapshot of a client only visits the cells in its view range and
+		stops at the events it got already.
+*/
 class CEventHandler
 {
-	static const int MAX_EVENTS = 128;
-	static const int MAX_DATASIZE = 128*64;
+	static const int MAX_AGE = 5; // ticks between two snapshots at 10 Hz
+	static const int MAX_EVENTS = 8192; // the IDs of the live events must fit a snapshot
+	static const int BLOCK_SIZE = 16*1024;
+	static const int CELL_SHIFT = 10; // cells of 1024 units
+	static const int NUM_BUCKETS = 256;
+	static const int VIEW_RANGE = 1500;
+
+	struct CEvent
+	{
+		int m_Type;
+		int m_Size;
+		int m_Tick;
+		vec2 m_Pos;
+		int64 m_ClientMask;
+		int64 m_NextInBucket; // serial of the next older event of the bucket
+		char *m_pData;
+	};
+
+	struct CBlock
+	{
+		int m_Used;
+		int m_LastTick;
+		char m_aData[BLOCK_SIZE];
+	};
 
-	int m_aTypes[MAX_EVENTS]; // TODO: remove some of these arrays
-	int m_aOffsets[MAX_EVENTS];
-	int m_aSizes[MAX_EVENTS];
-	int64 m_aClientMasks[MAX_EVENTS];
-	char m_aData[MAX_DATASIZE];
+	// ring buffer indexed by the serials, its size is a power of two
+	std::vector<CEvent> m_vEvents;
+	int64 m_FirstSerial;
+	int64 m_NextSerial;
+	int64 m_aBuckets[NUM_BUCKETS]; // serial of the newest event of each bucket
+
+	std::vector<CBlock *> m_vpBlocks; // oldest first
+	std::vector<CBlock *> m_vpFreeBlocks;
 
 	class CGameContext *m_pGameServer;
 
-	int m_CurrentOffset;
-	int m_NumEvents;
+	int m_SnappedTick;
+	int m_PeakEvents;
+	int64 m_NumOverflows;
+	int64 m_NumCulled;
+	int64 m_NumDropped;
+
+	CEvent *GetEvent(int64 Serial) { return &m_vEvents[Serial&(m_vEvents.size()-1)]; }
+	static int Cell(float Value) { return (int)floor(Value) >> CELL_SHIFT; }
+	static int Bucket(int CellX, int CellY) { return (((unsigned)CellX*73856093u)^((unsigned)CellY*19349663u))&(NUM_BUCKETS-1); }
+	char *Allocate(int Size, int Tick);
+	void Grow();
+	int64 FirstSerialAfter(int Tick);
+	void SnapEvent(int64 Serial);
+
 public:
 	CGameContext *GameServer() const { return m_pGameServer; }
 	void SetGameServer(CGameContext *pGameServer);
 
 	CEventHandler();
-	void *Create(int Type, int Size, int64 Mask = -1LL);
+	~CEventHandler();
+	void *Create(int Type, int Size, vec2 Pos, int64 Mask = -1LL);
 	void Clear();
+	// drops the events that every client got, call after the snapshots
+	void Expire();
 	void Snap(int SnappingClient);
+
+	int NumEvents() const { return m_NextSerial-m_FirstSerial; }
+	int PeakEvents() const { return m_PeakEvents; }
+	// events that did not fit the store
+	int64 NumOverflows() const { return m_NumOverflows; }
+	// events out of the view range of a snapshot
+	int64 NumCulled() const { return m_NumCulled; }
+	// events that did not fit a snapshot
+	int64 NumDropped() const { return m_NumDropped; }
 };
 
 #endif
@@ -20,6 +20,8 @@
 
 #include <game/server/player.h>
 
+#include <engine/engine.h>
+
 #ifdef CONF_GEOLOCATION
 #include <infclassr/geolocation.h>
 #endif
@@ -68,6 +70,10 @@ void CGameContext::Construct(int Resetting)
 	m_pVoteOptionLast = 0;
 	m_NumVoteOptions = 0;
 	m_HeroGiftCooldown = 0;
+	m_NumTuningMsgs = 0;
+	m_NumTuningSent = 0;
+	m_NumTuningPacked = 0;
+	m_TuningBytes = 0;
 	
 	m_ChatResponseTargetID = -1;
 
@@ -92,11 +98,6 @@ CGameContext::CGameContext()
 
 CGameContext::~CGameContext()
 {
-	for(int i = 0; i < m_LaserDots.size(); i++)
-		Server()->SnapFreeID(m_LaserDots[i].m_SnapID);
-	for(int i = 0; i < m_HammerDots.size(); i++)
-		Server()->SnapFreeID(m_HammerDots[i].m_SnapID);
-	
 	for(int i = 0; i < MAX_CLIENTS; i++)
 		delete m_apPlayers[i];
 	if(!m_Resetting)
@@ -105,7 +106,7 @@ CGameContext::~CGameContext()
 #ifdef CONF_GEOLOCATION
 	if(!m_Resetting)
 	{
-		Geolocation::Shutdown();
+		CGeolocation::Shutdown();
 	}
 #endif
 }
@@ -225,7 +226,7 @@ void CGameContext::CreateDamageInd(vec2 Pos, float Angle, int Amount, int64_t Ma
 	for(int i = 0; i < Amount; i++)
 	{
 		float f = mix(s, e, float(i + 1) / float(Amount + 2));
-		CNetEvent_DamageInd *pEvent = (CNetEvent_DamageInd *)m_Events.Create(NETEVENTTYPE_DAMAGEIND, sizeof(CNetEvent_DamageInd), Mask);
+		CNetEvent_DamageInd *pEvent = (CNetEvent_DamageInd *)m_Events.Create(NETEVENTTYPE_DAMAGEIND, sizeof(CNetEvent_DamageInd), Pos, Mask);
 		if(pEvent)
 		{
 			pEvent->m_X = (int)Pos.x;
@@ -238,7 +239,7 @@ void CGameContext::CreateDamageInd(vec2 Pos, float Angle, int Amount, int64_t Ma
 void CGameContext::CreateHammerHit(vec2 Pos, int64_t Mask)
 {
 	// create the event
-	CNetEvent_HammerHit *pEvent = (CNetEvent_HammerHit *)m_Events.Create(NETEVENTTYPE_HAMMERHIT, sizeof(CNetEvent_HammerHit), Mask);
+	CNetEvent_HammerHit *pEvent = (CNetEvent_HammerHit *)m_Events.Create(NETEVENTTYPE_HAMMERHIT, sizeof(CNetEvent_HammerHit), Pos, Mask);
 	if(pEvent)
 	{
 		pEvent->m_X = (int)Pos.x;
@@ -251,36 +252,31 @@ void CGameContext::CreateLaserDotEvent(vec2 Pos0, vec2 Pos1, int LifeSpan)
 	CGameContext::LaserDotState State;
 	State.m_Pos0 = Pos0;
 	State.m_Pos1 = Pos1;
-	State.m_LifeSpan = LifeSpan;
-	State.m_SnapID = Server()->SnapNewID();
 	
-	m_LaserDots.add(State);
+	m_LaserDots.Create(State, (Pos0 + Pos1)*0.5f, Server()->Tick() + LifeSpan - 1);
 }
 
 void CGameContext::CreateHammerDotEvent(vec2 Pos, int LifeSpan)
 {
 	CGameContext::HammerDotState State;
 	State.m_Pos = Pos;
-	State.m_LifeSpan = LifeSpan;
-	State.m_SnapID = Server()->SnapNewID();
 	
-	m_HammerDots.add(State);
+	m_HammerDots.Create(State, Pos, Server()->Tick() + LifeSpan - 1);
 }
 
 void CGameContext::CreateLoveEvent(vec2 Pos)
 {
 	CGameContext::LoveDotState State;
 	State.m_Pos = Pos;
-	State.m_LifeSpan = Server()->TickSpeed();
-	State.m_SnapID = Server()->SnapNewID();
+	State.m_StartTick = Server()->Tick();
 	
-	m_LoveDots.add(State);
+	m_LoveDots.Create(State, Pos, Server()->Tick() + Server()->TickSpeed() - 1);
 }
 
 void CGameContext::CreateExplosion(vec2 Pos, int Owner, int Weapon, int64_t Mask)
 {
 	// create the event
-	CNetEvent_Explosion *pEvent = (CNetEvent_Explosion *)m_Events.Create(NETEVENTTYPE_EXPLOSION, sizeof(CNetEvent_Explosion), Mask);
+	CNetEvent_Explosion *pEvent = (CNetEvent_Explosion *)m_Events.Create(NETEVENTTYPE_EXPLOSION, sizeof(CNetEvent_Explosion), Pos, Mask);
 	if(pEvent)
 	{
 		pEvent->m_X = (int)Pos.x;
@@ -303,7 +299,7 @@ void create_smoke(vec2 Pos)
 void CGameContext::CreatePlayerSpawn(vec2 Pos, int64_t Mask)
 {
 	// create the event
-	CNetEvent_Spawn *ev = (CNetEvent_Spawn *)m_Events.Create(NETEVENTTYPE_SPAWN, sizeof(CNetEvent_Spawn), Mask);
+	CNetEvent_Spawn *ev = (CNetEvent_Spawn *)m_Events.Create(NETEVENTTYPE_SPAWN, sizeof(CNetEvent_Spawn), Pos, Mask);
 	if(ev)
 	{
 		ev->m_X = (int)Pos.x;
@@ -314,7 +310,7 @@ void CGameContext::CreatePlayerSpawn(vec2 Pos, int64_t Mask)
 void CGameContext::CreateDeath(vec2 Pos, int ClientID, int64_t Mask)
 {
 	// create the event
-	CNetEvent_Death *pEvent = (CNetEvent_Death *)m_Events.Create(NETEVENTTYPE_DEATH, sizeof(CNetEvent_Death), Mask);
+	CNetEvent_Death *pEvent = (CNetEvent_Death *)m_Events.Create(NETEVENTTYPE_DEATH, sizeof(CNetEvent_Death), Pos, Mask);
 	if(pEvent)
 	{
 		pEvent->m_X = (int)Pos.x;
@@ -329,7 +325,7 @@ void CGameContext::CreateSound(vec2 Pos, int Sound, int64_t Mask)
 		return;
 
 	// create a sound
-	CNetEvent_SoundWorld *pEvent = (CNetEvent_SoundWorld *)m_Events.Create(NETEVENTTYPE_SOUNDWORLD, sizeof(CNetEvent_SoundWorld), Mask);
+	CNetEvent_SoundWorld *pEvent = (CNetEvent_SoundWorld *)m_Events.Create(NETEVENTTYPE_SOUNDWORLD, sizeof(CNetEvent_SoundWorld), Pos, Mask);
 	if(pEvent)
 	{
 		pEvent->m_X = (int)Pos.x;
@@ -959,41 +955,89 @@ void CGameContext::SendTuningParams(int ClientID)
 	SendTuningParams(ClientID, m_Tuning);
 }
 
-void CGameContext::SendTuningParams(int ClientID, const CTuningParams &params)
+// the params of each client version tier, older clients know less of them
+static constexpr int s_aTuningTierSizes[] = {
+	CTuningParams::TUNE_JetpackStrength, // before VERSION_DDNET_EXTRATUNES
+	CTuningParams::TUNE_HookDuration, // before VERSION_DDNET_HOOKDURATION_TUNE
+	CTuningParams::TUNE_HammerFireDelay, // before VERSION_DDNET_FIREDELAY_TUNE
+	CTuningParams::NUM_TUNES,
+};
+
+static constexpr uint64 TuningTierMask(int Size)
 {
-	CMsgPacker Msg(NETMSGTYPE_SV_TUNEPARAMS);
-	const int *pParams = (const int *)&params;
+	// player collision is sent inverted to avoid client collision prediction
+	// (keep behavior introduced by commit 11c408e5dd8f3672b658ad0581f016be85a46011)
+	// and the jetpack is left out, both are always sent as 0
+	return ((1ull << Size) - 1) & ~((1ull << CTuningParams::TUNE_PlayerCollision) | (1ull << CTuningParams::TUNE_JetpackStrength));
+}
 
-	unsigned int Last = sizeof(m_Tuning) / sizeof(int);
-	if(m_apPlayers[ClientID])
-	{
-		int ClientVersion = m_apPlayers[ClientID]->GetClientVersion();
-		if(ClientVersion < VERSION_DDNET_EXTRATUNES)
-			Last = 33;
-		else if(ClientVersion < VERSION_DDNET_HOOKDURATION_TUNE)
-			Last = 37;
-		else if(ClientVersion < VERSION_DDNET_FIREDELAY_TUNE)
-			Last = 38;
-	}
+static constexpr uint64 s_aTuningTierMasks[] = {
+	TuningTierMask(s_aTuningTierSizes[0]),
+	TuningTierMask(s_aTuningTierSizes[1]),
+	TuningTierMask(s_aTuningTierSizes[2]),
+	TuningTierMask(s_aTuningTierSizes[3]),
+};
 
-	for(unsigned i = 0; i < Last; i++)
+int CGameContext::TuningTier(int ClientID) const
+{
+	if(!m_apPlayers[ClientID])
+		return NUM_TUNING_TIERS-1;
+
+	int ClientVersion = m_apPlayers[ClientID]->GetClientVersion();
+	if(ClientVersion < VERSION_DDNET_EXTRATUNES)
+		return 0;
+	if(ClientVersion < VERSION_DDNET_HOOKDURATION_TUNE)
+		return 1;
+	if(ClientVersion < VERSION_DDNET_FIREDELAY_TUNE)
+		return 2;
+	return 3;
+}
+
+uint64 CGameContext::TuningMask(int ClientID) const
+{
+	return s_aTuningTierMasks[TuningTier(ClientID)];
+}
+
+const CGameContext::CTuningMsg *CGameContext::GetTuningMsg(const CTuningParams &Params, int Tier)
+{
+	uint64 Mask = s_aTuningTierMasks[Tier];
+	CTuningMsg *pMsg = 0;
+	for(int i = 0; i < m_NumTuningMsgs; i++)
 	{
-		if(i == 31) // PlayerCollision
+		if(m_aTuningMsgs[i].m_Tier == Tier && !(m_aTuningMsgs[i].m_Params.Diff(Params) & Mask))
 		{
-			// inverted to avoid client collision prediction
-			// (keep behavior introduced by commit 11c408e5dd8f3672b658ad0581f016be85a46011)
-			Msg.AddInt(0);
-		}
-		else if(i == 33) // JetpackStrength
-		{
-			Msg.AddInt(0);
-		}
-		else
-		{
-			Msg.AddInt(pParams[i]);
+			m_aTuningMsgs[i].m_LastUse = Server()->Tick();
+			return &m_aTuningMsgs[i];
 		}
+		if(!pMsg || m_aTuningMsgs[i].m_LastUse < pMsg->m_LastUse)
+			pMsg = &m_aTuningMsgs[i];
 	}
+	if(m_NumTuningMsgs < NUM_TUNING_MSGS)
+		pMsg = &m_aTuningMsgs[m_NumTuningMsgs++];
+
+	CPacker Packer;
+	Packer.Reset();
+	const int *pParams = (const int *)&Params;
+	for(int i = 0; i < s_aTuningTierSizes[Tier]; i++)
+		Packer.AddInt((Mask >> i) & 1 ? pParams[i] : 0);
+
+	pMsg->m_Params = Params;
+	pMsg->m_Tier = Tier;
+	pMsg->m_LastUse = Server()->Tick();
+	pMsg->m_Size = Packer.Size();
+	mem_copy(pMsg->m_aData, Packer.Data(), Packer.Size());
+	m_NumTuningPacked++;
+	return pMsg;
+}
+
+void CGameContext::SendTuningParams(int ClientID, const CTuningParams &params)
+{
+	const CTuningMsg *pTuningMsg = GetTuningMsg(params, TuningTier(ClientID));
+	CMsgPacker Msg(NETMSGTYPE_SV_TUNEPARAMS);
+	Msg.AddRaw(pTuningMsg->m_aData, pTuningMsg->m_Size);
 	Server()->SendMsg(&Msg, MSGFLAG_VITAL, ClientID);
+	m_NumTuningSent++;
+	m_TuningBytes += pTuningMsg->m_Size;
 }
 
 void CGameContext::SendHitSound(int ClientID)
@@ -1206,47 +1250,9 @@ void CGameContext::OnTick()
 	
 /* INFECTION MODIFICATION START ***************************************/
 	//Clean old dots
-	int DotIter;
-	
-	DotIter = 0;
-	while(DotIter < m_LaserDots.size())
-	{
-		m_LaserDots[DotIter].m_LifeSpan--;
-		if(m_LaserDots[DotIter].m_LifeSpan <= 0)
-		{
-			Server()->SnapFreeID(m_LaserDots[DotIter].m_SnapID);
-			m_LaserDots.remove_index(DotIter);
-		}
-		else
-			DotIter++;
-	}
-	
-	DotIter = 0;
-	while(DotIter < m_HammerDots.size())
-	{
-		m_HammerDots[DotIter].m_LifeSpan--;
-		if(m_HammerDots[DotIter].m_LifeSpan <= 0)
-		{
-			Server()->SnapFreeID(m_HammerDots[DotIter].m_SnapID);
-			m_HammerDots.remove_index(DotIter);
-		}
-		else
-			DotIter++;
-	}
-	
-	DotIter = 0;
-	while(DotIter < m_LoveDots.size())
-	{
-		m_LoveDots[DotIter].m_LifeSpan--;
-		m_LoveDots[DotIter].m_Pos.y -= 5.0f;
-		if(m_LoveDots[DotIter].m_LifeSpan <= 0)
-		{
-			Server()->SnapFreeID(m_LoveDots[DotIter].m_SnapID);
-			m_LoveDots.remove_index(DotIter);
-		}
-		else
-			DotIter++;
-	}
+	m_LaserDots.Tick(Server()->Tick());
+	m_HammerDots.Tick(Server()->Tick());
+	m_LoveDots.Tick(Server()->Tick());
 /* INFECTION MODIFICATION END *****************************************/
 
 	// update voting
@@ -1506,6 +1512,7 @@ void CGameContext::OnClientConnected(int ClientID)
 {
 	dbg_assert(!m_apPlayers[ClientID], "non-free player slot");
 	m_apPlayers[ClientID] = m_pController->CreatePlayer(ClientID);
+	StartGeolocation(ClientID);
 	
 	//players[client_id].init(client_id);
 	//players[client_id].client_id = client_id;
@@ -1549,6 +1556,7 @@ void CGameContext::OnClientDrop(int ClientID, int Type, const char *pReason)
 
 	delete m_apPlayers[ClientID];
 	m_apPlayers[ClientID] = 0;
+	m_apGeolocationJobs[ClientID] = nullptr;
 
 	Server()->RoundStatistics()->ResetPlayer(ClientID);
 
@@ -2164,15 +2172,10 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 			Server()->SetClientClan(ClientID, pMsg->m_pClan);
 			Server()->SetClientCountry(ClientID, pMsg->m_Country);
 
-#ifdef CONF_GEOLOCATION
-			std::string ip = Server()->GetClientIP(ClientID);
-			int LocatedCountry = Geolocation::get_country_iso_numeric_code(ip);
+			int LocatedCountry = GetLocatedCountry(ClientID);
 #ifdef CONF_FORCE_COUNTRY_BY_IP
 			Server()->SetClientCountry(ClientID, LocatedCountry);
 #endif // CONF_FORCE_COUNTRY_BY_IP
-#else
-			int LocatedCountry = -1;
-#endif // CONF_GEOLOCATION
 			
 			if(!Server()->GetClientMemory(ClientID, CLIENTMEMORY_LANGUAGESELECTION))
 			{
@@ -2303,6 +2306,44 @@ bool CGameContext::ConTuneDump(IConsole::IResult *pResult, void *pUserData)
 	return true;
 }
 
+bool CGameContext::ConSnapStats(IConsole::IResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "budget=%d culled critical=%lld gameplay=%lld decorative=%lld thinned=%lld",
+		pSelf->Config()->m_SvSnapBudget,
+		(long long)pSelf->m_World.SnapCulled(CGameWorld::SNAP_PRIORITY_CRITICAL),
+		(long long)pSelf->m_World.SnapCulled(CGameWorld::SNAP_PRIORITY_GAMEPLAY),
+		(long long)pSelf->m_World.SnapCulled(CGameWorld::SNAP_PRIORITY_DECORATIVE),
+		(long long)pSelf->m_World.SnapThinned());
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "snapshot", aBuf);
+	str_format(aBuf, sizeof(aBuf), "events live=%d peak=%d overflowed=%lld culled=%lld dropped=%lld",
+		pSelf->m_Events.NumEvents(),
+		pSelf->m_Events.PeakEvents(),
+		(long long)pSelf->m_Events.NumOverflows(),
+		(long long)pSelf->m_Events.NumCulled(),
+		(long long)pSelf->m_Events.NumDropped());
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "snapshot", aBuf);
+	str_format(aBuf, sizeof(aBuf), "interest tested=%lld visible=%lld",
+		(long long)pSelf->m_World.NumInterestTested(),
+		(long long)pSelf->m_World.NumInterestVisible());
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "snapshot", aBuf);
+
+	int64 Updates = pSelf->m_World.NumPlayerMapUpdates();
+	int64 Changes = pSelf->m_World.NumPlayerMapChanges();
+	float Seconds = (pSelf->Server()->Tick() - pSelf->m_World.PlayerMapStartTick())/(float)pSelf->Server()->TickSpeed();
+	str_format(aBuf, sizeof(aBuf), "player maps updates=%lld changes=%lld (%.2f/s) avg=%.1f us",
+		(long long)Updates, (long long)Changes,
+		Updates && Seconds > 0.0f ? Changes/Seconds : 0.0f,
+		Updates ? pSelf->m_World.PlayerMapTime()*1000000.0/time_freq()/Updates : 0.0);
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "snapshot", aBuf);
+	str_format(aBuf, sizeof(aBuf), "tuning round sent=%lld packed=%lld bytes=%lld",
+		(long long)pSelf->m_NumTuningSent, (long long)pSelf->m_NumTuningPacked, (long long)pSelf->m_TuningBytes);
+	pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "snapshot", aBuf);
+	
+	return true;
+}
+
 bool CGameContext::ConPause(IConsole::IResult *pResult, void *pUserData)
 {
 	CGameContext *pSelf = (CGameContext *)pUserData;
@@ -3330,19 +3371,49 @@ void CGameContext::MutePlayer(const char* pStr, int ClientID)
 void CGameContext::InitGeolocation()
 {
 #ifdef CONF_GEOLOCATION
-	const char aGeoDBFileName[] = "geo/GeoLite2-Country.mmdb";
+	const char aGeoTableFileName[] = "geo/GeoLite2-Country.geo";
 	char aBuf[512];
-	Storage()->GetDataPath(aGeoDBFileName, aBuf, sizeof(aBuf));
-	if(aBuf[0])
-	{
-		Geolocation::Initialize(aBuf);
-	}
-	else
+	Storage()->GetDataPath(aGeoTableFileName, aBuf, sizeof(aBuf));
+	if(aBuf[0] && CGeolocation::Initialize(aBuf))
+		return;
+
+	str_format(aBuf, sizeof(aBuf), "Unable to load geolocation data file %s", aGeoTableFileName);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+#endif
+}
+
+void CGameContext::StartGeolocation(int ClientID)
+{
+	m_apGeolocationJobs[ClientID] = nullptr;
+#ifdef CONF_GEOLOCATION
+	std::shared_ptr<const CGeolocation> pGeolocation = CGeolocation::Instance();
+	if(!pGeolocation)
+		return;
+
+	NETADDR Addr;
+	Server()->GetClientAddr(ClientID, &Addr);
+	m_apGeolocationJobs[ClientID] = std::make_shared<CGeolocationJob>(pGeolocation, &Addr);
+	Kernel()->RequestInterface<IEngine>()->AddJob(m_apGeolocationJobs[ClientID]);
+#endif
+}
+
+int CGameContext::GetLocatedCountry(int ClientID)
+{
+#ifdef CONF_GEOLOCATION
+	const std::shared_ptr<CGeolocationJob> &pJob = m_apGeolocationJobs[ClientID];
+	if(pJob && pJob->Status() == IJob::STATE_DONE)
+		return pJob->Country();
+
+	// the job was not picked up yet, the lookup itself is cheap
+	std::shared_ptr<const CGeolocation> pGeolocation = CGeolocation::Instance();
+	if(pGeolocation)
 	{
-		str_format(aBuf, sizeof(aBuf), "Unable to find geolocation data file %s", aGeoDBFileName);
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+		NETADDR Addr;
+		Server()->GetClientAddr(ClientID, &Addr);
+		return pGeolocation->Lookup(&Addr);
 	}
 #endif
+	return -1;
 }
 
 bool CGameContext::ConRegister(IConsole::IResult *pResult, void *pUserData)
@@ -4178,6 +4249,7 @@ void CGameContext::OnConsoleInit()
 	Console()->Register("tune", "s<param> i<value>", CFGFLAG_SERVER, ConTuneParam, this, "Tune variable to value");
 	Console()->Register("tune_reset", "", CFGFLAG_SERVER, ConTuneReset, this, "Reset tuning");
 	Console()->Register("tune_dump", "", CFGFLAG_SERVER, ConTuneDump, this, "Dump tuning");
+	Console()->Register("snap_stats", "", CFGFLAG_SERVER, ConSnapStats, this, "Show the items left out of snapshots by the budget, the event, interest, player map and tuning counters");
 
 	Console()->Register("pause", "", CFGFLAG_SERVER, ConPause, this, "Pause/unpause game");
 	Console()->Register("change_map", "?r", CFGFLAG_SERVER|CFGFLAG_STORE, ConChangeMap, this, "Change map");
@@ -4243,6 +4315,9 @@ void CGameContext::OnInit(/*class IKernel *pKernel*/)
 	m_pStorage = Kernel()->RequestInterface<IStorage>();
 	m_World.SetGameServer(this);
 	m_Events.SetGameServer(this);
+	m_LaserDots.SetServer(Server());
+	m_HammerDots.SetServer(Server());
+	m_LoveDots.SetServer(Server());
 	
 	for(int i=0; i<MAX_CLIENTS; i++)
 	{
@@ -4268,6 +4343,7 @@ void CGameContext::OnInit(/*class IKernel *pKernel*/)
 	m_ZoneHandle_icDamage = m_Collision.GetZoneHandle("icDamage");
 	m_ZoneHandle_icTeleport = m_Collision.GetZoneHandle("icTele");
 	m_ZoneHandle_icBonus = m_Collision.GetZoneHandle("icBonus");
+	m_Collision.InitClearance(m_ZoneHandle_icTeleport);
 
 	// reset everything here
 	//world = new GAMEWORLD;
@@ -4340,6 +4416,17 @@ void CGameContext::OnInit(/*class IKernel *pKernel*/)
 void CGameContext::OnStartRound()
 {
 	m_HeroGiftCooldown = 0;
+
+	if(m_NumTuningSent)
+	{
+		char aBuf[128];
+		str_format(aBuf, sizeof(aBuf), "tuning messages of the round sent=%lld packed=%lld bytes=%lld",
+			(long long)m_NumTuningSent, (long long)m_NumTuningPacked, (long long)m_TuningBytes);
+		Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "tuning", aBuf);
+	}
+	m_NumTuningSent = 0;
+	m_NumTuningPacked = 0;
+	m_TuningBytes = 0;
 }
 
 void CGameContext::OnShutdown()
@@ -4352,6 +4439,54 @@ void CGameContext::OnShutdown()
 	Clear();
 }
 
+/* INFECTION MODIFICATION START ***************************************/
+vec2 CGameContext::LoveDotPos(const LoveDotState *pDot) const
+{
+	// a love dot rises every tick from the one it was created in
+	return pDot->m_Pos - vec2(0.0f, 5.0f*(Server()->Tick() - pDot->m_StartTick + 1));
+}
+
+void CGameContext::SnapLaserDot(int SnapID, const LaserDotState *pDot)
+{
+	CNetObj_Laser *pObj = static_cast<CNetObj_Laser *>(Server()->SnapNewItem(NETOBJTYPE_LASER, SnapID, sizeof(CNetObj_Laser)));
+	if(pObj)
+	{
+		pObj->m_X = (int)pDot->m_Pos1.x;
+		pObj->m_Y = (int)pDot->m_Pos1.y;
+		pObj->m_FromX = (int)pDot->m_Pos0.x;
+		pObj->m_FromY = (int)pDot->m_Pos0.y;
+		pObj->m_StartTick = Server()->Tick();
+	}
+}
+
+void CGameContext::SnapHammerDot(int SnapID, const HammerDotState *pDot)
+{
+	CNetObj_Projectile *pObj = static_cast<CNetObj_Projectile *>(Server()->SnapNewItem(NETOBJTYPE_PROJECTILE, SnapID, sizeof(CNetObj_Projectile)));
+	if(pObj)
+	{
+		pObj->m_X = (int)pDot->m_Pos.x;
+		pObj->m_Y = (int)pDot->m_Pos.y;
+		pObj->m_VelX = 0;
+		pObj->m_VelY = 0;
+		pObj->m_StartTick = Server()->Tick();
+		pObj->m_Type = WEAPON_HAMMER;
+	}
+}
+
+void CGameContext::SnapLoveDot(int SnapID, const LoveDotState *pDot)
+{
+	CNetObj_Pickup *pObj = static_cast<CNetObj_Pickup *>(Server()->SnapNewItem(NETOBJTYPE_PICKUP, SnapID, sizeof(CNetObj_Pickup)));
+	if(pObj)
+	{
+		vec2 Pos = LoveDotPos(pDot);
+		pObj->m_X = (int)Pos.x;
+		pObj->m_Y = (int)Pos.y;
+		pObj->m_Type = POWERUP_HEALTH;
+		pObj->m_Subtype = 0;
+	}
+}
+/* INFECTION MODIFICATION END *****************************************/
+
 void CGameContext::OnSnap(int ClientID)
 {
 	// add tuning to demo
@@ -4365,88 +4500,60 @@ void CGameContext::OnSnap(int ClientID)
 		Server()->SendMsg(&Msg, MSGFLAG_RECORD|MSGFLAG_NOSEND, ClientID);
 	}
 
-	m_World.Snap(ClientID);
+	// the players and the game come first, then the world fills the
+	// snapshot budget by priority
+	m_World.BeginSnap(ClientID);
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(m_apPlayers[i])
+			m_apPlayers[i]->Snap(ClientID);
+	}
 	m_pController->Snap(ClientID);
+	m_World.Snap(ClientID);
 	m_Events.Snap(ClientID);
 
 /* INFECTION MODIFICATION START ***************************************/
 	//Snap laser dots
-	for(int i=0; i < m_LaserDots.size(); i++)
+	if(ClientID >= 0)
 	{
-		if(ClientID >= 0)
+		vec2 ViewPos = m_World.SnapViewPos();
+		vec2 ViewRange = vec2(1000.0f, 800.0f)*m_World.SnapViewScale();
+		CDotPool<LaserDotState>::CQuery LaserQuery(&m_LaserDots, ViewPos, ViewRange);
+		for(int Slot = LaserQuery.Next(); Slot >= 0; Slot = LaserQuery.Next())
 		{
-			vec2 CheckPos = (m_LaserDots[i].m_Pos0 + m_LaserDots[i].m_Pos1)*0.5f;
-			float dx = m_apPlayers[ClientID]->m_ViewPos.x-CheckPos.x;
-			float dy = m_apPlayers[ClientID]->m_ViewPos.y-CheckPos.y;
-			if(absolute(dx) > 1000.0f || absolute(dy) > 800.0f)
-				continue;
-			if(distance(m_apPlayers[ClientID]->m_ViewPos, CheckPos) > 1100.0f)
-				continue;
+			const LaserDotState *pDot = m_LaserDots.GetSlot(Slot);
+			if(m_World.InView(ClientID, (pDot->m_Pos0 + pDot->m_Pos1)*0.5f) && m_World.SnapDecorative(Slot))
+				SnapLaserDot(m_LaserDots.SnapID(Slot), pDot);
 		}
-		
-		CNetObj_Laser *pObj = static_cast<CNetObj_Laser *>(Server()->SnapNewItem(NETOBJTYPE_LASER, m_LaserDots[i].m_SnapID, sizeof(CNetObj_Laser)));
-		if(pObj)
+		CDotPool<HammerDotState>::CQuery HammerQuery(&m_HammerDots, ViewPos, ViewRange);
+		for(int Slot = HammerQuery.Next(); Slot >= 0; Slot = HammerQuery.Next())
 		{
-			pObj->m_X = (int)m_LaserDots[i].m_Pos1.x;
-			pObj->m_Y = (int)m_LaserDots[i].m_Pos1.y;
-			pObj->m_FromX = (int)m_LaserDots[i].m_Pos0.x;
-			pObj->m_FromY = (int)m_LaserDots[i].m_Pos0.y;
-			pObj->m_StartTick = Server()->Tick();
+			const HammerDotState *pDot = m_HammerDots.GetSlot(Slot);
+			if(m_World.InView(ClientID, pDot->m_Pos) && m_World.SnapDecorative(Slot))
+				SnapHammerDot(m_HammerDots.SnapID(Slot), pDot);
 		}
-	}
-	for(int i=0; i < m_HammerDots.size(); i++)
-	{
-		if(ClientID >= 0)
-		{
-			vec2 CheckPos = m_HammerDots[i].m_Pos;
-			float dx = m_apPlayers[ClientID]->m_ViewPos.x-CheckPos.x;
-			float dy = m_apPlayers[ClientID]->m_ViewPos.y-CheckPos.y;
-			if(absolute(dx) > 1000.0f || absolute(dy) > 800.0f)
-				continue;
-			if(distance(m_apPlayers[ClientID]->m_ViewPos, CheckPos) > 1100.0f)
-				continue;
-		}
-		
-		CNetObj_Projectile *pObj = static_cast<CNetObj_Projectile *>(Server()->SnapNewItem(NETOBJTYPE_PROJECTILE, m_HammerDots[i].m_SnapID, sizeof(CNetObj_Projectile)));
-		if(pObj)
+		// the love dots rise by up to a second from their cell
+		CDotPool<LoveDotState>::CQuery LoveQuery(&m_LoveDots, ViewPos, ViewRange + vec2(0.0f, 5.0f*Server()->TickSpeed()));
+		for(int Slot = LoveQuery.Next(); Slot >= 0; Slot = LoveQuery.Next())
 		{
-			pObj->m_X = (int)m_HammerDots[i].m_Pos.x;
-			pObj->m_Y = (int)m_HammerDots[i].m_Pos.y;
-			pObj->m_VelX = 0;
-			pObj->m_VelY = 0;
-			pObj->m_StartTick = Server()->Tick();
-			pObj->m_Type = WEAPON_HAMMER;
+			const LoveDotState *pDot = m_LoveDots.GetSlot(Slot);
+			if(m_World.InView(ClientID, LoveDotPos(pDot)) && m_World.SnapDecorative(Slot))
+				SnapLoveDot(m_LoveDots.SnapID(Slot), pDot);
 		}
 	}
-	for(int i=0; i < m_LoveDots.size(); i++)
+	else
 	{
-		if(ClientID >= 0)
-		{
-			vec2 CheckPos = m_LoveDots[i].m_Pos;
-			float dx = m_apPlayers[ClientID]->m_ViewPos.x-CheckPos.x;
-			float dy = m_apPlayers[ClientID]->m_ViewPos.y-CheckPos.y;
-			if(absolute(dx) > 1000.0f || absolute(dy) > 800.0f)
-				continue;
-			if(distance(m_apPlayers[ClientID]->m_ViewPos, CheckPos) > 1100.0f)
-				continue;
-		}
-		
-		CNetObj_Pickup *pObj = static_cast<CNetObj_Pickup *>(Server()->SnapNewItem(NETOBJTYPE_PICKUP, m_LoveDots[i].m_SnapID, sizeof(CNetObj_Pickup)));
-		if(pObj)
-		{
-			pObj->m_X = (int)m_LoveDots[i].m_Pos.x;
-			pObj->m_Y = (int)m_LoveDots[i].m_Pos.y;
-			pObj->m_Type = POWERUP_HEALTH;
-			pObj->m_Subtype = 0;
-		}
+		for(int Slot = 0; Slot < m_LaserDots.NumSlots(); Slot++)
+			if(m_LaserDots.IsAlive(Slot))
+				SnapLaserDot(m_LaserDots.SnapID(Slot), m_LaserDots.GetSlot(Slot));
+		for(int Slot = 0; Slot < m_HammerDots.NumSlots(); Slot++)
+			if(m_HammerDots.IsAlive(Slot))
+				SnapHammerDot(m_HammerDots.SnapID(Slot), m_HammerDots.GetSlot(Slot));
+		for(int Slot = 0; Slot < m_LoveDots.NumSlots(); Slot++)
+			if(m_LoveDots.IsAlive(Slot))
+				SnapLoveDot(m_LoveDots.SnapID(Slot), m_LoveDots.GetSlot(Slot));
 	}
 /* INFECTION MODIFICATION END *****************************************/
-	
-	for(int i = 0; i < MAX_CLIENTS; i++)
-	{
-		if(m_apPlayers[i])
-			m_apPlayers[i]->Snap(ClientID);
-	}
 }
 
 void CGameContext::FlagCollected()
@@ -4458,10 +4565,15 @@ void CGameContext::FlagCollected()
 	m_HeroGiftCooldown = Server()->TickSpeed() * (15+(120*t));
 }
 
-void CGameContext::OnPreSnap() {}
+void CGameContext::OnPreSnap()
+{
+	m_World.UpdateInterest();
+}
+
 void CGameContext::OnPostSnap()
 {
-	m_Events.Clear();
+	m_World.ClearInterest();
+	m_Events.Expire();
 }
 
 bool CGameContext::IsClientBot(int ClientID) const
@@ -4482,6 +4594,7 @@ bool CGameContext::IsClientPlayer(int ClientID) const
 const char *CGameContext::GameType() const { return m_pController && m_pController->m_pGameType ? m_pController->m_pGameType : ""; }
 const char *CGameContext::Version() const { return GAME_VERSION; }
 const char *CGameContext::NetVersion() const { return GAME_NETVERSION; }
+const char *CGameContext::NetObjName(int Type) const { return m_NetObjHandler.GetObjName(Type); }
 
 
 
@@ -19,11 +19,13 @@
 #include <teeuniverses/components/localization.h>
 
 #include "entities/character.h"
+#include "dotpool.h"
 #include "eventhandler.h"
 #include "gamecontroller.h"
 #include "gameworld.h"
 
 #include <fstream>
+#include <memory>
 
 /*
 	Tick
@@ -87,9 +89,34 @@ class CGameContext : public IGameServer
 	CTuningParams m_Tuning;
 	int m_HeroGiftCooldown;
 
+	// packed tuning messages, the players with the same tuning and
+	// client version tier share one
+	enum
+	{
+		NUM_TUNING_TIERS = 4,
+		NUM_TUNING_MSGS = 16,
+	};
+	struct CTuningMsg
+	{
+		CTuningParams m_Params;
+		int m_Tier;
+		int m_LastUse;
+		int m_Size;
+		unsigned char m_aData[CTuningParams::NUM_TUNES*5];
+	};
+	CTuningMsg m_aTuningMsgs[NUM_TUNING_MSGS];
+	int m_NumTuningMsgs;
+	// tuning messages of the round
+	int64 m_NumTuningSent;
+	int64 m_NumTuningPacked;
+	int64 m_TuningBytes;
+
+	const CTuningMsg *GetTuningMsg(const CTuningParams &Params, int Tier);
+
 	static bool ConTuneParam(IConsole::IResult *pResult, void *pUserData);
 	static bool ConTuneReset(IConsole::IResult *pResult, void *pUserData);
 	static bool ConTuneDump(IConsole::IResult *pResult, void *pUserData);
+	static bool ConSnapStats(IConsole::IResult *pResult, void *pUserData);
 	static bool ConPause(IConsole::IResult *pResult, void *pUserData);
 	static bool ConChangeMap(IConsole::IResult *pResult, void *pUserData);
 	static bool ConSkipMap(IConsole::IResult *pResult, void *pUserData);
@@ -216,6 +243,9 @@ public:
 	void CheckPureTuning();
 	void SendTuningParams(int ClientID);
 	void SendTuningParams(int ClientID, const CTuningParams &params);
+	int TuningTier(int ClientID) const;
+	// the params the client gets, changes of the others need no message
+	uint64 TuningMask(int ClientID) const;
 
 	struct CVoteOptionServer *GetVoteOption(int Index);
 	void ProgressVoteOptions(int ClientID);
@@ -247,6 +277,7 @@ public:
 	virtual const char *GameType() const;
 	virtual const char *Version() const;
 	virtual const char *NetVersion() const;
+	virtual const char *NetObjName(int Type) const;
 	int GetClientVersion(int ClientID) const;
 
 	bool RateLimitPlayerVote(int ClientID);
@@ -295,6 +326,8 @@ private:
 	void MutePlayer(const char* pStr, int ClientID);
 
 	void InitGeolocation();
+	void StartGeolocation(int ClientID);
+	int GetLocatedCountry(int ClientID);
 
 	enum OPTION_VOTE_TYPE
 	{
@@ -341,6 +374,7 @@ public:
 	bool MapExists(const char *pMapName) const;
 	
 private:
+	std::shared_ptr<class CGeolocationJob> m_apGeolocationJobs[MAX_CLIENTS];
 	int m_VoteLanguageTick[MAX_CLIENTS];
 	char m_VoteLanguage[MAX_CLIENTS][16];
 	int m_VoteBanClientID;
@@ -371,26 +405,27 @@ private:
 	{
 		vec2 m_Pos0;
 		vec2 m_Pos1;
-		int m_LifeSpan;
-		int m_SnapID;
 	};
-	array<LaserDotState> m_LaserDots;
+	CDotPool<LaserDotState> m_LaserDots;
 	
 	struct HammerDotState
 	{
 		vec2 m_Pos;
-		int m_LifeSpan;
-		int m_SnapID;
 	};
-	array<HammerDotState> m_HammerDots;
+	CDotPool<HammerDotState> m_HammerDots;
 	
+	// love dots rise from where they were created
 	struct LoveDotState
 	{
 		vec2 m_Pos;
-		int m_LifeSpan;
-		int m_SnapID;
+		int m_StartTick;
 	};
-	array<LoveDotState> m_LoveDots;
+	CDotPool<LoveDotState> m_LoveDots;
+	
+	vec2 LoveDotPos(const LoveDotState *pDot) const;
+	void SnapLaserDot(int SnapID, const LaserDotState *pDot);
+	void SnapHammerDot(int SnapID, const HammerDotState *pDot);
+	void SnapLoveDot(int SnapID, const LoveDotState *pDot);
 	
 	int m_aHitSoundState[MAX_CLIENTS]; //1 for hit, 2 for kill (no sounds must be sent)	
 
@@ -5,10 +5,35 @@
 #include "entity.h"
 #include "gamecontext.h"
 #include <algorithm>
-#include <utility>
 #include <engine/shared/config.h>
+#include <engine/shared/profiler.h>
 #include <game/server/player.h>
 
+static const char *s_apEntityTypeNames[CGameWorld::NUM_ENTTYPES] = {
+	"projectile",
+	"laser",
+	"growingexplosion",
+	"flyingpoint",
+	"character",
+	"engineer_wall",
+	"soldier_bomb",
+	"scientist_mine",
+	"scientist_laser",
+	"mercenary_bomb",
+	"scatter_grenade",
+	"medic_grenade",
+	"hero_flag",
+	"biologist_mine",
+	"slug_slime",
+	"bouncing_bullet",
+	"looper_wall",
+	"white_hole",
+	"superweapon_indicator",
+	"laser_teleport",
+	"turret",
+	"plasma",
+};
+
 //////////////////////////////////////////////////
 // game world
 //////////////////////////////////////////////////
@@ -22,6 +47,39 @@ CGameWorld::CGameWorld()
 	m_ResetRequested = false;
 	for(int i = 0; i < NUM_ENTTYPES; i++)
 		m_apFirstEntityTypes[i] = 0;
+
+	m_SnapBudget = 0;
+	m_SnapClient = -1;
+	m_SnapViewPos = vec2(0.0f, 0.0f);
+	m_SnapViewScale = 1.0f;
+	for(int i = 0; i < NUM_SNAP_PRIORITIES; i++)
+		m_aSnapCulled[i] = 0;
+	m_SnapThinned = 0;
+
+	m_InterestValid = false;
+	m_NumInterestEntities = 0;
+	m_HasSnapInterest = false;
+	m_NumInterestTested = 0;
+	m_NumInterestVisible = 0;
+
+	m_NumPlayerMapEntries = 0;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		m_aPlayerMapValid[i] = false;
+		for(int j = 0; j < MAX_CLIENTS; j++)
+			m_aaPlayerMapSlots[i][j] = -1;
+	}
+	m_NumPlayerMapUpdates = 0;
+	m_NumPlayerMapChanges = 0;
+	m_PlayerMapTime = 0;
+	m_PlayerMapStartTick = -1;
+
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+	{
+		char aName[CProfiler::MAX_NAME_LENGTH];
+		str_format(aName, sizeof(aName), "entity_%s", s_apEntityTypeNames[i]);
+		m_aEntityProfilePhases[i] = g_Profiler.AddPhase(aName);
+	}
 }
 
 CGameWorld::~CGameWorld()
@@ -72,6 +130,10 @@ void CGameWorld::InsertEntity(CEntity *pEnt)
 		dbg_assert(pCur != pEnt, "err");
 #endif
 
+	// the interest sets do not know it
+	if(m_InterestValid)
+		ClearInterest();
+
 	// insert it
 	if(m_apFirstEntityTypes[pEnt->m_ObjType])
 		m_apFirstEntityTypes[pEnt->m_ObjType]->m_pPrevTypeEntity = pEnt;
@@ -91,6 +153,10 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 	if(!pEnt->m_pNextTypeEntity && !pEnt->m_pPrevTypeEntity && m_apFirstEntityTypes[pEnt->m_ObjType] != pEnt)
 		return;
 
+	// the buckets must not point to it
+	if(m_InterestValid)
+		ClearInterest();
+
 	// remove
 	if(pEnt->m_pPrevTypeEntity)
 		pEnt->m_pPrevTypeEntity->m_pNextTypeEntity = pEnt->m_pNextTypeEntity;
@@ -110,13 +176,244 @@ void CGameWorld::RemoveEntity(CEntity *pEnt)
 //
 void CGameWorld::Snap(int SnappingClient)
 {
-	for(int i = 0; i < NUM_ENTTYPES; i++)
-		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
+	if(!m_SnapBudget)
+	{
+		if(m_HasSnapInterest)
 		{
-			m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
+			for(unsigned i = 0; i < m_vpSnapInterest.size(); i++)
+				m_vpSnapInterest[i]->Snap(SnappingClient);
+			return;
+		}
+
+		for(int i = 0; i < NUM_ENTTYPES; i++)
+			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
+			{
+				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
+				pEnt->Snap(SnappingClient);
+				pEnt = m_pNextTraverseEntity;
+			}
+		return;
+	}
+
+	// fill the budget by priority, closest entities first. The entries
+	// keep raw pointers, which stay valid: snap callbacks can only mark
+	// entities for destroy, they are freed in RemoveEntities after the tick
+	m_vSnapEntries.clear();
+	if(m_HasSnapInterest)
+	{
+		for(unsigned i = 0; i < m_vpSnapInterest.size(); i++)
+		{
+			CSnapEntry Entry;
+			Entry.m_pEntity = m_vpSnapInterest[i];
+			Entry.m_Priority = Entry.m_pEntity->SnapPriority();
+			Entry.m_Distance = distance(Entry.m_pEntity->m_Pos, m_SnapViewPos);
+			m_vSnapEntries.push_back(Entry);
+		}
+	}
+	else
+	{
+		for(int i = 0; i < NUM_ENTTYPES; i++)
+			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+			{
+				CSnapEntry Entry;
+				Entry.m_pEntity = pEnt;
+				Entry.m_Priority = pEnt->SnapPriority();
+				Entry.m_Distance = distance(pEnt->m_Pos, m_SnapViewPos);
+				m_vSnapEntries.push_back(Entry);
+			}
+	}
+	std::sort(m_vSnapEntries.begin(), m_vSnapEntries.end());
+
+	for(unsigned i = 0; i < m_vSnapEntries.size(); i++)
+	{
+		CEntity *pEnt = m_vSnapEntries[i].m_pEntity;
+		int Priority = m_vSnapEntries[i].m_Priority;
+		if(!SnapHasRoom(Priority))
+		{
+			if(!pEnt->NetworkClipped(SnappingClient))
+				m_aSnapCulled[Priority]++;
+			continue;
+		}
+
+		int Lod = SnapLod();
+		if(Lod > 0 && Priority < SNAP_PRIORITY_CRITICAL)
+		{
+			pEnt->SnapLod(SnappingClient, Lod);
+			m_SnapThinned++;
+		}
+		else
 			pEnt->Snap(SnappingClient);
-			pEnt = m_pNextTraverseEntity;
+	}
+}
+
+void CGameWorld::BeginSnap(int SnappingClient)
+{
+	m_SnapBudget = 0;
+	m_SnapClient = -1;
+	m_HasSnapInterest = false;
+	if(SnappingClient < 0 || !GameServer()->m_apPlayers[SnappingClient])
+		return;
+
+	m_SnapBudget = Config()->m_SvSnapBudget;
+	m_SnapClient = SnappingClient;
+	m_SnapViewPos = GameServer()->m_apPlayers[SnappingClient]->m_ViewPos;
+	m_SnapViewScale = ViewScale(SnappingClient);
+	if(m_InterestValid)
+		BuildSnapInterest();
+}
+
+float CGameWorld::ViewScale(int ClientID)
+{
+	const CPlayer *pPlayer = GameServer()->m_apPlayers[ClientID];
+	if(pPlayer->GetTeam() == TEAM_SPECTATORS && pPlayer->m_SpectatorID == SPEC_FREEVIEW)
+		return Config()->m_SvSpecViewScale/100.0f;
+	return 1.0f;
+}
+
+bool CGameWorld::InView(int ClientID, vec2 Pos)
+{
+	if(ClientID < 0)
+		return true;
+
+	vec2 ViewPos = m_SnapViewPos;
+	float Scale = m_SnapViewScale;
+	if(ClientID != m_SnapClient)
+	{
+		ViewPos = GameServer()->m_apPlayers[ClientID]->m_ViewPos;
+		Scale = ViewScale(ClientID);
+	}
+
+	if(absolute(ViewPos.x-Pos.x) > 1000.0f*Scale || absolute(ViewPos.y-Pos.y) > 800.0f*Scale)
+		return false;
+	return distance(ViewPos, Pos) <= 1100.0f*Scale;
+}
+
+void CGameWorld::UpdateInterest()
+{
+	m_vInterestEntries.clear();
+	m_vpInterestAlways.clear();
+	for(int i = 0; i < NUM_INTEREST_BUCKETS; i++)
+		m_aInterestBuckets[i] = -1;
+
+	int Index = 0;
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+		for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; pEnt = pEnt->m_pNextTypeEntity)
+		{
+			pEnt->m_InterestIndex = Index++;
+
+			vec2 aPositions[CEntity::MAX_INTEREST_POSITIONS];
+			int NumPositions = pEnt->GetInterestPositions(aPositions);
+			if(NumPositions == 0)
+				m_vpInterestAlways.push_back(pEnt);
+			for(int p = 0; p < NumPositions; p++)
+			{
+				CInterestEntry Entry;
+				Entry.m_pEntity = pEnt;
+				Entry.m_Pos = aPositions[p];
+				int *pBucket = &m_aInterestBuckets[InterestBucket(InterestCell(Entry.m_Pos.x), InterestCell(Entry.m_Pos.y))];
+				Entry.m_NextInBucket = *pBucket;
+				*pBucket = m_vInterestEntries.size();
+				m_vInterestEntries.push_back(Entry);
+			}
 		}
+
+	m_NumInterestEntities = Index;
+	m_InterestValid = true;
+}
+
+void CGameWorld::ClearInterest()
+{
+	m_InterestValid = false;
+	m_HasSnapInterest = false;
+}
+
+static bool CompareInterestIndex(const CEntity *pEntity1, const CEntity *pEntity2)
+{
+	return pEntity1->GetInterestIndex() < pEntity2->GetInterestIndex();
+}
+
+void CGameWorld::BuildSnapInterest()
+{
+	m_vSnapInterestBits.assign((m_NumInterestEntities+31)/32, 0);
+	m_vpSnapInterest.clear();
+
+	float RangeX = 1000.0f*m_SnapViewScale;
+	float RangeY = 800.0f*m_SnapViewScale;
+	int MinX = InterestCell(m_SnapViewPos.x-RangeX);
+	int MaxX = InterestCell(m_SnapViewPos.x+RangeX);
+	int MinY = InterestCell(m_SnapViewPos.y-RangeY);
+	int MaxY = InterestCell(m_SnapViewPos.y+RangeY);
+
+	// cells can share a bucket, visit each bucket once
+	bool aVisited[NUM_INTEREST_BUCKETS] = {false};
+	for(int y = MinY; y <= MaxY; y++)
+	{
+		for(int x = MinX; x <= MaxX; x++)
+		{
+			int Bucket = InterestBucket(x, y);
+			if(aVisited[Bucket])
+				continue;
+			aVisited[Bucket] = true;
+
+			for(int e = m_aInterestBuckets[Bucket]; e >= 0; e = m_vInterestEntries[e].m_NextInBucket)
+			{
+				const CInterestEntry *pEntry = &m_vInterestEntries[e];
+				int Index = pEntry->m_pEntity->m_InterestIndex;
+				unsigned Bit = 1u<<(Index&31);
+				m_NumInterestTested++;
+				if((m_vSnapInterestBits[Index>>5]&Bit) || !InView(m_SnapClient, pEntry->m_Pos))
+					continue;
+				m_vSnapInterestBits[Index>>5] |= Bit;
+				m_vpSnapInterest.push_back(pEntry->m_pEntity);
+			}
+		}
+	}
+
+	for(unsigned i = 0; i < m_vpInterestAlways.size(); i++)
+	{
+		int Index = m_vpInterestAlways[i]->m_InterestIndex;
+		m_vSnapInterestBits[Index>>5] |= 1u<<(Index&31);
+		m_vpSnapInterest.push_back(m_vpInterestAlways[i]);
+	}
+
+	// snap in the order of the world
+	std::sort(m_vpSnapInterest.begin(), m_vpSnapInterest.end(), CompareInterestIndex);
+	m_NumInterestVisible += m_vpSnapInterest.size();
+	m_HasSnapInterest = true;
+}
+
+int CGameWorld::SnapInterest(const CEntity *pEntity, int SnappingClient) const
+{
+	int Index = pEntity->m_InterestIndex;
+	if(!m_HasSnapInterest || SnappingClient != m_SnapClient || Index < 0 || Index >= m_NumInterestEntities)
+		return -1;
+	return (m_vSnapInterestBits[Index>>5]>>(Index&31))&1;
+}
+
+bool CGameWorld::SnapHasRoom(int Priority)
+{
+	return !m_SnapBudget || Priority >= SNAP_PRIORITY_CRITICAL || Server()->SnapSize() < m_SnapBudget;
+}
+
+int CGameWorld::SnapLod()
+{
+	if(!m_SnapBudget)
+		return 0;
+
+	int Size = Server()->SnapSize();
+	if(Size < m_SnapBudget/2)
+		return 0;
+	if(Size < m_SnapBudget*3/4)
+		return 1;
+	return 2;
+}
+
+bool CGameWorld::SnapDecorative(int Index)
+{
+	if(SnapHasRoom(SNAP_PRIORITY_DECORATIVE) && (Index & ((1<<SnapLod())-1)) == 0)
+		return true;
+	m_aSnapCulled[SNAP_PRIORITY_DECORATIVE]++;
+	return false;
 }
 
 void CGameWorld::Reset()
@@ -153,72 +450,163 @@ void CGameWorld::RemoveEntities()
 		}
 }
 
-bool distCompare(std::pair<float,int> a, std::pair<float,int> b)
-{
-	return (a.first < b.first);
-}
+static const float s_PlayerMapRange = 1300.0f; // players further away are not displayed anyway
+static const float s_PlayerMapHysteresis = 200.0f; // a player must be this much closer to take a slot
 
 void CGameWorld::UpdatePlayerMaps()
 {
 	if (Server()->Tick() % g_Config.m_SvMapUpdateRate != 0) return;
 
-	std::pair<float,int> dist[MAX_CLIENTS];
-	for (int i = 0; i < MAX_CLIENTS; i++)
+	int64 StartTime = time_get_impl();
+	if(m_PlayerMapStartTick < 0)
+		m_PlayerMapStartTick = Server()->Tick();
+
+	// bucket the players that can be displayed
+	m_NumPlayerMapEntries = 0;
+	for(int i = 0; i < NUM_INTEREST_BUCKETS; i++)
+		m_aPlayerMapBuckets[i] = -1;
+	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
-		if (!Server()->ClientIngame(i)) continue;
-		int* map = Server()->GetIdMap(i);
+		m_aPlayerMapValid[i] = Server()->ClientIngame(i) && GameServer()->m_apPlayers[i] && GameServer()->m_apPlayers[i]->GetCharacter();
+		if(!m_aPlayerMapValid[i])
+			continue;
 
-		// compute distances
-		for (int j = 0; j < MAX_CLIENTS; j++)
-		{
-			dist[j].second = j;
-			dist[j].first = 1e10;
-			if (!Server()->ClientIngame(j))
-				continue;
-			CCharacter* ch = GameServer()->m_apPlayers[j]->GetCharacter();
-			if (!ch)
-				continue;
-			dist[j].first = distance(GameServer()->m_apPlayers[i]->m_ViewPos, GameServer()->m_apPlayers[j]->m_ViewPos);
-		}
+		vec2 ViewPos = GameServer()->m_apPlayers[i]->m_ViewPos;
+		CPlayerMapEntry *pEntry = &m_aPlayerMapEntries[m_NumPlayerMapEntries];
+		pEntry->m_ClientID = i;
+		pEntry->m_CellX = InterestCell(ViewPos.x);
+		pEntry->m_CellY = InterestCell(ViewPos.y);
+		int *pBucket = &m_aPlayerMapBuckets[InterestBucket(pEntry->m_CellX, pEntry->m_CellY)];
+		pEntry->m_NextInBucket = *pBucket;
+		*pBucket = m_NumPlayerMapEntries++;
+	}
 
-		// always send the player himself
-		dist[i].first = 0;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if (!Server()->ClientIngame(i) || !GameServer()->m_apPlayers[i]) continue;
 
-		// compute reverse map
-		int rMap[MAX_CLIENTS];
-		for (int j = 0; j < MAX_CLIENTS; j++)
+		// custom clients see all ids
+		IServer::CClientInfo Info;
+		Server()->GetClientInfo(i, &Info);
+		if(Info.m_CustClt)
+			continue;
+
+		UpdatePlayerMap(i);
+	}
+
+	m_NumPlayerMapUpdates++;
+	m_PlayerMapTime += time_get_impl() - StartTime;
+}
+
+void CGameWorld::UpdatePlayerMap(int ClientID)
+{
+	int *pMap = Server()->GetIdMap(ClientID);
+	int *pSlots = m_aaPlayerMapSlots[ClientID];
+	vec2 ViewPos = GameServer()->m_apPlayers[ClientID]->m_ViewPos;
+
+	// drop the players that left or died, the client itself stays
+	int aFreeSlots[VANILLA_MAX_CLIENTS];
+	int NumFreeSlots = 0;
+	float aSlotDistances[VANILLA_MAX_CLIENTS];
+	for(int s = VANILLA_MAX_CLIENTS-2; s >= 0; s--)
+	{
+		int Player = pMap[s];
+		if(Player >= 0 && Player != ClientID && !m_aPlayerMapValid[Player])
 		{
-			rMap[j] = -1;
+			pMap[s] = -1;
+			m_NumPlayerMapChanges++;
+			Player = -1;
 		}
-		for (int j = 0; j < VANILLA_MAX_CLIENTS; j++)
+
+		if(Player < 0)
 		{
-			if (map[j] == -1) continue;
-			if (dist[map[j]].first > 1e9) map[j] = -1;
-			else rMap[map[j]] = j;
+			aFreeSlots[NumFreeSlots++] = s;
+			continue;
 		}
+		pSlots[Player] = s;
+		aSlotDistances[s] = Player == ClientID ? 0.0f : distance(ViewPos, GameServer()->m_apPlayers[Player]->m_ViewPos);
+	}
+	// player with empty name to say chat msgs
+	pMap[VANILLA_MAX_CLIENTS-1] = -1;
+
+	// the players in range, nearest first
+	int aCandidates[MAX_CLIENTS];
+	float aDistances[MAX_CLIENTS];
+	int NumCandidates = 0;
+	if(!IsInPlayerMap(ClientID, pMap, pSlots))
+	{
+		aCandidates[NumCandidates] = ClientID;
+		aDistances[NumCandidates++] = 0.0f;
+	}
 
-		std::nth_element(&dist[0], &dist[VANILLA_MAX_CLIENTS - 1], &dist[MAX_CLIENTS], distCompare);
-
-		int mapc = 0;
-		int demand = 0;
-		for (int j = 0; j < VANILLA_MAX_CLIENTS - 1; j++)
+	int MinX = InterestCell(ViewPos.x-s_PlayerMapRange);
+	int MaxX = InterestCell(ViewPos.x+s_PlayerMapRange);
+	int MinY = InterestCell(ViewPos.y-s_PlayerMapRange);
+	int MaxY = InterestCell(ViewPos.y+s_PlayerMapRange);
+	for(int y = MinY; y <= MaxY; y++)
+	{
+		for(int x = MinX; x <= MaxX; x++)
 		{
-			int k = dist[j].second;
-			if (rMap[k] != -1 || dist[j].first > 1e9) continue;
-			while (mapc < VANILLA_MAX_CLIENTS && map[mapc] != -1) mapc++;
-			if (mapc < VANILLA_MAX_CLIENTS - 1)
-				map[mapc] = k;
-			else
-				if (dist[j].first < 1300) // dont bother freeing up space for players which are too far to be displayed anyway
-					demand++;
+			for(int e = m_aPlayerMapBuckets[InterestBucket(x, y)]; e >= 0; e = m_aPlayerMapEntries[e].m_NextInBucket)
+			{
+				const CPlayerMapEntry *pEntry = &m_aPlayerMapEntries[e];
+				int Player = pEntry->m_ClientID;
+				if(pEntry->m_CellX != x || pEntry->m_CellY != y || Player == ClientID || IsInPlayerMap(Player, pMap, pSlots))
+					continue;
+
+				float Distance = distance(ViewPos, GameServer()->m_apPlayers[Player]->m_ViewPos);
+				if(Distance >= s_PlayerMapRange)
+					continue;
+
+				// insertion sort, there are few players in range
+				int c = NumCandidates++;
+				while(c > 0 && aDistances[c-1] > Distance)
+				{
+					aCandidates[c] = aCandidates[c-1];
+					aDistances[c] = aDistances[c-1];
+					c--;
+				}
+				aCandidates[c] = Player;
+				aDistances[c] = Distance;
+			}
 		}
-		for (int j = MAX_CLIENTS - 1; j > VANILLA_MAX_CLIENTS - 2; j--)
+	}
+
+	for(int c = 0; c < NumCandidates; c++)
+	{
+		int Slot = -1;
+		if(NumFreeSlots > 0)
+			Slot = aFreeSlots[--NumFreeSlots];
+		else
 		{
-			int k = dist[j].second;
-			if (rMap[k] != -1 && demand-- > 0)
-				map[rMap[k]] = -1;
+			// take the slot of the furthest player if it is clearly further
+			for(int s = 0; s < VANILLA_MAX_CLIENTS-1; s++)
+			{
+				if(pMap[s] != ClientID && (Slot < 0 || aSlotDistances[s] > aSlotDistances[Slot]))
+					Slot = s;
+			}
+			if(aCandidates[c] != ClientID && aSlotDistances[Slot] <= aDistances[c]+s_PlayerMapHysteresis)
+				break;
 		}
-		map[VANILLA_MAX_CLIENTS - 1] = -1; // player with empty name to say chat msgs
+
+		pMap[Slot] = aCandidates[c];
+		pSlots[aCandidates[c]] = Slot;
+		aSlotDistances[Slot] = aDistances[c];
+		m_NumPlayerMapChanges++;
+	}
+
+	// the free slots show the other players
+	for(int e = 0; e < m_NumPlayerMapEntries && NumFreeSlots > 0; e++)
+	{
+		int Player = m_aPlayerMapEntries[e].m_ClientID;
+		if(Player == ClientID || IsInPlayerMap(Player, pMap, pSlots))
+			continue;
+
+		int Slot = aFreeSlots[--NumFreeSlots];
+		pMap[Slot] = Player;
+		pSlots[Player] = Slot;
+		aSlotDistances[Slot] = distance(ViewPos, GameServer()->m_apPlayers[Player]->m_ViewPos);
+		m_NumPlayerMapChanges++;
 	}
 }
 
@@ -232,21 +620,40 @@ void CGameWorld::Tick()
 		if(GameServer()->m_pController->IsForceBalanced())
 			GameServer()->SendChat(-1, CGameContext::CHAT_ALL, "Teams have been balanced");
 		// update all objects
+		const bool Profile = g_Profiler.Enabled();
+		int64 aTickTimes[NUM_ENTTYPES] = {0};
+
 		for(int i = 0; i < NUM_ENTTYPES; i++)
+		{
+			int64 StartTime = Profile ? time_get_impl() : 0;
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 			{
 				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
 				pEnt->Tick();
 				pEnt = m_pNextTraverseEntity;
 			}
+			if(Profile)
+				aTickTimes[i] += time_get_impl() - StartTime;
+		}
 
 		for(int i = 0; i < NUM_ENTTYPES; i++)
+		{
+			int64 StartTime = Profile ? time_get_impl() : 0;
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 			{
 				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
 				pEnt->TickDefered();
 				pEnt = m_pNextTraverseEntity;
 			}
+			if(Profile)
+				aTickTimes[i] += time_get_impl() - StartTime;
+		}
+
+		if(Profile)
+		{
+			for(int i = 0; i < NUM_ENTTYPES; i++)
+				g_Profiler.AddSample(m_aEntityProfilePhases[i], aTickTimes[i]);
+		}
 	}
 	else
 	{
@@ -5,6 +5,8 @@
 
 #include <game/gamecore.h>
 
+#include <vector>
+
 class CEntity;
 class CCharacter;
 
@@ -45,18 +47,110 @@ public:
 		NUM_ENTTYPES
 	};
 
+	enum
+	{
+		SNAP_PRIORITY_DECORATIVE = 0,
+		SNAP_PRIORITY_GAMEPLAY,
+		SNAP_PRIORITY_CRITICAL,
+
+		NUM_SNAP_PRIORITIES
+	};
+
 private:
 	void Reset();
 	void RemoveEntities();
 
 	CEntity *m_pNextTraverseEntity;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
+	int m_aEntityProfilePhases[NUM_ENTTYPES];
 
 	class CGameContext *m_pGameServer;
 	class CConfig *m_pConfig;
 	class IServer *m_pServer;
 
+
+	struct CSnapEntry
+	{
+		CEntity *m_pEntity;
+		int m_Priority;
+		float m_Distance;
+
+		bool operator<(const CSnapEntry &Other) const
+		{
+			if(m_Priority != Other.m_Priority)
+				return m_Priority > Other.m_Priority;
+			return m_Distance < Other.m_Distance;
+		}
+	};
+
+	std::vector<CSnapEntry> m_vSnapEntries;
+	int m_SnapBudget;
+	int m_SnapClient;
+	vec2 m_SnapViewPos;
+	float m_SnapViewScale;
+	int64 m_aSnapCulled[NUM_SNAP_PRIORITIES];
+	int64 m_SnapThinned;
+
+	enum
+	{
+		INTEREST_CELL_SHIFT = 10, // cells of 1024 units
+		NUM_INTEREST_BUCKETS = 256,
+	};
+
+	struct CInterestEntry
+	{
+		CEntity *m_pEntity;
+		vec2 m_Pos;
+		int m_NextInBucket;
+	};
+
+	// the entities by the grid cells of their positions, valid during
+	// the snapshots of a tick
+	bool m_InterestValid;
+	std::vector<CInterestEntry> m_vInterestEntries;
+	int m_aInterestBuckets[NUM_INTEREST_BUCKETS];
+	std::vector<CEntity *> m_vpInterestAlways;
+	int m_NumInterestEntities;
+
+	// the interest set of the client of the current snapshot
+	bool m_HasSnapInterest;
+	std::vector<unsigned> m_vSnapInterestBits;
+	std::vector<CEntity *> m_vpSnapInterest;
+	int64 m_NumInterestTested;
+	int64 m_NumInterestVisible;
+
+	static int InterestCell(float Value) { return (int)floor(Value) >> INTEREST_CELL_SHIFT; }
+	static int InterestBucket(int CellX, int CellY) { return (((unsigned)CellX*73856093u)^((unsigned)CellY*19349663u))&(NUM_INTEREST_BUCKETS-1); }
+	float ViewScale(int ClientID);
+	void BuildSnapInterest();
+
 	void UpdatePlayerMaps();
+	void UpdatePlayerMap(int ClientID);
+	static bool IsInPlayerMap(int Player, const int *pMap, const int *pSlots)
+	{
+		int Slot = pSlots[Player];
+		return Slot >= 0 && Slot < VANILLA_MAX_CLIENTS-1 && pMap[Slot] == Player;
+	}
+
+	// the players with characters by the grid cells of their view
+	// positions, for the player maps of vanilla clients
+	struct CPlayerMapEntry
+	{
+		int m_ClientID;
+		int m_CellX;
+		int m_CellY;
+		int m_NextInBucket;
+	};
+	CPlayerMapEntry m_aPlayerMapEntries[MAX_CLIENTS];
+	int m_NumPlayerMapEntries;
+	int m_aPlayerMapBuckets[NUM_INTEREST_BUCKETS];
+	bool m_aPlayerMapValid[MAX_CLIENTS];
+	// slot of a player in the map of a client, checked against the map
+	int m_aaPlayerMapSlots[MAX_CLIENTS][MAX_CLIENTS];
+	int64 m_NumPlayerMapUpdates;
+	int64 m_NumPlayerMapChanges;
+	int64 m_PlayerMapTime;
+	int m_PlayerMapStartTick;
 
 public:
 	class CGameContext *GameServer() { return m_pGameServer; }
@@ -165,6 +259,82 @@ public:
 	*/
 	void Snap(int SnappingClient);
 
+	/*
+		Function: BeginSnap
+			Starts the byte budget of the snapshot for a client,
+			sv_snap_budget. Demo snapshots have no budget.
+	*/
+	void BeginSnap(int SnappingClient);
+
+	/*
+		Function: SnapHasRoom
+			Returns true if items of the priority class still fit in
+			the budget. Critical items always fit.
+	*/
+	bool SnapHasRoom(int Priority);
+
+	/*
+		Function: SnapLod
+			Returns the level of detail for the next item, 0 for full
+			detail. Every level halves the detail, the level rises as
+			the budget fills up.
+	*/
+	int SnapLod();
+
+	/*
+		Function: SnapDecorative
+			Returns true if the decorative item Index of a series is to
+			be snapped, thinning the series by the level of detail.
+			Counts the items left out.
+	*/
+	bool SnapDecorative(int Index);
+
+	int64 SnapCulled(int Priority) const { return m_aSnapCulled[Priority]; }
+	int64 SnapThinned() const { return m_SnapThinned; }
+
+	/*
+		Function: UpdateInterest
+			Buckets the entities by the grid cells of their interest
+			positions, once per snapshot tick. Each client snapshot
+			builds its interest set from the cells in its view, so the
+			entities only test their membership.
+	*/
+	void UpdateInterest();
+
+	/*
+		Function: ClearInterest
+			Drops the buckets after the snapshots of the tick.
+	*/
+	void ClearInterest();
+
+	/*
+		Function: InView
+			Returns true if a position is in the view of a client. Free
+			view spectators see sv_spec_view_scale percent of the player
+			view. Always true for the demo.
+	*/
+	bool InView(int ClientID, vec2 Pos);
+
+	/*
+		Function: SnapInterest
+			Returns 1 if the entity is in the interest set of the
+			client of the current snapshot, 0 if not and -1 if the set
+			does not know the entity.
+	*/
+	int SnapInterest(const CEntity *pEntity, int SnappingClient) const;
+
+	vec2 SnapViewPos() const { return m_SnapViewPos; }
+	float SnapViewScale() const { return m_SnapViewScale; }
+	int64 NumInterestTested() const { return m_NumInterestTested; }
+	int64 NumInterestVisible() const { return m_NumInterestVisible; }
+
+	int64 NumPlayerMapUpdates() const { return m_NumPlayerMapUpdates; }
+	// slots of the player maps that got another player or none
+	int64 NumPlayerMapChanges() const { return m_NumPlayerMapChanges; }
+	// time of the player map updates in time_get_impl() units
+	int64 PlayerMapTime() const { return m_PlayerMapTime; }
+	int PlayerMapStartTick() const { return m_PlayerMapStartTick; }
+
 	/*
 		Function: tick
 			Calls tick on all the entities in the world to progress
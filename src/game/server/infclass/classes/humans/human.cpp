@@ -283,7 +283,7 @@ void CInfClassHuman::OnGrenadeFired(WeaponFireContext *pFireContext)
 		if(FindPortalPosition(&PortalPos))
 		{
 			vec2 OldPos = GetPos();
-			m_pCharacter->m_Core.m_Pos = PortalPos;
+			m_pCharacter->m_Core.SetPosition(PortalPos);
 			m_pCharacter->m_Core.m_HookedPlayer = -1;
 			m_pCharacter->m_Core.m_HookState = HOOK_RETRACTED;
 			m_pCharacter->m_Core.m_HookPos = PortalPos;
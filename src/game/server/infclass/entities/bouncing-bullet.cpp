@@ -128,11 +128,16 @@ void CBouncingBullet::FillInfo(CNetObj_Projectile *pProj)
 	pProj->m_Type = WEAPON_SHOTGUN;
 }
 
-void CBouncingBullet::Snap(int SnappingClient)
+int CBouncingBullet::GetInterestPositions(vec2 *pPositions)
 {
 	float Ct = (Server()->Tick()-m_StartTick)/(float)Server()->TickSpeed();
+	pPositions[0] = GetPos(Ct);
+	return 1;
+}
 
-	if(NetworkClipped(SnappingClient, GetPos(Ct)))
+void CBouncingBullet::Snap(int SnappingClient)
+{
+	if(NetworkClipped(SnappingClient))
 		return;
 
 	CNetObj_Projectile *pProj = static_cast<CNetObj_Projectile *>(Server()->SnapNewItem(NETOBJTYPE_PROJECTILE, m_ID, sizeof(CNetObj_Projectile)));
@@ -15,6 +15,7 @@ public:
 
 	virtual void Tick();
 	virtual void TickPaused();
+	virtual int GetInterestPositions(vec2 *pPositions);
 	virtual void Snap(int SnappingClient);
 
 private:
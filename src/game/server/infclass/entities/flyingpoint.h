@@ -18,6 +18,8 @@ public:
 	
 	virtual void Tick();
 	virtual void Snap(int SnappingClient);
+	virtual int GetInterestPositions(vec2 *pPositions) { return 0; }
+	virtual int SnapPriority() const { return CGameWorld::SNAP_PRIORITY_DECORATIVE; }
 };
 
 #endif
@@ -163,9 +163,16 @@ void CInfClassLaser::TickPaused()
 	++m_EvalTick;
 }
 
+int CInfClassLaser::GetInterestPositions(vec2 *pPositions)
+{
+	pPositions[0] = m_Pos;
+	pPositions[1] = m_From;
+	return 2;
+}
+
 void CInfClassLaser::Snap(int SnappingClient)
 {
-	if(NetworkClipped(SnappingClient) && NetworkClipped(SnappingClient, m_From))
+	if(NetworkClipped(SnappingClient))
 		return;
 
 	CNetObj_Laser *pObj = static_cast<CNetObj_Laser *>(Server()->SnapNewItem(NETOBJTYPE_LASER, m_ID, sizeof(CNetObj_Laser)));
@@ -14,6 +14,7 @@ public:
 
 	void Tick() override;
 	void TickPaused() override;
+	int GetInterestPositions(vec2 *pPositions) override;
 	void Snap(int SnappingClient) override;
 protected:
 	CInfClassLaser(CGameContext *pGameContext, vec2 Pos, vec2 Direction, float StartEnergy, int Owner, int Dmg, int ObjType);
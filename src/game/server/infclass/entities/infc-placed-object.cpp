@@ -17,9 +17,19 @@ CPlacedObject::~CPlacedObject()
 	Server()->SnapFreeID(m_InfClassObjectID);
 }
 
+int CPlacedObject::GetInterestPositions(vec2 *pPositions)
+{
+	pPositions[0] = m_Pos;
+	if(!HasSecondPosition())
+		return 1;
+
+	pPositions[1] = m_Pos2;
+	return 2;
+}
+
 bool CPlacedObject::DoSnapForClient(int SnappingClient)
 {
-	if(NetworkClipped(SnappingClient) && (!HasSecondPosition() || NetworkClipped(SnappingClient, m_Pos2)))
+	if(NetworkClipped(SnappingClient))
 		return false;
 
 	CInfClassCharacter *pCharacter = GameController()->GetCharacter(SnappingClient);
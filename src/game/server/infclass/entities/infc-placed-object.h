@@ -13,6 +13,8 @@ public:
 
 	bool HasSecondPosition() const { return m_InfClassObjectFlags & INFCLASS_OBJECT_FLAG_HAS_SECOND_POSITION; }
 
+	int GetInterestPositions(vec2 *pPositions) override;
+
 protected:
 	bool DoSnapForClient(int SnappingClient) override;
 
@@ -208,7 +208,7 @@ void CInfClassCharacter::Tick()
 	if(GetPlayerClass() == PLAYERCLASS_SNIPER && PositionIsLocked())
 	{
 		m_Core.m_Vel = vec2(0.0f, 0.0f);
-		m_Core.m_Pos = PrevPos;
+		m_Core.SetPosition(PrevPos);
 	}
 
 	//NeedHeal
@@ -2411,7 +2411,7 @@ void CInfClassCharacter::Die(DAMAGE_TYPE DamageType, int Killer, int Assistant)
 
 	m_Alive = false;
 	GameWorld()->RemoveEntity(this);
-	GameWorld()->m_Core.m_apCharacters[GetCID()] = 0;
+	GameWorld()->m_Core.SetCharacter(GetCID(), nullptr);
 	GameServer()->CreateDeath(GetPos(), GetCID());
 }
 
@@ -3067,7 +3067,7 @@ void CInfClassCharacter::TeleToId(int TeleNumber, int TeleType)
 
 	int DestTeleNumber = random_int(0, Outs.size() - 1);
 	vec2 DestPosition = Outs.at(DestTeleNumber);
-	m_Core.m_Pos = DestPosition;
+	m_Core.SetPosition(DestPosition);
 	if(TeleType == TILE_TELEINEVIL)
 	{
 		m_Core.m_Vel = vec2(0, 0);
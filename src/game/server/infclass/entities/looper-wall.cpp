@@ -117,6 +117,11 @@ void CLooperWall::TickPaused()
 }
 
 void CLooperWall::Snap(int SnappingClient)
+{
+	SnapLod(SnappingClient, 0);
+}
+
+void CLooperWall::SnapLod(int SnappingClient, int Lod)
 {
 	if(!DoSnapForClient(SnappingClient))
 		return;
@@ -191,7 +196,7 @@ void CLooperWall::Snap(int SnappingClient)
 		dirVecT.y = -dirVecT.y*2.0f;
 		
 		int particleCount = length(dirVec)/g_BarrierMaxLength*NUM_PARTICLES;
-		for(int i=0; i<particleCount; i++)
+		for(int i=0; i<particleCount; i += 1<<Lod)
 		{
 			float fRandom1 = random_float();
 			float fRandom2 = random_float();
@@ -18,6 +18,7 @@ public:
 	virtual void Tick();
 	virtual void TickPaused();
 	virtual void Snap(int SnappingClient);
+	virtual void SnapLod(int SnappingClient, int Lod);
 	int GetTick() { return m_LifeSpan; }
 
 private:
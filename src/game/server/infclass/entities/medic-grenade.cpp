@@ -101,11 +101,16 @@ void CMedicGrenade::FillInfo(CNetObj_Projectile *pProj)
 	pProj->m_Type = WEAPON_GRENADE;
 }
 
-void CMedicGrenade::Snap(int SnappingClient)
+int CMedicGrenade::GetInterestPositions(vec2 *pPositions)
 {
 	float Ct = (Server()->Tick()-m_StartTick)/(float)Server()->TickSpeed();
+	pPositions[0] = GetPos(Ct);
+	return 1;
+}
 
-	if(NetworkClipped(SnappingClient, GetPos(Ct)))
+void CMedicGrenade::Snap(int SnappingClient)
+{
+	if(NetworkClipped(SnappingClient))
 		return;
 
 	CNetObj_Projectile *pProj = static_cast<CNetObj_Projectile *>(Server()->SnapNewItem(NETOBJTYPE_PROJECTILE, m_ID, sizeof(CNetObj_Projectile)));
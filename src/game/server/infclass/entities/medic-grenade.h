@@ -14,6 +14,7 @@ public:
 	virtual void Tick();
 	virtual void TickPaused();
 	virtual void Explode();
+	virtual int GetInterestPositions(vec2 *pPositions);
 	virtual void Snap(int SnappingClient);
 
 private:
@@ -121,11 +121,16 @@ void CScatterGrenade::FillInfo(CNetObj_Projectile *pProj)
 	pProj->m_Type = WEAPON_GRENADE;
 }
 
-void CScatterGrenade::Snap(int SnappingClient)
+int CScatterGrenade::GetInterestPositions(vec2 *pPositions)
 {
 	float Ct = (Server()->Tick()-m_StartTick)/(float)Server()->TickSpeed();
-	
-	if(NetworkClipped(SnappingClient, GetPos(Ct)))
+	pPositions[0] = GetPos(Ct);
+	return 1;
+}
+
+void CScatterGrenade::Snap(int SnappingClient)
+{
+	if(NetworkClipped(SnappingClient))
 		return;
 	
 	CNetObj_Projectile *pProj = static_cast<CNetObj_Projectile *>(Server()->SnapNewItem(NETOBJTYPE_PROJECTILE, m_ID, sizeof(CNetObj_Projectile)));
@@ -14,6 +14,7 @@ public:
 	~CSuperWeaponIndicator() override;
 	
 	virtual void Snap(int SnappingClient);
+	virtual int SnapPriority() const { return CGameWorld::SNAP_PRIORITY_DECORATIVE; }
 	virtual void Tick();
 
 private:
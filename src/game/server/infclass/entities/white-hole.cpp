@@ -88,6 +88,11 @@ void CWhiteHole::StartVisualEffect()
 
 // Draw ParticleEffect
 void CWhiteHole::Snap(int SnappingClient)
+{
+	SnapLod(SnappingClient, 0);
+}
+
+void CWhiteHole::SnapLod(int SnappingClient, int Lod)
 {
 	if(!DoSnapForClient(SnappingClient))
 		return;
@@ -120,6 +125,8 @@ void CWhiteHole::Snap(int SnappingClient)
 	{
 		if(!isDieing && distance(m_ParticlePos[i], m_Pos) > m_Radius)
 			continue; // start animation
+		if(i & ((1<<Lod)-1))
+			continue;
 
 		GameController()->SendHammerDot(m_ParticlePos[i], m_IDs[i]);
 	}
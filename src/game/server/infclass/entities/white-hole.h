@@ -17,6 +17,8 @@ public:
 	virtual ~CWhiteHole();
 	
 	virtual void Snap(int SnappingClient);
+	virtual void SnapLod(int SnappingClient, int Lod);
+	virtual int SnapPriority() const { return CGameWorld::SNAP_PRIORITY_DECORATIVE; }
 	virtual void TickPaused();
 	virtual void Tick();
 
@@ -2501,7 +2501,11 @@ void CInfClassGameController::DoWincheck()
 
 bool CInfClassGameController::IsSpawnable(vec2 Pos, int TeleZoneIndex)
 {
-	//First check if there is a tee too close
+	//First check the map, mostly a single lookup
+	if(!GameServer()->Collision()->IsClear(Pos, TeleZoneIndex))
+		return false;
+
+	//Then if there is a tee too close
 	CCharacter *aEnts[MAX_CLIENTS];
 	int Num = GameServer()->m_World.FindEntities(Pos, 64, (CEntity**)aEnts, MAX_CLIENTS, CGameWorld::ENTTYPE_CHARACTER);
 	
@@ -2511,25 +2515,6 @@ bool CInfClassGameController::IsSpawnable(vec2 Pos, int TeleZoneIndex)
 			return false;
 	}
 	
-	//Check the center
-	int TeleIndex = GameServer()->Collision()->GetZoneValueAt(GameServer()->m_ZoneHandle_icTeleport, Pos);
-	if(GameServer()->Collision()->CheckPoint(Pos))
-		return false;
-	if(TeleZoneIndex && TeleIndex == TeleZoneIndex)
-		return false;
-	
-	//Check the border of the tee. Kind of extrem, but more precise
-	for(int i=0; i<16; i++)
-	{
-		float Angle = i * (2.0f * pi / 16.0f);
-		vec2 CheckPos = Pos + vec2(cos(Angle), sin(Angle)) * 30.0f;
-		TeleIndex = GameServer()->Collision()->GetZoneValueAt(GameServer()->m_ZoneHandle_icTeleport, CheckPos);
-		if(GameServer()->Collision()->CheckPoint(CheckPos))
-			return false;
-		if(TeleZoneIndex && TeleIndex == TeleZoneIndex)
-			return false;
-	}
-	
 	return true;
 }
 
@@ -81,6 +81,13 @@ void CInfClassPlayer::Tick()
 
 	HandleTuningParams();
 
+	int ClanStamp = (m_HumanTime/Server()->TickSpeed())*2 + (Server()->IsClientLogged(m_ClientID) ? 1 : 0);
+	if(ClanStamp != m_ClanStamp)
+	{
+		m_ClanStamp = ClanStamp;
+		InvalidateClientInfo();
+	}
+
 	if(!GameServer()->m_World.m_Paused)
 	{
 		if(m_FollowTargetTicks > 0)
@@ -163,13 +170,8 @@ void CInfClassPlayer::Snap(int SnappingClient)
 	}
 }
 
-void CInfClassPlayer::SnapClientInfo(int SnappingClient, int SnappingClientMappedId)
+void CInfClassPlayer::FillClientInfo(int SnappingClient, CNetObj_ClientInfo *pClientInfo)
 {
-	CNetObj_ClientInfo *pClientInfo = static_cast<CNetObj_ClientInfo *>(Server()->SnapNewItem(NETOBJTYPE_CLIENTINFO, SnappingClientMappedId, sizeof(CNetObj_ClientInfo)));
-
-	if(!pClientInfo)
-		return;
-
 	StrToInts(&pClientInfo->m_Name0, 4, Server()->ClientName(m_ClientID));
 	StrToInts(&pClientInfo->m_Clan0, 3, GetClan(SnappingClient));
 	pClientInfo->m_Country = Server()->ClientCountry(m_ClientID);
@@ -306,6 +308,7 @@ void CInfClassPlayer::SetClass(int newClass)
 	}
 
 	m_class = newClass;
+	InvalidateClientInfo();
 
 	const bool HadHumanClass = GetCharacterClass() && GetCharacterClass()->IsHuman();
 	const bool HadInfectedClass = GetCharacterClass() && GetCharacterClass()->IsZombie();
@@ -332,6 +335,7 @@ void CInfClassPlayer::SetClass(int newClass)
 void CInfClassPlayer::UpdateSkin()
 {
 	m_SkinGetter = m_pInfcPlayerClass ? m_pInfcPlayerClass->SetupSkin(&m_SkinContext) : nullptr;
+	InvalidateClientInfo();
 }
 
 void CInfClassPlayer::Infect(CPlayer *pInfectiousPlayer)
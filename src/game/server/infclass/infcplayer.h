@@ -35,7 +35,6 @@ public:
 
 	void Tick() override;
 	void Snap(int SnappingClient) override;
-	void SnapClientInfo(int SnappingClient, int SnappingClientMappedId) override;
 	int GetDefaultEmote() const override;
 
 	void HandleInfection();
@@ -83,6 +82,7 @@ public:
 
 protected:
 	const char *GetClan(int SnappingClient = -1) const override;
+	void FillClientInfo(int SnappingClient, CNetObj_ClientInfo *pClientInfo) override;
 
 	bool IsForcedToSpectate() const;
 
@@ -112,6 +112,8 @@ protected:
 
 	int m_GhoulLevel = 0;
 	int m_GhoulLevelTick = 0;
+
+	int m_ClanStamp = -1; // the clan shows the login and the human time
 };
 
 inline CInfClassPlayer *CInfClassPlayer::GetInstance(CPlayer *pPlayer)
@@ -47,6 +47,10 @@ void CPlayer::Reset()
 	m_OverrideEmote = 0;
 	m_OverrideEmoteReset = -1;
 
+	m_NumClientInfoCaches = 0;
+	m_NextClientInfoCache = 0;
+	m_ClientInfoRevision = 0;
+
 /* INFECTION MODIFICATION START ***************************************/
 	m_Authed = IServer::AUTHED_NO;
 	m_ScoreMode = PLAYERSCOREMODE_SCORE;
@@ -163,9 +167,10 @@ void CPlayer::PostTick()
 
 void CPlayer::HandleTuningParams()
 {
-	if(!(m_PrevTuningParams == m_NextTuningParams))
+	uint64 Changed = m_PrevTuningParams.Diff(m_NextTuningParams);
+	if(Changed)
 	{
-		if(m_IsReady)
+		if(m_IsReady && (Changed & GameServer()->TuningMask(GetCID())))
 		{
 			GameServer()->SendTuningParams(GetCID(), m_NextTuningParams);
 		}
@@ -266,6 +271,62 @@ void CPlayer::SnapClientInfo(int SnappingClient, int SnappingClientMappedId)
 	if(!pClientInfo)
 		return;
 
+	mem_copy(pClientInfo, CachedClientInfo(SnappingClient), sizeof(CNetObj_ClientInfo));
+}
+
+const CNetObj_ClientInfo *CPlayer::CachedClientInfo(int SnappingClient)
+{
+	IServer::CClientInfo ClientInfo = {0};
+	if(SnappingClient != DemoClientID)
+	{
+		Server()->GetClientInfo(SnappingClient, &ClientInfo);
+	}
+
+	int ScoreMode = PLAYERSCOREMODE_SCORE;
+	if(GameServer()->GetPlayer(SnappingClient))
+	{
+		ScoreMode = GameServer()->m_apPlayers[SnappingClient]->GetScoreMode();
+	}
+
+	CClientInfoCache *pCache = 0;
+	for(int i = 0; i < m_NumClientInfoCaches; i++)
+	{
+		CClientInfoCache *pEntry = &m_aClientInfoCache[i];
+		if(pEntry->m_DDNetVersion == ClientInfo.m_DDNetVersion && pEntry->m_InfClassVersion == ClientInfo.m_InfClassVersion &&
+			pEntry->m_ScoreMode == ScoreMode)
+		{
+			pCache = pEntry;
+			break;
+		}
+	}
+
+	if(!pCache)
+	{
+		// replace the classes in turn once all entries are used
+		if(m_NumClientInfoCaches < NUM_CLIENTINFO_CACHES)
+			pCache = &m_aClientInfoCache[m_NumClientInfoCaches++];
+		else
+		{
+			pCache = &m_aClientInfoCache[m_NextClientInfoCache];
+			m_NextClientInfoCache = (m_NextClientInfoCache+1)%NUM_CLIENTINFO_CACHES;
+		}
+		pCache->m_DDNetVersion = ClientInfo.m_DDNetVersion;
+		pCache->m_InfClassVersion = ClientInfo.m_InfClassVersion;
+		pCache->m_ScoreMode = ScoreMode;
+		pCache->m_Revision = m_ClientInfoRevision-1;
+	}
+
+	if(pCache->m_Revision != m_ClientInfoRevision || pCache->m_ServerRevision != Server()->ClientInfoRevision())
+	{
+		FillClientInfo(SnappingClient, &pCache->m_Info);
+		pCache->m_Revision = m_ClientInfoRevision;
+		pCache->m_ServerRevision = Server()->ClientInfoRevision();
+	}
+	return &pCache->m_Info;
+}
+
+void CPlayer::FillClientInfo(int SnappingClient, CNetObj_ClientInfo *pClientInfo)
+{
 	StrToInts(&pClientInfo->m_Name0, 4, Server()->ClientName(m_ClientID));
 	StrToInts(&pClientInfo->m_Clan0, 3, GetClan(SnappingClient));
 	pClientInfo->m_Country = Server()->ClientCountry(m_ClientID);
@@ -360,6 +421,7 @@ void CPlayer::SetTeam(int Team, bool DoChatMsg)
 	KillCharacter();
 
 	m_Team = Team;
+	InvalidateClientInfo();
 	m_LastActionTick = Server()->Tick();
 	m_LastActionMoveTick = Server()->Tick();
 	m_SpectatorID = SPEC_FREEVIEW;
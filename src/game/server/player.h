@@ -45,6 +45,8 @@ public:
 	void PostTick();
 	virtual void Snap(int SnappingClient);
 	virtual void SnapClientInfo(int SnappingClient, int SnappingClientMappedId);
+	// call when something the client info shows changed
+	void InvalidateClientInfo() { m_ClientInfoRevision++; }
 
 	void OnDirectInput(CNetObj_PlayerInput *NewInput);
 	void OnPredictedInput(CNetObj_PlayerInput *NewInput);
@@ -125,12 +127,36 @@ protected:
 	IServer *Server() const;
 
 	virtual const char *GetClan(int SnappingClient = -1) const;
+	virtual void FillClientInfo(int SnappingClient, CNetObj_ClientInfo *pClientInfo);
+	const CNetObj_ClientInfo *CachedClientInfo(int SnappingClient);
 
 	//
 	bool m_Spawning;
 	int m_ClientID;
 	int m_Team;
 
+private:
+	enum
+	{
+		NUM_CLIENTINFO_CACHES = 4,
+	};
+
+	// the client info encoded for a class of viewers, which differ by
+	// their client versions and score modes
+	struct CClientInfoCache
+	{
+		int m_DDNetVersion;
+		int m_InfClassVersion;
+		int m_ScoreMode;
+		int m_Revision;
+		int m_ServerRevision;
+		CNetObj_ClientInfo m_Info;
+	};
+	CClientInfoCache m_aClientInfoCache[NUM_CLIENTINFO_CACHES];
+	int m_NumClientInfoCaches;
+	int m_NextClientInfoCache;
+	int m_ClientInfoRevision;
+
 /* IMPORT FROM DDNET */
 protected:
 	int m_DefEmote;
@@ -1,20 +1,76 @@
 #ifndef INFCLASSR_GEOLOCATION_H
 #define INFCLASSR_GEOLOCATION_H
 
-#include <infclassr/GeoLite2PP/GeoLite2PP.hpp>
+#include <base/system.h>
+
+#include <engine/shared/jobs.h>
+
+#include <atomic>
+#include <memory>
+
+/*
+	The geolocation table is compiled from the GeoLite2 country database by
+	geo_compile at build time. It is a sorted list of range starts per address
+	family, each range lasts until the next start. All integers are big endian:
+
+		char[8]  magic "infcgeo"
+		uint32   version
+		uint32   number of IPv4 ranges
+		uint32   number of IPv6 ranges
+		IPv4 range starts, 4 bytes each
+		IPv4 countries, int16 ISO 3166 numeric code each, -1 for unknown
+		IPv6 range starts, 16 bytes each
+		IPv6 countries, int16 each
+
+	The first range of each family starts at the lowest address. IPv4 mapped
+	and 6to4 IPv6 addresses are looked up in the IPv4 ranges.
+*/
+class CGeolocation
+{
+public:
+	enum
+	{
+		VERSION = 1,
+		HEADER_SIZE = 20,
+	};
+	static const char ms_aMagic[8];
 
-class Geolocation {
 private:
-	GeoLite2PP::DB *db;
-	int get_iso_numeric_code(GeoLite2PP::MStr& m);
-	Geolocation(const char* path_to_mmdb);
-	~Geolocation();
+	void *m_pData;
+	unsigned m_DataSize;
+	int m_aNumRanges[2];
+	const unsigned char *m_apStarts[2];
+	const unsigned char *m_apCountries[2];
+
+	int Find(int Family, const unsigned char *pAddr) const;
 
 public:
-	static bool Initialize(const char *pPathToDB);
+	CGeolocation();
+	~CGeolocation();
+
+	bool Load(const char *pFilename);
+	int NumRanges() const { return m_aNumRanges[0] + m_aNumRanges[1]; }
+
+	// returns the ISO 3166 numeric country code or -1, allocation free
+	int Lookup(const NETADDR *pAddr) const;
+
+	static bool Initialize(const char *pPathToTable);
 	static void Shutdown();
+	static std::shared_ptr<const CGeolocation> Instance();
+};
 
-	static int get_country_iso_numeric_code(std::string& ip);
+// resolves the country of one client on the job pool
+class CGeolocationJob : public IJob
+{
+	std::shared_ptr<const CGeolocation> m_pGeolocation;
+	NETADDR m_Addr;
+	std::atomic<int> m_Country;
+
+	void Run();
+
+public:
+	CGeolocationJob(std::shared_ptr<const CGeolocation> pGeolocation, const NETADDR *pAddr);
+	int Country() const { return m_Country; }
 };
 
 #endif
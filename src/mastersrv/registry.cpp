@@ -0,0 +1,380 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+
+#include "registry.h"
+
+CAddrMap::CAddrMap() :
+	m_Num(0)
+{
+}
+
+unsigned CAddrMap::Hash(const NETADDR *pAddr)
+{
+	// FNV-1a over the parts net_addr_comp looks at
+	unsigned Hash = 2166136261u ^ pAddr->type;
+	for(int i = 0; i < 16; i++)
+		Hash = (Hash ^ pAddr->ip[i]) * 16777619u;
+	Hash = (Hash ^ (pAddr->port & 0xff)) * 16777619u;
+	Hash = (Hash ^ (pAddr->port >> 8)) * 16777619u;
+	return Hash;
+}
+
+void CAddrMap::Grow()
+{
+	std::vector<CSlot> vOld;
+	vOld.swap(m_vSlots);
+	CSlot Empty;
+	mem_zero(&Empty.m_Addr, sizeof(Empty.m_Addr));
+	Empty.m_Value = -1;
+	m_vSlots.assign(vOld.empty() ? 64 : vOld.size() * 2, Empty);
+	m_Num = 0;
+	for(unsigned i = 0; i < vOld.size(); i++)
+	{
+		if(vOld[i].m_Value >= 0)
+			Set(&vOld[i].m_Addr, vOld[i].m_Value);
+	}
+}
+
+int CAddrMap::Find(const NETADDR *pAddr) const
+{
+	if(m_vSlots.empty())
+		return -1;
+	unsigned Mask = m_vSlots.size() - 1;
+	for(unsigned i = Hash(pAddr) & Mask; m_vSlots[i].m_Value >= 0; i = (i + 1) & Mask)
+	{
+		if(net_addr_comp(&m_vSlots[i].m_Addr, pAddr) == 0)
+			return m_vSlots[i].m_Value;
+	}
+	return -1;
+}
+
+void CAddrMap::Set(const NETADDR *pAddr, int Value)
+{
+	if((m_Num + 1) * 2 > (int)m_vSlots.size())
+		Grow();
+	unsigned Mask = m_vSlots.size() - 1;
+	unsigned i = Hash(pAddr) & Mask;
+	for(; m_vSlots[i].m_Value >= 0; i = (i + 1) & Mask)
+	{
+		if(net_addr_comp(&m_vSlots[i].m_Addr, pAddr) == 0)
+		{
+			m_vSlots[i].m_Value = Value;
+			return;
+		}
+	}
+	m_vSlots[i].m_Addr = *pAddr;
+	m_vSlots[i].m_Value = Value;
+	m_Num++;
+}
+
+void CAddrMap::Remove(const NETADDR *pAddr)
+{
+	if(m_vSlots.empty())
+		return;
+	unsigned Mask = m_vSlots.size() - 1;
+	unsigned i = Hash(pAddr) & Mask;
+	for(; m_vSlots[i].m_Value >= 0; i = (i + 1) & Mask)
+	{
+		if(net_addr_comp(&m_vSlots[i].m_Addr, pAddr) == 0)
+			break;
+	}
+	if(m_vSlots[i].m_Value < 0)
+		return;
+
+	// shift the following entries back instead of leaving a tombstone
+	m_vSlots[i].m_Value = -1;
+	m_Num--;
+	for(unsigned j = (i + 1) & Mask; m_vSlots[j].m_Value >= 0; j = (j + 1) & Mask)
+	{
+		unsigned Home = Hash(&m_vSlots[j].m_Addr) & Mask;
+		bool Stays = i <= j ? (i < Home && Home <= j) : (i < Home || Home <= j);
+		if(Stays)
+			continue;
+		m_vSlots[i] = m_vSlots[j];
+		m_vSlots[j].m_Value = -1;
+		i = j;
+	}
+}
+
+CServerRegistry::CServerRegistry()
+{
+	mem_copy(m_aCountPackets[SERVERTYPE_NORMAL].m_aHeader, SERVERBROWSE_COUNT, sizeof(SERVERBROWSE_COUNT));
+	mem_copy(m_aCountPackets[SERVERTYPE_LEGACY].m_aHeader, SERVERBROWSE_COUNT_LEGACY, sizeof(SERVERBROWSE_COUNT_LEGACY));
+	UpdateCount();
+}
+
+void CServerRegistry::HeapSwap(int a, int b)
+{
+	int Tmp = m_vHeap[a];
+	m_vHeap[a] = m_vHeap[b];
+	m_vHeap[b] = Tmp;
+	m_vServers[m_vHeap[a]].m_HeapIndex = a;
+	m_vServers[m_vHeap[b]].m_HeapIndex = b;
+}
+
+void CServerRegistry::HeapUp(int Index)
+{
+	while(Index > 0 && HeapLess(Index, (Index - 1) / 2))
+	{
+		HeapSwap(Index, (Index - 1) / 2);
+		Index = (Index - 1) / 2;
+	}
+}
+
+void CServerRegistry::HeapDown(int Index)
+{
+	int Num = m_vHeap.size();
+	while(1)
+	{
+		int Smallest = Index;
+		int Left = Index * 2 + 1;
+		int Right = Left + 1;
+		if(Left < Num && HeapLess(Left, Smallest))
+			Smallest = Left;
+		if(Right < Num && HeapLess(Right, Smallest))
+			Smallest = Right;
+		if(Smallest == Index)
+			return;
+		HeapSwap(Index, Smallest);
+		Index = Smallest;
+	}
+}
+
+void CServerRegistry::HeapRemove(int Index)
+{
+	int Last = m_vHeap.size() - 1;
+	if(Index != Last)
+		HeapSwap(Index, Last);
+	m_vHeap.pop_back();
+	if(Index < Last)
+	{
+		HeapUp(Index);
+		HeapDown(Index);
+	}
+}
+
+void CServerRegistry::WriteSlot(int Type, int Slot)
+{
+	const NETADDR *pAddr = &m_vServers[m_avSlots[Type][Slot]].m_Address;
+	if(Type == SERVERTYPE_NORMAL)
+	{
+		CMastersrvAddr *pOut = &m_vPackets[Slot / MAX_SERVERS_PER_PACKET].m_aServers[Slot % MAX_SERVERS_PER_PACKET];
+		if(pAddr->type == NETTYPE_IPV6)
+		{
+			mem_copy(pOut->m_aIp, pAddr->ip, sizeof(pOut->m_aIp));
+		}
+		else
+		{
+			static const unsigned char s_aIPV4Mapping[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF};
+
+			mem_copy(pOut->m_aIp, s_aIPV4Mapping, sizeof(s_aIPV4Mapping));
+			mem_copy(pOut->m_aIp + 12, pAddr->ip, 4);
+		}
+		pOut->m_aPort[0] = (pAddr->port >> 8) & 0xff;
+		pOut->m_aPort[1] = pAddr->port & 0xff;
+	}
+	else
+	{
+		CMastersrvAddrLegacy *pOut = &m_vPacketsLegacy[Slot / MAX_SERVERS_PER_PACKET].m_aServers[Slot % MAX_SERVERS_PER_PACKET];
+		mem_copy(pOut->m_aIp, pAddr->ip, sizeof(pOut->m_aIp));
+		// 0.5 has the port in little endian on the network
+		pOut->m_aPort[0] = pAddr->port & 0xff;
+		pOut->m_aPort[1] = (pAddr->port >> 8) & 0xff;
+	}
+}
+
+void CServerRegistry::AddSlot(int ServerIndex)
+{
+	int Type = m_vServers[ServerIndex].m_Type;
+	int Slot = m_avSlots[Type].size();
+	m_avSlots[Type].push_back(ServerIndex);
+	m_vServers[ServerIndex].m_Slot = Slot;
+
+	if(Slot % MAX_SERVERS_PER_PACKET == 0)
+	{
+		if(Type == SERVERTYPE_NORMAL)
+		{
+			m_vPackets.resize(m_vPackets.size() + 1);
+			mem_copy(m_vPackets.back().m_aHeader, SERVERBROWSE_LIST, sizeof(SERVERBROWSE_LIST));
+		}
+		else
+		{
+			m_vPacketsLegacy.resize(m_vPacketsLegacy.size() + 1);
+			mem_copy(m_vPacketsLegacy.back().m_aHeader, SERVERBROWSE_LIST_LEGACY, sizeof(SERVERBROWSE_LIST_LEGACY));
+		}
+	}
+	WriteSlot(Type, Slot);
+}
+
+void CServerRegistry::RemoveSlot(int ServerIndex)
+{
+	int Type = m_vServers[ServerIndex].m_Type;
+	int Slot = m_vServers[ServerIndex].m_Slot;
+	int Last = m_avSlots[Type].size() - 1;
+	if(Slot != Last)
+	{
+		m_avSlots[Type][Slot] = m_avSlots[Type][Last];
+		m_vServers[m_avSlots[Type][Slot]].m_Slot = Slot;
+		WriteSlot(Type, Slot);
+	}
+	m_avSlots[Type].pop_back();
+
+	if(Last % MAX_SERVERS_PER_PACKET == 0)
+	{
+		if(Type == SERVERTYPE_NORMAL)
+			m_vPackets.pop_back();
+		else
+			m_vPacketsLegacy.pop_back();
+	}
+}
+
+void CServerRegistry::RemoveServer(int ServerIndex)
+{
+	RemoveSlot(ServerIndex);
+	HeapRemove(m_vServers[ServerIndex].m_HeapIndex);
+	m_Index.Remove(&m_vServers[ServerIndex].m_Address);
+
+	// move the last server into the gap
+	int Last = m_vServers.size() - 1;
+	if(ServerIndex != Last)
+	{
+		CServerEntry *pMoved = &m_vServers[ServerIndex];
+		*pMoved = m_vServers[Last];
+		m_Index.Set(&pMoved->m_Address, ServerIndex);
+		m_vHeap[pMoved->m_HeapIndex] = ServerIndex;
+		m_avSlots[pMoved->m_Type][pMoved->m_Slot] = ServerIndex;
+	}
+	m_vServers.pop_back();
+}
+
+void CServerRegistry::UpdateCount()
+{
+	int Num = NumServers();
+	for(int i = 0; i < NUM_TYPES; i++)
+	{
+		m_aCountPackets[i].m_High = (Num >> 8) & 0xff;
+		m_aCountPackets[i].m_Low = Num & 0xff;
+	}
+}
+
+int CServerRegistry::Add(const NETADDR *pAddr, ServerType Type, int64 Expire)
+{
+	if(Type != SERVERTYPE_NORMAL && Type != SERVERTYPE_LEGACY)
+		return ADD_INVALID;
+
+	int Index = m_Index.Find(pAddr);
+	if(Index >= 0)
+	{
+		CServerEntry *pServer = &m_vServers[Index];
+		pServer->m_Expire = Expire;
+		HeapUp(pServer->m_HeapIndex);
+		HeapDown(pServer->m_HeapIndex);
+		return ADD_UPDATED;
+	}
+
+	if(NumServers() >= MAX_SERVERS)
+		return ADD_FULL;
+
+	Index = m_vServers.size();
+	m_vServers.resize(Index + 1);
+	CServerEntry *pServer = &m_vServers[Index];
+	pServer->m_Address = *pAddr;
+	pServer->m_Type = Type;
+	pServer->m_Expire = Expire;
+	pServer->m_HeapIndex = m_vHeap.size();
+	m_vHeap.push_back(Index);
+	HeapUp(pServer->m_HeapIndex);
+	m_Index.Set(pAddr, Index);
+	AddSlot(Index);
+	UpdateCount();
+	return ADD_NEW;
+}
+
+int CServerRegistry::Purge(int64 Now, FExpired pfnExpired, void *pUser)
+{
+	int NumExpired = 0;
+	while(!m_vHeap.empty() && m_vServers[m_vHeap[0]].m_Expire < Now)
+	{
+		int Index = m_vHeap[0];
+		if(pfnExpired)
+			pfnExpired(&m_vServers[Index].m_Address, pUser);
+		RemoveServer(Index);
+		NumExpired++;
+	}
+	if(NumExpired)
+		UpdateCount();
+	return NumExpired;
+}
+
+int CServerRegistry::NumPackets(ServerType Type) const
+{
+	if(Type == SERVERTYPE_NORMAL)
+		return m_vPackets.size();
+	if(Type == SERVERTYPE_LEGACY)
+		return m_vPacketsLegacy.size();
+	return 0;
+}
+
+const void *CServerRegistry::GetPacket(ServerType Type, int Index, int *pSize) const
+{
+	int NumInPacket = minimum((int)m_avSlots[Type].size() - Index * MAX_SERVERS_PER_PACKET, (int)MAX_SERVERS_PER_PACKET);
+	if(Type == SERVERTYPE_NORMAL)
+	{
+		*pSize = sizeof(SERVERBROWSE_LIST) + sizeof(CMastersrvAddr) * NumInPacket;
+		return &m_vPackets[Index];
+	}
+	*pSize = sizeof(SERVERBROWSE_LIST_LEGACY) + sizeof(CMastersrvAddrLegacy) * NumInPacket;
+	return &m_vPacketsLegacy[Index];
+}
+
+const void *CServerRegistry::GetCountPacket(ServerType Type, int *pSize) const
+{
+	*pSize = sizeof(CCountPacketData);
+	return &m_aCountPackets[Type];
+}
+
+void CCheckRegistry::Unindex(int Index)
+{
+	const CCheckServer *pServer = &m_vServers[Index];
+	if(m_Index.Find(&pServer->m_Address) == Index)
+		m_Index.Remove(&pServer->m_Address);
+	if(m_Index.Find(&pServer->m_AltAddress) == Index)
+		m_Index.Remove(&pServer->m_AltAddress);
+}
+
+bool CCheckRegistry::Add(const NETADDR *pAddr, const NETADDR *pAltAddr, ServerType Type)
+{
+	if(Find(pAddr) >= 0)
+		return true;
+	if(Num() >= CServerRegistry::MAX_SERVERS)
+		return false;
+
+	int Index = m_vServers.size();
+	m_vServers.resize(Index + 1);
+	CCheckServer *pServer = &m_vServers[Index];
+	pServer->m_Address = *pAddr;
+	pServer->m_AltAddress = *pAltAddr;
+	pServer->m_TryCount = 0;
+	pServer->m_TryTime = 0;
+	pServer->m_Type = Type;
+	m_Index.Set(pAddr, Index);
+	if(m_Index.Find(pAltAddr) < 0)
+		m_Index.Set(pAltAddr, Index);
+	return true;
+}
+
+void CCheckRegistry::Remove(int Index)
+{
+	Unindex(Index);
+	int Last = m_vServers.size() - 1;
+	if(Index != Last)
+	{
+		Unindex(Last);
+		m_vServers[Index] = m_vServers[Last];
+		m_Index.Set(&m_vServers[Index].m_Address, Index);
+		if(m_Index.Find(&m_vServers[Index].m_AltAddress) < 0)
+			m_Index.Set(&m_vServers[Index].m_AltAddress, Index);
+	}
+	m_vServers.pop_back();
+}
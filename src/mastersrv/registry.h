@@ -0,0 +1,159 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef MASTERSRV_REGISTRY_H
+#define MASTERSRV_REGISTRY_H
+
+#include <base/system.h>
+
+#include <vector>
+
+#include "mastersrv.h"
+
+// open addressing hash table from addresses to indices
+class CAddrMap
+{
+	struct CSlot
+	{
+		NETADDR m_Addr;
+		int m_Value; // -1 if the slot is empty
+	};
+
+	std::vector<CSlot> m_vSlots;
+	int m_Num;
+
+	static unsigned Hash(const NETADDR *pAddr);
+	void Grow();
+
+public:
+	CAddrMap();
+
+	int Find(const NETADDR *pAddr) const;
+	void Set(const NETADDR *pAddr, int Value);
+	void Remove(const NETADDR *pAddr);
+};
+
+/*
+	Class: CServerRegistry
+		The registered servers, indexed by address, ordered by expiry in a
+		min-heap. The list and count packets are kept up to date on every
+		change, so serving a request is a plain send of prebuilt packets.
+		Servers of one type fill the packets densely, removing a server
+		moves the last one of its type into its place.
+*/
+class CServerRegistry
+{
+public:
+	enum
+	{
+		MAX_SERVERS_PER_PACKET = 75,
+		MAX_SERVERS = 0xffff, // the count packet has 16 bits
+		NUM_TYPES = 2,
+
+		ADD_NEW = 0,
+		ADD_UPDATED,
+		ADD_FULL,
+		ADD_INVALID,
+	};
+
+	typedef void (*FExpired)(const NETADDR *pAddr, void *pUser);
+
+private:
+	struct CServerEntry
+	{
+		NETADDR m_Address;
+		int m_Type;
+		int64 m_Expire;
+		int m_HeapIndex;
+		int m_Slot; // position in the packets of its type
+	};
+
+	struct CPacketData
+	{
+		unsigned char m_aHeader[sizeof(SERVERBROWSE_LIST)];
+		CMastersrvAddr m_aServers[MAX_SERVERS_PER_PACKET];
+	};
+
+	struct CPacketDataLegacy
+	{
+		unsigned char m_aHeader[sizeof(SERVERBROWSE_LIST_LEGACY)];
+		CMastersrvAddrLegacy m_aServers[MAX_SERVERS_PER_PACKET];
+	};
+
+	struct CCountPacketData
+	{
+		unsigned char m_aHeader[sizeof(SERVERBROWSE_COUNT)];
+		unsigned char m_High;
+		unsigned char m_Low;
+	};
+
+	std::vector<CServerEntry> m_vServers;
+	CAddrMap m_Index;
+	std::vector<int> m_vHeap;
+
+	// server indices by slot
+	std::vector<int> m_avSlots[NUM_TYPES];
+	std::vector<CPacketData> m_vPackets;
+	std::vector<CPacketDataLegacy> m_vPacketsLegacy;
+	CCountPacketData m_aCountPackets[NUM_TYPES];
+
+	bool HeapLess(int a, int b) const { return m_vServers[m_vHeap[a]].m_Expire < m_vServers[m_vHeap[b]].m_Expire; }
+	void HeapSwap(int a, int b);
+	void HeapUp(int Index);
+	void HeapDown(int Index);
+	void HeapRemove(int Index);
+
+	void WriteSlot(int Type, int Slot);
+	void AddSlot(int ServerIndex);
+	void RemoveSlot(int ServerIndex);
+	void RemoveServer(int ServerIndex);
+	void UpdateCount();
+
+public:
+	CServerRegistry();
+
+	// adds the server or moves its expiry
+	int Add(const NETADDR *pAddr, ServerType Type, int64 Expire);
+	// removes all servers that expired before Now, returns their number
+	int Purge(int64 Now, FExpired pfnExpired, void *pUser);
+	int NumServers() const { return m_vServers.size(); }
+
+	int NumPackets(ServerType Type) const;
+	const void *GetPacket(ServerType Type, int Index, int *pSize) const;
+	const void *GetCountPacket(ServerType Type, int *pSize) const;
+};
+
+/*
+	Class: CCheckRegistry
+		The servers whose reachability is being checked, indexed by their
+		address and their alternative address.
+*/
+class CCheckRegistry
+{
+public:
+	struct CCheckServer
+	{
+		ServerType m_Type;
+		NETADDR m_Address;
+		NETADDR m_AltAddress;
+		int m_TryCount;
+		int64 m_TryTime;
+	};
+
+private:
+	std::vector<CCheckServer> m_vServers;
+	CAddrMap m_Index;
+
+	void Unindex(int Index);
+
+public:
+	// returns false if the registry is full, servers that are checked already are kept
+	bool Add(const NETADDR *pAddr, const NETADDR *pAltAddr, ServerType Type);
+	// finds the server by either of its addresses, -1 if unknown
+	int Find(const NETADDR *pAddr) const { return m_Index.Find(pAddr); }
+	void Remove(int Index);
+
+	int Num() const { return m_vServers.size(); }
+	CCheckServer *Get(int Index) { return &m_vServers[Index]; }
+};
+
+#endif
@@ -0,0 +1,307 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/config.h>
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+
+#include <game/collision.h>
+#include <game/gamecore.h>
+#include <game/layers.h>
+#include <game/mapitems.h>
+
+#include <string>
+#include <vector>
+
+/*
+	core_equiv runs the same players twice on a map: once with the
+	character broadphase of CWorldCore and once with the full scan it
+	replaced. After every tick it checks that both worlds are
+	bit-identical. The inputs come from a fixed seed and aim at nearby
+	players, so hooks, pushes, taxis and respawns happen all the time.
+	Without arguments it runs over all maps in the maps directory.
+*/
+
+enum
+{
+	NUM_TICKS = SERVER_TICK_SPEED * 120,
+	SEED = 1,
+};
+
+struct CWorld
+{
+	CWorldCore m_Core;
+	CCharacterCore m_aCharacters[MAX_CLIENTS];
+};
+
+static unsigned s_RandomState;
+
+static int Random(int Min, int Max)
+{
+	s_RandomState ^= s_RandomState << 13;
+	s_RandomState ^= s_RandomState >> 17;
+	s_RandomState ^= s_RandomState << 5;
+	return Min + (int)(s_RandomState % (unsigned)(Max - Min + 1));
+}
+
+static int ListMapCallback(const char *pName, int IsDir, int DirType, void *pUser)
+{
+	std::vector<std::string> *pvMaps = (std::vector<std::string> *)pUser;
+	int Length = str_length(pName);
+	if(!IsDir && Length > 4 && str_comp(pName + Length - 4, ".map") == 0)
+		pvMaps->push_back(std::string(pName, Length - 4));
+	return 0;
+}
+
+static void GetSpawnPoints(CLayers *pLayers, std::vector<vec2> *pvSpawnPoints)
+{
+	const CMapItemGroup *pGroup = pLayers->EntityGroup();
+	if(!pGroup)
+		return;
+
+	char aLayerName[12];
+	for(int l = 0; l < pGroup->m_NumLayers; l++)
+	{
+		CMapItemLayer *pLayer = pLayers->GetLayer(pGroup->m_StartLayer + l);
+		if(pLayer->m_Type != LAYERTYPE_QUADS)
+			continue;
+		CMapItemLayerQuads *pQLayer = (CMapItemLayerQuads *)pLayer;
+		IntsToStr(pQLayer->m_aName, sizeof(aLayerName) / sizeof(int), aLayerName);
+		if(str_comp(aLayerName, "icInfected") != 0 && str_comp(aLayerName, "icHuman") != 0)
+			continue;
+
+		const CQuad *pQuads = (const CQuad *)pLayers->Map()->GetDataSwapped(pQLayer->m_Data);
+		for(int q = 0; q < pQLayer->m_NumQuads; q++)
+		{
+			vec2 Pos(0.0f, 0.0f);
+			for(int p = 0; p < 4; p++)
+				Pos += vec2(fx2f(pQuads[q].m_aPoints[p].x), fx2f(pQuads[q].m_aPoints[p].y));
+			pvSpawnPoints->push_back(Pos / 4.0f);
+		}
+	}
+}
+
+static void Spawn(CWorld *pWorld, CCollision *pCollision, int ClientID, vec2 Pos, bool Infected, bool HookProtected)
+{
+	CCharacterCore *pCore = &pWorld->m_aCharacters[ClientID];
+	pCore->Init(&pWorld->m_Core, pCollision);
+	pCore->m_Pos = Pos;
+	pCore->m_Infected = Infected;
+	pCore->m_HookProtected = HookProtected;
+	pCore->m_InLove = false;
+	pWorld->m_Core.SetCharacter(ClientID, pCore);
+}
+
+// like CInfClassCharacter::Die, a dead taxi or passenger leaves the taxi
+static void Kill(CWorld *pWorld, int ClientID)
+{
+	CCharacterCore *pCore = &pWorld->m_aCharacters[ClientID];
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(pWorld->m_Core.m_apCharacters[i] && pWorld->m_Core.m_apCharacters[i]->m_Passenger == pCore)
+			pWorld->m_Core.m_apCharacters[i]->SetPassenger(nullptr);
+	}
+	pCore->SetPassenger(nullptr);
+	pWorld->m_Core.SetCharacter(ClientID, nullptr);
+}
+
+// same order as CGameWorld::Tick: all CCharacter::Tick, then all TickDefered
+static void Step(CWorld *pWorld, const CNetObj_PlayerInput *pInputs)
+{
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		CCharacterCore *pCore = pWorld->m_Core.m_apCharacters[i];
+		if(!pCore)
+			continue;
+		CCharacterCore::CParams Params(&pWorld->m_Core.m_Tuning);
+		Params.m_HookMode = i % 8 == 0;
+		pCore->m_Input = pInputs[i];
+		pCore->Tick(true, &Params);
+	}
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		CCharacterCore *pCore = pWorld->m_Core.m_apCharacters[i];
+		if(!pCore)
+			continue;
+		CCharacterCore::CParams Params(&pWorld->m_Core.m_Tuning);
+		pCore->Move(&Params);
+		pCore->Quantize();
+	}
+}
+
+static int PassengerOf(CWorld *pWorld, const CCharacterCore *pCore)
+{
+	return pCore->m_Passenger ? (int)(pCore->m_Passenger - pWorld->m_aCharacters) : -1;
+}
+
+static bool Compare(CWorld *pWorld, CWorld *pReference, int ClientID)
+{
+	CCharacterCore *pCore = pWorld->m_Core.m_apCharacters[ClientID];
+	CCharacterCore *pRefCore = pReference->m_Core.m_apCharacters[ClientID];
+	if(!pCore || !pRefCore)
+		return !pCore && !pRefCore;
+
+	CNetObj_CharacterCore Core;
+	CNetObj_CharacterCore RefCore;
+	mem_zero(&Core, sizeof(Core));
+	mem_zero(&RefCore, sizeof(RefCore));
+	pCore->Write(&Core);
+	pRefCore->Write(&RefCore);
+	return mem_comp(&Core, &RefCore, sizeof(Core)) == 0 &&
+		pCore->m_TriggeredEvents == pRefCore->m_TriggeredEvents &&
+		pCore->m_IsPassenger == pRefCore->m_IsPassenger &&
+		pCore->m_ProbablyStucked == pRefCore->m_ProbablyStucked &&
+		PassengerOf(pWorld, pCore) == PassengerOf(pReference, pRefCore);
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+
+	IKernel *pKernel = IKernel::Create();
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_BASIC, 1, argv);
+	IConfig *pConfig = CreateConfig();
+	IEngineMap *pEngineMap = CreateEngineMap();
+	if(!pStorage || !pKernel->RegisterInterface(pStorage) || !pKernel->RegisterInterface(pConfig) ||
+		!pKernel->RegisterInterface(static_cast<IEngineMap *>(pEngineMap)) || !pKernel->RegisterInterface(static_cast<IMap *>(pEngineMap)))
+		return -1;
+	pConfig->Init();
+
+	std::vector<std::string> vMaps;
+	for(int i = 1; i < argc; i++)
+		vMaps.push_back(argv[i]);
+	if(vMaps.empty())
+		pStorage->ListDirectory(IStorage::TYPE_ALL, "maps", ListMapCallback, &vMaps);
+
+	int64 TotalTicks = 0;
+	double TotalBroadphaseTime = 0.0;
+	double TotalFullScanTime = 0.0;
+	for(unsigned m = 0; m < vMaps.size(); m++)
+	{
+		char aFilename[IO_MAX_PATH_LENGTH];
+		str_format(aFilename, sizeof(aFilename), "maps/%s.map", vMaps[m].c_str());
+		if(!pEngineMap->Load(aFilename))
+		{
+			dbg_msg("core_equiv", "failed to load '%s'", aFilename);
+			return -1;
+		}
+
+		CLayers Layers;
+		Layers.Init(pKernel);
+		CCollision Collision;
+		Collision.Init(&Layers);
+
+		std::vector<vec2> vSpawnPoints;
+		GetSpawnPoints(&Layers, &vSpawnPoints);
+		if(vSpawnPoints.empty())
+		{
+			dbg_msg("core_equiv", "%-28s no spawn points, skipped", vMaps[m].c_str());
+			pEngineMap->Unload();
+			continue;
+		}
+
+		CWorld *pWorld = new CWorld;
+		CWorld *pReference = new CWorld;
+		pReference->m_Core.m_UseBroadphase = false;
+
+		s_RandomState = SEED * 2654435761u;
+		CNetObj_PlayerInput aInputs[MAX_CLIENTS];
+		mem_zero(aInputs, sizeof(aInputs));
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			// crowd the spawn points, that is where players meet the most
+			vec2 Pos = vSpawnPoints[Random(0, vSpawnPoints.size() - 1)] + vec2(Random(-32, 32), Random(-32, 32));
+			bool Infected = Random(0, 1);
+			bool HookProtected = Random(0, 3) == 0;
+			Spawn(pWorld, &Collision, i, Pos, Infected, HookProtected);
+			Spawn(pReference, &Collision, i, Pos, Infected, HookProtected);
+			aInputs[i].m_TargetX = 1;
+		}
+
+		int PlayerHooks = 0;
+		int Passengers = 0;
+		int Respawns = 0;
+		double BroadphaseTime = 0.0;
+		double FullScanTime = 0.0;
+		for(int Tick = 0; Tick < NUM_TICKS; Tick++)
+		{
+			for(int i = 0; i < MAX_CLIENTS; i++)
+			{
+				if(Random(0, 999) == 0)
+				{
+					vec2 Pos = vSpawnPoints[Random(0, vSpawnPoints.size() - 1)];
+					bool Infected = Random(0, 1);
+					Kill(pWorld, i);
+					Kill(pReference, i);
+					Spawn(pWorld, &Collision, i, Pos, Infected, false);
+					Spawn(pReference, &Collision, i, Pos, Infected, false);
+					Respawns++;
+				}
+
+				CNetObj_PlayerInput *pInput = &aInputs[i];
+				if(Random(0, 24) == 0)
+					pInput->m_Direction = Random(-1, 1);
+				if(Random(0, 9) == 0)
+				{
+					const CCharacterCore *pTarget = pWorld->m_Core.m_apCharacters[Random(0, MAX_CLIENTS - 1)];
+					vec2 Target = pTarget ? pTarget->m_Pos - pWorld->m_aCharacters[i].m_Pos : vec2(0.0f, 0.0f);
+					pInput->m_TargetX = (int)Target.x + Random(-8, 8);
+					pInput->m_TargetY = (int)Target.y + Random(-8, 8);
+					if(!pInput->m_TargetX && !pInput->m_TargetY)
+						pInput->m_TargetY = -1;
+				}
+				pInput->m_Jump = Random(0, 15) == 0;
+				if(Random(0, 3) == 0)
+					pInput->m_Hook = !pInput->m_Hook;
+			}
+
+			int64 Start = time_get_impl();
+			Step(pWorld, aInputs);
+			BroadphaseTime += (time_get_impl() - Start) / (double)time_freq();
+			Start = time_get_impl();
+			Step(pReference, aInputs);
+			FullScanTime += (time_get_impl() - Start) / (double)time_freq();
+
+			for(int i = 0; i < MAX_CLIENTS; i++)
+			{
+				if(!Compare(pWorld, pReference, i))
+				{
+					dbg_msg("core_equiv", "error: %s differs at tick %d, client %d", aFilename, Tick, i);
+					return 1;
+				}
+
+				const CCharacterCore *pCore = pWorld->m_Core.m_apCharacters[i];
+				if(pCore && pCore->m_HookedPlayer >= 0)
+					PlayerHooks++;
+				if(pCore && pCore->m_IsPassenger)
+					Passengers++;
+			}
+		}
+
+		dbg_msg("core_equiv", "%-28s %5d ticks, %6d player hooks, %6d passengers, %4d respawns, broadphase %7.3f ms, full scan %7.3f ms",
+			vMaps[m].c_str(), (int)NUM_TICKS, PlayerHooks, Passengers, Respawns, BroadphaseTime * 1000.0, FullScanTime * 1000.0);
+		TotalTicks += NUM_TICKS;
+		TotalBroadphaseTime += BroadphaseTime;
+		TotalFullScanTime += FullScanTime;
+		delete pWorld;
+		delete pReference;
+		pEngineMap->Unload();
+	}
+
+	if(TotalTicks)
+	{
+		dbg_msg("core_equiv", "%d maps, %lld ticks identical, broadphase %.1f us/tick, full scan %.1f us/tick", (int)vMaps.size(), (long long)TotalTicks,
+			TotalBroadphaseTime * 1e6 / TotalTicks, TotalFullScanTime * 1e6 / TotalTicks);
+	}
+
+	delete pEngineMap;
+	delete pConfig;
+	delete pStorage;
+	delete pKernel;
+	return 0;
+}
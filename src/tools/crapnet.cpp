@@ -1,5 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
 
 #include <cstdlib>
@@ -41,21 +42,31 @@ static int m_ConfigNumpingconfs = sizeof(m_aConfigPings)/sizeof(CPingConfig);
 static int m_ConfigInterval = 10; // seconds between different pingconfigs
 static int m_ConfigLog = 0;
 static int m_ConfigReorder = 0;
+static int m_ConfigWarmup = 0; // seconds of a clean link at the start
 
 void Run(int Port, NETADDR Dest)
 {
-	NETADDR Src = {NETTYPE_IPV4, {0,0,0,0}, Port};
+	NETADDR Src;
+	mem_zero(&Src, sizeof(Src));
+	Src.type = NETTYPE_IPV4;
+	Src.port = Port;
 	NETSOCKET Socket = net_udp_create(Src);
 
 	char aBuffer[1024*2];
 	int ID = 0;
 	int Delaycounter = 0;
+	int64 WarmupEnd = time_get() + time_freq()*m_ConfigWarmup;
 
 	while(1)
 	{
 		static int Lastcfg = 0;
 		int n = ((time_get()/time_freq())/m_ConfigInterval) % m_ConfigNumpingconfs;
 		CPingConfig Ping = m_aConfigPings[n];
+		if(time_get() < WarmupEnd)
+		{
+			mem_zero(&Ping, sizeof(Ping));
+			n = -1;
+		}
 
 		if(n != Lastcfg)
 			dbg_msg("crapnet", "cfg = %d", n);
@@ -206,10 +217,70 @@ void Run(int Port, NETADDR Dest)
 	}
 }
 
-int main(int argc, char **argv) // ignore_convention
+static void Usage(const char *pName)
+{
+	dbg_msg("crapnet", "usage: %s [-p port] [-a server_address] [-l loss_percent] [-b ping_ms] [-f flux_ms] [-w warmup_seconds]", pName);
+}
+
+int main(int argc, const char **argv) // ignore_convention
 {
 	NETADDR Addr = {NETTYPE_IPV4, {127,0,0,1},8303};
+	int Port = 8302;
 	dbg_logger_stdout();
-	Run(8302, Addr);
+
+	// a link given on the command line replaces the cycling ping configs
+	CPingConfig Link = {0, 0, 0, 0, 0, 0};
+	bool FixedLink = false;
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		const char *pArg = argv[i]; // ignore_convention
+		const char *pValue = i + 1 < argc ? argv[i + 1] : 0; // ignore_convention
+		if(!pValue || pArg[0] != '-')
+		{
+			Usage(argv[0]); // ignore_convention
+			return -1;
+		}
+		i++;
+
+		if(str_comp(pArg, "-p") == 0)
+			Port = str_toint(pValue);
+		else if(str_comp(pArg, "-a") == 0)
+		{
+			if(net_addr_from_str(&Addr, pValue) != 0)
+			{
+				dbg_msg("crapnet", "invalid address '%s'", pValue);
+				return -1;
+			}
+		}
+		else if(str_comp(pArg, "-l") == 0)
+		{
+			Link.m_Loss = clamp(str_toint(pValue), 0, 100);
+			FixedLink = true;
+		}
+		else if(str_comp(pArg, "-b") == 0)
+		{
+			Link.m_Base = maximum(0, str_toint(pValue));
+			FixedLink = true;
+		}
+		else if(str_comp(pArg, "-f") == 0)
+		{
+			Link.m_Flux = maximum(0, str_toint(pValue));
+			FixedLink = true;
+		}
+		else if(str_comp(pArg, "-w") == 0)
+			m_ConfigWarmup = maximum(0, str_toint(pValue));
+		else
+		{
+			Usage(argv[0]); // ignore_convention
+			return -1;
+		}
+	}
+
+	if(FixedLink)
+	{
+		m_aConfigPings[0] = Link;
+		m_ConfigNumpingconfs = 1;
+	}
+	Run(Port, Addr);
 	return 0;
 }
@@ -0,0 +1,485 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include <infclassr/geolocation.h>
+
+#include <map>
+#include <vector>
+
+/*
+	geo_compile reads a MaxMind DB country database and writes the compact
+	range table used by CGeolocation, see geolocation.h for the format.
+	Only the parts of the MaxMind DB format needed for country.iso_code are
+	decoded, so libmaxminddb is not needed.
+*/
+
+struct CIsoCode
+{
+	char m_aAlpha2[3];
+	int m_Numeric;
+};
+
+static const CIsoCode s_aIsoCodes[] = {
+	{"AF", 4}, {"AX", 248}, {"AL", 8}, {"DZ", 12}, {"AS", 16}, {"AD", 20},
+	{"AO", 24}, {"AI", 660}, {"AQ", 10}, {"AG", 28}, {"AR", 32}, {"AM", 51},
+	{"AW", 533}, {"AU", 36}, {"AT", 40}, {"AZ", 31}, {"BS", 44}, {"BH", 48},
+	{"BD", 50}, {"BB", 52}, {"BY", 112}, {"BE", 56}, {"BZ", 84}, {"BJ", 204},
+	{"BM", 60}, {"BT", 64}, {"BO", 68}, {"BQ", 535}, {"BA", 70}, {"BW", 72},
+	{"BV", 74}, {"BR", 76}, {"IO", 86}, {"BN", 96}, {"BG", 100}, {"BF", 854},
+	{"BI", 108}, {"KH", 116}, {"CM", 120}, {"CA", 124}, {"CV", 132}, {"KY", 136},
+	{"CF", 140}, {"TD", 148}, {"CL", 152}, {"CN", 156}, {"CX", 162}, {"CC", 166},
+	{"CO", 170}, {"KM", 174}, {"CG", 178}, {"CD", 180}, {"CK", 184}, {"CR", 188},
+	{"CI", 384}, {"HR", 191}, {"CU", 192}, {"CW", 531}, {"CY", 196}, {"CZ", 203},
+	{"DK", 208}, {"DJ", 262}, {"DM", 212}, {"DO", 214}, {"EC", 218}, {"EG", 818},
+	{"SV", 222}, {"GQ", 226}, {"ER", 232}, {"EE", 233}, {"ET", 231}, {"FK", 238},
+	{"FO", 234}, {"FJ", 242}, {"FI", 246}, {"FR", 250}, {"GF", 254}, {"PF", 258},
+	{"TF", 260}, {"GA", 266}, {"GM", 270}, {"GE", 268}, {"DE", 276}, {"GH", 288},
+	{"GI", 292}, {"GR", 300}, {"GL", 304}, {"GD", 308}, {"GP", 312}, {"GU", 316},
+	{"GT", 320}, {"GG", 831}, {"GN", 324}, {"GW", 624}, {"GY", 328}, {"HT", 332},
+	{"HM", 334}, {"VA", 336}, {"HN", 340}, {"HK", 344}, {"HU", 348}, {"IS", 352},
+	{"IN", 356}, {"ID", 360}, {"IR", 364}, {"IQ", 368}, {"IE", 372}, {"IM", 833},
+	{"IL", 376}, {"IT", 380}, {"JM", 388}, {"JP", 392}, {"JE", 832}, {"JO", 400},
+	{"KZ", 398}, {"KE", 404}, {"KI", 296}, {"KP", 408}, {"KR", 410}, {"KW", 414},
+	{"KG", 417}, {"LA", 418}, {"LV", 428}, {"LB", 422}, {"LS", 426}, {"LR", 430},
+	{"LY", 434}, {"LI", 438}, {"LT", 440}, {"LU", 442}, {"MO", 446}, {"MK", 807},
+	{"MG", 450}, {"MW", 454}, {"MY", 458}, {"MV", 462}, {"ML", 466}, {"MT", 470},
+	{"MH", 584}, {"MQ", 474}, {"MR", 478}, {"MU", 480}, {"YT", 175}, {"MX", 484},
+	{"FM", 583}, {"MD", 498}, {"MC", 492}, {"MN", 496}, {"ME", 499}, {"MS", 500},
+	{"MA", 504}, {"MZ", 508}, {"MM", 104}, {"NA", 516}, {"NR", 520}, {"NP", 524},
+	{"NL", 528}, {"NC", 540}, {"NZ", 554}, {"NI", 558}, {"NE", 562}, {"NG", 566},
+	{"NU", 570}, {"NF", 574}, {"MP", 580}, {"NO", 578}, {"OM", 512}, {"PK", 586},
+	{"PW", 585}, {"PS", 275}, {"PA", 591}, {"PG", 598}, {"PY", 600}, {"PE", 604},
+	{"PH", 608}, {"PN", 612}, {"PL", 616}, {"PT", 620}, {"PR", 630}, {"QA", 634},
+	{"RE", 638}, {"RO", 642}, {"RU", 643}, {"RW", 646}, {"BL", 652}, {"SH", 654},
+	{"KN", 659}, {"LC", 662}, {"MF", 663}, {"PM", 666}, {"VC", 670}, {"WS", 882},
+	{"SM", 674}, {"ST", 678}, {"SA", 682}, {"SN", 686}, {"RS", 688}, {"SC", 690},
+	{"SL", 694}, {"SG", 702}, {"SX", 534}, {"SK", 703}, {"SI", 705}, {"SB", 90},
+	{"SO", 706}, {"ZA", 710}, {"GS", 239}, {"SS", 728}, {"ES", 724}, {"LK", 144},
+	{"SD", 729}, {"SR", 740}, {"SJ", 744}, {"SZ", 748}, {"SE", 752}, {"CH", 756},
+	{"SY", 760}, {"TW", 158}, {"TJ", 762}, {"TZ", 834}, {"TH", 764}, {"TL", 626},
+	{"TG", 768}, {"TK", 772}, {"TO", 776}, {"TT", 780}, {"TN", 788}, {"TR", 792},
+	{"TM", 795}, {"TC", 796}, {"TV", 798}, {"UG", 800}, {"UA", 804}, {"AE", 784},
+	{"GB", 826}, {"US", 840}, {"UM", 581}, {"UY", 858}, {"UZ", 860}, {"VU", 548},
+	{"VE", 862}, {"VN", 704}, {"VG", 92}, {"VI", 850}, {"WF", 876}, {"EH", 732},
+	{"YE", 887}, {"ZM", 894}, {"ZW", 716},
+};
+
+enum
+{
+	MMDB_POINTER = 1,
+	MMDB_STRING = 2,
+	MMDB_DOUBLE = 3,
+	MMDB_BYTES = 4,
+	MMDB_UINT16 = 5,
+	MMDB_UINT32 = 6,
+	MMDB_MAP = 7,
+	MMDB_INT32 = 8,
+	MMDB_UINT64 = 9,
+	MMDB_UINT128 = 10,
+	MMDB_ARRAY = 11,
+	MMDB_BOOLEAN = 14,
+	MMDB_FLOAT = 15,
+
+	COUNTRY_UNKNOWN = -1,
+};
+
+static const unsigned char s_aMetadataMarker[] = "\xab\xcd\xefMaxMind.com";
+
+class CMaxMindDB
+{
+	const unsigned char *m_pData;
+	unsigned m_Size;
+	const unsigned char *m_pTree;
+	const unsigned char *m_pSection;
+	const unsigned char *m_pEnd;
+	unsigned m_NodeCount;
+	int m_RecordSize;
+	int m_IpVersion;
+	bool m_Error;
+
+	struct CField
+	{
+		int m_Type;
+		unsigned m_Size;
+		const unsigned char *m_pData;
+	};
+
+	// decodes the control bytes at pData, resolving pointers relative to pSection
+	const unsigned char *Field(const unsigned char *pSection, const unsigned char *pData, CField *pField)
+	{
+		if(pData >= m_pEnd)
+		{
+			m_Error = true;
+			pField->m_Type = 0;
+			return m_pEnd;
+		}
+
+		int Control = *pData++;
+		int Type = Control>>5;
+		if(Type == MMDB_POINTER)
+		{
+			int Size = (Control>>3)&3;
+			unsigned Offset = Size == 3 ? 0 : Control&7;
+			static const unsigned s_aBias[4] = {0, 2048, 526336, 0};
+			if(pData + Size + 1 > m_pEnd)
+			{
+				m_Error = true;
+				return m_pEnd;
+			}
+			for(int i = 0; i <= Size; i++)
+				Offset = (Offset<<8) | *pData++;
+			Offset += s_aBias[Size];
+			if(pSection + Offset >= m_pEnd)
+			{
+				m_Error = true;
+				return pData;
+			}
+			Field(pSection, pSection + Offset, pField);
+			return pData;
+		}
+		if(Type == 0)
+		{
+			if(pData >= m_pEnd)
+			{
+				m_Error = true;
+				return m_pEnd;
+			}
+			Type = 7 + *pData++;
+		}
+
+		unsigned Size = Control&31;
+		int Extra = Size < 29 ? 0 : Size - 28;
+		if(pData + Extra > m_pEnd)
+		{
+			m_Error = true;
+			return m_pEnd;
+		}
+		if(Size == 29)
+			Size = 29 + pData[0];
+		else if(Size == 30)
+			Size = 285 + ((pData[0]<<8) | pData[1]);
+		else if(Size == 31)
+			Size = 65821 + ((pData[0]<<16) | (pData[1]<<8) | pData[2]);
+		pData += Extra;
+		if(Type != MMDB_MAP && Type != MMDB_ARRAY && Type != MMDB_BOOLEAN && pData + Size > m_pEnd)
+			m_Error = true;
+
+		pField->m_Type = Type;
+		pField->m_Size = Size;
+		pField->m_pData = pData;
+		return pData;
+	}
+
+	// returns the position after the value at pData
+	const unsigned char *Skip(const unsigned char *pSection, const unsigned char *pData)
+	{
+		CField Field;
+		const unsigned char *pNext = this->Field(pSection, pData, &Field);
+		if(m_Error || pNext != Field.m_pData)
+			return pNext; // pointer, its target doesn't follow inline
+
+		switch(Field.m_Type)
+		{
+		case MMDB_MAP:
+			for(unsigned i = 0; i < Field.m_Size*2 && !m_Error; i++)
+				pNext = Skip(pSection, pNext);
+			return pNext;
+		case MMDB_ARRAY:
+			for(unsigned i = 0; i < Field.m_Size && !m_Error; i++)
+				pNext = Skip(pSection, pNext);
+			return pNext;
+		case MMDB_BOOLEAN:
+			return pNext;
+		case MMDB_DOUBLE:
+			return pNext + 8;
+		case MMDB_FLOAT:
+			return pNext + 4;
+		default:
+			return pNext + Field.m_Size;
+		}
+	}
+
+	// finds the value of a key in the map at pData
+	bool MapValue(const unsigned char *pSection, const unsigned char *pData, const char *pKey, CField *pValue)
+	{
+		CField Map;
+		Field(pSection, pData, &Map);
+		if(m_Error || Map.m_Type != MMDB_MAP)
+			return false;
+
+		int KeyLength = str_length(pKey);
+		const unsigned char *pEntry = Map.m_pData;
+		for(unsigned i = 0; i < Map.m_Size && !m_Error; i++)
+		{
+			CField Key;
+			Field(pSection, pEntry, &Key);
+			const unsigned char *pValueData = Skip(pSection, pEntry);
+			if(m_Error)
+				return false;
+
+			if(Key.m_Type == MMDB_STRING && Key.m_Size == (unsigned)KeyLength && mem_comp(Key.m_pData, pKey, KeyLength) == 0)
+			{
+				Field(pSection, pValueData, pValue);
+				if(pValue->m_Type == MMDB_MAP)
+					pValue->m_pData = pValueData;
+				return !m_Error;
+			}
+			pEntry = Skip(pSection, pValueData);
+		}
+		return false;
+	}
+
+	unsigned MetadataUInt(const unsigned char *pMetadata, const char *pKey)
+	{
+		CField Value;
+		if(!MapValue(pMetadata, pMetadata, pKey, &Value) || Value.m_Size > 4 ||
+			(Value.m_Type != MMDB_UINT16 && Value.m_Type != MMDB_UINT32 && Value.m_Type != MMDB_UINT64))
+			return 0;
+		unsigned Result = 0;
+		for(unsigned i = 0; i < Value.m_Size; i++)
+			Result = (Result<<8) | Value.m_pData[i];
+		return Result;
+	}
+
+public:
+	CMaxMindDB() : m_pData(0), m_Size(0) {}
+	~CMaxMindDB() { io_unmap_file((void *)m_pData, m_Size); }
+
+	bool Open(const char *pFilename)
+	{
+		m_pData = (const unsigned char *)io_map_file(pFilename, &m_Size);
+		if(!m_pData)
+			return false;
+		m_pEnd = m_pData + m_Size;
+		m_Error = false;
+
+		// the metadata map follows the last marker
+		int MarkerSize = sizeof(s_aMetadataMarker) - 1;
+		const unsigned char *pMetadata = 0;
+		for(const unsigned char *p = m_pEnd - MarkerSize; p >= m_pData && m_pEnd - p < 128*1024; p--)
+		{
+			if(mem_comp(p, s_aMetadataMarker, MarkerSize) == 0)
+			{
+				pMetadata = p + MarkerSize;
+				break;
+			}
+		}
+		if(!pMetadata)
+			return false;
+
+		m_NodeCount = MetadataUInt(pMetadata, "node_count");
+		m_RecordSize = MetadataUInt(pMetadata, "record_size");
+		m_IpVersion = MetadataUInt(pMetadata, "ip_version");
+		if(m_Error || m_NodeCount == 0 || (m_RecordSize != 24 && m_RecordSize != 28 && m_RecordSize != 32))
+			return false;
+
+		unsigned TreeSize = m_NodeCount * (m_RecordSize/4);
+		if(TreeSize + 16 > (unsigned)(pMetadata - m_pData))
+			return false;
+		m_pTree = m_pData;
+		m_pSection = m_pData + TreeSize + 16;
+		return true;
+	}
+
+	unsigned NodeCount() const { return m_NodeCount; }
+	int IpVersion() const { return m_IpVersion; }
+	bool Error() const { return m_Error; }
+
+	unsigned Record(unsigned Node, int Bit) const
+	{
+		const unsigned char *p = m_pTree + Node * (m_RecordSize/4);
+		switch(m_RecordSize)
+		{
+		case 24:
+			p += Bit*3;
+			return (p[0]<<16) | (p[1]<<8) | p[2];
+		case 28:
+			if(Bit)
+				return ((p[3]&0x0f)<<24) | (p[4]<<16) | (p[5]<<8) | p[6];
+			return ((p[3]&0xf0)<<20) | (p[0]<<16) | (p[1]<<8) | p[2];
+		default:
+			p += Bit*4;
+			return ((unsigned)p[0]<<24) | (p[1]<<16) | (p[2]<<8) | p[3];
+		}
+	}
+
+	// returns the two letter code of country.iso_code of a data record
+	bool CountryCode(unsigned Record, char *pCode)
+	{
+		unsigned Offset = Record - m_NodeCount - 16;
+		if(m_pSection + Offset >= m_pEnd)
+		{
+			m_Error = true;
+			return false;
+		}
+
+		CField Country, IsoCode;
+		if(!MapValue(m_pSection, m_pSection + Offset, "country", &Country) ||
+			!MapValue(m_pSection, Country.m_pData, "iso_code", &IsoCode) ||
+			IsoCode.m_Type != MMDB_STRING || IsoCode.m_Size != 2)
+			return false;
+		pCode[0] = IsoCode.m_pData[0];
+		pCode[1] = IsoCode.m_pData[1];
+		pCode[2] = 0;
+		return true;
+	}
+};
+
+struct CRange
+{
+	unsigned char m_aStart[16];
+	int m_Country;
+};
+
+class CCompiler
+{
+	CMaxMindDB *m_pDB;
+	std::map<unsigned, int> m_Countries;
+	unsigned m_SkipNode;
+	int m_Bits;
+	std::vector<CRange> *m_pRanges;
+	unsigned char m_aAddr[16];
+
+	int Country(unsigned Record)
+	{
+		std::map<unsigned, int>::const_iterator it = m_Countries.find(Record);
+		if(it != m_Countries.end())
+			return it->second;
+
+		int Country = COUNTRY_UNKNOWN;
+		char aCode[3];
+		if(m_pDB->CountryCode(Record, aCode))
+		{
+			for(unsigned i = 0; i < sizeof(s_aIsoCodes)/sizeof(s_aIsoCodes[0]); i++)
+			{
+				if(str_comp(s_aIsoCodes[i].m_aAlpha2, aCode) == 0)
+				{
+					Country = s_aIsoCodes[i].m_Numeric;
+					break;
+				}
+			}
+		}
+		m_Countries[Record] = Country;
+		return Country;
+	}
+
+	void Add(int Country)
+	{
+		// merge neighbouring networks of the same country
+		if(!m_pRanges->empty() && m_pRanges->back().m_Country == Country)
+			return;
+		CRange Range;
+		mem_copy(Range.m_aStart, m_aAddr, sizeof(Range.m_aStart));
+		Range.m_Country = Country;
+		m_pRanges->push_back(Range);
+	}
+
+	void Walk(unsigned Record, int Depth)
+	{
+		unsigned NodeCount = m_pDB->NodeCount();
+		if(Record < NodeCount && Depth < m_Bits && Record != m_SkipNode)
+		{
+			for(int Bit = 0; Bit < 2 && !m_pDB->Error(); Bit++)
+			{
+				if(Bit)
+					m_aAddr[Depth/8] |= 0x80>>(Depth%8);
+				Walk(m_pDB->Record(Record, Bit), Depth+1);
+			}
+			m_aAddr[Depth/8] &= ~(0x80>>(Depth%8));
+		}
+		else if(Record > NodeCount && Record != m_SkipNode)
+			Add(Country(Record));
+		else
+			Add(COUNTRY_UNKNOWN);
+	}
+
+public:
+	CCompiler(CMaxMindDB *pDB) : m_pDB(pDB) {}
+
+	void Compile(unsigned Root, int Bits, unsigned SkipNode, std::vector<CRange> *pRanges)
+	{
+		m_Bits = Bits;
+		m_SkipNode = SkipNode;
+		m_pRanges = pRanges;
+		mem_zero(m_aAddr, sizeof(m_aAddr));
+		Walk(Root, 0);
+	}
+};
+
+static void WriteUInt32(IOHANDLE File, unsigned Value)
+{
+	unsigned char aBuf[4] = {(unsigned char)(Value>>24), (unsigned char)(Value>>16), (unsigned char)(Value>>8), (unsigned char)Value};
+	io_write(File, aBuf, sizeof(aBuf));
+}
+
+static void WriteRanges(IOHANDLE File, const std::vector<CRange> &vRanges, int Size)
+{
+	for(unsigned i = 0; i < vRanges.size(); i++)
+		io_write(File, vRanges[i].m_aStart, Size);
+	for(unsigned i = 0; i < vRanges.size(); i++)
+	{
+		unsigned char aCountry[2] = {(unsigned char)(vRanges[i].m_Country>>8), (unsigned char)vRanges[i].m_Country};
+		io_write(File, aCountry, sizeof(aCountry));
+	}
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+	if(argc != 3)
+	{
+		dbg_msg("geo_compile", "usage: %s <database.mmdb> <output>", argv[0]);
+		return -1;
+	}
+
+	CMaxMindDB DB;
+	if(!DB.Open(argv[1]))
+	{
+		dbg_msg("geo_compile", "failed to open database '%s'", argv[1]);
+		return -1;
+	}
+
+	CCompiler Compiler(&DB);
+	std::vector<CRange> vRanges4, vRanges6;
+	unsigned NodeCount = DB.NodeCount();
+	if(DB.IpVersion() == 6)
+	{
+		// IPv4 lives in ::/96, the other aliases of it are left out of the IPv6 ranges
+		unsigned Node = 0;
+		for(int i = 0; i < 96 && Node < NodeCount; i++)
+			Node = DB.Record(Node, 0);
+		Compiler.Compile(Node, 32, NodeCount, &vRanges4);
+		Compiler.Compile(0, 128, Node < NodeCount ? Node : NodeCount, &vRanges6);
+	}
+	else
+	{
+		Compiler.Compile(0, 32, NodeCount, &vRanges4);
+		CRange Unknown;
+		mem_zero(&Unknown, sizeof(Unknown));
+		Unknown.m_Country = COUNTRY_UNKNOWN;
+		vRanges6.push_back(Unknown);
+	}
+	if(DB.Error())
+	{
+		dbg_msg("geo_compile", "database '%s' is corrupt", argv[1]);
+		return -1;
+	}
+
+	IOHANDLE File = io_open(argv[2], IOFLAG_WRITE);
+	if(!File)
+	{
+		dbg_msg("geo_compile", "failed to open '%s' for writing", argv[2]);
+		return -1;
+	}
+	io_write(File, CGeolocation::ms_aMagic, sizeof(CGeolocation::ms_aMagic));
+	WriteUInt32(File, CGeolocation::VERSION);
+	WriteUInt32(File, vRanges4.size());
+	WriteUInt32(File, vRanges6.size());
+	WriteRanges(File, vRanges4, 4);
+	WriteRanges(File, vRanges6, 16);
+	io_close(File);
+
+	dbg_msg("geo_compile", "wrote %d IPv4 and %d IPv6 ranges to '%s'", (int)vRanges4.size(), (int)vRanges6.size(), argv[2]);
+	return 0;
+}
@@ -0,0 +1,190 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/shared/huffman.h>
+#include <engine/shared/network.h>
+
+#include <vector>
+
+/*
+	huffman_bench compares the fast paths of CHuffman with the reference
+	paths. It first checks that both give the same results for random,
+	truncated and corrupted data, then measures the throughput of both
+	over snapshot messages captured with load_gen -c.
+*/
+
+static unsigned s_Random = 1;
+
+static unsigned Random()
+{
+	s_Random ^= s_Random << 13;
+	s_Random ^= s_Random >> 17;
+	s_Random ^= s_Random << 5;
+	return s_Random;
+}
+
+static bool SameResult(const char *pWhat, int Size, int RefSize, const unsigned char *pData, const unsigned char *pRefData)
+{
+	if(Size != RefSize || (Size > 0 && mem_comp(pData, pRefData, Size) != 0))
+	{
+		dbg_msg("huffman_bench", "error: %s differs, size=%d reference=%d", pWhat, Size, RefSize);
+		return false;
+	}
+	return true;
+}
+
+static bool CheckCompatibility(CHuffman *pFast, CHuffman *pReference, int NumRounds)
+{
+	unsigned char aInput[NET_MAX_PAYLOAD];
+	unsigned char aCompressed[NET_MAX_PAYLOAD * 2];
+	unsigned char aRefCompressed[NET_MAX_PAYLOAD * 2];
+	unsigned char aOutput[NET_MAX_PAYLOAD];
+	unsigned char aRefOutput[NET_MAX_PAYLOAD];
+
+	for(int r = 0; r < NumRounds; r++)
+	{
+		// mostly zeros like snapshot deltas
+		int Size = Random() % sizeof(aInput);
+		for(int i = 0; i < Size; i++)
+			aInput[i] = Random() % 2 ? 0 : Random();
+
+		int OutputSize = 1 + Random() % (Size * 2 + 16);
+		int CompressedSize = pFast->Compress(aInput, Size, aCompressed, OutputSize);
+		int RefCompressedSize = pReference->Compress(aInput, Size, aRefCompressed, OutputSize);
+		if(!SameResult("compress", CompressedSize, RefCompressedSize, aCompressed, aRefCompressed))
+			return false;
+		if(CompressedSize < 0)
+			continue;
+
+		// whole, truncated and corrupted streams into outputs of any size
+		int DecompressSize = Random() % 3 == 0 ? Random() % (Size + 1) : (int)sizeof(aOutput);
+		if(Random() % 4 == 0)
+			CompressedSize = Random() % (CompressedSize + 1);
+		if(Random() % 4 == 0 && CompressedSize > 0)
+			aCompressed[Random() % CompressedSize] ^= 1 << (Random() % 8);
+
+		int Decompressed = pFast->Decompress(aCompressed, CompressedSize, aOutput, DecompressSize);
+		int RefDecompressed = pReference->Decompress(aCompressed, CompressedSize, aRefOutput, DecompressSize);
+		if(!SameResult("decompress", Decompressed, RefDecompressed, aOutput, aRefOutput))
+			return false;
+	}
+	return true;
+}
+
+static bool LoadCapture(const char *pFilename, std::vector<std::vector<unsigned char> > *pvMessages)
+{
+	IOHANDLE File = io_open(pFilename, IOFLAG_READ);
+	if(!File)
+		return false;
+	unsigned char aSize[4];
+	while(io_read(File, aSize, sizeof(aSize)) == sizeof(aSize))
+	{
+		int Size = aSize[0] | (aSize[1] << 8) | (aSize[2] << 16);
+		if(Size > NET_MAX_PAYLOAD)
+			break;
+		std::vector<unsigned char> vMessage(Size);
+		if(Size && io_read(File, &vMessage[0], Size) != (unsigned)Size)
+			break;
+		pvMessages->push_back(vMessage);
+	}
+	io_close(File);
+	return true;
+}
+
+static void Measure(const char *pName, CHuffman *pHuffman, const std::vector<std::vector<unsigned char> > &vMessages, int NumRounds)
+{
+	unsigned char aCompressed[NET_MAX_PAYLOAD * 2];
+	unsigned char aOutput[NET_MAX_PAYLOAD];
+	int64 Bytes = 0;
+	int64 CompressedBytes = 0;
+
+	int64 Start = time_get_impl();
+	for(int r = 0; r < NumRounds; r++)
+	{
+		for(unsigned i = 0; i < vMessages.size(); i++)
+		{
+			int Size = vMessages[i].size();
+			CompressedBytes += pHuffman->Compress(Size ? &vMessages[i][0] : aOutput, Size, aCompressed, sizeof(aCompressed));
+			Bytes += Size;
+		}
+	}
+	double CompressTime = (time_get_impl() - Start) / (double)time_freq();
+
+	// decompress what the first round gave
+	std::vector<std::vector<unsigned char> > vCompressed;
+	for(unsigned i = 0; i < vMessages.size(); i++)
+	{
+		int Size = vMessages[i].size();
+		int CompressedSize = pHuffman->Compress(Size ? &vMessages[i][0] : aOutput, Size, aCompressed, sizeof(aCompressed));
+		vCompressed.push_back(std::vector<unsigned char>(aCompressed, aCompressed + CompressedSize));
+	}
+	Start = time_get_impl();
+	for(int r = 0; r < NumRounds; r++)
+	{
+		for(unsigned i = 0; i < vCompressed.size(); i++)
+			pHuffman->Decompress(&vCompressed[i][0], vCompressed[i].size(), aOutput, sizeof(aOutput));
+	}
+	double DecompressTime = (time_get_impl() - Start) / (double)time_freq();
+
+	dbg_msg("huffman_bench", "%-9s compress %.1f MB/s, decompress %.1f MB/s, ratio %.3f", pName,
+		Bytes / CompressTime / 1000000.0, Bytes / DecompressTime / 1000000.0, Bytes ? CompressedBytes / (double)Bytes : 0.0);
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+
+	const char *pCapture = 0;
+	int NumRounds = 100;
+	for(int i = 1; i < argc; i++)
+	{
+		if(str_comp(argv[i], "-c") == 0 && i+1 < argc)
+			pCapture = argv[++i];
+		else if(str_comp(argv[i], "-r") == 0 && i+1 < argc)
+			NumRounds = maximum(1, str_toint(argv[++i]));
+		else
+		{
+			dbg_msg("huffman_bench", "usage: %s [-c capture_file] [-r rounds]", argv[0]);
+			return -1;
+		}
+	}
+
+	static CHuffman s_Fast;
+	static CHuffman s_Reference;
+	CNetBase::InitHuffman(&s_Fast);
+	CNetBase::InitHuffman(&s_Reference);
+	s_Reference.SetFastPaths(false);
+
+	if(!CheckCompatibility(&s_Fast, &s_Reference, 200000))
+		return 1;
+	dbg_msg("huffman_bench", "fast and reference paths agree");
+
+	if(!pCapture)
+		return 0;
+
+	std::vector<std::vector<unsigned char> > vMessages;
+	if(!LoadCapture(pCapture, &vMessages) || vMessages.empty())
+	{
+		dbg_msg("huffman_bench", "no messages in '%s'", pCapture);
+		return -1;
+	}
+	dbg_msg("huffman_bench", "%d captured messages, %d rounds", (int)vMessages.size(), NumRounds);
+
+	for(unsigned i = 0; i < vMessages.size(); i++)
+	{
+		unsigned char aCompressed[NET_MAX_PAYLOAD * 2];
+		unsigned char aRefCompressed[NET_MAX_PAYLOAD * 2];
+		int Size = vMessages[i].size();
+		const unsigned char *pMessage = Size ? &vMessages[i][0] : aCompressed;
+		int CompressedSize = s_Fast.Compress(pMessage, Size, aCompressed, sizeof(aCompressed));
+		int RefCompressedSize = s_Reference.Compress(pMessage, Size, aRefCompressed, sizeof(aRefCompressed));
+		if(!SameResult("compress", CompressedSize, RefCompressedSize, aCompressed, aRefCompressed))
+			return 1;
+	}
+
+	Measure("reference", &s_Reference, vMessages, NumRounds);
+	Measure("fast", &s_Fast, vMessages, NumRounds);
+	return 0;
+}
@@ -0,0 +1,152 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/shared/jobs.h>
+
+#include <atomic>
+#include <vector>
+
+/*
+	jobs_bench measures the throughput of CJobPool with small jobs: jobs
+	added from the main thread, jobs fanned out from inside workers,
+	continuation chains and the shared pointer interface. All threads
+	compete for the same jobs, so it also shows the cost of contention.
+*/
+
+static int s_Work = 100;
+static std::atomic<int> s_NumDone(0);
+
+static unsigned DoWork(unsigned Seed)
+{
+	for(int i = 0; i < s_Work; i++)
+		Seed = Seed*1664525 + 1013904223;
+	return Seed;
+}
+
+class CBenchJob : public IJob
+{
+	void Run()
+	{
+		m_Result = DoWork(m_Result);
+		s_NumDone++;
+	}
+
+public:
+	unsigned m_Result;
+};
+
+// adds its children from inside the pool
+class CFanOutJob : public IJob
+{
+	void Run()
+	{
+		for(int i = 0; i < m_NumChildren; i++)
+			m_pPool->Add(&m_pChildren[i], m_pGroup);
+	}
+
+public:
+	CJobPool *m_pPool;
+	CJobGroup *m_pGroup;
+	CBenchJob *m_pChildren;
+	int m_NumChildren;
+};
+
+static void Report(const char *pName, int NumJobs, int64 Start)
+{
+	double Seconds = (time_get_impl() - Start) / (double)time_freq();
+	dbg_msg("jobs_bench", "%-12s %8d jobs in %.3f s, %.0f jobs/s", pName, NumJobs, Seconds, NumJobs / Seconds);
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+
+	int NumThreads = 4;
+	int NumJobs = 1000000;
+	for(int i = 1; i < argc; i++)
+	{
+		if(str_comp(argv[i], "-t") == 0 && i+1 < argc)
+			NumThreads = clamp(str_toint(argv[++i]), 1, 32);
+		else if(str_comp(argv[i], "-n") == 0 && i+1 < argc)
+			NumJobs = maximum(1000, str_toint(argv[++i]));
+		else if(str_comp(argv[i], "-w") == 0 && i+1 < argc)
+			s_Work = maximum(0, str_toint(argv[++i]));
+		else
+		{
+			dbg_msg("jobs_bench", "usage: %s [-t threads] [-n jobs] [-w work_per_job]", argv[0]);
+			return -1;
+		}
+	}
+
+	CJobPool Pool;
+	Pool.Init(NumThreads);
+	dbg_msg("jobs_bench", "%d threads, %d jobs, %d work per job", NumThreads, NumJobs, s_Work);
+
+	std::vector<CBenchJob> vJobs(NumJobs);
+	for(int i = 0; i < NumJobs; i++)
+		vJobs[i].m_Result = i;
+
+	// every job added by the main thread
+	{
+		CJobGroup Group;
+		int64 Start = time_get_impl();
+		for(int i = 0; i < NumJobs; i++)
+			Pool.Add(&vJobs[i], &Group);
+		Pool.Wait(&Group);
+		Report("main thread", NumJobs, Start);
+	}
+
+	// a few jobs that add the rest from the workers
+	{
+		const int NumChildren = 1000;
+		std::vector<CFanOutJob> vRoots(NumJobs / NumChildren);
+		CJobGroup Group;
+		int64 Start = time_get_impl();
+		for(unsigned i = 0; i < vRoots.size(); i++)
+		{
+			vRoots[i].m_pPool = &Pool;
+			vRoots[i].m_pGroup = &Group;
+			vRoots[i].m_pChildren = &vJobs[i*NumChildren];
+			vRoots[i].m_NumChildren = NumChildren;
+			Pool.Add(&vRoots[i], &Group);
+		}
+		Pool.Wait(&Group);
+		Report("fan out", NumJobs, Start);
+	}
+
+	// chains of continuations, each job only runs after the previous one
+	{
+		const int ChainLength = 100;
+		CJobGroup Group;
+		int64 Start = time_get_impl();
+		for(int c = 0; c < NumJobs / ChainLength; c++)
+		{
+			CBenchJob *pChain = &vJobs[c*ChainLength];
+			for(int i = ChainLength-1; i > 0; i--)
+				Pool.AddContinuation(&pChain[i], &pChain[i-1], &Group);
+			Pool.Add(&pChain[0], &Group);
+		}
+		Pool.Wait(&Group);
+		Report("continuation", NumJobs / ChainLength * ChainLength, Start);
+	}
+
+	// the shared pointer interface, allocates every job
+	{
+		s_NumDone = 0;
+		int NumShared = NumJobs / 10;
+		int64 Start = time_get_impl();
+		for(int i = 0; i < NumShared; i++)
+			Pool.Add(std::make_shared<CBenchJob>());
+		while(s_NumDone.load() < NumShared)
+			thread_yield();
+		Report("shared_ptr", NumShared, Start);
+	}
+
+	unsigned Check = 0;
+	for(int i = 0; i < NumJobs; i++)
+		Check ^= vJobs[i].m_Result;
+	dbg_msg("jobs_bench", "checksum %08x", Check);
+	return 0;
+}
@@ -0,0 +1,721 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/message.h>
+#include <engine/server/mapconverter.h>
+#include <engine/shared/compression.h>
+#include <engine/shared/network.h>
+#include <engine/shared/protocol.h>
+#include <engine/shared/protocol_ex.h>
+#include <engine/shared/snapshot.h>
+
+#include <game/generated/protocol.h>
+#include <game/version.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+/*
+	load_gen connects a number of simulated clients to a server, lets them
+	download the map, join the game, pick a class and play with scripted or
+	random inputs at the server tick rate. The bots are deterministic for a
+	given seed, so two runs against two server builds are comparable.
+
+	The server must accept the clients, e.g.:
+		sv_max_clients_per_ip 64
+		inf_captcha 0
+*/
+
+enum
+{
+	MODE_SCRIPTED = 0,
+	MODE_RANDOM,
+
+	INPUT_RING_SIZE = 200,
+	MAP_CHUNK_SIZE = 1024-128,
+};
+
+static int s_NumBots = 16;
+static int s_Seed = 1;
+static int s_Duration = 60;
+static int s_Mode = MODE_SCRIPTED;
+static int s_ConnectInterval = 100; // ms between two connecting bots
+static NETADDR s_ServerAddr = {NETTYPE_IPV4, {127, 0, 0, 1}, 8303};
+static IOHANDLE s_ReportFile = 0;
+static IOHANDLE s_CaptureFile = 0; // received snapshot messages for huffman_bench
+
+static CSnapshotDelta s_SnapshotDelta;
+static CNetObjHandler s_NetObjHandler;
+
+struct CIntervalStats
+{
+	int m_Snapshots;
+	int m_FullSnapshots;
+	int m_EmptySnapshots;
+	int m_BrokenSnapshots;
+	int64 m_SnapshotBytes;
+	int m_MaxSnapshotBytes;
+	int m_InputsSent;
+	std::vector<int> m_aLatencies; // in microseconds
+
+	void Reset()
+	{
+		m_Snapshots = 0;
+		m_FullSnapshots = 0;
+		m_EmptySnapshots = 0;
+		m_BrokenSnapshots = 0;
+		m_SnapshotBytes = 0;
+		m_MaxSnapshotBytes = 0;
+		m_InputsSent = 0;
+		m_aLatencies.clear();
+	}
+};
+
+static CIntervalStats s_Stats;
+static CIntervalStats s_TotalStats;
+
+class CBot
+{
+public:
+	enum
+	{
+		STATE_OFFLINE = 0,
+		STATE_CONNECTING,
+		STATE_LOADING,
+		STATE_READY,
+		STATE_INGAME,
+	};
+
+	int m_Index;
+	int m_State;
+	unsigned m_RandomState;
+	CNetClient m_Net;
+
+	int m_NumMapChunks;
+	int m_NextMapChunk;
+	int m_ReceivedMapChunks;
+	std::vector<bool> m_aReceivedMapChunks;
+
+	CSnapshotStorage m_Snapshots;
+	char m_aSnapshotParts[CSnapshot::MAX_SIZE];
+	int m_SnapshotPartsTick;
+	uint64 m_SnapshotParts;
+	int m_GameTick;
+	int m_AckGameTick;
+
+	int m_InGameTicks;
+	CNetObj_PlayerInput m_Input;
+	int64 m_aInputSendTime[INPUT_RING_SIZE];
+	int m_aInputTick[INPUT_RING_SIZE];
+
+	void Init(int Index)
+	{
+		m_Index = Index;
+		m_State = STATE_OFFLINE;
+		m_RandomState = (unsigned)s_Seed * 2654435761u + (unsigned)Index * 40503u + 1;
+		m_NumMapChunks = 0;
+		m_NextMapChunk = 0;
+		m_ReceivedMapChunks = 0;
+		m_SnapshotPartsTick = -1;
+		m_SnapshotParts = 0;
+		m_GameTick = -1;
+		m_AckGameTick = -1;
+		m_InGameTicks = 0;
+		mem_zero(&m_Input, sizeof(m_Input));
+		for(int i = 0; i < INPUT_RING_SIZE; i++)
+			m_aInputTick[i] = -1;
+	}
+
+	// xorshift, each bot has its own sequence
+	int Random(int Min, int Max)
+	{
+		m_RandomState ^= m_RandomState << 13;
+		m_RandomState ^= m_RandomState >> 17;
+		m_RandomState ^= m_RandomState << 5;
+		return Min + (int)(m_RandomState % (unsigned)(Max - Min + 1));
+	}
+
+	void SendMsg(CMsgPacker *pMsg, int Flags)
+	{
+		CPacker Packer;
+		Packer.Reset();
+		Packer.AddInt((pMsg->m_MsgID << 1) | (pMsg->m_System ? 1 : 0));
+		Packer.AddRaw(pMsg->Data(), pMsg->Size());
+
+		CNetChunk Packet;
+		mem_zero(&Packet, sizeof(Packet));
+		Packet.m_ClientID = 0;
+		Packet.m_pData = Packer.Data();
+		Packet.m_DataSize = Packer.Size();
+		if(Flags & MSGFLAG_VITAL)
+			Packet.m_Flags |= NETSENDFLAG_VITAL;
+		if(Flags & MSGFLAG_FLUSH)
+			Packet.m_Flags |= NETSENDFLAG_FLUSH;
+		m_Net.Send(&Packet);
+	}
+
+	bool Connect()
+	{
+		NETADDR BindAddr;
+		mem_zero(&BindAddr, sizeof(BindAddr));
+		BindAddr.type = s_ServerAddr.type;
+		if(!m_Net.Open(BindAddr, 0))
+			return false;
+		m_Net.Connect(&s_ServerAddr);
+		m_State = STATE_CONNECTING;
+		return true;
+	}
+
+	void OnOnline()
+	{
+		CMsgPacker Msg(NETMSG_INFO, true);
+		Msg.AddString(GAME_NETVERSION, 128);
+		Msg.AddString("", 128); // password
+		SendMsg(&Msg, MSGFLAG_VITAL | MSGFLAG_FLUSH);
+		m_State = STATE_LOADING;
+	}
+
+	void RequestMapData()
+	{
+		CMsgPacker Msg(NETMSG_REQUEST_MAP_DATA, true);
+		Msg.AddInt(m_NextMapChunk++);
+		SendMsg(&Msg, MSGFLAG_VITAL | MSGFLAG_FLUSH);
+	}
+
+	void SendReady()
+	{
+		CMsgPacker Msg(NETMSG_READY, true);
+		SendMsg(&Msg, MSGFLAG_VITAL | MSGFLAG_FLUSH);
+	}
+
+	void SendStartInfo()
+	{
+		char aName[16];
+		str_format(aName, sizeof(aName), "bot%d", m_Index);
+
+		CNetMsg_Cl_StartInfo StartInfo;
+		StartInfo.m_pName = aName;
+		StartInfo.m_pClan = "load_gen";
+		StartInfo.m_Country = -1;
+		StartInfo.m_pSkin = "default";
+		StartInfo.m_UseCustomColor = 0;
+		StartInfo.m_ColorBody = 0;
+		StartInfo.m_ColorFeet = 0;
+
+		CMsgPacker Msg(StartInfo.MsgID(), false);
+		StartInfo.Pack(&Msg);
+		SendMsg(&Msg, MSGFLAG_VITAL | MSGFLAG_FLUSH);
+	}
+
+	void SendEnterGame()
+	{
+		CMsgPacker Msg(NETMSG_ENTERGAME, true);
+		SendMsg(&Msg, MSGFLAG_VITAL | MSGFLAG_FLUSH);
+		m_State = STATE_INGAME;
+	}
+
+	void OnMapChange(CUnpacker *pUnpacker)
+	{
+		pUnpacker->GetString(CUnpacker::SANITIZE_CC); // map name
+		pUnpacker->GetInt(); // crc
+		int MapSize = pUnpacker->GetInt();
+		if(pUnpacker->Error() || MapSize < 0)
+			return;
+
+		m_NumMapChunks = (MapSize + MAP_CHUNK_SIZE - 1) / MAP_CHUNK_SIZE;
+		m_NextMapChunk = 0;
+		m_ReceivedMapChunks = 0;
+		m_aReceivedMapChunks.assign(m_NumMapChunks, false);
+		if(m_NumMapChunks == 0)
+			SendReady();
+		else
+			RequestMapData();
+	}
+
+	void OnMapData(CUnpacker *pUnpacker)
+	{
+		pUnpacker->GetInt(); // last
+		pUnpacker->GetInt(); // crc
+		int Chunk = pUnpacker->GetInt();
+		int Size = pUnpacker->GetInt();
+		pUnpacker->GetRaw(Size);
+		if(pUnpacker->Error() || Chunk < 0 || Chunk >= m_NumMapChunks || m_aReceivedMapChunks[Chunk])
+			return;
+
+		m_aReceivedMapChunks[Chunk] = true;
+		m_ReceivedMapChunks++;
+		if(m_ReceivedMapChunks == m_NumMapChunks)
+			SendReady();
+		else if(m_NextMapChunk < m_NumMapChunks)
+			RequestMapData();
+	}
+
+	void OnSnapshot(int Msg, CUnpacker *pUnpacker)
+	{
+		int GameTick = pUnpacker->GetInt();
+		int DeltaTick = GameTick - pUnpacker->GetInt();
+		int NumParts = 1;
+		int Part = 0;
+		int Crc = 0;
+		int PartSize = 0;
+		const char *pData = 0;
+
+		if(Msg == NETMSG_SNAP)
+		{
+			NumParts = pUnpacker->GetInt();
+			Part = pUnpacker->GetInt();
+		}
+		if(Msg != NETMSG_SNAPEMPTY)
+		{
+			Crc = pUnpacker->GetInt();
+			PartSize = pUnpacker->GetInt();
+			pData = (const char *)pUnpacker->GetRaw(PartSize);
+		}
+
+		if(pUnpacker->Error() || NumParts < 1 || NumParts > CSnapshot::MAX_PARTS || Part < 0 || Part >= NumParts ||
+			PartSize < 0 || PartSize > MAX_SNAPSHOT_PACKSIZE || GameTick < m_GameTick)
+			return;
+
+		if(GameTick != m_SnapshotPartsTick)
+		{
+			m_SnapshotParts = 0;
+			m_SnapshotPartsTick = GameTick;
+		}
+
+		if(pData)
+			mem_copy(&m_aSnapshotParts[Part * MAX_SNAPSHOT_PACKSIZE], pData, PartSize);
+		m_SnapshotParts |= (uint64)1 << Part;
+
+		const uint64 AllParts = NumParts == 64 ? ~(uint64)0 : ((uint64)1 << NumParts) - 1;
+		if(m_SnapshotParts != AllParts)
+			return;
+
+		const int CompleteSize = (NumParts - 1) * MAX_SNAPSHOT_PACKSIZE + PartSize;
+		m_SnapshotParts = 0;
+		m_SnapshotPartsTick = -1;
+
+		CSnapshot *pDeltaShot = 0;
+		static CSnapshot s_EmptySnap;
+		s_EmptySnap.Clear();
+		if(DeltaTick >= 0)
+		{
+			if(m_Snapshots.Get(DeltaTick, 0, &pDeltaShot, 0) < 0)
+			{
+				// the server will send a full snapshot again
+				s_Stats.m_BrokenSnapshots++;
+				m_AckGameTick = -1;
+				return;
+			}
+		}
+		else
+			pDeltaShot = &s_EmptySnap;
+
+		char aDeltaData[CSnapshot::MAX_SIZE];
+		char aSnapData[CSnapshot::MAX_SIZE];
+		void *pDeltaData = s_SnapshotDelta.EmptyDelta();
+		int DeltaSize = sizeof(int) * 3;
+		if(CompleteSize)
+		{
+			DeltaSize = CVariableInt::Decompress(m_aSnapshotParts, CompleteSize, aDeltaData, sizeof(aDeltaData));
+			if(DeltaSize < 0)
+			{
+				s_Stats.m_BrokenSnapshots++;
+				return;
+			}
+			pDeltaData = aDeltaData;
+		}
+
+		CSnapshot *pSnap = (CSnapshot *)aSnapData;
+		int SnapSize = s_SnapshotDelta.UnpackDelta(pDeltaShot, pSnap, pDeltaData, DeltaSize);
+		if(SnapSize < 0 || (Msg != NETMSG_SNAPEMPTY && (int)pSnap->Crc() != Crc))
+		{
+			s_Stats.m_BrokenSnapshots++;
+			m_AckGameTick = -1;
+			return;
+		}
+
+		m_Snapshots.PurgeUntil(minimum(DeltaTick, GameTick - SERVER_TICK_SPEED));
+		m_Snapshots.Add(GameTick, time_get(), SnapSize, pSnap, 0);
+		m_GameTick = GameTick;
+		m_AckGameTick = GameTick;
+
+		s_Stats.m_Snapshots++;
+		s_Stats.m_SnapshotBytes += CompleteSize;
+		s_Stats.m_MaxSnapshotBytes = maximum(s_Stats.m_MaxSnapshotBytes, CompleteSize);
+		if(DeltaTick < 0)
+			s_Stats.m_FullSnapshots++;
+		if(Msg == NETMSG_SNAPEMPTY)
+			s_Stats.m_EmptySnapshots++;
+	}
+
+	void OnInputTiming(CUnpacker *pUnpacker)
+	{
+		int InputTick = pUnpacker->GetInt();
+		pUnpacker->GetInt(); // time left
+		if(pUnpacker->Error() || InputTick < 0)
+			return;
+
+		int Slot = InputTick % INPUT_RING_SIZE;
+		if(m_aInputTick[Slot] != InputTick)
+			return;
+
+		s_Stats.m_aLatencies.push_back((int)((time_get() - m_aInputSendTime[Slot]) * 1000000 / time_freq()));
+		m_aInputTick[Slot] = -1;
+	}
+
+	void ProcessPacket(CNetChunk *pPacket)
+	{
+		CUnpacker Unpacker;
+		Unpacker.Reset(pPacket->m_pData, pPacket->m_DataSize);
+		int MsgID = Unpacker.GetInt();
+		if(Unpacker.Error())
+			return;
+
+		int Msg = MsgID >> 1;
+		bool Sys = MsgID & 1;
+		if(Msg == NETMSG_EX)
+			return; // no uuid messages are needed by the bots
+
+		if(s_CaptureFile && Sys && (Msg == NETMSG_SNAP || Msg == NETMSG_SNAPSINGLE))
+		{
+			// 32 bit little endian size followed by the message
+			unsigned char aSize[4] = {(unsigned char)pPacket->m_DataSize, (unsigned char)(pPacket->m_DataSize >> 8), (unsigned char)(pPacket->m_DataSize >> 16), 0};
+			io_write(s_CaptureFile, aSize, sizeof(aSize));
+			io_write(s_CaptureFile, pPacket->m_pData, pPacket->m_DataSize);
+		}
+
+		if(Sys)
+		{
+			if(Msg == NETMSG_MAP_CHANGE)
+				OnMapChange(&Unpacker);
+			else if(Msg == NETMSG_MAP_DATA)
+				OnMapData(&Unpacker);
+			else if(Msg == NETMSG_CON_READY)
+				SendStartInfo();
+			else if(Msg == NETMSG_SNAP || Msg == NETMSG_SNAPSINGLE || Msg == NETMSG_SNAPEMPTY)
+				OnSnapshot(Msg, &Unpacker);
+			else if(Msg == NETMSG_INPUTTIMING)
+				OnInputTiming(&Unpacker);
+		}
+		else if(Msg == NETMSGTYPE_SV_READYTOENTER && m_State == STATE_LOADING)
+		{
+			m_State = STATE_READY;
+			SendEnterGame();
+		}
+	}
+
+	void Pump()
+	{
+		if(m_State == STATE_OFFLINE)
+			return;
+
+		m_Net.Update();
+
+		int NetState = m_Net.State();
+		if(NetState == NETSTATE_OFFLINE)
+		{
+			dbg_msg("load_gen", "bot%d disconnected: %s", m_Index, m_Net.ErrorString());
+			m_State = STATE_OFFLINE;
+			return;
+		}
+		if(m_State == STATE_CONNECTING && NetState == NETSTATE_ONLINE)
+			OnOnline();
+
+		CNetChunk Packet;
+		while(m_Net.Recv(&Packet))
+		{
+			if(Packet.m_ClientID != -1)
+				ProcessPacket(&Packet);
+		}
+	}
+
+	void UpdateInput()
+	{
+		const int Tick = m_InGameTicks++;
+
+		// the class menu is open while the first seconds, point at a class
+		// and click it
+		if(Tick < SERVER_TICK_SPEED * 3)
+		{
+			int MenuClass = 1 + m_Index % (CMapConverter::NUM_MENUCLASS - 1);
+			float Angle = MenuClass * 2.0f * pi / CMapConverter::NUM_MENUCLASS;
+			m_Input.m_Direction = 0;
+			m_Input.m_TargetX = (int)(sinf(Angle) * 200.0f);
+			m_Input.m_TargetY = (int)(-cosf(Angle) * 200.0f);
+			if(Tick % 10 == 5)
+				m_Input.m_Fire++;
+			else if(m_Input.m_Fire & 1)
+				m_Input.m_Fire++;
+			return;
+		}
+
+		if(s_Mode == MODE_RANDOM)
+		{
+			if(Random(0, 24) == 0)
+				m_Input.m_Direction = Random(-1, 1);
+			m_Input.m_TargetX = Random(-400, 400);
+			m_Input.m_TargetY = Random(-300, 300);
+			m_Input.m_Jump = Random(0, 15) == 0;
+			m_Input.m_Hook = Random(0, 3) != 0 ? m_Input.m_Hook : !m_Input.m_Hook;
+			if(Random(0, 5) == 0)
+				m_Input.m_Fire++;
+			if(Random(0, 200) == 0)
+				m_Input.m_WantedWeapon = Random(1, NUM_WEAPONS);
+		}
+		else
+		{
+			// walk back and forth, jump, hook and fire in a fixed pattern
+			const int Phase = (Tick + m_Index * 7) % (SERVER_TICK_SPEED * 4);
+			m_Input.m_Direction = Phase < SERVER_TICK_SPEED * 2 ? 1 : -1;
+			float Angle = (Tick + m_Index * 13) * 0.05f;
+			m_Input.m_TargetX = (int)(cosf(Angle) * 300.0f);
+			m_Input.m_TargetY = (int)(sinf(Angle) * 300.0f);
+			m_Input.m_Jump = Phase % 25 == 0;
+			m_Input.m_Hook = (Phase / 30) % 2;
+			if(Phase % 8 == 0)
+				m_Input.m_Fire++;
+			if(Phase == 0)
+				m_Input.m_WantedWeapon = 1 + (Tick / (SERVER_TICK_SPEED * 4)) % NUM_WEAPONS;
+		}
+	}
+
+	void SendInput()
+	{
+		if(m_State != STATE_INGAME || m_GameTick < 0)
+			return;
+
+		UpdateInput();
+
+		// a bit ahead like a real client
+		const int IntendedTick = m_GameTick + 3;
+		CMsgPacker Msg(NETMSG_INPUT, true);
+		Msg.AddInt(m_AckGameTick);
+		Msg.AddInt(IntendedTick);
+		Msg.AddInt(sizeof(m_Input));
+		const int *pData = (const int *)&m_Input;
+		for(unsigned i = 0; i < sizeof(m_Input) / sizeof(int); i++)
+			Msg.AddInt(pData[i]);
+		SendMsg(&Msg, MSGFLAG_FLUSH);
+
+		const int Slot = IntendedTick % INPUT_RING_SIZE;
+		m_aInputTick[Slot] = IntendedTick;
+		m_aInputSendTime[Slot] = time_get();
+		s_Stats.m_InputsSent++;
+	}
+};
+
+static int Percentile(std::vector<int> &aValues, int Percent)
+{
+	if(aValues.empty())
+		return 0;
+	std::sort(aValues.begin(), aValues.end());
+	return aValues[minimum((int)aValues.size() - 1, (int)(aValues.size() * Percent / 100))];
+}
+
+static void Report(CBot *pBots, double Seconds, int GameTicks)
+{
+	int aNumStates[CBot::STATE_INGAME + 1] = {0};
+	for(int i = 0; i < s_NumBots; i++)
+		aNumStates[pBots[i].m_State]++;
+
+	const int NumLatencies = s_Stats.m_aLatencies.size();
+	int64 LatencySum = 0;
+	for(int i = 0; i < NumLatencies; i++)
+		LatencySum += s_Stats.m_aLatencies[i];
+	const int P99Latency = Percentile(s_Stats.m_aLatencies, 99);
+	const int MaxLatency = Percentile(s_Stats.m_aLatencies, 100);
+
+	char aBuf[512];
+	str_format(aBuf, sizeof(aBuf), "%.1f %d %d %.1f %d %d %d %d %lld %d %d %d %d %d",
+		Seconds,
+		aNumStates[CBot::STATE_INGAME],
+		s_NumBots - aNumStates[CBot::STATE_OFFLINE],
+		GameTicks / (Seconds > 0 ? Seconds : 1.0),
+		s_Stats.m_Snapshots,
+		s_Stats.m_FullSnapshots,
+		s_Stats.m_EmptySnapshots,
+		s_Stats.m_BrokenSnapshots,
+		s_Stats.m_Snapshots ? s_Stats.m_SnapshotBytes / s_Stats.m_Snapshots : 0,
+		s_Stats.m_MaxSnapshotBytes,
+		s_Stats.m_InputsSent,
+		NumLatencies ? (int)(LatencySum / NumLatencies) : 0,
+		P99Latency,
+		MaxLatency);
+	dbg_msg("load_gen", "%s", aBuf);
+
+	if(s_ReportFile)
+	{
+		io_write(s_ReportFile, aBuf, str_length(aBuf));
+		io_write_newline(s_ReportFile);
+		io_flush(s_ReportFile);
+	}
+
+	s_TotalStats.m_Snapshots += s_Stats.m_Snapshots;
+	s_TotalStats.m_FullSnapshots += s_Stats.m_FullSnapshots;
+	s_TotalStats.m_EmptySnapshots += s_Stats.m_EmptySnapshots;
+	s_TotalStats.m_BrokenSnapshots += s_Stats.m_BrokenSnapshots;
+	s_TotalStats.m_SnapshotBytes += s_Stats.m_SnapshotBytes;
+	s_TotalStats.m_MaxSnapshotBytes = maximum(s_TotalStats.m_MaxSnapshotBytes, s_Stats.m_MaxSnapshotBytes);
+	s_TotalStats.m_InputsSent += s_Stats.m_InputsSent;
+	s_TotalStats.m_aLatencies.insert(s_TotalStats.m_aLatencies.end(), s_Stats.m_aLatencies.begin(), s_Stats.m_aLatencies.end());
+	s_Stats.Reset();
+}
+
+static void Run()
+{
+	CBot *pBots = new CBot[s_NumBots];
+	for(int i = 0; i < s_NumBots; i++)
+		pBots[i].Init(i);
+
+	s_Stats.Reset();
+	s_TotalStats.Reset();
+
+	dbg_msg("load_gen", "columns: seconds ingame connected server_ticks/s snaps full_snaps empty_snaps broken_snaps avg_snap_bytes max_snap_bytes inputs avg_latency_us p99_latency_us max_latency_us");
+
+	const int64 Freq = time_freq();
+	const int64 StartTime = time_get();
+	int64 NextTick = StartTime;
+	int64 NextConnect = StartTime;
+	int64 LastReport = StartTime;
+	int NumConnected = 0;
+	int ReportStartTick = -1;
+
+	while(time_get() < StartTime + s_Duration * Freq)
+	{
+		int64 Now = time_get();
+
+		// connect the bots one after another, a real join storm drops
+		// clients on the token handshake
+		if(NumConnected < s_NumBots && Now >= NextConnect)
+		{
+			if(!pBots[NumConnected].Connect())
+				dbg_msg("load_gen", "bot%d failed to open a socket", NumConnected);
+			NumConnected++;
+			NextConnect = Now + Freq * s_ConnectInterval / 1000;
+		}
+
+		for(int i = 0; i < NumConnected; i++)
+			pBots[i].Pump();
+
+		if(Now >= NextTick)
+		{
+			for(int i = 0; i < NumConnected; i++)
+				pBots[i].SendInput();
+			NextTick += Freq / SERVER_TICK_SPEED;
+			if(NextTick < Now)
+				NextTick = Now + Freq / SERVER_TICK_SPEED;
+		}
+
+		if(Now - LastReport >= Freq)
+		{
+			int GameTick = -1;
+			for(int i = 0; i < NumConnected; i++)
+				GameTick = maximum(GameTick, pBots[i].m_GameTick);
+			Report(pBots, (Now - LastReport) / (double)Freq, ReportStartTick >= 0 && GameTick >= 0 ? GameTick - ReportStartTick : 0);
+			ReportStartTick = GameTick;
+			LastReport = Now;
+		}
+
+		thread_sleep(500);
+	}
+
+	const int NumLatencies = s_TotalStats.m_aLatencies.size();
+	dbg_msg("load_gen", "total: bots=%d seed=%d mode=%s duration=%ds snaps=%d full=%d empty=%d broken=%d avg_snap_bytes=%lld max_snap_bytes=%d inputs=%d latency_us p50=%d p99=%d samples=%d",
+		s_NumBots, s_Seed, s_Mode == MODE_RANDOM ? "random" : "scripted", s_Duration,
+		s_TotalStats.m_Snapshots, s_TotalStats.m_FullSnapshots, s_TotalStats.m_EmptySnapshots, s_TotalStats.m_BrokenSnapshots,
+		s_TotalStats.m_Snapshots ? s_TotalStats.m_SnapshotBytes / s_TotalStats.m_Snapshots : 0, s_TotalStats.m_MaxSnapshotBytes,
+		s_TotalStats.m_InputsSent,
+		Percentile(s_TotalStats.m_aLatencies, 50), Percentile(s_TotalStats.m_aLatencies, 99), NumLatencies);
+
+	for(int i = 0; i < NumConnected; i++)
+		pBots[i].m_Net.Disconnect("load_gen done");
+	for(int i = 0; i < NumConnected; i++)
+		pBots[i].m_Net.Update();
+	delete[] pBots;
+}
+
+static void Usage(const char *pName)
+{
+	dbg_msg("load_gen", "usage: %s [-a address] [-n bots] [-s seed] [-d seconds] [-m scripted|random] [-i connect_interval_ms] [-o report_file] [-c capture_file]", pName);
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		const char *pArg = argv[i]; // ignore_convention
+		const char *pValue = i + 1 < argc ? argv[i + 1] : 0; // ignore_convention
+		if(!pValue || pArg[0] != '-')
+		{
+			Usage(argv[0]); // ignore_convention
+			return -1;
+		}
+		i++;
+
+		if(str_comp(pArg, "-a") == 0)
+		{
+			if(net_addr_from_str(&s_ServerAddr, pValue) != 0)
+			{
+				dbg_msg("load_gen", "invalid address '%s'", pValue);
+				return -1;
+			}
+		}
+		else if(str_comp(pArg, "-n") == 0)
+			s_NumBots = clamp(str_toint(pValue), 1, (int)MAX_CLIENTS);
+		else if(str_comp(pArg, "-s") == 0)
+			s_Seed = str_toint(pValue);
+		else if(str_comp(pArg, "-d") == 0)
+			s_Duration = maximum(1, str_toint(pValue));
+		else if(str_comp(pArg, "-m") == 0)
+			s_Mode = str_comp(pValue, "random") == 0 ? MODE_RANDOM : MODE_SCRIPTED;
+		else if(str_comp(pArg, "-i") == 0)
+			s_ConnectInterval = maximum(0, str_toint(pValue));
+		else if(str_comp(pArg, "-o") == 0)
+		{
+			s_ReportFile = io_open(pValue, IOFLAG_WRITE);
+			if(!s_ReportFile)
+			{
+				dbg_msg("load_gen", "failed to open '%s'", pValue);
+				return -1;
+			}
+		}
+		else if(str_comp(pArg, "-c") == 0)
+		{
+			s_CaptureFile = io_open(pValue, IOFLAG_WRITE);
+			if(!s_CaptureFile)
+			{
+				dbg_msg("load_gen", "failed to open '%s'", pValue);
+				return -1;
+			}
+		}
+		else
+		{
+			Usage(argv[0]); // ignore_convention
+			return -1;
+		}
+	}
+
+	if(secure_random_init() != 0)
+	{
+		dbg_msg("load_gen", "could not initialize secure RNG");
+		return -1;
+	}
+
+	net_init();
+	CNetBase::Init();
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+		s_SnapshotDelta.SetStaticsize(i, s_NetObjHandler.GetObjSize(i));
+
+	Run();
+
+	if(s_ReportFile)
+		io_close(s_ReportFile);
+	if(s_CaptureFile)
+		io_close(s_CaptureFile);
+	return 0;
+}
@@ -0,0 +1,187 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <mastersrv/registry.h>
+
+#include <vector>
+
+/*
+	mastersrv_bench floods the master server registry with heartbeats of
+	random servers, serves list requests and expires servers, and reports
+	the rates. It also checks that the list packets contain every server
+	exactly once.
+*/
+
+static unsigned s_Random = 1;
+
+static unsigned Random()
+{
+	s_Random ^= s_Random << 13;
+	s_Random ^= s_Random >> 17;
+	s_Random ^= s_Random << 5;
+	return s_Random;
+}
+
+static void RandomAddr(NETADDR *pAddr, bool IPv6)
+{
+	mem_zero(pAddr, sizeof(*pAddr));
+	pAddr->type = IPv6 ? NETTYPE_IPV6 : NETTYPE_IPV4;
+	for(int i = 0; i < (IPv6 ? 16 : 4); i++)
+		pAddr->ip[i] = Random();
+	pAddr->port = 8303 + Random() % 16;
+}
+
+static double Seconds(int64 Start)
+{
+	return (time_get_impl() - Start) / (double)time_freq();
+}
+
+// decodes the list packets and checks that they hold every registered
+// server exactly once
+static bool CheckListed(const CServerRegistry *pRegistry, const CAddrMap *pKnown)
+{
+	CAddrMap Listed;
+	int Num = 0;
+	for(int Type = SERVERTYPE_NORMAL; Type <= SERVERTYPE_LEGACY; Type++)
+	{
+		for(int i = 0; i < pRegistry->NumPackets((ServerType)Type); i++)
+		{
+			int Size;
+			const unsigned char *pData = (const unsigned char *)pRegistry->GetPacket((ServerType)Type, i, &Size);
+			int HeaderSize = Type == SERVERTYPE_NORMAL ? sizeof(SERVERBROWSE_LIST) : sizeof(SERVERBROWSE_LIST_LEGACY);
+			int AddrSize = Type == SERVERTYPE_NORMAL ? sizeof(CMastersrvAddr) : sizeof(CMastersrvAddrLegacy);
+			for(int Offset = HeaderSize; Offset + AddrSize <= Size; Offset += AddrSize, Num++)
+			{
+				NETADDR Addr;
+				mem_zero(&Addr, sizeof(Addr));
+				if(Type == SERVERTYPE_NORMAL)
+				{
+					const CMastersrvAddr *pAddr = (const CMastersrvAddr *)(pData + Offset);
+					static const unsigned char s_aIPV4Mapping[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF};
+					if(mem_comp(pAddr->m_aIp, s_aIPV4Mapping, sizeof(s_aIPV4Mapping)) == 0)
+					{
+						Addr.type = NETTYPE_IPV4;
+						mem_copy(Addr.ip, pAddr->m_aIp + 12, 4);
+					}
+					else
+					{
+						Addr.type = NETTYPE_IPV6;
+						mem_copy(Addr.ip, pAddr->m_aIp, 16);
+					}
+					Addr.port = (pAddr->m_aPort[0] << 8) | pAddr->m_aPort[1];
+				}
+				else
+				{
+					const CMastersrvAddrLegacy *pAddr = (const CMastersrvAddrLegacy *)(pData + Offset);
+					Addr.type = NETTYPE_IPV4;
+					mem_copy(Addr.ip, pAddr->m_aIp, 4);
+					Addr.port = pAddr->m_aPort[0] | (pAddr->m_aPort[1] << 8);
+				}
+				if(pKnown->Find(&Addr) < 0 || Listed.Find(&Addr) >= 0)
+				{
+					dbg_msg("mastersrv_bench", "error: unknown or duplicate server in the list");
+					return false;
+				}
+				Listed.Set(&Addr, 0);
+			}
+		}
+	}
+	if(Num != pRegistry->NumServers())
+	{
+		dbg_msg("mastersrv_bench", "error: %d servers listed, %d registered", Num, pRegistry->NumServers());
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+
+	int NumServers = 50000;
+	int NumHeartbeats = 1000000;
+	for(int i = 1; i < argc; i++)
+	{
+		if(str_comp(argv[i], "-n") == 0 && i+1 < argc)
+			NumServers = clamp(str_toint(argv[++i]), 1, (int)CServerRegistry::MAX_SERVERS);
+		else if(str_comp(argv[i], "-b") == 0 && i+1 < argc)
+			NumHeartbeats = maximum(1, str_toint(argv[++i]));
+		else
+		{
+			dbg_msg("mastersrv_bench", "usage: %s [-n servers] [-b heartbeats]", argv[0]);
+			return -1;
+		}
+	}
+
+	std::vector<NETADDR> vAddrs(NumServers);
+	std::vector<ServerType> vTypes(NumServers);
+	CAddrMap Known;
+	for(int i = 0; i < NumServers; i++)
+	{
+		vTypes[i] = Random() % 8 == 0 ? SERVERTYPE_LEGACY : SERVERTYPE_NORMAL;
+		RandomAddr(&vAddrs[i], vTypes[i] == SERVERTYPE_NORMAL && Random() % 4 == 0);
+		Known.Set(&vAddrs[i], i);
+	}
+
+	CServerRegistry Registry;
+	CCheckRegistry CheckRegistry;
+
+	// every server goes through the check first
+	int64 Start = time_get_impl();
+	for(int i = 0; i < NumServers; i++)
+		CheckRegistry.Add(&vAddrs[i], &vAddrs[i], vTypes[i]);
+	for(int i = 0; i < NumServers; i++)
+	{
+		int Index = CheckRegistry.Find(&vAddrs[i]);
+		if(Index >= 0)
+		{
+			ServerType Type = CheckRegistry.Get(Index)->m_Type;
+			CheckRegistry.Remove(Index);
+			Registry.Add(&vAddrs[i], Type, i);
+		}
+	}
+	double Time = Seconds(Start);
+	dbg_msg("mastersrv_bench", "registered %d servers in %.3f s, %.0f servers/s", Registry.NumServers(), Time, NumServers / Time);
+
+	// heartbeats of known servers push their expiry
+	Start = time_get_impl();
+	for(int i = 0; i < NumHeartbeats; i++)
+	{
+		int Index = Random() % NumServers;
+		Registry.Add(&vAddrs[Index], vTypes[Index], NumServers + i);
+	}
+	Time = Seconds(Start);
+	dbg_msg("mastersrv_bench", "%d heartbeats in %.3f s, %.0f heartbeats/s", NumHeartbeats, Time, NumHeartbeats / Time);
+
+	// list requests only collect the prebuilt packets
+	int NumRequests = 10000;
+	int64 Bytes = 0;
+	Start = time_get_impl();
+	for(int r = 0; r < NumRequests; r++)
+	{
+		for(int i = 0; i < Registry.NumPackets(SERVERTYPE_NORMAL); i++)
+		{
+			int Size;
+			Registry.GetPacket(SERVERTYPE_NORMAL, i, &Size);
+			Bytes += Size;
+		}
+	}
+	Time = Seconds(Start);
+	dbg_msg("mastersrv_bench", "%d list requests in %.3f s, %.0f requests/s, %lld bytes", NumRequests, Time, NumRequests / Time, (long long)Bytes);
+
+	if(!CheckListed(&Registry, &Known))
+		return 1;
+
+	// expire about half of the servers, the time since the last heartbeat
+	// of a server has a median of ln(2) * NumServers heartbeats
+	Start = time_get_impl();
+	int NumExpired = Registry.Purge(NumServers + NumHeartbeats - (int64)NumServers * 7 / 10, 0, 0);
+	Time = Seconds(Start);
+	dbg_msg("mastersrv_bench", "expired %d servers in %.3f s, %d left", NumExpired, Time, Registry.NumServers());
+
+	if(!CheckListed(&Registry, &Known))
+		return 1;
+	return 0;
+}
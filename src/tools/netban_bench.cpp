@@ -0,0 +1,134 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/console.h>
+#include <engine/shared/config.h>
+#include <engine/shared/netban.h>
+
+#include <cstdlib>
+#include <vector>
+
+/*
+	netban_bench fills a CNetBan with random address and range bans and
+	measures how many lookups per second it answers, so changes to the
+	ban index can be compared between builds.
+*/
+
+static unsigned s_Random = 1;
+
+static unsigned Random()
+{
+	s_Random ^= s_Random << 13;
+	s_Random ^= s_Random >> 17;
+	s_Random ^= s_Random << 5;
+	return s_Random;
+}
+
+static void RandomAddr(NETADDR *pAddr, bool IPv6)
+{
+	mem_zero(pAddr, sizeof(*pAddr));
+	pAddr->type = IPv6 ? NETTYPE_IPV6 : NETTYPE_IPV4;
+	for(int i = 0; i < (IPv6 ? 16 : 4); i++)
+		pAddr->ip[i] = Random();
+	// keep clear of localhost, it can't be banned
+	pAddr->ip[0] |= 0x10;
+}
+
+class CBenchBan : public CNetBan
+{
+public:
+	void AddRange(const NETADDR *pAddr, int HostBits)
+	{
+		CNetRange Range;
+		Range.m_LB = *pAddr;
+		Range.m_UB = *pAddr;
+		int Bytes = pAddr->type == NETTYPE_IPV4 ? 4 : 16;
+		for(int i = 0; i < HostBits; i++)
+		{
+			Range.m_LB.ip[Bytes-1-i/8] &= ~(1<<(i%8));
+			Range.m_UB.ip[Bytes-1-i/8] |= 1<<(i%8);
+		}
+		// make most ranges unaligned
+		Range.m_LB.ip[Bytes-1] |= Random()&7;
+		if(Range.IsValid())
+			BanRange(&Range, 0, "bench");
+	}
+};
+
+int main(int argc, const char **argv)
+{
+	int NumAddrBans = 10000;
+	int NumRangeBans = 1000;
+	int NumLookups = 5000000;
+	bool IPv6 = false;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(str_comp(argv[i], "-a") == 0 && i+1 < argc)
+			NumAddrBans = str_toint(argv[++i]);
+		else if(str_comp(argv[i], "-r") == 0 && i+1 < argc)
+			NumRangeBans = str_toint(argv[++i]);
+		else if(str_comp(argv[i], "-l") == 0 && i+1 < argc)
+			NumLookups = str_toint(argv[++i]);
+		else if(str_comp(argv[i], "-s") == 0 && i+1 < argc)
+			s_Random = maximum(1, str_toint(argv[++i]));
+		else if(str_comp(argv[i], "-6") == 0)
+			IPv6 = true;
+		else
+		{
+			dbg_logger_stdout();
+			dbg_msg("netban_bench", "usage: %s [-a addr_bans] [-r range_bans] [-l lookups] [-s seed] [-6]", argv[0]);
+			return -1;
+		}
+	}
+
+	IConsole *pConsole = CreateConsole(CFGFLAG_SERVER);
+	CBenchBan Bans;
+	Bans.Init(pConsole, 0);
+
+	// ban some of the addresses that are looked up later
+	std::vector<NETADDR> vLookups(4096);
+	for(unsigned i = 0; i < vLookups.size(); i++)
+		RandomAddr(&vLookups[i], IPv6);
+
+	int64 Start = time_get_impl();
+	for(int i = 0; i < NumAddrBans; i++)
+	{
+		NETADDR Addr;
+		if(i % 8 == 0)
+			Addr = vLookups[Random()%vLookups.size()];
+		else
+			RandomAddr(&Addr, IPv6);
+		Bans.BanAddr(&Addr, 0, "bench");
+	}
+	for(int i = 0; i < NumRangeBans; i++)
+	{
+		NETADDR Addr;
+		RandomAddr(&Addr, IPv6);
+		Bans.AddRange(&Addr, 4 + Random()%12);
+	}
+	double InsertTime = (time_get_impl()-Start) / (double)time_freq();
+
+	// the ban messages are only logged from here on
+	dbg_logger_stdout();
+	dbg_msg("netban_bench", "inserted %d bans in %.3f s", Bans.NumBans(), InsertTime);
+
+	int Hits = 0;
+	Start = time_get_impl();
+	for(int i = 0; i < NumLookups; i++)
+	{
+		if(Bans.FindBan(&vLookups[i&(vLookups.size()-1)]) != -1)
+			Hits++;
+	}
+	double LookupTime = (time_get_impl()-Start) / (double)time_freq();
+	dbg_msg("netban_bench", "%d lookups in %.3f s, %.0f lookups/s, %d hits", NumLookups, LookupTime, NumLookups / LookupTime, Hits);
+
+	Start = time_get_impl();
+	Bans.UnbanByIndex(0);
+	dbg_msg("netban_bench", "unban with index rebuild in %.3f ms", (time_get_impl()-Start) * 1000.0 / time_freq());
+
+	delete pConsole;
+	return 0;
+}
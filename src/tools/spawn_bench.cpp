@@ -0,0 +1,181 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/storage.h>
+
+#include <game/collision.h>
+#include <game/gamecore.h>
+#include <game/layers.h>
+#include <game/mapitems.h>
+
+#include <string>
+#include <vector>
+
+/*
+	spawn_bench loads maps and tests the positions the spawn searches look
+	at around every spawn point: the spawn point itself, the witch spawn
+	circle and a scientist portal ray. It checks that the clearance field
+	gives the same answers as the probes and reports the time of both.
+	Without arguments it runs over all maps in the maps directory.
+*/
+
+static const int s_aZoneValues[] = {0, ZONE_TELE_NOWITCH, ZONE_TELE_NOSCIENTIST};
+static const int NUM_ZONE_VALUES = sizeof(s_aZoneValues) / sizeof(s_aZoneValues[0]);
+
+static int ListMapCallback(const char *pName, int IsDir, int DirType, void *pUser)
+{
+	std::vector<std::string> *pvMaps = (std::vector<std::string> *)pUser;
+	int Length = str_length(pName);
+	if(!IsDir && Length > 4 && str_comp(pName + Length - 4, ".map") == 0)
+		pvMaps->push_back(std::string(pName, Length - 4));
+	return 0;
+}
+
+static void GetSpawnPoints(CLayers *pLayers, std::vector<vec2> *pvSpawnPoints)
+{
+	const CMapItemGroup *pGroup = pLayers->EntityGroup();
+	if(!pGroup)
+		return;
+
+	char aLayerName[12];
+	for(int l = 0; l < pGroup->m_NumLayers; l++)
+	{
+		CMapItemLayer *pLayer = pLayers->GetLayer(pGroup->m_StartLayer + l);
+		if(pLayer->m_Type != LAYERTYPE_QUADS)
+			continue;
+		CMapItemLayerQuads *pQLayer = (CMapItemLayerQuads *)pLayer;
+		IntsToStr(pQLayer->m_aName, sizeof(aLayerName) / sizeof(int), aLayerName);
+		if(str_comp(aLayerName, "icInfected") != 0 && str_comp(aLayerName, "icHuman") != 0)
+			continue;
+
+		const CQuad *pQuads = (const CQuad *)pLayers->Map()->GetDataSwapped(pQLayer->m_Data);
+		for(int q = 0; q < pQLayer->m_NumQuads; q++)
+		{
+			vec2 Pos(0.0f, 0.0f);
+			for(int p = 0; p < 4; p++)
+				Pos += vec2(fx2f(pQuads[q].m_aPoints[p].x), fx2f(pQuads[q].m_aPoints[p].y));
+			pvSpawnPoints->push_back(Pos / 4.0f);
+		}
+	}
+}
+
+static void GetPositions(const std::vector<vec2> &vSpawnPoints, std::vector<vec2> *pvPositions)
+{
+	for(unsigned i = 0; i < vSpawnPoints.size(); i++)
+	{
+		vec2 Spawn = vSpawnPoints[i];
+		pvPositions->push_back(Spawn);
+
+		// like CInfClassInfected::FindWitchSpawnPosition
+		for(int a = 0; a < 64; a++)
+		{
+			float Angle = a * (pi / 32.0f);
+			pvPositions->push_back(Spawn + vec2(cos(Angle), sin(Angle)) * 84.0f);
+		}
+
+		// like CInfClassHuman::FindPortalPosition
+		float Angle = i * 0.7f;
+		for(float Distance = 500.0f; Distance > 0.0f; Distance -= 4.0f)
+			pvPositions->push_back(Spawn + vec2(cos(Angle), sin(Angle)) * Distance);
+	}
+}
+
+int main(int argc, const char **argv)
+{
+	dbg_logger_stdout();
+
+	IKernel *pKernel = IKernel::Create();
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_BASIC, 1, argv);
+	IEngineMap *pEngineMap = CreateEngineMap();
+	if(!pStorage || !pKernel->RegisterInterface(pStorage) || !pKernel->RegisterInterface(static_cast<IEngineMap *>(pEngineMap)) ||
+		!pKernel->RegisterInterface(static_cast<IMap *>(pEngineMap)))
+		return -1;
+
+	std::vector<std::string> vMaps;
+	for(int i = 1; i < argc; i++)
+		vMaps.push_back(argv[i]);
+	if(vMaps.empty())
+		pStorage->ListDirectory(IStorage::TYPE_ALL, "maps", ListMapCallback, &vMaps);
+
+	int64 TotalQueries = 0;
+	double TotalProbeTime = 0.0;
+	double TotalFieldTime = 0.0;
+	for(unsigned m = 0; m < vMaps.size(); m++)
+	{
+		char aFilename[IO_MAX_PATH_LENGTH];
+		str_format(aFilename, sizeof(aFilename), "maps/%s.map", vMaps[m].c_str());
+		if(!pEngineMap->Load(aFilename))
+		{
+			dbg_msg("spawn_bench", "failed to load '%s'", aFilename);
+			return -1;
+		}
+
+		CLayers Layers;
+		Layers.Init(pKernel);
+		CCollision Collision;
+		Collision.Init(&Layers);
+		int ZoneHandle = Collision.GetZoneHandle("icTele");
+
+		int64 Start = time_get_impl();
+		Collision.InitClearance(ZoneHandle);
+		double InitTime = (time_get_impl() - Start) / (double)time_freq();
+
+		std::vector<vec2> vSpawnPoints;
+		std::vector<vec2> vPositions;
+		GetSpawnPoints(&Layers, &vSpawnPoints);
+		GetPositions(vSpawnPoints, &vPositions);
+
+		std::vector<bool> vProbed;
+		Start = time_get_impl();
+		for(int z = 0; z < NUM_ZONE_VALUES; z++)
+		{
+			for(unsigned i = 0; i < vPositions.size(); i++)
+				vProbed.push_back(Collision.ProbeClearance(vPositions[i], s_aZoneValues[z], true, true));
+		}
+		double ProbeTime = (time_get_impl() - Start) / (double)time_freq();
+
+		std::vector<bool> vCleared;
+		Start = time_get_impl();
+		for(int z = 0; z < NUM_ZONE_VALUES; z++)
+		{
+			for(unsigned i = 0; i < vPositions.size(); i++)
+				vCleared.push_back(Collision.IsClear(vPositions[i], s_aZoneValues[z]));
+		}
+		double FieldTime = (time_get_impl() - Start) / (double)time_freq();
+
+		int NumClear = 0;
+		for(unsigned i = 0; i < vProbed.size(); i++)
+		{
+			if(vProbed[i] != vCleared[i])
+			{
+				vec2 Pos = vPositions[i % vPositions.size()];
+				dbg_msg("spawn_bench", "error: %s differs at %f %f, zone %d", aFilename, Pos.x, Pos.y, s_aZoneValues[i / vPositions.size()]);
+				return 1;
+			}
+			NumClear += vProbed[i];
+		}
+
+		dbg_msg("spawn_bench", "%-28s %3d spawns, %6d queries, %5.1f%% clear, probes %7.3f ms, field %7.3f ms, init %6.3f ms",
+			vMaps[m].c_str(), (int)vSpawnPoints.size(), (int)vProbed.size(), vProbed.empty() ? 0.0 : NumClear * 100.0 / vProbed.size(),
+			ProbeTime * 1000.0, FieldTime * 1000.0, InitTime * 1000.0);
+		TotalQueries += vProbed.size();
+		TotalProbeTime += ProbeTime;
+		TotalFieldTime += FieldTime;
+		pEngineMap->Unload();
+	}
+
+	if(TotalQueries)
+	{
+		dbg_msg("spawn_bench", "%d maps, %lld queries, probes %.0f ns/query, field %.0f ns/query", (int)vMaps.size(), (long long)TotalQueries,
+			TotalProbeTime * 1e9 / TotalQueries, TotalFieldTime * 1e9 / TotalQueries);
+	}
+
+	delete pEngineMap;
+	delete pStorage;
+	delete pKernel;
+	return 0;
+}